@@ -45,9 +45,12 @@
 #include "llcleanup.h"
 #include "lltrace.h"
 #include "llfasttimer.h"
+#include "workqueue.h"
 
 // system libraries
+#include <iomanip>
 #include <iostream>
+#include <thread>
 
 // doc string provided when invoking the program with --help
 static const char USAGE[] = "\n"
@@ -99,6 +102,13 @@ static const char USAGE[] = "\n"
 "        Results in <metric>_report.csv\n"
 " -s, --image-stats\n"
 "        Output stats for each input and output image.\n"
+" -k, --kernels <n>\n"
+"        Time the scaling, mip and compositing kernels on 1, 3 and 4 channel images from\n"
+"        64x64 to 2048x2048, scalar and SIMD, averaged over <n> runs, then exit.\n"
+" -e, --encode <n>\n"
+"        Time lossy j2c encodes of 3 and 4 channel images from 512x512 to 2048x2048\n"
+"        on 1 thread and as tiles on <n> threads, check that both decode and compare\n"
+"        their quality, then exit. Default is the number of cores.\n"
 "\n";
 
 // true when all image loading is done. Used by metric logging thread to know when to stop the thread.
@@ -343,6 +353,210 @@ public:
     }
 };
 
+// Fill an image with noise, alpha included
+LLPointer<LLImageRaw> make_noise_image(S32 width, S32 height, S8 components)
+{
+    LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+    U8* data = image->getData();
+    U32 state = 12345;
+    for (S32 i = 0; i < width * height * components; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        data[i] = U8(state >> 24);
+    }
+    return image;
+}
+
+// Average milliseconds per call of op, with the SIMD kernels on or off
+template <typename OP>
+F64 time_kernel(bool use_simd, int iterations, OP op)
+{
+    LLImage::setUseSIMD(use_simd);
+    LLTimer timer;
+    for (int i = 0; i < iterations; ++i)
+    {
+        op();
+    }
+    return timer.getElapsedTimeF64() * 1000.0 / iterations;
+}
+
+// Time the image kernels that have SIMD versions against their scalar code
+void benchmark_kernels(int iterations)
+{
+    bool had_simd = LLImage::useSIMD();
+    LLImage::setUseSIMD(true);
+    if (!LLImage::useSIMD())
+    {
+        std::cout << "This build has no SIMD image kernels, timing the scalar code only" << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "kernel             comp   size     scalar ms     simd ms   speedup" << std::endl;
+    auto report = [](const char* kernel, S32 components, S32 size, F64 scalar_ms, F64 simd_ms)
+    {
+        std::cout << std::left << std::setw(18) << kernel << std::right
+                  << std::setw(5) << components << std::setw(7) << size
+                  << std::setw(13) << scalar_ms << std::setw(12) << simd_ms
+                  << std::setw(9) << std::setprecision(2) << (simd_ms > 0.0 ? scalar_ms / simd_ms : 0.0)
+                  << std::setprecision(3) << std::endl;
+    };
+
+    const S8 channels[] = { 1, 3, 4 };
+    for (S32 size = 64; size <= 2048; size *= 2)
+    {
+        for (S8 components : channels)
+        {
+            LLPointer<LLImageRaw> src = make_noise_image(size, size, components);
+
+            // odd sizes so no kernel gets an easy power of two
+            LLPointer<LLImageRaw> down = new LLImageRaw(size / 2 - 1, size / 2 - 1, components);
+            auto scale_down = [&]() { down->copyScaled(src); };
+            report("scale down", components, size,
+                   time_kernel(false, iterations, scale_down), time_kernel(true, iterations, scale_down));
+
+            LLPointer<LLImageRaw> half = make_noise_image(size / 2 + 1, size / 2 + 1, components);
+            LLPointer<LLImageRaw> up = new LLImageRaw(size, size, components);
+            auto scale_up = [&]() { up->copyScaled(half); };
+            report("scale up", components, size,
+                   time_kernel(false, iterations, scale_up), time_kernel(true, iterations, scale_up));
+
+            std::vector<U8> mip(size / 2 * size / 2 * components);
+            auto generate_mip = [&]() { LLImageBase::generateMip(src->getData(), mip.data(), size / 2, size / 2, components); };
+            report("mip", components, size,
+                   time_kernel(false, iterations, generate_mip), time_kernel(true, iterations, generate_mip));
+
+            if (components == 4)
+            {
+                LLPointer<LLImageRaw> dst = make_noise_image(size, size, 3);
+                auto composite = [&]() { dst->composite(src); };
+                report("composite", components, size,
+                       time_kernel(false, iterations, composite), time_kernel(true, iterations, composite));
+
+                LLPointer<LLImageRaw> small_dst = make_noise_image(size / 2 - 1, size / 2 - 1, 3);
+                auto composite_scaled = [&]() { small_dst->composite(src); };
+                report("composite scaled", components, size,
+                       time_kernel(false, iterations, composite_scaled), time_kernel(true, iterations, composite_scaled));
+            }
+        }
+    }
+
+    LLImage::setUseSIMD(had_simd);
+}
+
+// Something between a photo and noise: smooth gradients, edges and grain
+LLPointer<LLImageRaw> make_test_image(S32 width, S32 height, S8 components)
+{
+    LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+    U8* data = image->getData();
+    U32 state = 12345;
+    for (S32 y = 0; y < height; ++y)
+    {
+        for (S32 x = 0; x < width; ++x)
+        {
+            state = state * 1664525u + 1013904223u;
+            const S32 grain = S32(state >> 28) - 8;
+            const S32 checker = ((x / 37) + (y / 53)) % 2 ? 48 : 0;
+            for (S32 c = 0; c < components; ++c)
+            {
+                S32 value = (x * (c + 1) * 255 / width + y * 255 / height) / 2 + checker + grain;
+                data[(y * width + x) * components + c] = (U8)llclamp(value, 0, 255);
+            }
+        }
+    }
+    return image;
+}
+
+// Peak signal to noise ratio of b against a, in dB
+F64 psnr(const LLImageRaw* a, const LLImageRaw* b)
+{
+    if (a->getWidth() != b->getWidth() || a->getHeight() != b->getHeight() ||
+        a->getComponents() != b->getComponents())
+    {
+        return 0.0;
+    }
+    F64 error = 0.0;
+    const S32 count = a->getDataSize();
+    for (S32 i = 0; i < count; ++i)
+    {
+        const F64 diff = (F64)a->getData()[i] - (F64)b->getData()[i];
+        error += diff * diff;
+    }
+    error /= count;
+    return error > 0.0 ? 10.0 * log10(255.0 * 255.0 / error) : 99.0;
+}
+
+// Time the j2c encodes of uploads, as one tile and as tiles encoded in parallel
+static bool time_encodes(LL::WorkQueue& queue, S32 threads)
+{
+    const S32 iterations = 3;
+
+    const S8 channels[] = { 3, 4 };
+    for (S32 size = 512; size <= 2048; size *= 2)
+    {
+        for (S8 components : channels)
+        {
+            LLPointer<LLImageRaw> src = make_test_image(size, size, components);
+            F64 single_seconds = 0.0;
+            for (S32 encode_threads : { 1, threads })
+            {
+                LLPointer<LLImageJ2C> j2c;
+                LLTimer timer;
+                for (S32 i = 0; i < iterations; ++i)
+                {
+                    j2c = new LLImageJ2C;
+                    if (encode_threads > 1)
+                    {
+                        j2c->setEncodeQueue(queue.getWeak());
+                    }
+                    if (!j2c->encode(src, 0.f))
+                    {
+                        std::cout << "Failed to encode " << size << "x" << size << " on " << encode_threads << " threads" << std::endl;
+                        return false;
+                    }
+                }
+                const F64 seconds = timer.getElapsedTimeF64() / iterations;
+                if (encode_threads == 1)
+                {
+                    single_seconds = seconds;
+                }
+
+                LLPointer<LLImageRaw> decoded = new LLImageRaw;
+                j2c->setDiscardLevel(0);
+                F64 quality = j2c->decode(decoded, 0.f) ? psnr(src, decoded) : 0.0;
+
+                std::cout << std::setw(4) << components << std::setw(7) << size << std::setw(9) << encode_threads
+                          << std::setw(9) << (size * size / 1000000.0 / seconds) << std::setw(10) << j2c->getDataSize()
+                          << std::setw(10) << quality << std::setw(9) << (seconds > 0.0 ? single_seconds / seconds : 0.0)
+                          << std::endl;
+            }
+        }
+    }
+    return true;
+}
+
+void benchmark_encode(S32 threads)
+{
+    std::cout << "Encoding on 1 and " << threads << " threads, rate 1:" << (S32)(1.f / DEFAULT_COMPRESSION_RATE) << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "comp   size  threads     MP/s     bytes   psnr dB  speedup" << std::endl;
+
+    // the encoding thread takes tiles as well
+    LL::WorkQueue queue("llimage_libtest encode");
+    std::vector<std::thread> workers;
+    for (S32 i = 1; i < threads; ++i)
+    {
+        workers.emplace_back([&queue]() { queue.runUntilClose(); });
+    }
+
+    time_encodes(queue, threads);
+
+    queue.close();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
 int main(int argc, char** argv)
 {
     // List of input and output files
@@ -359,6 +573,8 @@ int main(int argc, char** argv)
     int levels = 0;
     bool reversible = false;
     std::string filter_name = "";
+    int kernel_iterations = 0;
+    int encode_threads = 0;
 
     // Init whatever is necessary
     ll_init_apr();
@@ -559,6 +775,36 @@ int main(int argc, char** argv)
         {
             image_stats = true;
         }
+        else if (!strcmp(argv[arg], "--kernels") || !strcmp(argv[arg], "-k"))
+        {
+            kernel_iterations = 10;
+            if ((arg + 1) < argc && argv[arg+1][0] != '-')
+            {
+                kernel_iterations = llmax(1, atoi(argv[++arg]));
+            }
+        }
+        else if (!strcmp(argv[arg], "--encode") || !strcmp(argv[arg], "-e"))
+        {
+            encode_threads = llmax(2, (int)std::thread::hardware_concurrency());
+            if ((arg + 1) < argc && argv[arg+1][0] != '-')
+            {
+                encode_threads = llmax(2, atoi(argv[++arg]));
+            }
+        }
+    }
+
+    if (kernel_iterations > 0)
+    {
+        benchmark_kernels(kernel_iterations);
+        SUBSYSTEM_CLEANUP(LLImage);
+        return 0;
+    }
+
+    if (encode_threads > 0)
+    {
+        benchmark_encode(encode_threads);
+        SUBSYSTEM_CLEANUP(LLImage);
+        return 0;
     }
 
     // Check arguments consistency. Exit with proper message if inconsistent.
@@ -0,0 +1,682 @@
+/**
+ * @file llimagereplay.cpp
+ * @brief Replays the texture requests of a recorded viewer session through
+ *        LLDiskCache and LLImageDecodeThread and reports timing.
+ *
+ * This is not a replay of the viewer's texture pipeline: LLTextureCache,
+ * LLTextureFetch and the HTTP texture service are not involved. Requests
+ * are read from the disk cache, or from <id>.j2c files standing in for
+ * the network, and decoded. Use it to compare builds of the llfilesystem
+ * and llimage libraries, not of the fetch state machine.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "llpointer.h"
+#include "lltimer.h"
+
+#include "llimagereplay.h"
+
+// Linden library includes
+#include "llapr.h"
+#include "llassettype.h"
+#include "llcleanup.h"
+#include "lldir.h"
+#include "lldiskcache.h"
+#include "llfile.h"
+#include "llfilesystem.h"
+#include "llimage.h"
+#include "llimagej2c.h"
+#include "llimageworker.h"
+#include "llsdserialize.h"
+#include "threadpool.h"
+
+// system libraries
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllimagereplay [options]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -r, --replay <file>\n"
+"        Replay log written by the viewer when the TextureFetchReplayLog setting\n"
+"        names a file: one LLSD notation map per line with 't', 'id', 'discard',\n"
+"        'size' and 'priority'.\n"
+" -s, --source <dir>\n"
+"        Directory holding <texture id>.j2c files. Requests the disk cache cannot\n"
+"        satisfy read their byte range from these files.\n"
+" -c, --cache <dir>\n"
+"        Disk cache directory. Default is ./llimagereplay_cache.\n"
+" -p, --passes <n>\n"
+"        Number of times to replay the log. The cache is cleared before the first\n"
+"        pass, so pass 1 runs cold and later passes warm. Default is 2.\n"
+" -j, --concurrency <n>\n"
+"        Maximum requests in flight. Default is 32.\n"
+" -l, --latency <ms>\n"
+"        Delay added to every read from --source. Default is 0.\n"
+" -t, --realtime\n"
+"        Issue requests at their recorded times instead of as fast as possible.\n"
+" -o, --output <file>\n"
+"        Write the results of the last pass to <file> as LLSD.\n"
+" -b, --baseline <file>\n"
+"        Compare the last pass against results saved earlier with --output.\n"
+"\n";
+
+namespace
+{
+// Stages a request goes through, timed separately
+enum EReplayState
+{
+    CACHE_READ = 0,
+    SOURCE_READ,
+    CACHE_WRITE,
+    DECODE,
+    DECODE_NOTIFY,
+    TOTAL,
+    STATE_COUNT
+};
+
+const char* const STATE_NAMES[STATE_COUNT] =
+{
+    "CACHE_READ",
+    "SOURCE_READ",
+    "CACHE_WRITE",
+    "DECODE",
+    "DECODE_NOTIFY",
+    "TOTAL"
+};
+
+F64 now()
+{
+    return LLTimer::getTotalSeconds().value();
+}
+
+struct ReplayRequest
+{
+    F64 mTime = 0.0;
+    LLUUID mID;
+    S32 mDiscard = 0;
+    S32 mSize = 0;
+    F32 mPriority = 0.f;
+};
+
+// Latency samples for one state, in seconds
+class LatencyHistogram
+{
+public:
+    void add(F64 seconds) { mSamples.push_back(seconds); }
+    size_t count() const { return mSamples.size(); }
+
+    F64 percentile(F64 p)
+    {
+        if (mSamples.empty())
+        {
+            return 0.0;
+        }
+        std::sort(mSamples.begin(), mSamples.end());
+        size_t idx = llmin(mSamples.size() - 1, (size_t)(p * (F64)mSamples.size()));
+        return mSamples[idx];
+    }
+
+    F64 mean() const
+    {
+        F64 total = 0.0;
+        for (F64 sample : mSamples)
+        {
+            total += sample;
+        }
+        return mSamples.empty() ? 0.0 : total / (F64)mSamples.size();
+    }
+
+    // One bar per power of two of microseconds
+    void print(std::ostream& os) const
+    {
+        std::map<S32, size_t> buckets;
+        for (F64 sample : mSamples)
+        {
+            F64 usec = llmax(sample * 1000000.0, 1.0);
+            ++buckets[(S32)std::floor(std::log2(usec))];
+        }
+        size_t peak = 0;
+        for (const auto& bucket : buckets)
+        {
+            peak = llmax(peak, bucket.second);
+        }
+        for (const auto& bucket : buckets)
+        {
+            size_t bar = (bucket.second * 50 + peak - 1) / peak;
+            os << "        < " << std::setw(10) << (U64(2) << bucket.first) << " us "
+               << std::setw(7) << bucket.second << " " << std::string(bar, '#') << "\n";
+        }
+    }
+
+    LLSD asLLSD()
+    {
+        LLSD sd;
+        sd["count"] = (LLSD::Integer)count();
+        sd["mean"] = mean();
+        sd["p50"] = percentile(0.5);
+        sd["p90"] = percentile(0.9);
+        sd["p99"] = percentile(0.99);
+        return sd;
+    }
+
+private:
+    std::vector<F64> mSamples;
+};
+
+class Replayer;
+
+// One request moving through the stages
+struct ReplayJob
+{
+    ReplayRequest mRequest;
+    F64 mStart = 0.0;
+    F64 mStateTimes[STATE_COUNT] = {};
+    S32 mBytes = 0;
+    bool mFromCache = false;
+    bool mSuccess = false;
+};
+typedef std::shared_ptr<ReplayJob> job_ptr_t;
+
+class DecodeResponder : public LLImageDecodeThread::Responder
+{
+public:
+    DecodeResponder(Replayer* replayer, const job_ptr_t& job, F64 posted)
+        : mReplayer(replayer), mJob(job), mPosted(posted) {}
+
+    void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux,
+                   LLImageBCMips* compressed, U32 request_id) override;
+
+private:
+    Replayer* mReplayer;
+    job_ptr_t mJob;
+    F64 mPosted;
+};
+
+class Replayer
+{
+public:
+    Replayer(const std::string& source_dir, S32 concurrency, F64 latency, bool realtime)
+        : mSourceDir(source_dir),
+          mConcurrency(concurrency),
+          mLatency(latency),
+          mRealtime(realtime),
+          mIOPool("ReplayIO", 4),
+          mDecoder(true)
+    {
+        mIOPool.start();
+    }
+
+    ~Replayer()
+    {
+        mDecoder.shutdown();
+        mIOPool.close();
+    }
+
+    void run(const std::vector<ReplayRequest>& requests);
+    void report(std::ostream& os);
+    LLSD asLLSD();
+
+    // Threads: decode pool
+    void decoded(const job_ptr_t& job, bool success)
+    {
+        std::lock_guard<std::mutex> lock(mDoneMutex);
+        job->mSuccess = success;
+        mDone.push_back(job);
+        mDoneCond.notify_one();
+    }
+
+private:
+    // Threads: IO pool
+    void load(const job_ptr_t& job);
+    bool readSource(const job_ptr_t& job, std::vector<U8>& buffer);
+    void finish(const job_ptr_t& job);
+
+    std::string mSourceDir;
+    S32 mConcurrency;
+    F64 mLatency;
+    bool mRealtime;
+    LL::ThreadPool mIOPool;
+    LLImageDecodeThread mDecoder;
+
+    std::mutex mDoneMutex;
+    std::condition_variable mDoneCond;
+    std::deque<job_ptr_t> mDone;
+
+    // Tmain only
+    LatencyHistogram mStates[STATE_COUNT];
+    LatencyHistogram mTimeToFirstDiscard;
+    std::map<LLUUID, F64> mFirstRequest;
+    F64 mElapsed = 0.0;
+    size_t mDecodedCount = 0;
+    size_t mFailedCount = 0;
+    size_t mCacheHits = 0;
+    U64 mBytes = 0;
+};
+
+void DecodeResponder::completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux,
+                                LLImageBCMips* compressed, U32 request_id)
+{
+    mJob->mStateTimes[DECODE] = now() - mPosted;
+    mJob->mStateTimes[DECODE_NOTIFY] = now();
+    mReplayer->decoded(mJob, success && raw);
+}
+
+bool Replayer::readSource(const job_ptr_t& job, std::vector<U8>& buffer)
+{
+    std::string filename = gDirUtilp->add(mSourceDir, job->mRequest.mID.asString() + ".j2c");
+    llifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    S32 file_size = (S32)file.tellg();
+    file.seekg(0, std::ios::beg);
+    S32 bytes = (job->mRequest.mSize > 0) ? llmin(job->mRequest.mSize, file_size) : file_size;
+    buffer.resize(bytes);
+    file.read((char*)buffer.data(), bytes);
+    return file.gcount() == bytes;
+}
+
+void Replayer::load(const job_ptr_t& job)
+{
+    const LLUUID& id = job->mRequest.mID;
+    std::vector<U8> buffer;
+
+    // CACHE_READ
+    F64 start = now();
+    {
+        LLFileSystem file(id, LLAssetType::AT_TEXTURE);
+        S32 cached = file.getSize();
+        if (cached > 0 && (job->mRequest.mSize <= 0 || cached >= job->mRequest.mSize))
+        {
+            S32 bytes = (job->mRequest.mSize > 0) ? job->mRequest.mSize : cached;
+            buffer.resize(bytes);
+            job->mFromCache = file.read(buffer.data(), bytes);
+        }
+    }
+    job->mStateTimes[CACHE_READ] = now() - start;
+
+    if (!job->mFromCache)
+    {
+        // SOURCE_READ
+        start = now();
+        if (mLatency > 0.0)
+        {
+            ms_sleep((U32)(mLatency * 1000.0));
+        }
+        bool fetched = readSource(job, buffer);
+        job->mStateTimes[SOURCE_READ] = now() - start;
+        if (!fetched)
+        {
+            decoded(job, false);
+            return;
+        }
+
+        // CACHE_WRITE
+        start = now();
+        LLFileSystem file(id, LLAssetType::AT_TEXTURE, LLFileSystem::WRITE);
+        file.write(buffer.data(), (S32)buffer.size());
+        job->mStateTimes[CACHE_WRITE] = now() - start;
+    }
+
+    job->mBytes = (S32)buffer.size();
+    LLPointer<LLImageJ2C> image = new LLImageJ2C;
+    U8* data = image->allocateData(job->mBytes);
+    if (!data)
+    {
+        decoded(job, false);
+        return;
+    }
+    memcpy(data, buffer.data(), job->mBytes);
+
+    // DECODE
+    F64 posted = now();
+    if (!mDecoder.decodeImage(image.get(), job->mRequest.mDiscard, false,
+                              new DecodeResponder(this, job, posted), job->mRequest.mPriority))
+    {
+        decoded(job, false);
+    }
+}
+
+void Replayer::finish(const job_ptr_t& job)
+{
+    F64 finished = now();
+    if (job->mStateTimes[DECODE_NOTIFY] > 0.0)
+    {
+        // completion time was stamped on the decode thread, turn it into
+        // the delay until the main thread noticed
+        job->mStateTimes[DECODE_NOTIFY] = finished - job->mStateTimes[DECODE_NOTIFY];
+    }
+    job->mStateTimes[TOTAL] = finished - job->mStart;
+
+    if (!job->mSuccess)
+    {
+        ++mFailedCount;
+        return;
+    }
+
+    ++mDecodedCount;
+    mBytes += job->mBytes;
+    if (job->mFromCache)
+    {
+        ++mCacheHits;
+    }
+    for (S32 state = 0; state < STATE_COUNT; ++state)
+    {
+        if ((state != SOURCE_READ && state != CACHE_WRITE) || !job->mFromCache)
+        {
+            mStates[state].add(job->mStateTimes[state]);
+        }
+    }
+
+    auto first = mFirstRequest.find(job->mRequest.mID);
+    if (first != mFirstRequest.end())
+    {
+        mTimeToFirstDiscard.add(finished - first->second);
+        mFirstRequest.erase(first);
+    }
+}
+
+void Replayer::run(const std::vector<ReplayRequest>& requests)
+{
+    std::set<LLUUID> seen;
+    size_t next = 0;
+    size_t in_flight = 0;
+    F64 begin = now();
+
+    while (next < requests.size() || in_flight > 0)
+    {
+        // Issue whatever the concurrency limit and the clock allow
+        while (next < requests.size() && in_flight < (size_t)mConcurrency
+               && (!mRealtime || now() - begin >= requests[next].mTime))
+        {
+            job_ptr_t job = std::make_shared<ReplayJob>();
+            job->mRequest = requests[next++];
+            job->mStart = now();
+            if (seen.insert(job->mRequest.mID).second)
+            {
+                mFirstRequest[job->mRequest.mID] = job->mStart;
+            }
+            ++in_flight;
+            mIOPool.getQueue().post([this, job]() { load(job); });
+        }
+
+        std::unique_lock<std::mutex> lock(mDoneMutex);
+        mDoneCond.wait_for(lock, std::chrono::milliseconds(mRealtime ? 1 : 100),
+                           [this]() { return !mDone.empty(); });
+        std::deque<job_ptr_t> done;
+        done.swap(mDone);
+        lock.unlock();
+
+        for (const job_ptr_t& job : done)
+        {
+            finish(job);
+            --in_flight;
+        }
+    }
+
+    mElapsed = now() - begin;
+}
+
+void Replayer::report(std::ostream& os)
+{
+    os << std::fixed << std::setprecision(3);
+    os << "    decoded " << mDecodedCount << " requests (" << mFailedCount << " failed, "
+       << mCacheHits << " from cache) in " << mElapsed << " s\n";
+    if (mElapsed > 0.0)
+    {
+        os << "    throughput " << (F64)mDecodedCount / mElapsed << " textures/s, "
+           << (F64)mBytes / (1024.0 * 1024.0) / mElapsed << " MB/s of J2C\n";
+    }
+    os << "    time to first discard: p50 " << mTimeToFirstDiscard.percentile(0.5) * 1000.0
+       << " ms, p90 " << mTimeToFirstDiscard.percentile(0.9) * 1000.0
+       << " ms, p99 " << mTimeToFirstDiscard.percentile(0.99) * 1000.0 << " ms\n";
+    for (S32 state = 0; state < STATE_COUNT; ++state)
+    {
+        LatencyHistogram& hist = mStates[state];
+        if (!hist.count())
+        {
+            continue;
+        }
+        os << "    " << STATE_NAMES[state] << ": n " << hist.count()
+           << ", mean " << hist.mean() * 1000.0 << " ms, p50 " << hist.percentile(0.5) * 1000.0
+           << " ms, p90 " << hist.percentile(0.9) * 1000.0
+           << " ms, p99 " << hist.percentile(0.99) * 1000.0 << " ms\n";
+        hist.print(os);
+    }
+}
+
+LLSD Replayer::asLLSD()
+{
+    LLSD sd;
+    sd["elapsed"] = mElapsed;
+    sd["decoded"] = (LLSD::Integer)mDecodedCount;
+    sd["failed"] = (LLSD::Integer)mFailedCount;
+    sd["cache_hits"] = (LLSD::Integer)mCacheHits;
+    sd["textures_per_sec"] = mElapsed > 0.0 ? (F64)mDecodedCount / mElapsed : 0.0;
+    sd["bytes_per_sec"] = mElapsed > 0.0 ? (F64)mBytes / mElapsed : 0.0;
+    sd["time_to_first_discard"] = mTimeToFirstDiscard.asLLSD();
+    for (S32 state = 0; state < STATE_COUNT; ++state)
+    {
+        sd["states"][STATE_NAMES[state]] = mStates[state].asLLSD();
+    }
+    return sd;
+}
+
+bool load_replay(const std::string& filename, std::vector<ReplayRequest>& requests)
+{
+    llifstream file(filename.c_str());
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        LLSD sd;
+        std::istringstream str(line);
+        if (LLSDSerialize::fromNotation(sd, str, line.size()) <= 0 || !sd.has("id"))
+        {
+            continue;
+        }
+        ReplayRequest request;
+        request.mTime = sd["t"].asReal();
+        request.mID = sd["id"].asUUID();
+        request.mDiscard = sd["discard"].asInteger();
+        request.mSize = sd["size"].asInteger();
+        request.mPriority = (F32)sd["priority"].asReal();
+        requests.push_back(request);
+    }
+    return true;
+}
+
+void compare(const LLSD& baseline, const LLSD& current)
+{
+    auto line = [](const std::string& name, F64 before, F64 after)
+    {
+        F64 change = (before != 0.0) ? (after - before) / before * 100.0 : 0.0;
+        std::cout << "    " << std::left << std::setw(36) << name << std::right
+                  << std::setw(12) << before << std::setw(12) << after
+                  << std::setw(9) << change << " %" << std::endl;
+    };
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Comparison with baseline (before, after, change):" << std::endl;
+    line("textures/s", baseline["textures_per_sec"].asReal(), current["textures_per_sec"].asReal());
+    line("time to first discard p50 (ms)", baseline["time_to_first_discard"]["p50"].asReal() * 1000.0,
+         current["time_to_first_discard"]["p50"].asReal() * 1000.0);
+    line("time to first discard p90 (ms)", baseline["time_to_first_discard"]["p90"].asReal() * 1000.0,
+         current["time_to_first_discard"]["p90"].asReal() * 1000.0);
+    for (S32 state = 0; state < STATE_COUNT; ++state)
+    {
+        line(std::string(STATE_NAMES[state]) + " p50 (ms)",
+             baseline["states"][STATE_NAMES[state]]["p50"].asReal() * 1000.0,
+             current["states"][STATE_NAMES[state]]["p50"].asReal() * 1000.0);
+    }
+}
+
+// Returns the value following option arg, or empty if there is none
+std::string option_value(int argc, char** argv, int& arg)
+{
+    if ((arg + 1) < argc && argv[arg + 1][0] != '-')
+    {
+        return argv[++arg];
+    }
+    std::cout << "Missing value for " << argv[arg] << std::endl;
+    return std::string();
+}
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    std::string replay_name;
+    std::string source_dir;
+    std::string cache_dir = "llimagereplay_cache";
+    std::string output_name;
+    std::string baseline_name;
+    S32 passes = 2;
+    S32 concurrency = 32;
+    F64 latency = 0.0;
+    bool realtime = false;
+
+    // Analyze command line arguments
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if (!strcmp(argv[arg], "--replay") || !strcmp(argv[arg], "-r"))
+        {
+            replay_name = option_value(argc, argv, arg);
+        }
+        else if (!strcmp(argv[arg], "--source") || !strcmp(argv[arg], "-s"))
+        {
+            source_dir = option_value(argc, argv, arg);
+        }
+        else if (!strcmp(argv[arg], "--cache") || !strcmp(argv[arg], "-c"))
+        {
+            cache_dir = option_value(argc, argv, arg);
+        }
+        else if (!strcmp(argv[arg], "--passes") || !strcmp(argv[arg], "-p"))
+        {
+            passes = llmax(1, atoi(option_value(argc, argv, arg).c_str()));
+        }
+        else if (!strcmp(argv[arg], "--concurrency") || !strcmp(argv[arg], "-j"))
+        {
+            concurrency = llmax(1, atoi(option_value(argc, argv, arg).c_str()));
+        }
+        else if (!strcmp(argv[arg], "--latency") || !strcmp(argv[arg], "-l"))
+        {
+            latency = atof(option_value(argc, argv, arg).c_str()) / 1000.0;
+        }
+        else if (!strcmp(argv[arg], "--realtime") || !strcmp(argv[arg], "-t"))
+        {
+            realtime = true;
+        }
+        else if (!strcmp(argv[arg], "--output") || !strcmp(argv[arg], "-o"))
+        {
+            output_name = option_value(argc, argv, arg);
+        }
+        else if (!strcmp(argv[arg], "--baseline") || !strcmp(argv[arg], "-b"))
+        {
+            baseline_name = option_value(argc, argv, arg);
+        }
+    }
+
+    // Check arguments consistency. Exit with proper message if inconsistent.
+    if (replay_name.empty() || source_dir.empty())
+    {
+        std::cout << "Both --replay and --source are required -> exit" << std::endl;
+        return 1;
+    }
+
+    std::vector<ReplayRequest> requests;
+    if (!load_replay(replay_name, requests) || requests.empty())
+    {
+        std::cout << "No requests could be read from " << replay_name << " -> exit" << std::endl;
+        return 1;
+    }
+
+    // Init whatever is necessary
+    ll_init_apr();
+    LLImage::initClass();
+    LLDiskCache::initParamSingleton(cache_dir, (uintmax_t)4 * 1024 * 1024 * 1024, false, false);
+    LLDiskCache::getInstance()->clearCache();
+
+    std::cout << "Replaying " << requests.size() << " requests from " << replay_name << std::endl;
+
+    LLSD results;
+    for (S32 pass = 1; pass <= passes; ++pass)
+    {
+        Replayer replayer(source_dir, concurrency, latency, realtime);
+        replayer.run(requests);
+        std::cout << "Pass " << pass << (pass == 1 ? " (cold cache)" : " (warm cache)") << ":" << std::endl;
+        replayer.report(std::cout);
+        results = replayer.asLLSD();
+    }
+
+    if (!baseline_name.empty())
+    {
+        LLSD baseline;
+        llifstream file(baseline_name.c_str());
+        if (file.is_open() && LLSDSerialize::fromXML(baseline, file) > 0)
+        {
+            compare(baseline, results);
+        }
+        else
+        {
+            std::cout << "Could not read baseline " << baseline_name << std::endl;
+        }
+    }
+
+    if (!output_name.empty())
+    {
+        llofstream file(output_name.c_str());
+        LLSDSerialize::toPrettyXML(results, file);
+    }
+
+    // Cleanup and exit
+    LLDiskCache::deleteSingleton();
+    SUBSYSTEM_CLEANUP(LLImage);
+    return 0;
+}
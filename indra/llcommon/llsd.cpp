@@ -166,7 +166,7 @@ public:
     virtual const LLSD& ref(size_t) const       { return undef(); }
 
     virtual LLSD::map_const_iterator beginMap() const { return endMap(); }
-    virtual LLSD::map_const_iterator endMap() const { static const std::map<String, LLSD> empty; return empty.end(); }
+    virtual LLSD::map_const_iterator endMap() const { return LLSD::map_const_iterator(); }
     virtual LLSD::array_const_iterator beginArray() const { return endArray(); }
     virtual LLSD::array_const_iterator endArray() const { static const std::vector<LLSD> empty; return empty.end(); }
 
@@ -431,7 +431,7 @@ namespace
     class ImplMap final : public LLSD::Impl
     {
     private:
-        typedef std::map<LLSD::String, LLSD, std::less<>> DataMap;
+        typedef LLSDFlatMap<LLSD> DataMap;
 
         DataMap mData;
 
@@ -468,6 +468,8 @@ namespace
         virtual LLSD get(std::string_view) const;
         virtual LLSD getKeys() const;
         void insert(std::string_view k, const LLSD& v);
+        LLSD& append(std::string_view k, const LLSD& v);
+        void sortAppended();
         virtual void erase(const LLSD::String&);
                       LLSD& ref(std::string_view);
         virtual const LLSD& ref(std::string_view) const;
@@ -531,6 +533,18 @@ namespace
         mData.emplace(k, v);
     }
 
+    LLSD& ImplMap::append(std::string_view k, const LLSD& v)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
+        return mData.append(k, v).second;
+    }
+
+    void ImplMap::sortAppended()
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
+        mData.sortAppended();
+    }
+
     void ImplMap::erase(const LLSD::String& k)
     {
         LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
@@ -540,9 +554,9 @@ namespace
     LLSD& ImplMap::ref(std::string_view k)
     {
         DataMap::iterator i = mData.lower_bound(k);
-        if (i == mData.end() || mData.key_comp()(k, i->first))
+        if (i == mData.end() || i->first != k)
         {
-            return mData.emplace_hint(i, std::make_pair(k, LLSD()))->second;
+            return mData.emplace_hint(i, k, LLSD())->second;
         }
 
         return i->second;
@@ -551,7 +565,7 @@ namespace
     const LLSD& ImplMap::ref(std::string_view k) const
     {
         DataMap::const_iterator i = mData.lower_bound(k);
-        if (i == mData.end() || mData.key_comp()(k, i->first))
+        if (i == mData.end() || i->first != k)
         {
             return undef();
         }
@@ -1046,6 +1060,10 @@ LLSD& LLSD::with(std::string_view k, const LLSD& v)
                                         }
 void LLSD::erase(const String& k)       { makeMap(impl).erase(k); }
 
+LLSD& LLSD::appendToMap(std::string_view k, const LLSD& v)
+                                        { return makeMap(impl).append(k, v); }
+void LLSD::sortMap()                    { makeMap(impl).sortAppended(); }
+
 LLSD& LLSD::operator[](const std::string_view k)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
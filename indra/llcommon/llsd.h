@@ -33,6 +33,7 @@
 
 #include "stdtypes.h"
 
+#include "llsdflatmap.h"
 #include "lldate.h"
 #include "lluri.h"
 #include "lluuid.h"
@@ -325,6 +326,13 @@ public:
         void erase(const String&);
         LLSD& with(std::string_view, const LLSD&);
 
+        // For parsers building large maps: appendToMap() adds an entry in
+        // O(1) whatever its key, but the entry is only visible once
+        // sortMap() has merged it in. As with insert(), the first entry for
+        // a key wins.
+        LLSD& appendToMap(std::string_view, const LLSD&);
+        void sortMap();
+
         LLSD& operator[](const std::string_view);
         LLSD& operator[](const char* c)
         {
@@ -366,8 +374,8 @@ public:
     //@{
         size_t size() const;
 
-        typedef std::map<String, LLSD>::iterator        map_iterator;
-        typedef std::map<String, LLSD>::const_iterator  map_const_iterator;
+        typedef LLSDFlatMap<LLSD>::iterator         map_iterator;
+        typedef LLSDFlatMap<LLSD>::const_iterator   map_const_iterator;
 
         map_iterator        beginMap();
         map_iterator        endMap();
@@ -0,0 +1,466 @@
+/**
+ * @file   llsdflatmap.h
+ * @brief  Compact sorted storage behind LLSD maps.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDFLATMAP_H
+#define LL_LLSDFLATMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "llerror.h"
+
+// Debug builds check that an iterator is not used after its map changed
+#ifdef SHOW_ASSERT
+#define LL_SDFLATMAP_CHECK_ITERATORS 1
+#else
+#define LL_SDFLATMAP_CHECK_ITERATORS 0
+#endif
+
+/**
+ * LLSDFlatMap is the container behind LLSD maps. It keeps the parts of the
+ * std::map interface that LLSD exposes -- entries are
+ * std::pair<const std::string, T>, iteration is in key order, and a
+ * reference to an entry stays valid until that entry is erased -- while
+ * spending far less memory and far fewer allocations on it:
+ *
+ * - Entries are constructed in place in a short chain of chunks. Each new
+ *   chunk grows the total capacity by half and chunks never move, so a map
+ *   of n entries costs O(log n) allocations instead of one tree node apiece.
+ *   Short keys stay inside std::string's own small buffer.
+ * - A sorted vector of entry pointers provides binary search lookup and
+ *   ordered iteration over contiguous memory.
+ * - Erased slots go on a free list and are reused by the next insert.
+ * - Inserting a key that doesn't sort last shifts the index, so building a
+ *   large map in arbitrary key order would be quadratic. Parsers append()
+ *   instead and sort the appended entries in once with sortAppended().
+ *
+ * Unlike std::map, inserting into or erasing from a map invalidates
+ * iterators (though not references) into that same map, and so do
+ * sortAppended(), clear() and swap(). Builds with SHOW_ASSERT check it:
+ * using such an iterator is an LL_ERRS.
+ *
+ * T may still be incomplete where LLSDFlatMap<T> is named, which is what
+ * lets llsd.h declare its map iterators in terms of it.
+ */
+template <typename T>
+class LLSDFlatMap
+{
+public:
+    typedef std::string key_type;
+    typedef T mapped_type;
+    typedef std::pair<const std::string, T> value_type;
+    typedef size_t size_type;
+
+private:
+    typedef value_type* entry_ptr;
+    typedef std::vector<entry_ptr> index_t;
+
+public:
+    template <typename V>
+    class iterator_base
+    {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::remove_const_t<V> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef V* pointer;
+        typedef V& reference;
+
+        iterator_base() = default;
+
+        // iterator converts to const_iterator, but not the reverse
+        template <typename U,
+                  typename std::enable_if<std::is_convertible<U*, V*>::value, bool>::type = true>
+        iterator_base(const iterator_base<U>& other) : mPos(other.mPos)
+#if LL_SDFLATMAP_CHECK_ITERATORS
+            , mOwner(other.mOwner), mVersion(other.mVersion)
+#endif
+        {}
+
+        reference operator*() const  { check(); return **mPos; }
+        pointer   operator->() const { check(); return *mPos; }
+
+        iterator_base& operator++()   { check(); ++mPos; return *this; }
+        iterator_base  operator++(int) { check(); iterator_base prev(*this); ++mPos; return prev; }
+        iterator_base& operator--()   { check(); --mPos; return *this; }
+        iterator_base  operator--(int) { check(); iterator_base prev(*this); --mPos; return prev; }
+
+        friend bool operator==(const iterator_base& lhs, const iterator_base& rhs)
+        {
+            lhs.check();
+            rhs.check();
+            return lhs.mPos == rhs.mPos;
+        }
+        friend bool operator!=(const iterator_base& lhs, const iterator_base& rhs) { return !(lhs == rhs); }
+
+    private:
+        friend class LLSDFlatMap;
+        template <typename U> friend class iterator_base;
+
+        iterator_base(const entry_ptr* pos, const LLSDFlatMap* owner) : mPos(pos)
+#if LL_SDFLATMAP_CHECK_ITERATORS
+            , mOwner(owner), mVersion(owner->mVersion)
+#endif
+        {}
+
+#if LL_SDFLATMAP_CHECK_ITERATORS
+        void check() const
+        {
+            llassert_always_msg(!mOwner || mOwner->mVersion == mVersion,
+                                "LLSDFlatMap iterator used after its map was modified");
+        }
+#else
+        void check() const {}
+#endif
+
+        const entry_ptr* mPos = nullptr;
+#if LL_SDFLATMAP_CHECK_ITERATORS
+        const LLSDFlatMap* mOwner = nullptr;
+        size_t mVersion = 0;
+#endif
+    };
+
+    typedef iterator_base<value_type>       iterator;
+    typedef iterator_base<const value_type> const_iterator;
+
+    LLSDFlatMap() = default;
+
+    LLSDFlatMap(const LLSDFlatMap& other)
+    {
+        // A copy is sized exactly: one chunk, no slack.
+        if (!other.empty() || !other.mAppended.empty())
+        {
+            grow(other.size() + other.mAppended.size());
+            for (const value_type* entry : other.mIndex)
+            {
+                mIndex.push_back(construct(entry->first, entry->second));
+            }
+            mAppended.reserve(other.mAppended.size());
+            for (const value_type* entry : other.mAppended)
+            {
+                mAppended.push_back(construct(entry->first, entry->second));
+            }
+        }
+    }
+
+    LLSDFlatMap(LLSDFlatMap&& other) noexcept
+    {
+        swap(other);
+    }
+
+    LLSDFlatMap& operator=(LLSDFlatMap other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~LLSDFlatMap()
+    {
+        clear();
+        while (mChunks)
+        {
+            Chunk* next = mChunks->mNext;
+            ::operator delete(mChunks);
+            mChunks = next;
+        }
+    }
+
+    void swap(LLSDFlatMap& other) noexcept
+    {
+        modified();
+        other.modified();
+        mIndex.swap(other.mIndex);
+        mAppended.swap(other.mAppended);
+        std::swap(mChunks, other.mChunks);
+        std::swap(mFree, other.mFree);
+        std::swap(mCapacity, other.mCapacity);
+    }
+
+    bool      empty() const { return mIndex.empty(); }
+    size_type size() const  { return mIndex.size(); }
+
+    iterator       begin()       { return iterator(mIndex.data(), this); }
+    iterator       end()         { return iterator(mIndex.data() + mIndex.size(), this); }
+    const_iterator begin() const { return const_iterator(mIndex.data(), this); }
+    const_iterator end() const   { return const_iterator(mIndex.data() + mIndex.size(), this); }
+
+    iterator lower_bound(std::string_view key)
+    {
+        return iterator(mIndex.data() + lowerBound(key), this);
+    }
+
+    const_iterator lower_bound(std::string_view key) const
+    {
+        return const_iterator(mIndex.data() + lowerBound(key), this);
+    }
+
+    iterator find(std::string_view key)
+    {
+        size_t pos = lowerBound(key);
+        return iterator(mIndex.data() + (matches(pos, key) ? pos : mIndex.size()), this);
+    }
+
+    const_iterator find(std::string_view key) const
+    {
+        size_t pos = lowerBound(key);
+        return const_iterator(mIndex.data() + (matches(pos, key) ? pos : mIndex.size()), this);
+    }
+
+    // Like std::map::emplace(): an existing entry for key is left alone.
+    std::pair<iterator, bool> emplace(std::string_view key, const T& value)
+    {
+        size_t pos = lowerBound(key);
+        if (matches(pos, key))
+        {
+            return std::make_pair(iterator(mIndex.data() + pos, this), false);
+        }
+        return std::make_pair(insertAt(pos, key, value), true);
+    }
+
+    // hint must be lower_bound(key), and key must not already be present.
+    iterator emplace_hint(const_iterator hint, std::string_view key, const T& value)
+    {
+        hint.check();
+        return insertAt(hint.mPos - mIndex.data(), key, value);
+    }
+
+    // Adds an entry in O(1) whatever its key, for building a map in bulk.
+    // Appended entries are not visible until sortAppended() merges them in.
+    // References to the value stay valid as usual.
+    value_type& append(std::string_view key, const T& value)
+    {
+        entry_ptr entry = construct(key, value);
+        try
+        {
+            mAppended.push_back(entry);
+        }
+        catch (...)
+        {
+            destroy(entry);
+            throw;
+        }
+        return *entry;
+    }
+
+    // Merges the appended entries in: O(n + m log m) for m appended entries.
+    // Like emplace(), the first entry for a key wins and later ones with the
+    // same key are dropped.
+    void sortAppended()
+    {
+        if (mAppended.empty())
+        {
+            return;
+        }
+
+        modified();
+        auto less = [](const value_type* lhs, const value_type* rhs)
+                    { return std::string_view(lhs->first) < std::string_view(rhs->first); };
+        std::stable_sort(mAppended.begin(), mAppended.end(), less);
+        // mIndex has room for every slot, this doesn't reallocate.
+        size_t sorted = mIndex.size();
+        mIndex.insert(mIndex.end(), mAppended.begin(), mAppended.end());
+        mAppended.clear();
+        std::inplace_merge(mIndex.begin(), mIndex.begin() + sorted, mIndex.end(), less);
+
+        auto out = mIndex.begin();
+        for (entry_ptr entry : mIndex)
+        {
+            if (out != mIndex.begin() && (*(out - 1))->first == entry->first)
+            {
+                destroy(entry);
+            }
+            else
+            {
+                *out++ = entry;
+            }
+        }
+        mIndex.erase(out, mIndex.end());
+    }
+
+    size_type erase(std::string_view key)
+    {
+        size_t pos = lowerBound(key);
+        if (!matches(pos, key))
+        {
+            return 0;
+        }
+        modified();
+        entry_ptr entry = mIndex[pos];
+        mIndex.erase(mIndex.begin() + pos);
+        destroy(entry);
+        return 1;
+    }
+
+    void clear()
+    {
+        modified();
+        for (entry_ptr entry : mIndex)
+        {
+            destroy(entry);
+        }
+        mIndex.clear();
+        for (entry_ptr entry : mAppended)
+        {
+            destroy(entry);
+        }
+        mAppended.clear();
+    }
+
+    /// Bytes held by this map itself: chunks plus index, excluding any
+    /// heap storage owned by the keys and values.
+    size_t memoryUsage() const
+    {
+        size_t bytes = (mIndex.capacity() + mAppended.capacity()) * sizeof(entry_ptr);
+        for (const Chunk* chunk = mChunks; chunk; chunk = chunk->mNext)
+        {
+            bytes += headerSize() + chunk->mCapacity * sizeof(value_type);
+        }
+        return bytes;
+    }
+
+private:
+    struct Chunk
+    {
+        Chunk* mNext;
+        size_t mCapacity;
+        size_t mUsed;
+    };
+
+    static constexpr size_t MIN_CHUNK = 4;
+
+    static constexpr size_t headerSize()
+    {
+        return (sizeof(Chunk) + alignof(value_type) - 1) / alignof(value_type) * alignof(value_type);
+    }
+
+    static entry_ptr slot(Chunk* chunk, size_t i)
+    {
+        return reinterpret_cast<entry_ptr>(reinterpret_cast<char*>(chunk) + headerSize()) + i;
+    }
+
+    size_t lowerBound(std::string_view key) const
+    {
+        return std::lower_bound(mIndex.begin(), mIndex.end(), key,
+                                [](const value_type* entry, std::string_view k)
+                                { return std::string_view(entry->first) < k; })
+            - mIndex.begin();
+    }
+
+    bool matches(size_t pos, std::string_view key) const
+    {
+        return pos < mIndex.size() && std::string_view(mIndex[pos]->first) == key;
+    }
+
+    void grow(size_t capacity)
+    {
+        Chunk* chunk = static_cast<Chunk*>(::operator new(headerSize() + capacity * sizeof(value_type)));
+        chunk->mNext = mChunks;
+        chunk->mCapacity = capacity;
+        chunk->mUsed = 0;
+        mChunks = chunk;
+        mCapacity += capacity;
+        // Keep the index able to hold every slot, so that inserting an
+        // entry pointer never has to reallocate after the entry exists.
+        mIndex.reserve(mCapacity);
+    }
+
+    entry_ptr construct(std::string_view key, const T& value)
+    {
+        entry_ptr entry;
+        if (mFree)
+        {
+            entry = mFree;
+            mFree = *reinterpret_cast<entry_ptr*>(entry);
+        }
+        else
+        {
+            if (!mChunks || mChunks->mUsed == mChunks->mCapacity)
+            {
+                grow(std::max(MIN_CHUNK, mCapacity / 2));
+            }
+            entry = slot(mChunks, mChunks->mUsed++);
+        }
+
+        try
+        {
+            return new (entry) value_type(std::piecewise_construct,
+                                          std::forward_as_tuple(key),
+                                          std::forward_as_tuple(value));
+        }
+        catch (...)
+        {
+            release(entry);
+            throw;
+        }
+    }
+
+    void destroy(entry_ptr entry)
+    {
+        entry->~value_type();
+        release(entry);
+    }
+
+    void release(entry_ptr entry)
+    {
+        static_assert(sizeof(value_type) >= sizeof(entry_ptr), "free list link does not fit in a slot");
+        *reinterpret_cast<entry_ptr*>(entry) = mFree;
+        mFree = entry;
+    }
+
+    iterator insertAt(size_t pos, std::string_view key, const T& value)
+    {
+        entry_ptr entry = construct(key, value);
+        modified();
+        auto it = mIndex.insert(mIndex.begin() + pos, entry);
+        return iterator(&*it, this);
+    }
+
+#if LL_SDFLATMAP_CHECK_ITERATORS
+    void modified() { ++mVersion; }
+#else
+    void modified() {}
+#endif
+
+    index_t mIndex;
+    index_t mAppended;
+    Chunk*  mChunks = nullptr;
+    entry_ptr mFree = nullptr;
+    size_t  mCapacity = 0;
+#if LL_SDFLATMAP_CHECK_ITERATORS
+    // bumped by every change to mIndex, iterators remember it
+    size_t  mVersion = 0;
+#endif
+};
+
+#endif // LL_LLSDFLATMAP_H
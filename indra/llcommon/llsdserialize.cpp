@@ -34,9 +34,6 @@
 #include <iostream>
 #include "apr_base64.h"
 
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/stream.hpp>
-
 #ifdef LL_USESYSTEMLIBS
 # include <zlib.h>
 #else
@@ -56,6 +53,10 @@
 // File constants
 static const size_t MAX_HDR_LEN = 20;
 static const S32 UNZIP_LLSD_MAX_DEPTH = 96;
+// Deflate expands at most 1032:1, and no LLSD block we unzip comes near
+// the ceiling. Bounds the length prefixes of a streamed parse.
+static const llssize UNZIP_LLSD_MAX_RATIO = 1032;
+static const llssize UNZIP_LLSD_MAX_BYTES = 256 * 1024 * 1024;
 static const char LEGACY_NON_HEADER[] = "<llsd>";
 const std::string LLSD_BINARY_HEADER("LLSD/Binary");
 const std::string LLSD_XML_HEADER("LLSD/XML");
@@ -323,6 +324,31 @@ llssize deserialize_string(std::istream& istr, std::string& value, llssize max_b
  */
 llssize deserialize_string_delim(std::istream& istr, std::string& value, char d);
 
+/**
+ * @brief Parse a delimited string out of a buffer.
+ *
+ * @param cur The read position, with the delimiter already popped. On
+ * return it is advanced past the closing delimiter.
+ * @param end One past the last readable byte.
+ * @param value [out] The string which was found.
+ * @param d The delimiter to use.
+ * @return Returns number of bytes consumed from the buffer. Returns
+ * PARSE_FAILURE (-1) if the buffer ends before the closing delimiter.
+ */
+llssize deserialize_string_delim(const U8*& cur, const U8* end, std::string& value, char d);
+
+/**
+ * @brief Copy a fixed number of bytes out of a buffer.
+ *
+ * @param cur The read position, advanced by len on success.
+ * @param end One past the last readable byte.
+ * @param dest Where to copy the bytes.
+ * @param len The number of bytes to copy.
+ * @return Returns false, leaving dest untouched, if fewer than len bytes
+ * remain.
+ */
+bool read_buffer(const U8*& cur, const U8* end, void* dest, size_t len);
+
 /**
  * @brief Read a raw string off the stream.
  *
@@ -775,7 +801,7 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) c
                     // There must be a value for every key, thus
                     // child_count must be greater than 0.
                     parse_count += count;
-                    map.insert(name, child);
+                    map.appendToMap(name, child);
                 }
                 else
                 {
@@ -790,6 +816,7 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) c
             map.clear();
             return PARSE_FAILURE;
         }
+        map.sortMap();
     }
     return parse_count;
 }
@@ -1218,7 +1245,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) con
             // There must be a value for every key, thus child_count
             // must be greater than 0.
             parse_count += child_count;
-            map.insert(name, child);
+            map.appendToMap(name, child);
         }
         else
         {
@@ -1233,6 +1260,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) con
         // as were said to be there.
         return PARSE_FAILURE;
     }
+    map.sortMap();
     return parse_count;
 }
 
@@ -1295,6 +1323,312 @@ bool LLSDBinaryParser::parseString(
     return true;
 }
 
+S32 LLSDBinaryParser::parse(const U8* buf, size_t size, LLSD& data, S32 max_depth,
+                            size_t* bytes_parsed) const
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
+    const U8* cur = buf;
+    S32 parse_count = doParse(cur, buf + size, data, max_depth);
+    if (bytes_parsed)
+    {
+        *bytes_parsed = cur - buf;
+    }
+    return parse_count;
+}
+
+S32 LLSDBinaryParser::doParse(const U8*& cur, const U8* end, LLSD& data, S32 max_depth) const
+{
+    // See doParse(std::istream&, ...) for the format. Unlike the stream
+    // parser there are no byte limits to account for: the end of the
+    // buffer is the limit, and every read is checked against it.
+    if (cur >= end)
+    {
+        return 0;
+    }
+    char c = (char)*cur++;
+    if (max_depth == 0)
+    {
+        return PARSE_FAILURE;
+    }
+    S32 parse_count = 1;
+    switch(c)
+    {
+    case '{':
+    {
+        S32 child_count = parseMap(cur, end, data, max_depth - 1);
+        if((child_count == PARSE_FAILURE) || data.isUndefined())
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        else
+        {
+            parse_count += child_count;
+        }
+        break;
+    }
+
+    case '[':
+    {
+        S32 child_count = parseArray(cur, end, data, max_depth - 1);
+        if((child_count == PARSE_FAILURE) || data.isUndefined())
+        {
+            parse_count = PARSE_FAILURE;
+        }
+        else
+        {
+            parse_count += child_count;
+        }
+        break;
+    }
+
+    case '!':
+        data.clear();
+        break;
+
+    case '0':
+        data = false;
+        break;
+
+    case '1':
+        data = true;
+        break;
+
+    case 'i':
+    {
+        U32 value_nbo = 0;
+        if(!read_buffer(cur, end, &value_nbo, sizeof(U32)))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary integer." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        data = (S32)ntohl(value_nbo);
+        break;
+    }
+
+    case 'r':
+    {
+        F64 real_nbo = 0.0;
+        if(!read_buffer(cur, end, &real_nbo, sizeof(F64)))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary real." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        data = ll_ntohd(real_nbo);
+        break;
+    }
+
+    case 'u':
+    {
+        LLUUID id;
+        if(!read_buffer(cur, end, id.mData, UUID_BYTES))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary uuid." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        data = id;
+        break;
+    }
+
+    case '\'':
+    case '"':
+    {
+        std::string value;
+        if(PARSE_FAILURE == deserialize_string_delim(cur, end, value, c))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary (notation-style) string."
+                << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        data = std::move(value);
+        break;
+    }
+
+    case 's':
+    {
+        std::string value;
+        if(!parseString(cur, end, value))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary string." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        data = std::move(value);
+        break;
+    }
+
+    case 'l':
+    {
+        std::string value;
+        if(!parseString(cur, end, value))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary link." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        data = LLURI(value);
+        break;
+    }
+
+    case 'd':
+    {
+        F64 real = 0.0;
+        if(!read_buffer(cur, end, &real, sizeof(F64)))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary date." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        data = LLDate(real);
+        break;
+    }
+
+    case 'b':
+    {
+        U32 size_nbo = 0;
+        if(!read_buffer(cur, end, &size_nbo, sizeof(U32)))
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        S32 size = (S32)ntohl(size_nbo);
+        if(size > end - cur)
+        {
+            LL_INFOS() << "BUFFER OVERRUN reading binary." << LL_ENDL;
+            parse_count = PARSE_FAILURE;
+            break;
+        }
+        LLSD::Binary value;
+        if(size > 0)
+        {
+            value.assign(cur, cur + size);
+            cur += size;
+        }
+        data = std::move(value);
+        break;
+    }
+
+    default:
+        parse_count = PARSE_FAILURE;
+        LL_INFOS() << "Unrecognized character while parsing: int(" << int(c)
+            << ")" << LL_ENDL;
+        break;
+    }
+    if(PARSE_FAILURE == parse_count)
+    {
+        data.clear();
+    }
+    return parse_count;
+}
+
+S32 LLSDBinaryParser::parseMap(const U8*& cur, const U8* end, LLSD& map, S32 max_depth) const
+{
+    map = LLSD::emptyMap();
+    U32 value_nbo = 0;
+    if(!read_buffer(cur, end, &value_nbo, sizeof(U32)))
+    {
+        return PARSE_FAILURE;
+    }
+    S32 size = (S32)ntohl(value_nbo);
+    S32 parse_count = 0;
+    for(S32 count = 0; count < size; ++count)
+    {
+        if(cur >= end)
+        {
+            return PARSE_FAILURE;
+        }
+        char c = (char)*cur++;
+        std::string name;
+        switch(c)
+        {
+        case 'k':
+            if(!parseString(cur, end, name))
+            {
+                return PARSE_FAILURE;
+            }
+            break;
+        case '\'':
+        case '"':
+            if(PARSE_FAILURE == deserialize_string_delim(cur, end, name, c))
+            {
+                return PARSE_FAILURE;
+            }
+            break;
+        default:
+            // Includes a '}' arriving before as many entries as were
+            // said to be there.
+            return PARSE_FAILURE;
+        }
+        LLSD child;
+        S32 child_count = doParse(cur, end, child, max_depth);
+        if(child_count <= 0)
+        {
+            // There must be a value for every key, thus child_count
+            // must be greater than 0.
+            return PARSE_FAILURE;
+        }
+        parse_count += child_count;
+        map.appendToMap(name, child);
+    }
+    if((cur >= end) || (*cur++ != '}'))
+    {
+        return PARSE_FAILURE;
+    }
+    map.sortMap();
+    return parse_count;
+}
+
+S32 LLSDBinaryParser::parseArray(const U8*& cur, const U8* end, LLSD& array, S32 max_depth) const
+{
+    array = LLSD::emptyArray();
+    U32 value_nbo = 0;
+    if(!read_buffer(cur, end, &value_nbo, sizeof(U32)))
+    {
+        return PARSE_FAILURE;
+    }
+    S32 size = (S32)ntohl(value_nbo);
+    S32 parse_count = 0;
+    for(S32 count = 0; count < size; ++count)
+    {
+        if((cur >= end) || (*cur == ']'))
+        {
+            return PARSE_FAILURE;
+        }
+        // Parse straight into the new slot rather than copying a
+        // temporary in; a failure discards the whole array anyway.
+        LLSD& child = array.append(LLSD());
+        S32 child_count = doParse(cur, end, child, max_depth);
+        if(PARSE_FAILURE == child_count)
+        {
+            return PARSE_FAILURE;
+        }
+        parse_count += child_count;
+    }
+    if((cur >= end) || (*cur++ != ']'))
+    {
+        return PARSE_FAILURE;
+    }
+    return parse_count;
+}
+
+bool LLSDBinaryParser::parseString(
+    const U8*& cur,
+    const U8* end,
+    std::string& value) const
+{
+    U32 value_nbo = 0;
+    if(!read_buffer(cur, end, &value_nbo, sizeof(U32))) return false;
+    S32 size = (S32)ntohl(value_nbo);
+    if((size < 0) || (size > end - cur)) return false;
+    value.assign((const char*)cur, size);
+    cur += size;
+    return true;
+}
+
 
 /**
  * LLSDFormatter
@@ -1789,6 +2123,128 @@ llssize deserialize_string_delim(
     return count;
 }
 
+llssize deserialize_string_delim(
+    const U8*& cur,
+    const U8* end,
+    std::string& value,
+    char delim)
+{
+    const U8* start = cur;
+    const U8* next = cur;
+
+    // Most strings carry no escapes, so look for the closing delimiter
+    // first and copy the whole run out of the buffer in one go.
+    while((next < end) && (*next != (U8)delim) && (*next != '\\'))
+    {
+        ++next;
+    }
+    if(next >= end)
+    {
+        return LLSDParser::PARSE_FAILURE;
+    }
+    value.assign((const char*)start, next - start);
+    if(*next == (U8)delim)
+    {
+        cur = next + 1;
+        return cur - start;
+    }
+
+    // Found an escape: decode the remainder a character at a time, the
+    // same way deserialize_string_delim(std::istream&, ...) does.
+    bool found_escape = false;
+    bool found_hex = false;
+    bool found_digit = false;
+    U8 byte = 0;
+
+    while(next < end)
+    {
+        char next_char = (char)*next++;
+
+        if(found_escape)
+        {
+            if(found_hex)
+            {
+                if(found_digit)
+                {
+                    found_digit = false;
+                    found_hex = false;
+                    found_escape = false;
+                    byte = byte << 4;
+                    byte |= hex_as_nybble(next_char);
+                    value.push_back((char)byte);
+                    byte = 0;
+                }
+                else
+                {
+                    found_digit = true;
+                    byte = hex_as_nybble(next_char);
+                }
+            }
+            else if(next_char == 'x')
+            {
+                found_hex = true;
+            }
+            else
+            {
+                switch(next_char)
+                {
+                case 'a':
+                    value.push_back('\a');
+                    break;
+                case 'b':
+                    value.push_back('\b');
+                    break;
+                case 'f':
+                    value.push_back('\f');
+                    break;
+                case 'n':
+                    value.push_back('\n');
+                    break;
+                case 'r':
+                    value.push_back('\r');
+                    break;
+                case 't':
+                    value.push_back('\t');
+                    break;
+                case 'v':
+                    value.push_back('\v');
+                    break;
+                default:
+                    value.push_back(next_char);
+                    break;
+                }
+                found_escape = false;
+            }
+        }
+        else if(next_char == '\\')
+        {
+            found_escape = true;
+        }
+        else if(next_char == delim)
+        {
+            cur = next;
+            return cur - start;
+        }
+        else
+        {
+            value.push_back(next_char);
+        }
+    }
+
+    return LLSDParser::PARSE_FAILURE;
+}
+
+bool read_buffer(const U8*& cur, const U8* end, void* dest, size_t len)
+{
+    if((size_t)(end - cur) < len)
+    {
+        return false;
+    }
+    memcpy(dest, cur, len);
+    cur += len;
+    return true;
+}
+
 llssize deserialize_string_raw(
     std::istream& istr,
     std::string& value,
@@ -2148,97 +2604,241 @@ std::ostream& operator<<(std::ostream& s, const LLSD& llsd)
 
 //dirty little zippers -- yell at davep if these are horrid
 
-//return a string containing gzipped bytes of binary serialized LLSD
-// VERY inefficient -- creates several copies of LLSD block in memory
-std::string zip_llsd(LLSD& data)
+namespace
 {
-    std::stringstream llsd_strm;
+    // Inflated bytes are produced into a scratch window this size. Payloads
+    // that inflate to no more than this are parsed straight out of it,
+    // larger ones are parsed as a stream that refills it.
+    constexpr U32 UNZIP_WINDOW_SIZE = 1024 * 512;
 
-    LLSDSerialize::toBinary(data, llsd_strm);
+    const char DEPRECATED_BINARY_HEADER[] = "<? LLSD/Binary ?>";
+    constexpr size_t DEPRECATED_BINARY_HEADER_SIZE = 17;
 
-    const U32 CHUNK = 65536;
+    // zlib inflate state and scratch window, kept per thread and reset
+    // between payloads instead of being rebuilt for every mesh block.
+    class InflateContext
+    {
+    public:
+        ~InflateContext()
+        {
+            if (mInitialized)
+            {
+                inflateEnd(&mStream);
+            }
+        }
 
-    z_stream strm;
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
+        bool start(const U8* in, U32 size)
+        {
+            if (!mWindow)
+            {
+                mWindow.reset(new(std::nothrow) U8[UNZIP_WINDOW_SIZE]);
+                if (!mWindow)
+                {
+                    return false;
+                }
+            }
 
-    S32 ret = deflateInit(&strm, Z_BEST_COMPRESSION);
-    if (ret != Z_OK)
+            if (!mInitialized)
+            {
+                mStream.zalloc = Z_NULL;
+                mStream.zfree = Z_NULL;
+                mStream.opaque = Z_NULL;
+                mStream.next_in = Z_NULL;
+                mStream.avail_in = 0;
+                if (inflateInit(&mStream) != Z_OK)
+                {
+                    return false;
+                }
+                mInitialized = true;
+            }
+            else if (inflateReset(&mStream) != Z_OK)
+            {
+                return false;
+            }
+
+            mStream.next_in = const_cast<U8*>(in);
+            mStream.avail_in = size;
+            return true;
+        }
+
+        z_stream& stream() { return mStream; }
+        char* window() { return reinterpret_cast<char*>(mWindow.get()); }
+
+    private:
+        z_stream mStream;
+        bool mInitialized = false;
+        std::unique_ptr<U8[]> mWindow;
+    };
+
+    thread_local InflateContext sInflateContext;
+
+    // Read side streambuf that inflates into the context window on demand,
+    // so the binary parser never needs the whole payload in memory.
+    class InflateStreamBuf : public std::streambuf
     {
-        LL_WARNS() << "Failed to compress LLSD block." << LL_ENDL;
-        return std::string();
-    }
+    public:
+        InflateStreamBuf(InflateContext& context) : mContext(context) {}
 
-    std::string source = llsd_strm.str();
+        // Inflate the next window full. Returns the number of bytes now
+        // available, 0 once the stream has ended or failed.
+        size_t fill()
+        {
+            char* window = mContext.window();
+            setg(window, window, window);
+            if (mStatus != Z_OK)
+            {
+                return 0;
+            }
 
-    U8 out[CHUNK];
+            z_stream& strm = mContext.stream();
+            strm.next_out = reinterpret_cast<Bytef*>(window);
+            strm.avail_out = UNZIP_WINDOW_SIZE;
+            while (strm.avail_out && mStatus == Z_OK)
+            {
+                mStatus = inflate(&strm, Z_NO_FLUSH);
+            }
 
-    strm.avail_in = narrow<size_t>(source.size());
-    strm.next_in = (U8*) source.data();
-    U8* output = NULL;
+            size_t have = UNZIP_WINDOW_SIZE - strm.avail_out;
+            setg(window, window, window + have);
+            return have;
+        }
 
-    U32 cur_size = 0;
+        // Discard whatever the parser left unread, so that zlib still
+        // reaches and verifies the end of the stream.
+        void drain()
+        {
+            while (fill())
+            {
+            }
+        }
+
+        bool skip(const char* prefix, size_t len)
+        {
+            if (size_t(egptr() - gptr()) > len && memcmp(gptr(), prefix, len) == 0)
+            {
+                gbump(narrow(len));
+                return true;
+            }
+            return false;
+        }
 
-    U32 have = 0;
+        const U8* data() const { return reinterpret_cast<const U8*>(gptr()); }
+        size_t available() const { return egptr() - gptr(); }
+        S32 status() const { return mStatus; }
 
-    do
+    protected:
+        int_type underflow() override
+        {
+            if (gptr() == egptr() && !fill())
+            {
+                return traits_type::eof();
+            }
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        InflateContext& mContext;
+        S32 mStatus = Z_OK;
+    };
+
+    // Write side streambuf that deflates straight into a string, so
+    // zip_llsd() no longer keeps the serialized block around.
+    class DeflateStreamBuf : public std::streambuf
     {
-        strm.avail_out = CHUNK;
-        strm.next_out = out;
+    public:
+        DeflateStreamBuf(std::string& out) : mOut(out)
+        {
+            mStream.zalloc = Z_NULL;
+            mStream.zfree = Z_NULL;
+            mStream.opaque = Z_NULL;
+            mStatus = deflateInit(&mStream, Z_BEST_COMPRESSION);
+            mInitialized = (mStatus == Z_OK);
+            setp(mBuffer, mBuffer + sizeof(mBuffer));
+        }
 
-        ret = deflate(&strm, Z_FINISH);
-        if (ret == Z_OK || ret == Z_STREAM_END)
-        { //copy result into output
-            if (strm.avail_out >= CHUNK)
+        ~DeflateStreamBuf()
+        {
+            if (mInitialized)
             {
-                deflateEnd(&strm);
-                if(output)
-                    free(output);
-                LL_WARNS() << "Failed to compress LLSD block." << LL_ENDL;
-                return std::string();
+                deflateEnd(&mStream);
             }
+        }
 
-            have = CHUNK-strm.avail_out;
-            U8* new_output = (U8*) realloc(output, cur_size+have);
-            if (new_output == NULL)
+        bool finish()
+        {
+            return deflateBuffered(Z_FINISH) && mStatus == Z_STREAM_END;
+        }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if (!deflateBuffered(Z_NO_FLUSH))
             {
-                LL_WARNS() << "Failed to compress LLSD block: can't reallocate memory, current size: " << cur_size << " bytes; requested " << cur_size + have << " bytes." << LL_ENDL;
-                deflateEnd(&strm);
-                if (output)
-                {
-                    free(output);
-                }
-                return std::string();
+                return traits_type::eof();
+            }
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
             }
-            output = new_output;
-            memcpy(output+cur_size, out, have);
-            cur_size += have;
+            return traits_type::not_eof(c);
         }
-        else
+
+    private:
+        bool deflateBuffered(S32 flush)
         {
-            deflateEnd(&strm);
-            if(output)
-                free(output);
-            LL_WARNS() << "Failed to compress LLSD block." << LL_ENDL;
-            return std::string();
+            if (!mInitialized || mStatus == Z_STREAM_ERROR)
+            {
+                return false;
+            }
+
+            constexpr U32 OUT_CHUNK = 65536;
+            mStream.next_in = reinterpret_cast<Bytef*>(pbase());
+            mStream.avail_in = narrow(pptr() - pbase());
+            do
+            {
+                size_t used = mOut.size();
+                mOut.resize(used + OUT_CHUNK);
+                mStream.next_out = reinterpret_cast<Bytef*>(&mOut[used]);
+                mStream.avail_out = OUT_CHUNK;
+                mStatus = deflate(&mStream, flush);
+                mOut.resize(used + OUT_CHUNK - mStream.avail_out);
+                if (mStatus == Z_STREAM_ERROR)
+                {
+                    return false;
+                }
+            } while (mStream.avail_out == 0);
+
+            setp(mBuffer, mBuffer + sizeof(mBuffer));
+            return true;
         }
-    }
-    while (ret == Z_OK);
 
-    std::string::size_type size = cur_size;
+        std::string& mOut;
+        z_stream mStream;
+        S32 mStatus;
+        bool mInitialized;
+        char mBuffer[16384];
+    };
+}
 
-    std::string result((char*) output, size);
-    deflateEnd(&strm);
-    if(output)
-        free(output);
+//return a string containing zlib compressed bytes of binary serialized LLSD
+std::string zip_llsd(LLSD& data)
+{
+    std::string result;
+    DeflateStreamBuf buf(result);
+    std::ostream ostr(&buf);
+
+    LLSDSerialize::toBinary(data, ostr);
+    if (!ostr.good() || !buf.finish())
+    {
+        LL_WARNS() << "Failed to compress LLSD block." << LL_ENDL;
+        return std::string();
+    }
 
     return result;
 }
 
 //decompress a block of LLSD from provided istream
-// not very efficient -- creats a copy of decompressed LLSD block in memory
-// and deserializes from that copy using LLSDSerialize
 LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is, S32 size)
 {
     std::unique_ptr<U8[]> in = std::unique_ptr<U8[]>(new(std::nothrow) U8[size]);
@@ -2251,98 +2851,54 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is,
     return unzip_llsd(data, in.get(), size);
 }
 
+//decompress a block of LLSD, parsing it as it inflates so that peak memory
+//is bounded by the scratch window rather than the decompressed size
 LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32 size)
 {
-    U8* result = NULL;
-    llssize cur_size = 0;
-    z_stream strm;
-
-    constexpr U32 CHUNK = 1024 * 512;
-
-    static thread_local std::unique_ptr<U8[]> out;
-    if (!out)
+    InflateContext& context = sInflateContext;
+    if (size < 0 || !context.start(in, size))
     {
-        out = std::unique_ptr<U8[]>(new(std::nothrow) U8[CHUNK]);
+        return ZR_MEM_ERROR;
     }
 
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = size;
-    strm.next_in = const_cast<U8*>(in);
-
-    S32 ret = inflateInit(&strm);
+    InflateStreamBuf buf(context);
+    buf.fill();
+    buf.skip(DEPRECATED_BINARY_HEADER, DEPRECATED_BINARY_HEADER_SIZE);
 
-    do
+    S32 parsed;
+    if (buf.status() == Z_STREAM_END)
     {
-        strm.avail_out = CHUNK;
-        strm.next_out = out.get();
-        ret = inflate(&strm, Z_NO_FLUSH);
-        switch (ret)
-        {
-        case Z_NEED_DICT:
-        case Z_DATA_ERROR:
-        {
-            inflateEnd(&strm);
-            free(result);
-            return ZR_DATA_ERROR;
-        }
-        case Z_STREAM_ERROR:
-        case Z_BUF_ERROR:
-        {
-            inflateEnd(&strm);
-            free(result);
-            return ZR_BUFFER_ERROR;
-        }
-
-        case Z_MEM_ERROR:
-        {
-            inflateEnd(&strm);
-            free(result);
-            return ZR_MEM_ERROR;
-        }
-        }
-
-        U32 have = CHUNK-strm.avail_out;
-
-        U8* new_result = (U8*)realloc(result, cur_size + have);
-        if (new_result == NULL)
-        {
-            inflateEnd(&strm);
-            if (result)
-            {
-                free(result);
-            }
-            return ZR_MEM_ERROR;
-        }
-        result = new_result;
-        memcpy(result+cur_size, out.get(), have);
-        cur_size += have;
-
-    } while (ret == Z_OK && ret != Z_STREAM_END);
-
-    inflateEnd(&strm);
+        // Everything fit in the window: use the faster buffer parser.
+        parsed = LLSDSerialize::fromBinary(data, buf.data(), buf.available(), UNZIP_LLSD_MAX_DEPTH);
+    }
+    else
+    {
+        // The inflated size is not known yet, keep the length checks on
+        // with the most it can be
+        llssize max_bytes = llmin((llssize)size * UNZIP_LLSD_MAX_RATIO, UNZIP_LLSD_MAX_BYTES);
+        std::istream istr(&buf);
+        parsed = LLSDSerialize::fromBinary(data, istr, max_bytes, UNZIP_LLSD_MAX_DEPTH);
+        buf.drain();
+    }
 
-    if (ret != Z_STREAM_END)
+    switch (buf.status())
     {
-        free(result);
+    case Z_STREAM_END:
+        break;
+    case Z_STREAM_ERROR:
+    case Z_BUF_ERROR:
+        return ZR_BUFFER_ERROR;
+    case Z_MEM_ERROR:
+        return ZR_MEM_ERROR;
+    default:
         return ZR_DATA_ERROR;
     }
 
-    //result now points to the decompressed LLSD block
+    if (parsed <= 0)
     {
-        char* result_ptr = strip_deprecated_header((char*)result, cur_size);
-
-        boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
-
-        if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
-        {
-            free(result);
-            return ZR_PARSE_ERROR;
-        }
+        return ZR_PARSE_ERROR;
     }
 
-    free(result);
     return ZR_OK;
 }
 //This unzip function will only work with a gzip header and trailer - while the contents
@@ -2452,17 +3008,14 @@ U8* unzip_llsdNavMesh( bool& valid, size_t& outsize, std::istream& is, S32 size
 
 char* strip_deprecated_header(char* in, llssize& cur_size, llssize* header_size)
 {
-    const char* deprecated_header = "<? LLSD/Binary ?>";
-    constexpr size_t deprecated_header_size = 17;
-
-    if (cur_size > deprecated_header_size
-        && memcmp(in, deprecated_header, deprecated_header_size) == 0)
+    if (cur_size > (llssize)DEPRECATED_BINARY_HEADER_SIZE
+        && memcmp(in, DEPRECATED_BINARY_HEADER, DEPRECATED_BINARY_HEADER_SIZE) == 0)
     {
-        in = in + deprecated_header_size;
-        cur_size = cur_size - deprecated_header_size;
+        in = in + DEPRECATED_BINARY_HEADER_SIZE;
+        cur_size = cur_size - DEPRECATED_BINARY_HEADER_SIZE;
         if (header_size)
         {
-            *header_size = deprecated_header_size + 1;
+            *header_size = DEPRECATED_BINARY_HEADER_SIZE + 1;
         }
     }
 
@@ -358,6 +358,31 @@ public:
      */
     LLSDBinaryParser();
 
+    using LLSDParser::parse;
+
+    /**
+     * @brief Parse binary LLSD directly out of a contiguous buffer.
+     *
+     * This is the zero-copy counterpart of parse(std::istream&, ...)
+     * for callers that already hold the whole serialized block in
+     * memory, such as a decompressed asset or a network payload. The
+     * buffer is walked with a bounds checked cursor instead of being
+     * wrapped in an istream, and every embedded length is validated
+     * against the bytes remaining, so truncated or corrupt data fails
+     * cleanly rather than reading past the end.
+     * @param buf The serialized data, without any deprecated header.
+     * @param size The number of bytes available at buf.
+     * @param data[out] The newly parse structured data.
+     * @param max_depth Max depth parser will check before exiting
+     *  with parse error, -1 - unlimited.
+     * @param bytes_parsed[out] If not null, receives the number of
+     *  bytes consumed from buf.
+     * @return Returns the number of LLSD objects parsed into
+     * data. Returns -1 on parse failure.
+     */
+    S32 parse(const U8* buf, size_t size, LLSD& data, S32 max_depth = -1,
+              size_t* bytes_parsed = nullptr) const;
+
 protected:
     /**
      * @brief Call this method to parse a stream for LLSD.
@@ -406,6 +431,17 @@ private:
      * @return Retuns true if a complete string was parsed.
      */
     bool parseString(std::istream& istr, std::string& value) const;
+
+    /**
+     * @brief Buffer counterparts of the stream parsing methods above.
+     *
+     * cur is advanced past everything consumed and never moves
+     * beyond end.
+     */
+    S32 doParse(const U8*& cur, const U8* end, LLSD& data, S32 max_depth) const;
+    S32 parseMap(const U8*& cur, const U8* end, LLSD& map, S32 max_depth) const;
+    S32 parseArray(const U8*& cur, const U8* end, LLSD& array, S32 max_depth) const;
+    bool parseString(const U8*& cur, const U8* end, std::string& value) const;
 };
 
 
@@ -846,6 +882,12 @@ public:
         (void)p->parse(str, sd, max_bytes, max_depth);
         return sd;
     }
+    static S32 fromBinary(LLSD& sd, const U8* buf, size_t size, S32 max_depth = -1,
+                          size_t* bytes_parsed = nullptr)
+    {
+        LLPointer<LLSDBinaryParser> p = new LLSDBinaryParser;
+        return p->parse(buf, size, sd, max_depth, bytes_parsed);
+    }
 };
 
 class LL_COMMON_API LLUZipHelper : public LLRefCount
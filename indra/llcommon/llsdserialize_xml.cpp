@@ -29,9 +29,16 @@
 
 #include <iostream>
 #include <deque>
+#include <charconv>
+#include <bit>
 
 #include "apr_base64.h"
-#include <boost/regex.hpp>
+
+#if LL_ARM64
+#include "sse2neon.h"
+#else
+#include <emmintrin.h>
+#endif
 
 extern "C"
 {
@@ -296,6 +303,13 @@ private:
     };
     static Element readElement(const XML_Char* name);
 
+    bool bufferDocument(std::istream& input);
+    S32 parseBuffered(LLSD& data);
+    static bool readStartTag(const char*& p, const char* end, Element& element,
+                             bool& empty_element);
+    static bool readEndTag(const char*& p, const char* end, Element element);
+    static void assignValue(Element element, const std::string& content, LLSD& value);
+
     static const XML_Char* findAttribute(const XML_Char* name, const XML_Char** pairs);
 
     bool mEmitErrors;
@@ -317,6 +331,8 @@ private:
 
     std::string mCurrentKey;        // Current XML <tag>
     std::string mCurrentContent;    // String data between <tag> and </tag>
+
+    std::string mBuffer;            // Document text read ahead for parseBuffered()
 };
 
 
@@ -362,12 +378,29 @@ static unsigned get_till_eol(std::istream& input, char *buf, unsigned bufsize)
 
 S32 LLSDXMLParser::Impl::parse(std::istream& input, LLSD& data)
 {
-    XML_Status status;
+    if (bufferDocument(input))
+    {
+        S32 count = parseBuffered(data);
+        if (count != LLSDParser::PARSE_FAILURE)
+        {
+            mBuffer.clear();
+            clear_eol(input);
+            return count;
+        }
+    }
+
+    // Fall back to expat, starting with whatever was already read ahead.
+    XML_Status status = XML_STATUS_OK;
+    if (!mBuffer.empty())
+    {
+        status = XML_Parse(mParser, mBuffer.data(), (int)mBuffer.size(), false);
+        mBuffer.clear();
+    }
 
     static const int BUFFER_SIZE = 1024;
     void* buffer = NULL;
     int count = 0;
-    while (input.good() && !input.eof())
+    while (status != XML_STATUS_ERROR && input.good() && !input.eof())
     {
         buffer = XML_GetBuffer(mParser, BUFFER_SIZE);
 
@@ -385,11 +418,6 @@ S32 LLSDXMLParser::Impl::parse(std::istream& input, LLSD& data)
             break;
         }
         status = XML_ParseBuffer(mParser, count, false);
-
-        if (status == XML_STATUS_ERROR)
-        {
-            break;
-        }
     }
 
     // *FIX.: This code is buggy - if the stream was empty or not
@@ -398,8 +426,11 @@ S32 LLSDXMLParser::Impl::parse(std::istream& input, LLSD& data)
     // futhermore, it isn't clear that the expat buffer semantics are
     // preserved
 
+    // A document that never closes its <llsd> element is a failure even
+    // if it is otherwise well formed XML. (The old loop got this by
+    // accident, by handing expat the EOF marker as a trailing byte.)
     status = XML_ParseBuffer(mParser, 0, true);
-    if (status == XML_STATUS_ERROR && !mGracefullStop)
+    if (!mGracefullStop)
     {
         if (buffer)
         {
@@ -440,7 +471,26 @@ S32 LLSDXMLParser::Impl::parseLines(std::istream& input, LLSD& data)
     // Must get rid of any leading \n, otherwise the stream gets into an error/eof state
     clear_eol(input);
 
-    while( !mGracefullStop
+    if (bufferDocument(input))
+    {
+        S32 count = parseBuffered(data);
+        if (count != LLSDParser::PARSE_FAILURE)
+        {
+            mBuffer.clear();
+            clear_eol(input);
+            return count;
+        }
+    }
+
+    // Fall back to expat, starting with whatever was already read ahead.
+    if (!mBuffer.empty())
+    {
+        status = XML_Parse(mParser, mBuffer.data(), (int)mBuffer.size(), false);
+        mBuffer.clear();
+    }
+
+    while( status != XML_STATUS_ERROR
+        && !mGracefullStop
         && input.good()
         && !input.eof())
     {
@@ -521,6 +571,7 @@ void LLSDXMLParser::Impl::reset()
     mSkipping = false;
 
     mCurrentKey.clear();
+    mBuffer.clear();
 
     XML_ParserReset(mParser, "utf-8");
     XML_SetUserData(mParser, this);
@@ -551,15 +602,571 @@ LLSDXMLParser::Impl::findAttribute(const XML_Char* name, const XML_Char** pairs)
 
 void LLSDXMLParser::Impl::parsePart(const char* buf, llssize len)
 {
+    // Held back so that parse() can hand the whole document to
+    // parseBuffered(); expat only sees it if that has to fall back.
     if ( buf != NULL
         && len > 0 )
     {
-        XML_Status status = XML_Parse(mParser, buf, (int)len, 0);
-        if (status == XML_STATUS_ERROR)
+        mBuffer.append(buf, len);
+    }
+}
+
+/*
+    Fast path
+
+    Almost everything we are asked to parse was written by
+    LLSDXMLFormatter or by the simulator and web services, which stick to
+    a small, regular subset of XML: an optional declaration, one <llsd>
+    element, the LLSD elements themselves and the five predefined
+    entities plus character references. parseBuffered() reads that
+    subset straight out of the buffered document, scanning text 16 bytes
+    at a time and building the LLSD in place, without any per-element
+    callbacks.
+
+    Anything outside the subset - comments, DOCTYPEs, CDATA sections,
+    unknown elements or entities, stray text, or any markup error -
+    makes it give up without touching the result, and the document is
+    handed to expat, which remains the reference implementation.
+*/
+
+// Read ahead up to and including the line holding </llsd>, which is as
+// far as the expat loop would read, or to the end of the stream.
+bool LLSDXMLParser::Impl::bufferDocument(std::istream& input)
+{
+    static const char LLSD_END[] = "</llsd>";
+    static const size_t LLSD_END_LEN = sizeof(LLSD_END) - 1;
+
+    if (mBuffer.find(LLSD_END) != std::string::npos)
+    {
+        return true;
+    }
+
+    std::streambuf* sb = input.rdbuf();
+    while (sb && input.good())
+    {
+        size_t line_start = mBuffer.size();
+        int c = sb->sbumpc();
+        while (c != EOF)
+        {
+            mBuffer.push_back((char)c);
+            if (is_eol((char)c))
+            {
+                break;
+            }
+            c = sb->sbumpc();
+        }
+        if (c == EOF)
+        {
+            input.setstate(std::ios::eofbit);
+        }
+
+        size_t search_from = line_start > LLSD_END_LEN ? line_start - LLSD_END_LEN : 0;
+        if (mBuffer.find(LLSD_END, search_from) != std::string::npos)
+        {
+            return true;
+        }
+    }
+    return !mBuffer.empty();
+}
+
+namespace
+{
+    inline bool is_xml_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    inline const char* skip_xml_space(const char* p, const char* end)
+    {
+        while (p < end && is_xml_space(*p))
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    // Find the next byte in character data that cannot simply be copied:
+    // '<', '&', '\r' (XML normalizes line ends), a control character, or
+    // a byte with the high bit set (UTF-8 that needs validating). Since
+    // the compare is signed, one test against ' ' catches both of the
+    // last two.
+    const char* find_text_special(const char* p, const char* end)
+    {
+        const __m128i lt = _mm_set1_epi8('<');
+        const __m128i amp = _mm_set1_epi8('&');
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i space = _mm_set1_epi8(' ');
+
+        while (end - p >= 16)
+        {
+            __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chars, lt), _mm_cmpeq_epi8(chars, amp));
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(chars, cr));
+            __m128i low = _mm_cmplt_epi8(chars, space);
+            __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(chars, tab), _mm_cmpeq_epi8(chars, lf));
+            special = _mm_or_si128(special, _mm_andnot_si128(ws, low));
+            int mask = _mm_movemask_epi8(special);
+            if (mask)
+            {
+                return p + std::countr_zero((unsigned)mask);
+            }
+            p += 16;
+        }
+        while (p < end)
+        {
+            char c = *p;
+            if (c == '<' || c == '&' || c == '\r' || (c < ' ' && c != '\t' && c != '\n'))
+            {
+                return p;
+            }
+            ++p;
+        }
+        return end;
+    }
+
+    // Length of the well formed UTF-8 sequence at p, or 0 if it is
+    // malformed or encodes a character XML does not allow.
+    size_t utf8_sequence_length(const char* p, const char* end)
+    {
+        const U8* u = reinterpret_cast<const U8*>(p);
+        size_t avail = end - p;
+        auto cont = [u](size_t i) { return (u[i] & 0xC0) == 0x80; };
+
+        if (u[0] >= 0xC2 && u[0] <= 0xDF)
+        {
+            return (avail >= 2 && cont(1)) ? 2 : 0;
+        }
+        if (u[0] >= 0xE0 && u[0] <= 0xEF)
+        {
+            if (avail < 3 || !cont(1) || !cont(2)) return 0;
+            if (u[0] == 0xE0 && u[1] < 0xA0) return 0;     // overlong
+            if (u[0] == 0xED && u[1] > 0x9F) return 0;     // surrogate
+            if (u[0] == 0xEF && u[1] == 0xBF && u[2] >= 0xBE) return 0; // U+FFFE, U+FFFF
+            return 3;
+        }
+        if (u[0] >= 0xF0 && u[0] <= 0xF4)
+        {
+            if (avail < 4 || !cont(1) || !cont(2) || !cont(3)) return 0;
+            if (u[0] == 0xF0 && u[1] < 0x90) return 0;     // overlong
+            if (u[0] == 0xF4 && u[1] > 0x8F) return 0;     // > U+10FFFF
+            return 4;
+        }
+        return 0;
+    }
+
+    bool append_utf8(U32 code, std::string& out)
+    {
+        if (code == 0x9 || code == 0xA || code == 0xD || (code >= 0x20 && code < 0x80))
+        {
+            out.push_back((char)code);
+        }
+        else if (code < 0x20)
+        {
+            return false;
+        }
+        else if (code < 0x800)
+        {
+            out.push_back((char)(0xC0 | (code >> 6)));
+            out.push_back((char)(0x80 | (code & 0x3F)));
+        }
+        else if (code < 0x10000)
+        {
+            if ((code >= 0xD800 && code <= 0xDFFF) || code >= 0xFFFE)
+            {
+                return false;
+            }
+            out.push_back((char)(0xE0 | (code >> 12)));
+            out.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (code & 0x3F)));
+        }
+        else if (code <= 0x10FFFF)
+        {
+            out.push_back((char)(0xF0 | (code >> 18)));
+            out.push_back((char)(0x80 | ((code >> 12) & 0x3F)));
+            out.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (code & 0x3F)));
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // Decode one entity or character reference; p points just past the
+    // '&' and is left just past the ';'.
+    bool decode_entity(const char*& p, const char* end, std::string& out)
+    {
+        const char* semi = static_cast<const char*>(memchr(p, ';', llmin(end - p, (ptrdiff_t)12)));
+        if (!semi)
+        {
+            return false;
+        }
+        std::string_view name(p, semi - p);
+        p = semi + 1;
+
+        if (name == "lt")   { out.push_back('<');  return true; }
+        if (name == "gt")   { out.push_back('>');  return true; }
+        if (name == "amp")  { out.push_back('&');  return true; }
+        if (name == "quot") { out.push_back('"');  return true; }
+        if (name == "apos") { out.push_back('\''); return true; }
+
+        if (name.size() < 2 || name[0] != '#')
+        {
+            return false;
+        }
+        int base = 10;
+        name.remove_prefix(1);
+        if (name[0] == 'x')
+        {
+            base = 16;
+            name.remove_prefix(1);
+        }
+        U32 code = 0;
+        auto result = std::from_chars(name.data(), name.data() + name.size(), code, base);
+        if (name.empty() || result.ec != std::errc() || result.ptr != name.data() + name.size())
+        {
+            return false;
+        }
+        return append_utf8(code, out);
+    }
+
+    // Decode character data up to the next '<' into out. Returns the
+    // position of that '<', or NULL if the text cannot be handled here.
+    const char* decode_text(const char* p, const char* end, std::string& out)
+    {
+        out.clear();
+        while (true)
+        {
+            const char* special = find_text_special(p, end);
+            out.append(p, special - p);
+            if (special == end)
+            {
+                return NULL;
+            }
+            p = special;
+            char c = *p;
+            if (c == '<')
+            {
+                return p;
+            }
+            else if (c == '&')
+            {
+                ++p;
+                if (!decode_entity(p, end, out))
+                {
+                    return NULL;
+                }
+            }
+            else if (c == '\r')
+            {
+                out.push_back('\n');
+                ++p;
+                if (p < end && *p == '\n')
+                {
+                    ++p;
+                }
+            }
+            else
+            {
+                size_t len = utf8_sequence_length(p, end);
+                if (!len)
+                {
+                    return NULL;
+                }
+                out.append(p, len);
+                p += len;
+            }
+        }
+    }
+}
+
+// Read a start tag. p points at the '<' and is left just past the '>'.
+// static
+bool LLSDXMLParser::Impl::readStartTag(const char*& p, const char* end, Element& element,
+                                       bool& empty_element)
+{
+    const char* name = ++p;
+    while (p < end && !is_xml_space(*p) && *p != '/' && *p != '>')
+    {
+        ++p;
+    }
+    char name_buf[16];
+    size_t name_len = p - name;
+    if (!name_len || name_len >= sizeof(name_buf))
+    {
+        return false;
+    }
+    memcpy(name_buf, name, name_len);
+    name_buf[name_len] = '\0';
+    element = readElement(name_buf);
+
+    empty_element = false;
+    while (true)
+    {
+        p = skip_xml_space(p, end);
+        if (p >= end)
+        {
+            return false;
+        }
+        if (*p == '>')
+        {
+            ++p;
+            return true;
+        }
+        if (*p == '/')
+        {
+            if (end - p < 2 || p[1] != '>')
+            {
+                return false;
+            }
+            p += 2;
+            empty_element = true;
+            return true;
+        }
+
+        // An attribute. Only <binary encoding="base64"> means anything to
+        // LLSD; any other encoding is left to expat to skip.
+        const char* attr = p;
+        while (p < end && !is_xml_space(*p) && *p != '=' && *p != '>' && *p != '/')
+        {
+            ++p;
+        }
+        std::string_view attr_name(attr, p - attr);
+        p = skip_xml_space(p, end);
+        if (p >= end || *p != '=')
+        {
+            return false;
+        }
+        p = skip_xml_space(p + 1, end);
+        if (p >= end || (*p != '"' && *p != '\''))
+        {
+            return false;
+        }
+        char quote = *p++;
+        const char* attr_value = p;
+        while (p < end && *p != quote && *p != '<' && *p != '&')
+        {
+            ++p;
+        }
+        if (p >= end || *p != quote)
+        {
+            return false;
+        }
+        std::string_view value(attr_value, p - attr_value);
+        ++p;
+        if (attr_name.empty())
+        {
+            return false;
+        }
+        if (element == ELEMENT_BINARY && attr_name == "encoding" && value != "base64")
+        {
+            return false;
+        }
+    }
+}
+
+// Read the end tag closing element. p points at the '<' and is left just
+// past the '>'.
+// static
+bool LLSDXMLParser::Impl::readEndTag(const char*& p, const char* end, Element element)
+{
+    if (end - p < 3 || p[0] != '<' || p[1] != '/')
+    {
+        return false;
+    }
+    p += 2;
+    const char* name = p;
+    while (p < end && !is_xml_space(*p) && *p != '>')
+    {
+        ++p;
+    }
+    char name_buf[16];
+    size_t name_len = p - name;
+    if (!name_len || name_len >= sizeof(name_buf))
+    {
+        return false;
+    }
+    memcpy(name_buf, name, name_len);
+    name_buf[name_len] = '\0';
+    if (readElement(name_buf) != element)
+    {
+        return false;
+    }
+    p = skip_xml_space(p, end);
+    if (p >= end || *p != '>')
+    {
+        return false;
+    }
+    ++p;
+    return true;
+}
+
+S32 LLSDXMLParser::Impl::parseBuffered(LLSD& data)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
+
+    const char* p = mBuffer.data();
+    const char* end = p + mBuffer.size();
+
+    // Prolog: whitespace and processing instructions such as <?xml ...?>
+    Element element = ELEMENT_UNKNOWN;
+    bool empty_element = false;
+    while (true)
+    {
+        p = skip_xml_space(p, end);
+        if (end - p < 2 || *p != '<')
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        if (p[1] == '?')
+        {
+            size_t close = std::string_view(p, end - p).find("?>");
+            if (close == std::string_view::npos)
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            p += close + 2;
+            continue;
+        }
+        if (!readStartTag(p, end, element, empty_element) || element != ELEMENT_LLSD)
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+        break;
+    }
+
+    LLSD result;
+    S32 parse_count = 0;
+    if (empty_element)
+    {
+        data = result;
+        return parse_count;
+    }
+
+    struct Container
+    {
+        LLSD* mValue;
+        Element mElement;
+    };
+    std::vector<Container> stack;
+    std::string key;
+    std::string content;
+    bool have_key = false;
+    bool have_value = false;
+
+    while (true)
+    {
+        // Between elements only whitespace is expected.
+        p = skip_xml_space(p, end);
+        if (end - p < 2 || *p != '<')
+        {
+            return LLSDParser::PARSE_FAILURE;
+        }
+
+        if (p[1] == '/')
+        {
+            // Closing a map, an array or the document
+            if (stack.empty())
+            {
+                if (!readEndTag(p, end, ELEMENT_LLSD))
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                break;
+            }
+            if (have_key || !readEndTag(p, end, stack.back().mElement))
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            if (stack.back().mElement == ELEMENT_MAP)
+            {
+                stack.back().mValue->sortMap();
+            }
+            stack.pop_back();
+            continue;
+        }
+
+        if (!readStartTag(p, end, element, empty_element))
         {
-            LL_INFOS() << "Unexpected XML parsing error at start" << LL_ENDL;
+            return LLSDParser::PARSE_FAILURE;
         }
+
+        switch (element)
+        {
+            case ELEMENT_LLSD:
+            case ELEMENT_UNKNOWN:
+                return LLSDParser::PARSE_FAILURE;
+
+            case ELEMENT_KEY:
+                if (stack.empty() || stack.back().mElement != ELEMENT_MAP || have_key || empty_element)
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                p = decode_text(p, end, key);
+                if (!p || key.empty() || !readEndTag(p, end, ELEMENT_KEY))
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                have_key = true;
+                continue;
+
+            default:
+                break;
+        }
+
+        // Find where the value goes
+        LLSD* value = NULL;
+        if (stack.empty())
+        {
+            if (have_value)
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            value = &result;
+            have_value = true;
+        }
+        else if (stack.back().mElement == ELEMENT_MAP)
+        {
+            if (!have_key)
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            value = &stack.back().mValue->appendToMap(key, LLSD());
+            have_key = false;
+        }
+        else
+        {
+            value = &stack.back().mValue->append(LLSD());
+        }
+        ++parse_count;
+
+        if (element == ELEMENT_MAP || element == ELEMENT_ARRAY)
+        {
+            *value = (element == ELEMENT_MAP) ? LLSD::emptyMap() : LLSD::emptyArray();
+            if (!empty_element)
+            {
+                stack.push_back({ value, element });
+            }
+            continue;
+        }
+
+        content.clear();
+        if (!empty_element)
+        {
+            p = decode_text(p, end, content);
+            if (!p || !readEndTag(p, end, element))
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+        }
+        assignValue(element, content, *value);
     }
+
+    data = result;
+    return parse_count;
 }
 
 // Performance testing code
@@ -645,7 +1252,7 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
         if (mCurrentKey.empty()) { return startSkipping(); }
 
         LLSD& map = *mStack.back();
-        LLSD& newElement = map[mCurrentKey];
+        LLSD& newElement = map.appendToMap(mCurrentKey, LLSD());
         mStack.push_back(&newElement);
 
         mCurrentKey.clear();
@@ -722,6 +1329,18 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
     LLSD& value = *mStack.back();
     mStack.pop_back();
 
+    if (element == ELEMENT_MAP)
+    {
+        value.sortMap();
+    }
+    assignValue(element, mCurrentContent, value);
+
+    mCurrentContent.clear();
+}
+
+// static
+void LLSDXMLParser::Impl::assignValue(Element element, const std::string& content, LLSD& value)
+{
     switch (element)
     {
         case ELEMENT_UNDEF:
@@ -729,71 +1348,90 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
             break;
 
         case ELEMENT_BOOL:
-            value = (mCurrentContent == "true" || mCurrentContent == "1");
+            value = (content == "true" || content == "1");
             break;
 
         case ELEMENT_INTEGER:
             {
+                const char* first = content.c_str();
+                const char* last = first + content.size();
+                while (first < last && isspace((unsigned char)*first))
+                {
+                    ++first;
+                }
                 S32 i;
-                // sscanf okay here with different locales - ints don't change for different locale settings like floats do.
-                if ( sscanf(mCurrentContent.c_str(), "%d", &i ) == 1 )
+                // from_chars and sscanf are both fine with different locales - ints
+                // don't change for different locale settings like floats do.
+                if (std::from_chars(first, last, i).ec == std::errc())
+                {   // Plain decimal, by far the most common case
+                    value = i;
+                }
+                else if ( sscanf(content.c_str(), "%d", &i ) == 1 )
                 {   // See if sscanf works - it's faster
                     value = i;
                 }
                 else
                 {
-                    value = LLSD(mCurrentContent).asInteger();
+                    value = LLSD(content).asInteger();
                 }
             }
             break;
 
         case ELEMENT_REAL:
             {
-                value = LLSD(mCurrentContent).asReal();
+                value = LLSD(content).asReal();
                 // removed since this breaks when locale has decimal separator that isn't '.'
                 // investigated changing local to something compatible each time but deemed higher
                 // risk that just using LLSD.asReal() each time.
                 //F64 r;
-                //if ( sscanf(mCurrentContent.c_str(), "%lf", &r ) == 1 )
+                //if ( sscanf(content.c_str(), "%lf", &r ) == 1 )
                 //{ // See if sscanf works - it's faster
                 //  value = r;
                 //}
                 //else
                 //{
-                //  value = LLSD(mCurrentContent).asReal();
+                //  value = LLSD(content).asReal();
                 //}
             }
             break;
 
         case ELEMENT_STRING:
-            value = mCurrentContent;
+            value = content;
             break;
 
         case ELEMENT_UUID:
-            value = LLSD(mCurrentContent).asUUID();
+            value = LLUUID(content);
             break;
 
         case ELEMENT_DATE:
-            value = LLSD(mCurrentContent).asDate();
+            value = LLDate(content);
             break;
 
         case ELEMENT_URI:
-            value = LLSD(mCurrentContent).asURI();
+            value = LLSD(content).asURI();
             break;
 
         case ELEMENT_BINARY:
         {
-            // Regex is expensive, but only fix for whitespace in base64,
-            // created by python and other non-linden systems - DEV-39358
-            // Fortunately we have very little binary passing now,
-            // so performance impact shold be negligible. + poppy 2009-09-04
-            boost::regex r;
-            r.assign("\\s");
-            std::string stripped = boost::regex_replace(mCurrentContent, r, "");
-            S32 len = apr_base64_decode_len(stripped.c_str());
+            // Strip whitespace in base64, created by python and other
+            // non-linden systems - DEV-39358
+            auto is_base64_space = [](char c)
+            {
+                return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+            };
+            std::string stripped;
+            const std::string* encoded = &content;
+            if (std::any_of(content.begin(), content.end(), is_base64_space))
+            {
+                stripped = content;
+                stripped.erase(std::remove_if(stripped.begin(), stripped.end(), is_base64_space),
+                               stripped.end());
+                encoded = &stripped;
+            }
+            S32 len = apr_base64_decode_len(encoded->c_str());
             std::vector<U8> data;
             data.resize(len);
-            len = apr_base64_decode_binary(&data[0], stripped.c_str());
+            len = apr_base64_decode_binary(&data[0], encoded->c_str());
             data.resize(len);
             value = data;
             break;
@@ -807,8 +1445,6 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
             // other values, map and array, have already been set
             break;
     }
-
-    mCurrentContent.clear();
 }
 
 void LLSDXMLParser::Impl::characterDataHandler(const XML_Char* data, int length)
@@ -51,6 +51,13 @@ typedef U32 uint32_t;
 #include "llsdutil.h"
 #include "llformat.h"
 #include "llmemorystream.h"
+#include "lltimer.h"
+
+#ifdef LL_USESYSTEMLIBS
+# include <zlib.h>
+#else
+# include "zlib-ng/zlib.h"
+#endif
 
 #include "../test/hexdump.h"
 #include "../test/lltut.h"
@@ -858,6 +865,69 @@ namespace tut
     }
 
 
+    template<> template<>
+    void TestLLSDXMLParsingObject::test<6>()
+    {
+        // text decoding on the fast path
+        ensureParse(
+            "entities and character references",
+            "<llsd><string>&lt;&gt;&amp;&quot;&apos; &#65;&#x42; &#xe9;</string></llsd>",
+            LLSD("<>&\"' AB \xc3\xa9"),
+            1);
+        ensureParse(
+            "line ends are normalized",
+            "<llsd><string>a\r\nb\rc</string></llsd>",
+            LLSD("a\nb\nc"),
+            1);
+        ensureParse(
+            "utf-8 passes through",
+            "<llsd><string>\xe3\x81\x82\xf0\x9f\x98\x80</string></llsd>",
+            LLSD("\xe3\x81\x82\xf0\x9f\x98\x80"),
+            1);
+        ensureParse(
+            "invalid utf-8",
+            "<llsd><string>\xc3\x28</string></llsd>",
+            LLSD(),
+            LLSDParser::PARSE_FAILURE);
+        ensureParse(
+            "mismatched end tag",
+            "<llsd><string>ha ha</integer></llsd>",
+            LLSD(),
+            LLSDParser::PARSE_FAILURE);
+    }
+
+    template<> template<>
+    void TestLLSDXMLParsingObject::test<7>()
+    {
+        // Constructs the fast path leaves to expat must give the same
+        // result as the plain document.
+        LLSD v;
+        v["a"] = 1;
+        v["b"] = "two";
+        v["c"].append(3.5);
+        ensureParse(
+            "plain",
+            "<?xml version=\"1.0\" ?>\n<llsd><map><key>a</key><integer>1</integer>"
+            "<key>b</key><string>two</string><key>c</key><array><real>3.5</real></array>"
+            "</map></llsd>\n",
+            v,
+            5);
+        ensureParse(
+            "comments",
+            "<?xml version=\"1.0\" ?>\n<llsd><!-- x --><map><key>a</key><integer>1</integer>"
+            "<key>b</key><string>t<!-- y -->wo</string><key>c</key><array><real>3.5</real></array>"
+            "</map></llsd>\n",
+            v,
+            5);
+        ensureParse(
+            "cdata",
+            "<llsd><map><key>a</key><integer>1</integer>"
+            "<key>b</key><string><![CDATA[two]]></string><key>c</key><array><real>3.5</real></array>"
+            "</map></llsd>",
+            v,
+            5);
+    }
+
     /*
     TODO:
         test XML parsing
@@ -1267,6 +1337,25 @@ namespace tut
     {
     public:
         TestLLSDBinaryParsing() {}
+
+        // Every binary parse test also runs through the buffer parser,
+        // which must agree with the stream parser.
+        void ensureParse(
+            const std::string& msg,
+            const std::string& in,
+            const LLSD& expected_value,
+            S32 expected_count,
+            S32 depth_limit = -1)
+        {
+            TestLLSDParsing<LLSDBinaryParser>::ensureParse(
+                msg, in, expected_value, expected_count, depth_limit);
+
+            LLSD parsed_result;
+            S32 parsed_count = LLSDSerialize::fromBinary(
+                parsed_result, (const U8*)in.data(), in.size(), depth_limit);
+            ensure_equals(msg + " (buffer)", parsed_result, expected_value);
+            ensure_equals(msg + " (buffer count)", parsed_count, expected_count);
+        }
     };
 
     typedef tut::test_group<TestLLSDBinaryParsing> TestLLSDBinaryParsingGroup;
@@ -1584,12 +1673,164 @@ namespace tut
             1);
     }
 
-/*
     template<> template<>
     void TestLLSDBinaryParsingObject::test<11>()
     {
+        std::vector<U8> vec;
+        vec.push_back('\'');
+        std::string escaped("tab\\tand hex \\x41\\'");
+        vec.insert(vec.end(), escaped.begin(), escaped.end());
+        vec.push_back('\'');
+        std::string str_good((char*)&vec[0], vec.size());
+        ensureParse(
+            "escaped notation-style string",
+            str_good,
+            LLSD("tab\tand hex A'"),
+            1);
+
+        vec.pop_back();
+        std::string str_bad((char*)&vec[0], vec.size());
+        ensureParse(
+            "unterminated notation-style string",
+            str_bad,
+            LLSD(),
+            LLSDParser::PARSE_FAILURE);
+    }
+
+    template<> template<>
+    void TestLLSDBinaryParsingObject::test<12>()
+    {
+        // Compare the buffer parser against the stream parser on a large
+        // synthetic document: a deep tree of small maps plus a wide map
+        // of every scalar type. Timings are logged for comparison, not
+        // asserted.
+        LLSD v = LLSD::emptyMap();
+        fillmap(v["tree"], 10, 4);
+        LLSD& wide = v["wide"];
+        for (S32 i = 0; i < 20000; ++i)
+        {
+            LLSD entry;
+            entry["int"] = i;
+            entry["real"] = i * 0.5;
+            entry["string"] = llformat("value %d", i);
+            entry["uuid"] = LLUUID::generateNewID();
+            entry["date"] = LLDate(F64(i));
+            entry["binary"] = LLSD::Binary(i % 64, U8(i));
+            wide[llformat("entry %d", i)] = entry;
+        }
+
+        std::ostringstream ostr;
+        LLSDSerialize::toBinary(v, ostr);
+        const std::string serialized(ostr.str());
+
+        constexpr S32 ITERATIONS = 5;
+        LLTimer timer;
+        LLSD from_stream;
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            from_stream.clear();
+            LLMemoryStream istr((const U8*)serialized.data(), (S32)serialized.size());
+            LLSDSerialize::fromBinary(from_stream, istr, serialized.size());
+        }
+        F64 stream_secs = timer.getElapsedTimeAndResetF64();
+
+        LLSD from_buffer;
+        size_t bytes_parsed = 0;
+        for (S32 i = 0; i < ITERATIONS; ++i)
+        {
+            from_buffer.clear();
+            LLSDSerialize::fromBinary(from_buffer, (const U8*)serialized.data(),
+                                      serialized.size(), -1, &bytes_parsed);
+        }
+        F64 buffer_secs = timer.getElapsedTimeF64();
+
+        LL_INFOS() << "Parsed " << serialized.size() << " bytes of binary LLSD "
+                   << ITERATIONS << " times: stream " << stream_secs
+                   << "s, buffer " << buffer_secs << "s" << LL_ENDL;
+
+        ensure_equals("stream parse", from_stream, v);
+        ensure_equals("buffer parse", from_buffer, v);
+        ensure_equals("buffer bytes parsed", bytes_parsed, serialized.size());
+    }
+
+    template<> template<>
+    void TestLLSDBinaryParsingObject::test<13>()
+    {
+        // zip_llsd()/unzip_llsd() round trips, both for payloads that
+        // inflate within unzip's scratch window and for ones that have to
+        // be parsed as they stream through it.
+        LLSD small = LLSD::emptyMap();
+        small["name"] = "small";
+        small["values"].append(1);
+        small["values"].append(2.5);
+
+        LLSD large = LLSD::emptyArray();
+        for (S32 i = 0; i < 20000; ++i)
+        {
+            large.append(LLSD::Binary(64, U8(i)));
+        }
+
+        for (const LLSD& v : { small, large })
+        {
+            std::string zipped = zip_llsd(const_cast<LLSD&>(v));
+            ensure("zip_llsd produced output", !zipped.empty());
+
+            LLSD unzipped;
+            ensure_equals("unzip_llsd result",
+                          LLUZipHelper::unzip_llsd(unzipped, (const U8*)zipped.data(), (S32)zipped.size()),
+                          LLUZipHelper::ZR_OK);
+            ensure_equals("unzip_llsd value", unzipped, v);
+
+            LLMemoryStream istr((const U8*)zipped.data(), (S32)zipped.size());
+            unzipped.clear();
+            ensure_equals("unzip_llsd stream result",
+                          LLUZipHelper::unzip_llsd(unzipped, istr, (S32)zipped.size()),
+                          LLUZipHelper::ZR_OK);
+            ensure_equals("unzip_llsd stream value", unzipped, v);
+
+            LLSD truncated;
+            ensure("truncated payload rejected",
+                   LLUZipHelper::unzip_llsd(truncated, (const U8*)zipped.data(), (S32)zipped.size() / 2)
+                   != LLUZipHelper::ZR_OK);
+
+            std::string corrupt(zipped);
+            corrupt[corrupt.size() - 1] ^= 0xff; // adler32 trailer
+            LLSD corrupted;
+            ensure("corrupt checksum rejected",
+                   LLUZipHelper::unzip_llsd(corrupted, (const U8*)corrupt.data(), (S32)corrupt.size())
+                   != LLUZipHelper::ZR_OK);
+        }
+    }
+
+    template<> template<>
+    void TestLLSDBinaryParsingObject::test<14>()
+    {
+        // A streamed unzip keeps the parser's length checks: a binary
+        // claiming nearly 2 GB after enough data to overflow the scratch
+        // window is rejected rather than allocated.
+        std::string raw("[");
+        auto append_size = [&raw](U32 size)
+        {
+            U32 net_size = htonl(size);
+            raw.append((const char*)&net_size, sizeof(net_size));
+        };
+        append_size(2);
+        raw += 'b';
+        append_size(600000);
+        raw.append(600000, '\0');
+        raw += 'b';
+        append_size(0x7ffffff0);
+        raw += ']';
+
+        uLongf zipped_size = compressBound((uLong)raw.size());
+        std::vector<U8> zipped(zipped_size);
+        ensure_equals("compress", compress(&zipped[0], &zipped_size, (const Bytef*)raw.data(), (uLong)raw.size()), Z_OK);
+
+        LLSD hostile;
+        ensure_equals("hostile length rejected",
+                      LLUZipHelper::unzip_llsd(hostile, &zipped[0], (S32)zipped_size),
+                      LLUZipHelper::ZR_PARSE_ERROR);
     }
-*/
 
    /**
      * @class TestLLSDCrossCompatible
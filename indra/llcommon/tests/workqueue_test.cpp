@@ -15,8 +15,11 @@
 #include "workqueue.h"
 // STL headers
 // std headers
+#include <atomic>
 #include <chrono>
 #include <deque>
+#include <thread>
+#include <vector>
 // external library headers
 // other Linden headers
 #include "../test/lltut.h"
@@ -236,4 +239,184 @@ namespace tut
         ensure_equals("didn't run coroutine", stored, "ran");
         ensure("void waitForResult() didn't return", done);
     }
+
+    struct workstealing_data
+    {
+        WorkStealingQueue queue{"stealing"};
+
+        // Drive QUEUE with 'threads' workers: post 'items' work items from
+        // this thread, each of which posts 'fanout' more from its worker.
+        // Returns elapsed seconds.
+        template <class QUEUE>
+        static F64 throughput(size_t threads, S32 items, S32 fanout)
+        {
+            QUEUE q(std::string(), 1024*1024, false);
+            std::atomic<S32> count{ 0 };
+            const S32 expected = items * (1 + fanout);
+            std::vector<std::thread> workers;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&q](){ q.runUntilClose(); });
+            }
+            for (S32 i = 0; i < items; ++i)
+            {
+                q.post([&q, &count, fanout]()
+                       {
+                           ++count;
+                           for (S32 j = 0; j < fanout; ++j)
+                           {
+                               q.post([&count](){ ++count; });
+                           }
+                       });
+            }
+            while (count < expected)
+            {
+                std::this_thread::yield();
+            }
+            q.close();
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+            ensure_equals("lost work items", S32(count), expected);
+            ensure("queue not drained", q.done());
+            return std::chrono::duration<F64>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+    typedef test_group<workstealing_data> workstealing_group;
+    typedef workstealing_group::object stealing_object;
+    workstealing_group workstealinggrp("workstealingqueue");
+
+    template<> template<>
+    void stealing_object::test<1>()
+    {
+        set_test_name("post");
+        std::vector<S32> ran;
+        // single thread: runUntilClose() drains everything posted before
+        // close(), and nothing can be posted after
+        for (S32 i = 0; i < 10; ++i)
+        {
+            queue.post([&ran, i](){ ran.push_back(i); });
+        }
+        ensure_equals("size", queue.size(), size_t(10));
+        queue.close();
+        ensure("posted after close", ! queue.post([](){}));
+        ensure("done too soon", ! queue.done());
+        queue.runUntilClose();
+        ensure_equals("didn't run everything", ran.size(), size_t(10));
+        ensure("not done", queue.done());
+    }
+
+    template<> template<>
+    void stealing_object::test<2>()
+    {
+        set_test_name("postTo");
+        WorkQueue main("main");
+        auto qptr = WorkStealingQueue::getInstance("stealing");
+        int result = 0;
+        main.postTo(
+            qptr,
+            [](){ return 17; },
+            [&result](int i){ result = i; });
+        qptr->runOne();
+        main.runOne();
+        ensure_equals("failed to run int callback", result, 17);
+    }
+
+    template<> template<>
+    void stealing_object::test<3>()
+    {
+        set_test_name("tryPost");
+        WorkStealingQueue small("small", 2);
+        ensure("first", small.tryPost([](){}));
+        ensure("second", small.tryPost([](){}));
+        ensure("accepted past capacity", ! small.tryPost([](){}));
+        small.runOne();
+        ensure("no room after runOne()", small.tryPost([](){}));
+    }
+
+    template<> template<>
+    void stealing_object::test<4>()
+    {
+        set_test_name("throughput");
+        // Timings are logged for comparison, not asserted: they depend on
+        // the machine. Correctness (every item ran) is asserted.
+        const S32 ITEMS = 100000;
+        for (S32 fanout : { 0, 4 })
+        {
+            for (size_t threads : { 1, 4, 8 })
+            {
+                F64 shared = throughput<WorkQueue>(threads, ITEMS, fanout);
+                F64 stealing = throughput<WorkStealingQueue>(threads, ITEMS, fanout);
+                LL_INFOS("WorkQueue") << threads << " threads, fanout " << fanout
+                                      << ": WorkQueue " << shared
+                                      << "s, WorkStealingQueue " << stealing << "s" << LL_ENDL;
+            }
+        }
+    }
+
+    struct priority_data
+    {
+        PriorityWorkQueue queue{"priority"};
+        std::string order;
+
+        PriorityWorkQueue::Handle post(const std::string& name, F32 priority)
+        {
+            auto handle = queue.makeHandle();
+            queue.post([this, name](){ order.append(name); }, priority, handle);
+            return handle;
+        }
+    };
+    typedef test_group<priority_data> priority_group;
+    typedef priority_group::object priority_object;
+    priority_group prioritygrp("priorityworkqueue");
+
+    template<> template<>
+    void priority_object::test<1>()
+    {
+        set_test_name("priority order");
+        post("a", 1.f);
+        post("b", 3.f);
+        post("c", 2.f);
+        post("d", 3.f);
+        // anonymous post() is priority 0
+        queue.post([this](){ order.append("e"); });
+        queue.runPending();
+        ensure_equals("highest first, FIFO among equals", order, "bdcae");
+    }
+
+    template<> template<>
+    void priority_object::test<2>()
+    {
+        set_test_name("setPriority and cancel");
+        auto a = post("a", 1.f);
+        auto b = post("b", 2.f);
+        auto c = post("c", 3.f);
+        ensure("reprioritize queued", queue.setPriority(a, 10.f));
+        ensure("cancel queued", queue.cancel(c));
+        ensure("cancel twice", ! queue.cancel(c));
+        ensure("reprioritize cancelled", ! queue.setPriority(c, 1.f));
+        ensure_equals("size after cancel", queue.size(), size_t(2));
+        queue.runOne();
+        ensure_equals("reprioritized item ran first", order, "a");
+        ensure("reprioritize taken", ! queue.setPriority(a, 1.f));
+        queue.runPending();
+        ensure_equals("cancelled item never ran", order, "ab");
+        ensure("cancel taken", ! queue.cancel(b));
+    }
+
+    template<> template<>
+    void priority_object::test<3>()
+    {
+        set_test_name("handles");
+        auto a = post("a", 1.f);
+        ensure("duplicate handle accepted",
+               ! queue.post([this](){ order.append("x"); }, 1.f, a));
+        queue.close();
+        ensure("posted after close", ! queue.post([](){}, 1.f, queue.makeHandle()));
+        queue.runUntilClose();
+        ensure_equals("wrong work ran", order, "a");
+        ensure("not done", queue.done());
+    }
 } // namespace tut
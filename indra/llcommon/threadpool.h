@@ -136,6 +136,12 @@ namespace LL
     /// ThreadPool is shorthand for using the simpler WorkQueue
     using ThreadPool = ThreadPoolUsing<WorkQueue>;
 
+    /// WorkStealingThreadPool gives each worker thread its own deque
+    using WorkStealingThreadPool = ThreadPoolUsing<WorkStealingQueue>;
+
+    /// PriorityThreadPool runs the highest priority work first
+    using PriorityThreadPool = ThreadPoolUsing<PriorityWorkQueue>;
+
 } // namespace LL
 
 #endif /* ! defined(LL_THREADPOOL_H) */
@@ -14,6 +14,7 @@
 // associated header
 #include "workqueue.h"
 // STL headers
+#include <condition_variable>
 // std headers
 // external library headers
 // other Linden headers
@@ -356,3 +357,547 @@ bool LL::WorkSchedule::tryPop_(Work& work)
 {
     return mQueue.tryPop(work);
 }
+
+/*****************************************************************************
+*   WorkStealingQueue
+*****************************************************************************/
+namespace
+{
+    // Upper bound on the injection ring; once it is full, work posted from
+    // outside the pool spills into the locked overflow list.
+    constexpr size_t MAX_RING_SIZE = 4096;
+    // Threads beyond this many still run and steal work, they just don't
+    // get a deque of their own.
+    constexpr size_t MAX_DEQUE_WORKERS = 64;
+    // Identifies a queue for the thread-local worker lookup. Unlike the
+    // queue's address, it is never reused by a later queue.
+    std::atomic<U64> sQueueSerial{ 0 };
+}
+
+struct LL::WorkStealingQueue::Worker
+{
+    std::mutex mMutex;
+    std::deque<Work> mDeque;
+};
+
+struct LL::WorkStealingQueue::Cell
+{
+    std::atomic<size_t> mSequence;
+    Work mWork;
+};
+
+LL::WorkStealingQueue::WorkStealingQueue(const std::string& name, size_t capacity, bool auto_shutdown):
+    super(name, auto_shutdown),
+    mCapacity(capacity),
+    mSerial(++sQueueSerial),
+    mWorkers(new Worker[MAX_DEQUE_WORKERS])
+{
+    size_t ring_size = 1;
+    while (ring_size < std::min(capacity, MAX_RING_SIZE))
+    {
+        ring_size <<= 1;
+    }
+    mRing.reset(new Cell[ring_size]);
+    for (size_t i = 0; i < ring_size; ++i)
+    {
+        mRing[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+    mRingMask = ring_size - 1;
+}
+
+LL::WorkStealingQueue::~WorkStealingQueue()
+{
+}
+
+void LL::WorkStealingQueue::close()
+{
+    mClosed = true;
+    LLCoros::LockType lock(mSleepMutex);
+    mWorkCond.notify_all();
+    mSpaceCond.notify_all();
+}
+
+size_t LL::WorkStealingQueue::size()
+{
+    return mPending;
+}
+
+bool LL::WorkStealingQueue::isClosed()
+{
+    return mClosed;
+}
+
+bool LL::WorkStealingQueue::done()
+{
+    return mClosed && mPending == 0;
+}
+
+bool LL::WorkStealingQueue::post(const Work& callable)
+{
+    return reserve(true) && push(callable);
+}
+
+bool LL::WorkStealingQueue::tryPost(const Work& callable)
+{
+    return reserve(false) && push(callable);
+}
+
+bool LL::WorkStealingQueue::reserve(bool wait)
+{
+    // Count the item as pending before checking mClosed: a worker that sees
+    // the queue closed must also see this item, or it might quit without
+    // running it.
+    size_t pending = mPending;
+    for (;;)
+    {
+        if (pending < mCapacity)
+        {
+            if (mPending.compare_exchange_weak(pending, pending + 1))
+            {
+                break;
+            }
+        }
+        else if (! wait || mClosed)
+        {
+            return false;
+        }
+        else
+        {
+            LLCoros::LockType lock(mSleepMutex);
+            mSpaceCond.wait(lock, [this]{ return mClosed || mPending < mCapacity; });
+            pending = mPending;
+        }
+    }
+
+    if (mClosed)
+    {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void LL::WorkStealingQueue::release()
+{
+    if (mPending-- == mCapacity)
+    {
+        // someone may be blocked in post() waiting for room
+        LLCoros::LockType lock(mSleepMutex);
+        mSpaceCond.notify_all();
+    }
+}
+
+bool LL::WorkStealingQueue::push(const Work& work)
+{
+    if (Worker* self = getWorker(false))
+    {
+        std::lock_guard<std::mutex> lock(self->mMutex);
+        self->mDeque.push_back(work);
+    }
+    else if (! ringPush(work))
+    {
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        mOverflow.push_back(work);
+        ++mOverflowSize;
+    }
+
+    if (mSleepers > 0)
+    {
+        LLCoros::LockType lock(mSleepMutex);
+        mWorkCond.notify_one();
+    }
+    return true;
+}
+
+LL::WorkStealingQueue::Work LL::WorkStealingQueue::pop_()
+{
+    Worker* self = getWorker(true);
+    Work work;
+    for (;;)
+    {
+        if (take(self, work))
+        {
+            return work;
+        }
+        if (mClosed && mPending == 0)
+        {
+            LLTHROW(Closed());
+        }
+
+        LLCoros::LockType lock(mSleepMutex);
+        ++mSleepers;
+        mWorkCond.wait(lock, [this]{ return mClosed || mPending > 0; });
+        --mSleepers;
+    }
+}
+
+bool LL::WorkStealingQueue::tryPop_(Work& work)
+{
+    return take(getWorker(false), work);
+}
+
+LL::WorkStealingQueue::Worker* LL::WorkStealingQueue::getWorker(bool create)
+{
+    // A worker thread serves a single queue, so remembering one suffices.
+    static thread_local U64 sSerial = 0;
+    static thread_local Worker* sWorker = nullptr;
+    if (sSerial == mSerial)
+    {
+        return sWorker;
+    }
+    if (! create)
+    {
+        return nullptr;
+    }
+
+    size_t index = mWorkerCount;
+    while (index < MAX_DEQUE_WORKERS
+           && ! mWorkerCount.compare_exchange_weak(index, index + 1))
+    {
+    }
+    sSerial = mSerial;
+    sWorker = (index < MAX_DEQUE_WORKERS) ? &mWorkers[index] : nullptr;
+    return sWorker;
+}
+
+bool LL::WorkStealingQueue::take(Worker* self, Work& work)
+{
+    bool found = false;
+    if (self)
+    {
+        // own deque, newest first
+        std::lock_guard<std::mutex> lock(self->mMutex);
+        if (! self->mDeque.empty())
+        {
+            work = std::move(self->mDeque.back());
+            self->mDeque.pop_back();
+            found = true;
+        }
+    }
+
+    if (! found)
+    {
+        found = ringPop(work);
+    }
+
+    if (! found && mOverflowSize > 0)
+    {
+        std::lock_guard<std::mutex> lock(mOverflowMutex);
+        if (! mOverflow.empty())
+        {
+            work = std::move(mOverflow.front());
+            mOverflow.pop_front();
+            --mOverflowSize;
+            found = true;
+        }
+    }
+
+    if (! found)
+    {
+        // steal the oldest item from some other worker, starting from a
+        // different victim each time to spread the contention
+        static thread_local size_t sVictim = 0;
+        size_t count = std::min(size_t(mWorkerCount), MAX_DEQUE_WORKERS);
+        for (size_t i = 0; i < count && ! found; ++i)
+        {
+            Worker& victim = mWorkers[sVictim++ % count];
+            if (&victim == self)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(victim.mMutex);
+            if (! victim.mDeque.empty())
+            {
+                work = std::move(victim.mDeque.front());
+                victim.mDeque.pop_front();
+                found = true;
+            }
+        }
+    }
+
+    if (found)
+    {
+        release();
+    }
+    return found;
+}
+
+// Bounded MPMC ring after Dmitry Vyukov: each cell's sequence number says
+// whether it is ready to be written (== position) or read (== position + 1)
+// on the current lap.
+bool LL::WorkStealingQueue::ringPush(const Work& work)
+{
+    Cell* cell;
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &mRing[pos & mRingMask];
+        size_t seq = cell->mSequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos);
+        if (diff == 0)
+        {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // ring is full
+            return false;
+        }
+        else
+        {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->mWork = work;
+    cell->mSequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool LL::WorkStealingQueue::ringPop(Work& work)
+{
+    Cell* cell;
+    size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &mRing[pos & mRingMask];
+        size_t seq = cell->mSequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos + 1);
+        if (diff == 0)
+        {
+            if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // ring is empty
+            return false;
+        }
+        else
+        {
+            pos = mDequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    work = std::move(cell->mWork);
+    cell->mWork = nullptr;
+    cell->mSequence.store(pos + mRingMask + 1, std::memory_order_release);
+    return true;
+}
+
+/*****************************************************************************
+*   PriorityWorkQueue
+*****************************************************************************/
+LL::PriorityWorkQueue::PriorityWorkQueue(const std::string& name, size_t capacity, bool auto_shutdown):
+    super(name, auto_shutdown),
+    mCapacity(capacity)
+{
+}
+
+void LL::PriorityWorkQueue::close()
+{
+    LLCoros::LockType lock(mMutex);
+    mClosed = true;
+    lock.unlock();
+    mEmptyCond.notify_all();
+    mCapacityCond.notify_all();
+}
+
+size_t LL::PriorityWorkQueue::size()
+{
+    LLCoros::LockType lock(mMutex);
+    return mQueue.size();
+}
+
+bool LL::PriorityWorkQueue::isClosed()
+{
+    LLCoros::LockType lock(mMutex);
+    return mClosed;
+}
+
+bool LL::PriorityWorkQueue::done()
+{
+    LLCoros::LockType lock(mMutex);
+    return mClosed && mQueue.empty();
+}
+
+bool LL::PriorityWorkQueue::post(const Work& callable)
+{
+    return post(callable, 0.f);
+}
+
+bool LL::PriorityWorkQueue::post(const Work& callable, F32 priority, Handle handle)
+{
+    LLCoros::LockType lock(mMutex);
+    mCapacityCond.wait(lock, [this](){ return mClosed || mQueue.size() < mCapacity; });
+    return push_(lock, callable, priority, handle);
+}
+
+bool LL::PriorityWorkQueue::tryPost(const Work& callable)
+{
+    LLCoros::LockType lock(mMutex);
+    if (mQueue.size() >= mCapacity)
+    {
+        return false;
+    }
+    return push_(lock, callable, 0.f, 0);
+}
+
+bool LL::PriorityWorkQueue::push_(LLCoros::LockType& lock, const Work& callable, F32 priority, Handle handle)
+{
+    if (mClosed || (handle && mHandles.find(handle) != mHandles.end()))
+    {
+        return false;
+    }
+
+    auto inserted = mQueue.emplace(Key{ priority, mSequence++ }, Item{ callable, handle });
+    if (handle)
+    {
+        mHandles.emplace(handle, inserted.first);
+    }
+    lock.unlock();
+    mEmptyCond.notify_one();
+    return true;
+}
+
+LL::PriorityWorkQueue::Handle LL::PriorityWorkQueue::makeHandle()
+{
+    Handle handle;
+    do
+    {
+        handle = ++mLastHandle;
+    } while (handle == 0);
+    return handle;
+}
+
+bool LL::PriorityWorkQueue::setPriority(Handle handle, F32 priority)
+{
+    LLCoros::LockType lock(mMutex);
+    auto found = mHandles.find(handle);
+    if (found == mHandles.end())
+    {
+        return false;
+    }
+    if (found->second->first.mPriority != priority)
+    {
+        // Re-key the node in place: no reallocation, and the item keeps its
+        // original sequence number relative to others at the new priority.
+        auto node = mQueue.extract(found->second);
+        node.key().mPriority = priority;
+        found->second = mQueue.insert(std::move(node)).position;
+    }
+    return true;
+}
+
+bool LL::PriorityWorkQueue::cancel(Handle handle)
+{
+    Work discarded;
+    {
+        LLCoros::LockType lock(mMutex);
+        auto found = mHandles.find(handle);
+        if (found == mHandles.end())
+        {
+            return false;
+        }
+        // destroy the work item (and whatever it binds) outside the lock
+        discarded = std::move(found->second->second.mWork);
+        mQueue.erase(found->second);
+        mHandles.erase(found);
+    }
+    mCapacityCond.notify_one();
+    return true;
+}
+
+LL::PriorityWorkQueue::Work LL::PriorityWorkQueue::take_(LLCoros::LockType& lock)
+{
+    auto front = mQueue.begin();
+    Work work{ std::move(front->second.mWork) };
+    if (front->second.mHandle)
+    {
+        mHandles.erase(front->second.mHandle);
+    }
+    mQueue.erase(front);
+    lock.unlock();
+    mCapacityCond.notify_one();
+    return work;
+}
+
+LL::PriorityWorkQueue::Work LL::PriorityWorkQueue::pop_()
+{
+    LLCoros::LockType lock(mMutex);
+    mEmptyCond.wait(lock, [this](){ return mClosed || ! mQueue.empty(); });
+    if (mQueue.empty())
+    {
+        // closed and drained
+        LLTHROW(Closed());
+    }
+    return take_(lock);
+}
+
+bool LL::PriorityWorkQueue::tryPop_(Work& work)
+{
+    LLCoros::LockType lock(mMutex);
+    if (mQueue.empty())
+    {
+        return false;
+    }
+    work = take_(lock);
+    return true;
+}
+
+/*****************************************************************************
+*   parallel_for()
+*****************************************************************************/
+void LL::parallel_for(WorkQueueBase* queue, S32 count, const std::function<void(S32)>& fn)
+{
+    struct State
+    {
+        State(S32 count, const std::function<void(S32)>& fn): mCount(count), mFn(fn) {}
+
+        // returns true if it finished the last index
+        bool drain()
+        {
+            bool last = false;
+            for (S32 i = mNext++; i < mCount; i = mNext++)
+            {
+                mFn(i);
+                last = (++mFinished == mCount);
+            }
+            return last;
+        }
+
+        const S32 mCount;
+        // only called for claimed indices, all of which complete before
+        // parallel_for() returns
+        const std::function<void(S32)> mFn;
+        std::atomic<S32> mNext{ 0 };
+        std::atomic<S32> mFinished{ 0 };
+        std::mutex mMutex;
+        std::condition_variable mDoneCond;
+    };
+
+    auto state = std::make_shared<State>(count, fn);
+    for (S32 i = 1; i < count; ++i)
+    {
+        // helpers that only get to run after all indices were claimed
+        // find nothing left and drop their reference to state
+        if (!queue->tryPost([state]()
+            {
+                if (state->drain())
+                {
+                    std::lock_guard<std::mutex> lock(state->mMutex);
+                    state->mDoneCond.notify_all();
+                }
+            }))
+        {
+            break;
+        }
+    }
+
+    state->drain();
+    std::unique_lock<std::mutex> lock(state->mMutex);
+    state->mDoneCond.wait(lock, [&state]() { return state->mFinished == state->mCount; });
+}
@@ -17,10 +17,16 @@
 #include "llinstancetracker.h"
 #include "llinstancetrackersubclass.h"
 #include "threadsafeschedule.h"
+#include <atomic>
 #include <chrono>
+#include <deque>
 #include <exception>                // std::current_exception
 #include <functional>               // std::function
+#include <map>
+#include <memory>                   // std::unique_ptr
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace LL
 {
@@ -359,6 +365,203 @@ namespace LL
         bool tryPop_(Work&) override;
     };
 
+/*****************************************************************************
+*   WorkStealingQueue: per-worker deques for ThreadPool
+*****************************************************************************/
+    /**
+     * WorkStealingQueue is a drop-in WorkQueue for a ThreadPool whose workers
+     * would otherwise all contend on the single lock of an
+     * LLThreadSafeQueue. Each thread that calls runUntilClose() on it gets
+     * its own deque:
+     *
+     * * Work posted by one of this queue's own workers goes onto that
+     *   worker's deque, and the worker takes it back from the same end,
+     *   while it is still hot in cache.
+     * * Work posted from any other thread goes into a lock-free injection
+     *   ring (spilling into a locked overflow list if the ring fills).
+     * * A worker whose deque is empty takes from the injection ring, then
+     *   steals from the opposite end of the other workers' deques, and only
+     *   sleeps when there is nothing anywhere.
+     *
+     * post(), tryPost(), postTo(), waitForResult() and the run*() methods
+     * behave as for WorkQueue, except that items are not run in strict FIFO
+     * order: a worker runs its own most recently posted item first.
+     */
+    class WorkStealingQueue: public LLInstanceTrackerSubclass<WorkStealingQueue, WorkQueueBase>
+    {
+    private:
+        using super = LLInstanceTrackerSubclass<WorkStealingQueue, WorkQueueBase>;
+
+    public:
+        /**
+         * You may omit the WorkStealingQueue name, in which case a unique
+         * name is synthesized; for practical purposes that makes it
+         * anonymous.
+         */
+        WorkStealingQueue(const std::string& name = std::string(), size_t capacity=1024, bool auto_shutdown = true);
+        ~WorkStealingQueue() override;
+
+        void close() override;
+        size_t size() override;
+        bool isClosed() override;
+        bool done() override;
+
+        /**
+         * post work, unless the queue is closed before we can post
+         */
+        bool post(const Work&) override;
+
+        /**
+         * post work, unless the queue is full
+         */
+        bool tryPost(const Work&) override;
+
+    private:
+        struct Worker;
+        struct Cell;
+
+        Work pop_() override;
+        bool tryPop_(Work&) override;
+
+        Worker* getWorker(bool create);
+        bool reserve(bool wait);
+        void release();
+        bool push(const Work& work);
+        bool take(Worker* self, Work& work);
+        bool ringPush(const Work& work);
+        bool ringPop(Work& work);
+
+        const size_t mCapacity;
+        const U64 mSerial;
+        // items posted and not yet taken, wherever they are
+        std::atomic<size_t> mPending{ 0 };
+        std::atomic<bool> mClosed{ false };
+
+        // injection ring: bounded multi-producer, multi-consumer
+        std::unique_ptr<Cell[]> mRing;
+        size_t mRingMask;
+        alignas(64) std::atomic<size_t> mEnqueuePos{ 0 };
+        alignas(64) std::atomic<size_t> mDequeuePos{ 0 };
+
+        std::mutex mOverflowMutex;
+        std::deque<Work> mOverflow;
+        std::atomic<size_t> mOverflowSize{ 0 };
+
+        // per-worker deques, registered as threads first block in pop_()
+        std::unique_ptr<Worker[]> mWorkers;
+        std::atomic<size_t> mWorkerCount{ 0 };
+
+        // idle workers, and posters blocked on a full queue, wait here
+        LLCoros::Mutex mSleepMutex;
+        LLCoros::ConditionVariable mWorkCond;
+        LLCoros::ConditionVariable mSpaceCond;
+        std::atomic<size_t> mSleepers{ 0 };
+    };
+
+/*****************************************************************************
+*   PriorityWorkQueue: run the most important work first
+*****************************************************************************/
+    /**
+     * PriorityWorkQueue runs work in order of a caller-supplied priority,
+     * highest first, and FIFO among equal priorities. Work posted with a
+     * Handle can be reprioritized while it waits -- e.g. a texture decode
+     * whose object has just come into view -- or cancelled outright. Once a
+     * worker has taken an item, its Handle no longer refers to anything.
+     *
+     * The plain post() and tryPost() overloads, and therefore postTo() and
+     * waitForResult(), post anonymously at priority 0.
+     */
+    class PriorityWorkQueue: public LLInstanceTrackerSubclass<PriorityWorkQueue, WorkQueueBase>
+    {
+    private:
+        using super = LLInstanceTrackerSubclass<PriorityWorkQueue, WorkQueueBase>;
+
+    public:
+        /// 0 is never a valid Handle
+        using Handle = U32;
+
+        /**
+         * You may omit the PriorityWorkQueue name, in which case a unique
+         * name is synthesized; for practical purposes that makes it
+         * anonymous.
+         */
+        PriorityWorkQueue(const std::string& name = std::string(), size_t capacity=1024, bool auto_shutdown = true);
+
+        void close() override;
+        size_t size() override;
+        bool isClosed() override;
+        bool done() override;
+
+        /**
+         * post work at priority 0, unless the queue is closed before we can
+         * post
+         */
+        bool post(const Work& callable) override;
+
+        /**
+         * post work at the specified priority, unless the queue is closed
+         * before we can post. Pass a Handle from makeHandle() to be able to
+         * setPriority() or cancel() it later; a Handle already in the queue
+         * is refused.
+         */
+        bool post(const Work& callable, F32 priority, Handle handle = 0);
+
+        /**
+         * post work at priority 0, unless the queue is full
+         */
+        bool tryPost(const Work& callable) override;
+
+        /// A fresh Handle to pass to post()
+        Handle makeHandle();
+
+        /**
+         * Change the priority of work still waiting in the queue. Returns
+         * false if that work has already been taken or cancelled.
+         */
+        bool setPriority(Handle handle, F32 priority);
+
+        /**
+         * Discard work still waiting in the queue. Returns false if that
+         * work has already been taken or cancelled.
+         */
+        bool cancel(Handle handle);
+
+    private:
+        struct Key
+        {
+            F32 mPriority;
+            U64 mSequence;
+
+            bool operator<(const Key& other) const
+            {
+                return (mPriority != other.mPriority) ?
+                    (mPriority > other.mPriority) : (mSequence < other.mSequence);
+            }
+        };
+        struct Item
+        {
+            Work mWork;
+            Handle mHandle;
+        };
+        using Queue = std::map<Key, Item>;
+
+        bool push_(LLCoros::LockType& lock, const Work& callable, F32 priority, Handle handle);
+        Work take_(LLCoros::LockType& lock);
+
+        Work pop_() override;
+        bool tryPop_(Work&) override;
+
+        LLCoros::Mutex mMutex;
+        LLCoros::ConditionVariable mCapacityCond;
+        LLCoros::ConditionVariable mEmptyCond;
+        Queue mQueue;
+        std::unordered_map<Handle, Queue::iterator> mHandles;
+        const size_t mCapacity;
+        U64 mSequence{ 0 };
+        bool mClosed{ false };
+        std::atomic<Handle> mLastHandle{ 0 };
+    };
+
     /**
      * BackJack is, in effect, a hand-rolled lambda, binding a WorkSchedule, a
      * CALLABLE that returns bool, a TimePoint and an interval at which to
@@ -631,6 +834,17 @@ namespace LL
             (this, std::forward<CALLABLE>(callable), std::forward<ARGS>(args)...);
     }
 
+/*****************************************************************************
+*   parallel_for()
+*****************************************************************************/
+    /**
+     * Runs fn(0) .. fn(count - 1), letting idle workers of queue take some
+     * of the indices. The calling thread claims indices as well and only
+     * ever waits for ones that are already running, so this is safe to call
+     * from one of queue's own workers even when no other worker is free.
+     */
+    void parallel_for(WorkQueueBase* queue, S32 count, const std::function<void(S32)>& fn);
+
 } // namespace LL
 
 #endif /* ! defined(LL_WORKQUEUE_H) */
@@ -144,6 +144,12 @@ constexpr long HTTP_REQUEST_XFER_TIMEOUT_DEFAULT = 0L;
 constexpr long HTTP_REQUEST_TIMEOUT_MIN = 0L;
 constexpr long HTTP_REQUEST_TIMEOUT_MAX = 3600L;
 
+// Response bodies are reserved in one block from their
+// Content-Length so consumers can take them without copying.
+// Larger claims fall back to incremental blocks rather than
+// trusting the server with the allocation.
+constexpr size_t HTTP_REPLY_RESERVE_MAX = 32 * 1024 * 1024;
+
 // Limits on connection counts
 constexpr int HTTP_CONNECTION_LIMIT_DEFAULT = 8;
 constexpr int HTTP_CONNECTION_LIMIT_MIN = 1;
@@ -153,6 +159,12 @@ constexpr int HTTP_CONNECTION_LIMIT_MAX = 256;
 constexpr long HTTP_PIPELINING_DEFAULT = 0L;
 constexpr long HTTP_PIPELINING_MAX = 20L;
 
+// HTTP/2 limits
+constexpr long HTTP_HTTP2_DEFAULT = 0L;
+constexpr long HTTP_HTTP2_PRIOR_KNOWLEDGE = 2L;
+constexpr long HTTP_HTTP2_STREAM_LIMIT_DEFAULT = 16L;
+constexpr long HTTP_HTTP2_STREAM_LIMIT_MAX = 256L;
+
 // Miscellaneous defaults
 constexpr bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 constexpr long HTTP_THROTTLE_RATE_DEFAULT = 0L;
@@ -163,6 +175,11 @@ constexpr long HTTP_THROTTLE_RATE_DEFAULT = 0L;
 // request, ready and active queues.
 constexpr int HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS = 2;
 
+// Longest time worker thread blocks waiting on libcurl sockets
+// when requests are active.  Sockets, timeouts and new requests
+// end the wait early so this only bounds missed events.
+constexpr int HTTP_SERVICE_LOOP_WAIT_MAX_MS = 100;
+
 // Block allocation size (a tuning parameter) is found
 // in bufferarray.h.
 
@@ -30,6 +30,7 @@
 #include "bufferarray.h"
 #include "_httpoprequest.h"
 #include "_httppolicy.h"
+#include "httpstats.h"
 
 #include "llhttpconstants.h"
 
@@ -64,7 +65,8 @@ HttpLibcurl::HttpLibcurl(HttpService * service)
       mPolicyCount(0),
       mMultiHandles(NULL),
       mActiveHandles(NULL),
-      mDirtyPolicy(NULL)
+      mDirtyPolicy(NULL),
+      mCompleted(false)
 {}
 
 
@@ -146,6 +148,7 @@ HttpService::ELoopSpeed HttpLibcurl::processTransport()
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
     HttpService::ELoopSpeed ret(HttpService::REQUEST_SLEEP);
+    mCompleted = false;
 
     // Give libcurl some cycles to do I/O & callbacks
     for (unsigned int policy_class(0); policy_class < mPolicyCount; ++policy_class)
@@ -192,6 +195,7 @@ HttpService::ELoopSpeed HttpLibcurl::processTransport()
                     handle = NULL;                  // No longer valid on return
                     ret = HttpService::NORMAL;      // If anything completes, we may have a free slot.
                                                     // Turning around quickly reduces connection gap by 7-10mS.
+                    mCompleted = true;
                 }
                 else if (CURLMSG_NONE == msg->msg)
                 {
@@ -217,6 +221,127 @@ HttpService::ELoopSpeed HttpLibcurl::processTransport()
 }
 
 
+// Waits on every policy class's sockets with a single
+// curl_multi_poll() on the first multi handle, the one wakeup()
+// signals.  The other handles' sockets are passed in as extra
+// descriptors and the shortest libcurl timeout bounds the wait.
+bool HttpLibcurl::waitForActivity(int max_wait_ms)
+{
+#if (LIBCURL_VERSION_NUM >= 0x074400)
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+    if (! mPolicyCount || ! mMultiHandles[0])
+    {
+        return false;
+    }
+    if (mCompleted)
+    {
+        mCompleted = false;
+        return true;
+    }
+
+    long timeout(max_wait_ms);
+    std::vector<curl_waitfd> extra_fds;
+    for (unsigned int policy_class(0); policy_class < mPolicyCount; ++policy_class)
+    {
+        if (! mMultiHandles[policy_class] || ! mActiveHandles[policy_class])
+        {
+            continue;
+        }
+
+        long class_timeout(-1);
+        curl_multi_timeout(mMultiHandles[policy_class], &class_timeout);
+        if (class_timeout >= 0)
+        {
+            timeout = (std::min)(timeout, class_timeout);
+        }
+        if (! policy_class)
+        {
+            // Polled directly
+            continue;
+        }
+
+        fd_set read_fds, write_fds, except_fds;
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        FD_ZERO(&except_fds);
+        int max_fd(-1);
+        curl_multi_fdset(mMultiHandles[policy_class], &read_fds, &write_fds, &except_fds, &max_fd);
+        if (max_fd < 0)
+        {
+            // Nothing to wait on yet (e.g. resolving), poll as before
+            timeout = (std::min)(timeout, long(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS));
+            continue;
+        }
+
+        auto add_fd = [&](curl_socket_t fd)
+        {
+            curl_waitfd wait_fd;
+            wait_fd.fd = fd;
+            wait_fd.events = 0;
+            wait_fd.revents = 0;
+            if (FD_ISSET(fd, &read_fds))
+                wait_fd.events |= CURL_WAIT_POLLIN;
+            if (FD_ISSET(fd, &write_fds))
+                wait_fd.events |= CURL_WAIT_POLLOUT;
+            if (FD_ISSET(fd, &except_fds))
+                wait_fd.events |= CURL_WAIT_POLLPRI;
+            if (wait_fd.events)
+                extra_fds.push_back(wait_fd);
+        };
+#if LL_WINDOWS
+        // Windows fd_sets are socket arrays, not bitmaps
+        std::set<curl_socket_t> sockets;
+        for (u_int i(0); i < read_fds.fd_count; ++i)
+            sockets.insert(read_fds.fd_array[i]);
+        for (u_int i(0); i < write_fds.fd_count; ++i)
+            sockets.insert(write_fds.fd_array[i]);
+        for (u_int i(0); i < except_fds.fd_count; ++i)
+            sockets.insert(except_fds.fd_array[i]);
+        for (curl_socket_t fd : sockets)
+        {
+            add_fd(fd);
+        }
+#else
+        for (int fd(0); fd <= max_fd; ++fd)
+        {
+            add_fd(fd);
+        }
+#endif
+    }
+
+    if (timeout > 0)
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_NETWORK("httppt - curl_multi_poll");
+        int numfds(0);
+        CURLMcode status = curl_multi_poll(mMultiHandles[0],
+                                           extra_fds.empty() ? NULL : &extra_fds[0],
+                                           (unsigned int) extra_fds.size(),
+                                           int(timeout),
+                                           &numfds);
+        if (CURLM_OK != status)
+        {
+            check_curl_multi_code(status);
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void HttpLibcurl::wakeup()
+{
+#if (LIBCURL_VERSION_NUM >= 0x074400)
+    if (mPolicyCount && mMultiHandles && mMultiHandles[0])
+    {
+        curl_multi_wakeup(mMultiHandles[0]);
+    }
+#endif
+}
+
+
 // Caller has provided us with a ref count on op.
 void HttpLibcurl::addOp(const HttpOpRequest::ptr_t &op)
 {
@@ -245,6 +370,12 @@ void HttpLibcurl::addOp(const HttpOpRequest::ptr_t &op)
     mActiveOps.insert(op);
     ++mActiveHandles[op->mReqPolicy];
 
+    if (mService->getPolicy().getClassOptions(op->mReqPolicy).mHttp2)
+    {
+        // Requests in flight on the class's shared connections
+        HTTPStats::instance().recordStreamsInUse(mActiveHandles[op->mReqPolicy]);
+    }
+
     if (op->mTracing > HTTP_TRACE_OFF)
     {
         HttpPolicy & policy(mService->getPolicy());
@@ -363,6 +494,16 @@ bool HttpLibcurl::completeRequest(CURLM * multi_handle, CURL * handle, CURLcode
     {
         op->mStatus = HttpStatus(HttpStatus::EXT_CURL_EASY, status);
     }
+    if (handle && CURLE_OK == status)
+    {
+        // A transfer that didn't have to connect reused a cached or
+        // shared (multiplexed) connection
+        long new_connects(0);
+        long http_version(CURL_HTTP_VERSION_NONE);
+        curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &new_connects);
+        curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &http_version);
+        HTTPStats::instance().recordConnectionUse(0 == new_connects, CURL_HTTP_VERSION_2_0 == http_version);
+    }
     if (op->mStatus)
     {
         // note: CURLINFO_RESPONSE_CODE requires a long - https://curl.haxx.se/libcurl/c/CURLINFO_RESPONSE_CODE.html
@@ -487,7 +628,28 @@ void HttpLibcurl::policyUpdated(unsigned int policy_class)
         policy.stallPolicy(policy_class, false);
         mDirtyPolicy[policy_class] = false;
 
-        if (options.mPipelining > 1)
+        if (options.mHttp2)
+        {
+            // Multiplex HTTP/2 streams, libcurl opens connections up to
+            // the limits and then shares them.  Requests wait for a
+            // connection to allow multiplexing rather than opening
+            // their own (see CURLOPT_PIPEWAIT in HttpOpRequest).
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_PIPELINING,
+                                     long(CURLPIPE_MULTIPLEX));
+#if (LIBCURL_VERSION_NUM >= 0x074300)
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_CONCURRENT_STREAMS,
+                                     long(options.mHttp2StreamLimit));
+#endif
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_HOST_CONNECTIONS,
+                                     long(options.mPerHostConnectionLimit));
+            check_curl_multi_setopt(multi_handle,
+                                     CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                                     long(options.mConnectionLimit));
+        }
+        else if (options.mPipelining > 1)
         {
             // We'll try to do pipelining on this multihandle
             check_curl_multi_setopt(multi_handle,
@@ -77,6 +77,25 @@ public:
     /// Threading:  called by worker thread.
     HttpService::ELoopSpeed processTransport();
 
+    /// Block until libcurl has socket activity or a timeout of its
+    /// own to service, wakeup() is called or @max_wait_ms passes.
+    /// Returns at once if the last processTransport() completed
+    /// requests as policy may have free slots to fill.
+    ///
+    /// @return         False if this libcurl can't wait on its
+    ///                 sockets (before 7.68.0).  Caller should
+    ///                 fall back to a short sleep.
+    ///
+    /// Threading:  called by worker thread.
+    bool waitForActivity(int max_wait_ms);
+
+    /// End a waitForActivity() call early, or the next one if
+    /// none is in progress.
+    ///
+    /// Threading:  callable by any thread between start() and
+    /// shutdown().
+    void wakeup();
+
     /// Add request to the active list.  Caller is expected to have
     /// provided us with a reference count on the op to hold the
     /// request.  (No additional references will be added.)
@@ -215,6 +234,7 @@ protected:
     CURLM **            mMultiHandles;      // One handle per policy class
     int *               mActiveHandles;     // Active count per policy class
     bool *              mDirtyPolicy;       // Dirty policy update waiting for stall (per pc)
+    bool                mCompleted;         // Last processTransport() completed something
 
 }; // end class HttpLibcurl
 
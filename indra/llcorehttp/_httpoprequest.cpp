@@ -723,7 +723,22 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
     {
         xfer_timeout = timeout;
     }
-    if (cpolicy.mPipelining > 1L)
+    if (cpolicy.mHttp2)
+    {
+        // Multiplexed streams share their connection like pipelined
+        // requests do but don't wait on each other.  Keep some of the
+        // pipelining allowance for the shared bandwidth.
+        xfer_timeout *= 2L;
+
+        // Wait for a connection that can take another stream rather
+        // than opening a new one, that's the point of multiplexing.
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION,
+                               (cpolicy.mHttp2 >= HTTP_HTTP2_PRIOR_KNOWLEDGE
+                                ? CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE
+                                : CURL_HTTP_VERSION_2TLS));
+        check_curl_easy_setopt(mCurlHandle, CURLOPT_PIPEWAIT, 1L);
+    }
+    else if (cpolicy.mPipelining > 1L)
     {
         // Pipelining affects both connection and transfer timeout values.
         // Requests that are added to a pipeling immediately have completed
@@ -798,6 +813,20 @@ size_t HttpOpRequest::writeCallback(void * data, size_t size, size_t nmemb, void
     if (! op->mReplyBody)
     {
         op->mReplyBody = new BufferArray();
+
+        // Size the body from the Content-Length, when there is one,
+        // so that it arrives in a single block.
+#if (LIBCURL_VERSION_NUM >= 0x073700)
+        curl_off_t content_length(-1);
+        curl_easy_getinfo(op->mCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+#else
+        double content_length(-1.0);
+        curl_easy_getinfo(op->mCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &content_length);
+#endif
+        if (content_length > 0 && content_length <= static_cast<decltype(content_length)>(HTTP_REPLY_RESERVE_MAX))
+        {
+            op->mReplyBody->reserve(static_cast<size_t>(content_length));
+        }
     }
     const size_t req_size(size * nmemb);
     const size_t write_size(op->mReplyBody->append(static_cast<char *>(data), req_size));
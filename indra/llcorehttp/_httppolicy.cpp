@@ -75,7 +75,8 @@ public:
 
 
 HttpPolicy::HttpPolicy(HttpService * service)
-    : mService(service)
+    : mService(service),
+      mWakeTime(0)
 {
     // Create default class
     mClasses.push_back(new ClassState());
@@ -217,6 +218,16 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
     HttpService::ELoopSpeed result(HttpService::REQUEST_SLEEP);
     HttpLibcurl & transport(mService->getTransport());
 
+    // Earliest of the times a class needs another look
+    mWakeTime = 0;
+    auto wake_at = [this](HttpTime when)
+    {
+        if (! mWakeTime || when < mWakeTime)
+        {
+            mWakeTime = when;
+        }
+    };
+
     for (int policy_class(0); policy_class < mClasses.size(); ++policy_class)
     {
         ClassState & state(*mClasses[policy_class]);
@@ -230,6 +241,7 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
             // the retryq/readyq test or you'll get stalls until you
             // click a setting or an asset request comes in.
             result = HttpService::NORMAL;
+            wake_at(now + HttpTime(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS * 1000));
             continue;
         }
         if (retryq.empty() && readyq.empty())
@@ -244,11 +256,15 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
         {
             // Throttled condition, don't serve this class but don't sleep hard.
             result = HttpService::NORMAL;
+            wake_at(state.mThrottleEnd);
             continue;
         }
 
         int active(transport.getActiveCountInClass(policy_class));
-        int active_limit(state.mOptions.mPipelining > 1L
+        int active_limit(state.mOptions.mHttp2
+                         ? (state.mOptions.mPerHostConnectionLimit
+                            * state.mOptions.mHttp2StreamLimit)
+                         : state.mOptions.mPipelining > 1L
                          ? (state.mOptions.mPerHostConnectionLimit
                             * state.mOptions.mPipelining)
                          : state.mOptions.mConnectionLimit);
@@ -324,6 +340,18 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
         {
             // If anything is ready, continue looping...
             result = HttpService::NORMAL;
+
+            // Requests waiting on a free connection are woken by
+            // transport completions.  Throttled requests and early
+            // retries need a timer.
+            if (throttle_enabled && state.mThrottleLeft <= 0 && now < state.mThrottleEnd)
+            {
+                wake_at(state.mThrottleEnd);
+            }
+            else if (! retryq.empty() && retryq.top()->mPolicyRetryAt > now)
+            {
+                wake_at(retryq.top()->mPolicyRetryAt);
+            }
         }
     } // end foreach policy_class
 
@@ -89,6 +89,18 @@ public:
     /// Threading:  called by worker thread
     HttpService::ELoopSpeed processReadyQueue();
 
+    /// Earliest time, in the totalTime() clock, at which the last
+    /// processReadyQueue() call expects to have more to do without
+    /// any transport activity (throttle windows ending, retries
+    /// coming due, stalls to re-check).  Zero if it is only
+    /// waiting on the transport or new requests.
+    ///
+    /// Threading:  called by worker thread
+    HttpTime getWakeTime() const
+        {
+            return mWakeTime;
+        }
+
     /// Add request to a ready queue.  Caller is expected to have
     /// provided us with a reference count to hold the request.  (No
     /// additional references will be added.)
@@ -169,6 +181,7 @@ protected:
     HttpPolicyGlobal                    mGlobalOptions;
     class_list_t                        mClasses;
     HttpService *                       mService;               // Naked pointer, not refcounted, not owner
+    HttpTime                            mWakeTime;
 };  // end class HttpPolicy
 
 }  // end namespace LLCore
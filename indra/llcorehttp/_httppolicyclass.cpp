@@ -37,7 +37,9 @@ HttpPolicyClass::HttpPolicyClass()
     : mConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
       mPerHostConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
       mPipelining(HTTP_PIPELINING_DEFAULT),
-      mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT)
+      mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT),
+      mHttp2(HTTP_HTTP2_DEFAULT),
+      mHttp2StreamLimit(HTTP_HTTP2_STREAM_LIMIT_DEFAULT)
 {}
 
 
@@ -53,6 +55,8 @@ HttpPolicyClass & HttpPolicyClass::operator=(const HttpPolicyClass & other)
         mPerHostConnectionLimit = other.mPerHostConnectionLimit;
         mPipelining = other.mPipelining;
         mThrottleRate = other.mThrottleRate;
+        mHttp2 = other.mHttp2;
+        mHttp2StreamLimit = other.mHttp2StreamLimit;
     }
     return *this;
 }
@@ -62,7 +66,9 @@ HttpPolicyClass::HttpPolicyClass(const HttpPolicyClass & other)
     : mConnectionLimit(other.mConnectionLimit),
       mPerHostConnectionLimit(other.mPerHostConnectionLimit),
       mPipelining(other.mPipelining),
-      mThrottleRate(other.mThrottleRate)
+      mThrottleRate(other.mThrottleRate),
+      mHttp2(other.mHttp2),
+      mHttp2StreamLimit(other.mHttp2StreamLimit)
 {}
 
 
@@ -86,6 +92,14 @@ HttpStatus HttpPolicyClass::set(HttpRequest::EPolicyOption opt, long value)
         mThrottleRate = llclamp(value, 0L, 1000000L);
         break;
 
+    case HttpRequest::PO_HTTP2:
+        mHttp2 = llclamp(value, 0L, HTTP_HTTP2_PRIOR_KNOWLEDGE);
+        break;
+
+    case HttpRequest::PO_HTTP2_STREAM_LIMIT:
+        mHttp2StreamLimit = llclamp(value, 1L, HTTP_HTTP2_STREAM_LIMIT_MAX);
+        break;
+
     default:
         return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
     }
@@ -114,6 +128,14 @@ HttpStatus HttpPolicyClass::get(HttpRequest::EPolicyOption opt, long * value) co
         *value = mThrottleRate;
         break;
 
+    case HttpRequest::PO_HTTP2:
+        *value = mHttp2;
+        break;
+
+    case HttpRequest::PO_HTTP2_STREAM_LIMIT:
+        *value = mHttp2StreamLimit;
+        break;
+
     default:
         return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
     }
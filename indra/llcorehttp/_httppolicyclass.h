@@ -64,6 +64,8 @@ public:
     long                        mPerHostConnectionLimit;
     long                        mPipelining;
     long                        mThrottleRate;
+    long                        mHttp2;
+    long                        mHttp2StreamLimit;
 };  // end class HttpPolicyClass
 
 }  // end namespace LLCore
@@ -30,6 +30,8 @@
 
 #include <vector>
 
+#include <boost/function.hpp>
+
 #include "httpcommon.h"
 #include "_refcounted.h"
 #include "_mutex.h"
@@ -126,6 +128,18 @@ public:
     /// Threading:  callable by any thread.
     bool stopQueue();
 
+    typedef boost::function<void ()> wakeup_t;
+
+    /// Install a function called when an operation is queued on
+    /// an empty queue or the queue is stopped.  Lets a consumer
+    /// that blocks somewhere other than @fetchAll (e.g. in libcurl)
+    /// notice new requests.  Called with the queue mutex held so
+    /// it must be quick and must not call back into the queue.
+    /// An empty function removes the hook.
+    ///
+    /// Threading:  callable by any thread.
+    void setWakeup(const wakeup_t & wakeup);
+
 protected:
     static HttpRequestQueue *           sInstance;
 
@@ -134,6 +148,7 @@ protected:
     LLCoreInt::HttpMutex                mQueueMutex;
     LLCoreInt::HttpConditionVariable    mQueueCV;
     bool                                mQueueStopped;
+    wakeup_t                            mWakeup;
 
 }; // end class HttpRequestQueue
 
@@ -63,7 +63,9 @@ const HttpService::OptionDescriptor HttpService::sOptionDesc[] =
     {   true,       true,       true,       false,      false   },      // PO_TRACE
     {   true,       true,       false,      true,       false   },      // PO_ENABLE_PIPELINING
     {   true,       true,       false,      true,       false   },      // PO_THROTTLE_RATE
-    {   false,      false,      true,       false,      true    }       // PO_SSL_VERIFY_CALLBACK
+    {   false,      false,      true,       false,      true    },      // PO_SSL_VERIFY_CALLBACK
+    {   true,       true,       false,      true,       false   },      // PO_HTTP2
+    {   true,       true,       false,      true,       false   }       // PO_HTTP2_STREAM_LIMIT
 };
 HttpService * HttpService::sInstance(NULL);
 volatile HttpService::EState HttpService::sState(NOT_INITIALIZED);
@@ -289,6 +291,9 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
 
     LLThread::registerThreadID();
 
+    // New requests end a wait on the transport's sockets
+    mRequestQueue->setWakeup(boost::bind(&HttpLibcurl::wakeup, mTransport));
+
     ELoopSpeed loop(REQUEST_SLEEP);
     while (! mExitRequested)
     {
@@ -305,10 +310,20 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
             new_loop = mTransport->processTransport();
             loop = (std::min)(loop, new_loop);
 
-            // Determine whether to spin, sleep briefly or sleep for next request
+            // Determine whether to wait on the transport or sleep for next request
             if (REQUEST_SLEEP != loop)
             {
-                ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+                int wait_ms(HTTP_SERVICE_LOOP_WAIT_MAX_MS);
+                const HttpTime wake(mPolicy->getWakeTime());
+                if (wake)
+                {
+                    const HttpTime now(totalTime());
+                    wait_ms = wake <= now ? 0 : int((std::min)(HttpTime(wait_ms), (wake - now + 999) / 1000));
+                }
+                if (! mTransport->waitForActivity(wait_ms))
+                {
+                    ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+                }
             }
         }
         catch (const LLContinueError&)
@@ -331,6 +346,9 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
         }
     }
 
+    // Transport is going away, stop waking it
+    mRequestQueue->setWakeup(HttpRequestQueue::wakeup_t());
+
     shutdown();
     sState = STOPPED;
 }
@@ -31,7 +31,8 @@
 
 // BufferArray is a list of chunks, each a BufferArray::Block, of contiguous
 // data presented as a single array.  Chunks are at least BufferArray::BLOCK_ALLOC_SIZE
-// in length and can be larger.  Any chunk may be partially filled or even
+// in length and can be larger, except those sized by reserve() which are
+// exactly as long as asked for.  Any chunk may be partially filled or even
 // empty.
 //
 // The BufferArray itself is sharable as a RefCounted entity.  As shared
@@ -54,31 +55,26 @@ class BufferArray::Block
 public:
     ~Block();
 
-    void operator delete(void *);
-    void operator delete(void *, size_t len);
-
 protected:
-    Block(size_t len);
+    Block(char * data, size_t len);
 
     Block(const Block &);                       // Not defined
     void operator=(const Block &);              // Not defined
 
-    // Allocate the block with the additional space for the
-    // buffered data at the end of the object.
-    void * operator new(size_t len, size_t addl_len);
-
 public:
-    // Only public entry to get a block.
+    // Only public entry to get a block.  Throws std::bad_alloc.
     static Block * alloc(size_t len);
 
+    // Gives up ownership of the data, leaving an empty block.
+    char * detach();
+
 public:
     size_t mUsed;
     size_t mAlloced;
 
-    // *NOTE:  Must be last member of the object.  We'll
-    // overallocate as requested via operator new and index
-    // into the array at will.
-    char mData[1];
+    // Allocated apart from the object with ll_aligned_malloc_16()
+    // so that it can be handed over by detachContiguous().
+    char * mData;
 };
 
 
@@ -177,6 +173,7 @@ void * BufferArray::appendBufferAlloc(size_t len)
         mBlocks.reserve(mBlocks.size() + 5);
     }
     Block * block = Block::alloc((std::max)(BLOCK_ALLOC_SIZE, len));
+    memset(block->mData, 0, len);
     block->mUsed = len;
     mBlocks.push_back(block);
     mLen += len;
@@ -282,6 +279,130 @@ size_t BufferArray::write(size_t pos, const void * src, size_t len)
 }
 
 
+bool BufferArray::reserve(size_t len)
+{
+    if (! len)
+    {
+        return true;
+    }
+    if (! mBlocks.empty())
+    {
+        const Block & last(*mBlocks.back());
+        if (last.mAlloced - last.mUsed >= len)
+        {
+            // Already have the room
+            return true;
+        }
+    }
+
+    if (mBlocks.size() >= mBlocks.capacity())
+    {
+        mBlocks.reserve(mBlocks.size() + 5);
+    }
+    try
+    {
+        mBlocks.push_back(Block::alloc(len));
+    }
+    catch (std::bad_alloc&)
+    {
+        LL_WARNS() << "Unable to reserve " << len << " bytes in BufferArray" << LL_ENDL;
+        return false;
+    }
+    return true;
+}
+
+
+bool BufferArray::isContiguous() const
+{
+    int filled(0);
+    for (container_t::const_iterator it(mBlocks.begin());
+         it != mBlocks.end();
+         ++it)
+    {
+        if ((*it)->mUsed && ++filled > 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+char * BufferArray::contiguousData()
+{
+    Block * block(coalesce());
+    return block ? block->mData : NULL;
+}
+
+
+char * BufferArray::detachContiguous(size_t * len)
+{
+    *len = 0;
+    Block * block(coalesce());
+    if (! block)
+    {
+        return NULL;
+    }
+
+    char * data(block->detach());
+    *len = mLen;
+    for (container_t::iterator it(mBlocks.begin());
+         it != mBlocks.end();
+         ++it)
+    {
+        delete *it;
+    }
+    mBlocks.clear();
+    mLen = 0;
+    return data;
+}
+
+
+BufferArray::Block * BufferArray::coalesce()
+{
+    if (! mLen)
+    {
+        return NULL;
+    }
+
+    if (isContiguous())
+    {
+        for (container_t::iterator it(mBlocks.begin());
+             it != mBlocks.end();
+             ++it)
+        {
+            if ((*it)->mUsed)
+            {
+                return *it;
+            }
+        }
+    }
+
+    Block * block;
+    try
+    {
+        block = Block::alloc(mLen);
+    }
+    catch (std::bad_alloc&)
+    {
+        LL_WARNS() << "Unable to allocate " << mLen << " contiguous bytes in BufferArray" << LL_ENDL;
+        return NULL;
+    }
+    block->mUsed = read(0, block->mData, mLen);
+    llassert_always(block->mUsed == mLen);
+
+    for (container_t::iterator it(mBlocks.begin());
+         it != mBlocks.end();
+         ++it)
+    {
+        delete *it;
+    }
+    mBlocks.clear();
+    mBlocks.push_back(block);
+    return block;
+}
+
+
 int BufferArray::findBlock(size_t pos, size_t * ret_offset)
 {
     *ret_offset = 0;
@@ -323,45 +444,51 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
 // ==================================
 
 
-BufferArray::Block::Block(size_t len)
+BufferArray::Block::Block(char * data, size_t len)
     : mUsed(0),
-      mAlloced(len)
-{
-    memset(mData, 0, len);
-}
+      mAlloced(len),
+      mData(data)
+{}
 
 
 BufferArray::Block::~Block()
 {
+    if (mData)
+    {
+        ll_aligned_free_16(mData);
+        mData = NULL;
+    }
     mUsed = 0;
     mAlloced = 0;
 }
 
 
-void * BufferArray::Block::operator new(size_t len, size_t addl_len)
-{
-    void * mem = new char[len + addl_len + sizeof(void *)];
-    return mem;
-}
-
-
-void BufferArray::Block::operator delete(void * mem)
+char * BufferArray::Block::detach()
 {
-    char * cmem = static_cast<char *>(mem);
-    delete [] cmem;
-}
-
-
-void BufferArray::Block::operator delete(void * mem, size_t)
-{
-    operator delete(mem);
+    char * data(mData);
+    mData = NULL;
+    mUsed = 0;
+    mAlloced = 0;
+    return data;
 }
 
 
 BufferArray::Block * BufferArray::Block::alloc(size_t len)
 {
-    Block * block = new (len) Block(len);
-    return block;
+    char * data = static_cast<char *>(ll_aligned_malloc_16(len));
+    if (! data)
+    {
+        throw std::bad_alloc();
+    }
+    try
+    {
+        return new Block(data, len);
+    }
+    catch (...)
+    {
+        ll_aligned_free_16(data);
+        throw;
+    }
 }
 
 
@@ -120,6 +120,41 @@ public:
     /// size of the instance or do a mix of both.
     size_t write(size_t pos, const void * src, size_t len);
 
+    /// Makes room for at least 'len' more bytes in a single
+    /// block at the end of the instance so that following
+    /// append() calls, up to that length, land in contiguous
+    /// memory.  Size and position are unchanged.  Used to
+    /// size response bodies from their Content-Length.
+    ///
+    /// @return         False if the memory couldn't be allocated.
+    bool reserve(size_t len);
+
+    /// True if all the data is held in a single block and
+    /// contiguousData() won't have to copy.
+    bool isContiguous() const;
+
+    /// Returns a pointer to all the data of the instance in
+    /// contiguous memory, coalescing the blocks into one if
+    /// there are several.  The pointer is valid until the next
+    /// modifying call.
+    ///
+    /// @return         NULL if the instance is empty or the
+    ///                 coalesced block couldn't be allocated.
+    char * contiguousData();
+
+    /// Hands the contiguous data of the instance over to the
+    /// caller, coalescing first as contiguousData() does, and
+    /// leaves the instance empty.  The memory comes from
+    /// ll_aligned_malloc_16() and must be freed with
+    /// ll_aligned_free_16(), it can be given to LLImageBase::setData()
+    /// as is.  Other holders of a reference to the instance will
+    /// see it empty.
+    ///
+    /// @param len      Set to the count of bytes returned.
+    /// @return         NULL if the instance is empty or the
+    ///                 coalesced block couldn't be allocated.
+    char * detachContiguous(size_t * len);
+
 protected:
     int findBlock(size_t pos, size_t * ret_offset);
 
@@ -127,6 +162,11 @@ protected:
 
 protected:
     class Block;
+
+    // Returns the only block holding data, merging all the
+    // blocks into one first if needed.
+    Block * coalesce();
+
     typedef std::vector<Block *> container_t;
 
     container_t         mBlocks;
@@ -232,6 +232,32 @@ public:
         /// Global only
         PO_SSL_VERIFY_CALLBACK,
 
+        /// Long value electing HTTP/2 for the class.  Requests
+        /// on HTTP/2 connections are multiplexed as concurrent
+        /// streams on as few connections as possible instead of
+        /// each taking a connection.  Possible values are:
+        /// 0 - HTTP/1.1 only (default)
+        /// 1 - HTTP/2 where the server offers it during the TLS
+        ///     handshake, HTTP/1.1 otherwise and for http: URLs.
+        /// 2 - HTTP/2 without negotiation, for servers known to
+        ///     speak it (h2c on http: URLs).
+        ///
+        /// When enabled, libcurl manages connections as for
+        /// pipelining (which it replaces) and both PO_CONNECTION_LIMIT
+        /// and PO_PER_HOST_CONNECTION_LIMIT should be set.  Up to
+        /// PO_PER_HOST_CONNECTION_LIMIT times PO_HTTP2_STREAM_LIMIT
+        /// requests are made active at once.
+        ///
+        /// Per-class only
+        PO_HTTP2,
+
+        /// Long value giving the maximum number of concurrent
+        /// streams on one HTTP/2 connection.  Servers may allow
+        /// fewer.  Only used when PO_HTTP2 is enabled.
+        ///
+        /// Per-class only
+        PO_HTTP2_STREAM_LIMIT,
+
         PO_LAST  // Always at end
     };
 
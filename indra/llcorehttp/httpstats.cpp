@@ -44,7 +44,11 @@ void HTTPStats::resetStats()
     mResutCodes.clear();
     mDataDown.reset();
     mDataUp.reset();
+    mStreamsInUse.reset();
     mRequests = 0;
+    mConnectionsOpened = 0;
+    mConnectionsReused = 0;
+    mHTTP2Responses = 0;
 }
 
 
@@ -93,6 +97,13 @@ void HTTPStats::dumpStats()
     out << "Data Sent: " << byte_count_converter(mDataUp.getSum()) << "   (" << mDataUp.getSum() << ")" << std::endl;
     out << "Data Recv: " << byte_count_converter(mDataDown.getSum()) << "   (" << mDataDown.getSum() << ")" << std::endl;
     out << "Total requests: " << mRequests << "(request objects created)" << std::endl;
+    out << "Connections opened: " << mConnectionsOpened << "  reused: " << mConnectionsReused << std::endl;
+    out << "HTTP/2 responses: " << mHTTP2Responses << std::endl;
+    if (mStreamsInUse.getCount())
+    {
+        out << "HTTP/2 streams in use: mean " << mStreamsInUse.getMean()
+            << "  max " << mStreamsInUse.getMaxValue() << std::endl;
+    }
     out << std::endl;
     out << "Result Codes:" << std::endl << "--- -----" << std::endl;
 
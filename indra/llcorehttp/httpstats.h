@@ -59,12 +59,38 @@ namespace LLCore
 
         void    recordResultCode(S32 code);
 
+        // A completed transfer, whether it opened its connection
+        // and whether the response came over HTTP/2
+        void    recordConnectionUse(bool reused, bool http2)
+        {
+            ++(reused ? mConnectionsReused : mConnectionsOpened);
+            if (http2)
+            {
+                ++mHTTP2Responses;
+            }
+        }
+
+        // Requests active in an HTTP/2 class as one more starts
+        void    recordStreamsInUse(S32 streams)
+        {
+            mStreamsInUse.push((F32)streams);
+        }
+
+        S32     getConnectionsOpened() const { return mConnectionsOpened; }
+        S32     getConnectionsReused() const { return mConnectionsReused; }
+        S32     getHTTP2Responses() const { return mHTTP2Responses; }
+        const StatsAccumulator& getStreamsInUse() const { return mStreamsInUse; }
+
         void    dumpStats();
     private:
         StatsAccumulator mDataDown;
         StatsAccumulator mDataUp;
+        StatsAccumulator mStreamsInUse;
 
         S32              mRequests;
+        S32              mConnectionsOpened;
+        S32              mConnectionsReused;
+        S32              mHTTP2Responses;
 
         std::map<S32, S32> mResutCodes;
     };
@@ -105,6 +105,23 @@ std::string get_base_url()
 }
 
 
+// Empty if the test server couldn't start an h2c peer
+std::string get_h2c_base_url()
+{
+    const char * env(getenv("LL_TEST_H2C_PORT"));
+
+    if (! env)
+    {
+        return std::string();
+    }
+
+    int port(atoi(env));
+    std::ostringstream out;
+    out << "http://localhost:" << port << "/";
+    return out.str();
+}
+
+
 void stop_thread(LLCore::HttpRequest * req)
 {
     if (req)
@@ -44,6 +44,7 @@
 extern void init_curl();
 extern void term_curl();
 extern std::string get_base_url();
+extern std::string get_h2c_base_url();
 extern void stop_thread(LLCore::HttpRequest * req);
 
 class ScopedCurlInit
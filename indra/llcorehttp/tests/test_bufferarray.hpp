@@ -27,7 +27,9 @@
 #define TEST_LLCORE_BUFFER_ARRAY_H_
 
 #include "bufferarray.h"
+#include "llmemory.h"
 
+#include <algorithm>
 #include <iostream>
 
 
@@ -374,6 +376,72 @@ void BufferArrayTestObjectType::test<8>()
     ba->release();
 }
 
+template <> template <>
+void BufferArrayTestObjectType::test<9>()
+{
+    set_test_name("BufferArray reserve, contiguous view and detach");
+
+    // create a new ref counted object with an implicit reference
+    BufferArray * ba = new BufferArray();
+    ensure("Empty BA has no contiguous data", NULL == ba->contiguousData());
+
+    // reserve more than a block and fill it in small appends
+    const size_t reserved(BufferArray::BLOCK_ALLOC_SIZE + 1000);
+    ensure("Reserve succeeds", ba->reserve(reserved));
+    ensure("Reserve doesn't change size", 0 == ba->size());
+
+    char chunk[997];
+    size_t total(0);
+    while (total < reserved)
+    {
+        const size_t len((std::min)(sizeof(chunk), reserved - total));
+        for (size_t i(0); i < len; ++i)
+        {
+            chunk[i] = char((total + i) % 251);
+        }
+        ba->append(chunk, len);
+        total += len;
+    }
+    ensure("Reserved appends contiguous", ba->isContiguous());
+    ensure("Size after appends correct", reserved == ba->size());
+
+    const char * view(ba->contiguousData());
+    ensure("Contiguous view non-NULL", NULL != view);
+    ensure("Contiguous view stable", view == ba->contiguousData());
+    ensure("Contiguous view content correct", char(12345 % 251) == view[12345]);
+
+    // spill into a new block, then coalesce
+    static const char str1[] = "abcdefghij";
+    ba->append(str1, 10);
+    ensure("Spilled appends not contiguous", ! ba->isContiguous());
+    view = ba->contiguousData();
+    ensure("Coalesced view non-NULL", NULL != view);
+    ensure("Coalesced is contiguous", ba->isContiguous());
+    ensure("Coalesced size correct", reserved + 10 == ba->size());
+    ensure("Coalesced content correct", char(12345 % 251) == view[12345]);
+    ensure("Coalesced tail correct", 0 == strncmp(view + reserved, str1, 10));
+
+    // take the memory over
+    size_t detached_len(0);
+    char * detached(ba->detachContiguous(&detached_len));
+    ensure("Detached pointer is the view", detached == view);
+    ensure("Detached length correct", reserved + 10 == detached_len);
+    ensure("BA empty after detach", 0 == ba->size());
+    ensure("No contiguous data after detach", NULL == ba->contiguousData());
+    ll_aligned_free_16(detached);
+
+    // still usable
+    ba->append(str1, 10);
+    char buffer[20];
+    ensure("Read after detach", 10 == ba->read(0, buffer, sizeof(buffer)));
+    detached = ba->detachContiguous(&detached_len);
+    ensure("Small detach correct", detached && 10 == detached_len && 0 == strncmp(detached, str1, 10));
+    ll_aligned_free_16(detached);
+
+    // release the implicit reference, causing the object to be released
+    ba->release();
+}
+
 }  // end namespace tut
 
 
@@ -32,14 +32,18 @@
 #include "httpheaders.h"
 #include "httpresponse.h"
 #include "httpoptions.h"
+#include "httpstats.h"
 #include "_httpservice.h"
 #include "_httprequestqueue.h"
 
 #include <curl/curl.h>
 #include <boost/regex.hpp>
+#include <algorithm>
+#include <iostream>
 #include <sstream>
 
 #include "llcorehttp_test.h"
+#include "lltimer.h"
 
 
 using namespace LLCoreInt;
@@ -3043,6 +3047,263 @@ void HttpRequestTestObjectType::test<23>()
 }
 
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+    ScopedCurlInit ready;
+
+    set_test_name("HttpRequest GET round-trip latency");
+
+    // Benchmark of the time from issuing a request to its
+    // notification against the local test server.  Requests go
+    // out one at a time, so this is dominated by how quickly the
+    // service thread notices new requests and socket activity,
+    // then in bursts that have to share the connection limit.
+    // Only completion is checked, the timings are reported.
+
+    // Handler can be stack-allocated *if* there are no dangling
+    // references to it after completion of this method.
+    TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+    std::string url_base(get_base_url());
+    mHandlerCalls = 0;
+
+    HttpRequest * req = NULL;
+
+    try
+    {
+        // Get singletons created
+        HttpRequest::createService();
+
+        // Start threading early so that thread memory is invariant
+        // over the test.
+        HttpRequest::startThread();
+
+        // create a new ref counted object with an implicit reference
+        req = new HttpRequest();
+
+        static const int sequential_count(100);
+        static const int burst_count(10);
+        static const int burst_size(32);
+        std::vector<HttpTime> sequential;
+        std::vector<HttpTime> bursts;
+
+        mStatus = HttpStatus(200);
+        for (int i(0); i < sequential_count + burst_count; ++i)
+        {
+            const int batch(i < sequential_count ? 1 : burst_size);
+            const int target(mHandlerCalls + batch);
+            const HttpTime start(totalTime());
+            for (int j(0); j < batch; ++j)
+            {
+                HttpHandle handle = req->requestGet(HttpRequest::DEFAULT_POLICY_ID,
+                                                    url_base,
+                                                    HttpOptions::ptr_t(),
+                                                    HttpHeaders::ptr_t(),
+                                                    handlerp);
+                ensure("Valid handle returned for get request", handle != LLCORE_HTTP_HANDLE_INVALID);
+            }
+
+            // Pump tightly so the pump isn't what's measured
+            int count(0);
+            int limit(LOOP_COUNT_SHORT * 100);
+            while (count++ < limit && mHandlerCalls < target)
+            {
+                req->update(0);
+                usleep(LOOP_SLEEP_INTERVAL / 100);
+            }
+            ensure("Request executed in reasonable time", count < limit);
+            ensure("One handler invocation for each request", mHandlerCalls == target);
+            (i < sequential_count ? sequential : bursts).push_back(totalTime() - start);
+        }
+
+        // Skip the first, connection setup isn't of interest
+        sequential.erase(sequential.begin());
+        std::sort(sequential.begin(), sequential.end());
+        std::sort(bursts.begin(), bursts.end());
+        HttpTime total(0);
+        for (HttpTime latency : sequential)
+        {
+            total += latency;
+        }
+        std::cout << "\nHttpRequest GET latency (uS):  mean " << total / sequential.size()
+                  << ", median " << sequential[sequential.size() / 2]
+                  << ", 95th " << sequential[sequential.size() * 95 / 100]
+                  << ", max " << sequential.back()
+                  << "; " << burst_size << " request bursts median " << bursts[bursts.size() / 2]
+                  << std::endl;
+
+        // Okay, request a shutdown of the servicing thread
+        mStatus = HttpStatus();
+        mHandlerCalls = 0;
+        HttpHandle handle = req->requestStopThread(handlerp);
+        ensure("Valid handle returned for second request", handle != LLCORE_HTTP_HANDLE_INVALID);
+
+        // Run the notification pump again
+        int count(0);
+        int limit(LOOP_COUNT_LONG);
+        while (count++ < limit && mHandlerCalls < 1)
+        {
+            req->update(1000000);
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Second request executed in reasonable time", count < limit);
+        ensure("Second handler invocation", mHandlerCalls == 1);
+
+        // See that we actually shutdown the thread
+        count = 0;
+        limit = LOOP_COUNT_SHORT;
+        while (count++ < limit && ! HttpService::isStopped())
+        {
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Thread actually stopped running", HttpService::isStopped());
+
+        // release the request object
+        delete req;
+        req = NULL;
+
+        // Shut down service
+        HttpRequest::destroyService();
+    }
+    catch (...)
+    {
+        stop_thread(req);
+        delete req;
+        HttpRequest::destroyService();
+        throw;
+    }
+}
+
+
+template <> template <>
+void HttpRequestTestObjectType::test<25>()
+{
+    ScopedCurlInit ready;
+
+    set_test_name("HttpRequest GET with HTTP/2 multiplexing");
+
+    // The peer script only runs an h2c server when Python's h2
+    // package is installed.
+    std::string url_base(get_h2c_base_url());
+    if (url_base.empty())
+    {
+        skip("No h2c server, install the Python h2 package");
+    }
+
+    // Handler can be stack-allocated *if* there are no dangling
+    // references to it after completion of this method.
+    TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+    mHandlerCalls = 0;
+
+    HttpRequest * req = NULL;
+
+    try
+    {
+        // Get singletons created
+        HttpRequest::createService();
+
+        // HTTP/2 class limited to a single connection so every
+        // request after the first must be multiplexed onto it
+        HttpRequest::policy_t policy_class(HttpRequest::createPolicyClass());
+        ensure("Policy class created", policy_class != HttpRequest::INVALID_POLICY_ID);
+
+        long value(0);
+        HttpStatus status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2, policy_class, 5, &value);
+        ensure("HTTP/2 option set", bool(status));
+        ensure_equals("HTTP/2 option clamped to prior knowledge", value, 2L);
+        status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2, HttpRequest::GLOBAL_POLICY_ID, 1, NULL);
+        ensure("HTTP/2 option is per-class only", ! status);
+        status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAM_LIMIT, policy_class, 8, &value);
+        ensure_equals("Stream limit set", value, 8L);
+        HttpRequest::setStaticPolicyOption(HttpRequest::PO_CONNECTION_LIMIT, policy_class, 4, NULL);
+        HttpRequest::setStaticPolicyOption(HttpRequest::PO_PER_HOST_CONNECTION_LIMIT, policy_class, 1, NULL);
+
+        // Start threading early so that thread memory is invariant
+        // over the test.
+        HttpRequest::startThread();
+
+        // create a new ref counted object with an implicit reference
+        req = new HttpRequest();
+
+        HTTPStats::instance().resetStats();
+
+        // Issue more GETs than the class can have streams
+        static const int request_count(16);
+        mStatus = HttpStatus(200);
+        for (int i(0); i < request_count; ++i)
+        {
+            HttpHandle handle = req->requestGet(policy_class,
+                                                url_base,
+                                                HttpOptions::ptr_t(),
+                                                HttpHeaders::ptr_t(),
+                                                handlerp);
+            ensure("Valid handle returned for get request", handle != LLCORE_HTTP_HANDLE_INVALID);
+        }
+
+        // Run the notification pump.
+        int count(0);
+        int limit(LOOP_COUNT_SHORT);
+        while (count++ < limit && mHandlerCalls < request_count)
+        {
+            req->update(1000000);
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Requests executed in reasonable time", count < limit);
+        ensure("One handler invocation for each request", mHandlerCalls == request_count);
+
+        const HTTPStats & stats(HTTPStats::instance());
+        ensure_equals("All responses over HTTP/2", stats.getHTTP2Responses(), request_count);
+        ensure_equals("One connection opened", stats.getConnectionsOpened(), 1);
+        ensure_equals("Connection reused by the others", stats.getConnectionsReused(), request_count - 1);
+        ensure_equals("Streams sampled for each request", stats.getStreamsInUse().getCount(), U32(request_count));
+        ensure("Streams limited by policy", stats.getStreamsInUse().getMaxValue() <= 8.f);
+        ensure("Streams shared the connection", stats.getStreamsInUse().getMaxValue() > 1.f);
+
+        // Okay, request a shutdown of the servicing thread
+        mStatus = HttpStatus();
+        mHandlerCalls = 0;
+        HttpHandle handle = req->requestStopThread(handlerp);
+        ensure("Valid handle returned for second request", handle != LLCORE_HTTP_HANDLE_INVALID);
+
+        // Run the notification pump again
+        count = 0;
+        limit = LOOP_COUNT_LONG;
+        while (count++ < limit && mHandlerCalls < 1)
+        {
+            req->update(1000000);
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Second request executed in reasonable time", count < limit);
+        ensure("Second handler invocation", mHandlerCalls == 1);
+
+        // See that we actually shutdown the thread
+        count = 0;
+        limit = LOOP_COUNT_SHORT;
+        while (count++ < limit && ! HttpService::isStopped())
+        {
+            usleep(LOOP_SLEEP_INTERVAL);
+        }
+        ensure("Thread actually stopped running", HttpService::isStopped());
+
+        // release the request object
+        delete req;
+        req = NULL;
+
+        // Shut down service
+        HttpRequest::destroyService();
+    }
+    catch (...)
+    {
+        stop_thread(req);
+        delete req;
+        HttpRequest::destroyService();
+        throw;
+    }
+}
+
+
 }  // end namespace tut
 
 namespace
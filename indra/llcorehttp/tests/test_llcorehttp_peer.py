@@ -34,12 +34,23 @@ import sys
 import time
 import select
 import getopt
+import socketserver
+import threading
 from io import StringIO
 from http.server import HTTPServer, BaseHTTPRequestHandler
 
 
 import llsd
 
+# The h2c server for HTTP/2 tests is only started when the h2 package
+# is installed.  Tests needing it skip themselves otherwise.
+try:
+    import h2.config
+    import h2.connection
+    import h2.events
+except ImportError:
+    h2 = None
+
 # we're in llcorehttp/tests ; testrunner.py is found in llmessage/tests
 sys.path.append(os.path.join(os.path.dirname(__file__), os.pardir, os.pardir,
                              "llmessage", "tests"))
@@ -269,6 +280,41 @@ class TestHTTPRequestHandler(BaseHTTPRequestHandler):
             # Suppress error output as well
             pass
 
+class H2CRequestHandler(socketserver.BaseRequestHandler):
+    """Minimal cleartext HTTP/2 peer.  Clients must use prior
+    knowledge (no upgrade from HTTP/1.1).  Every stream is answered
+    with a 200 and a short text body once its request is complete.
+    Streams are answered in the order they complete, so requests
+    sent together are multiplexed on the connection.
+    """
+    def handle(self):
+        conn = h2.connection.H2Connection(
+            config=h2.config.H2Configuration(client_side=False, header_encoding="utf-8"))
+        conn.initiate_connection()
+        self.request.sendall(conn.data_to_send())
+        while True:
+            data = self.request.recv(65536)
+            if not data:
+                return
+            for event in conn.receive_data(data):
+                if isinstance(event, h2.events.DataReceived):
+                    conn.acknowledge_received_data(event.flow_controlled_length, event.stream_id)
+                elif isinstance(event, h2.events.StreamEnded):
+                    body = b"success"
+                    conn.send_headers(event.stream_id,
+                                      [(":status", "200"),
+                                       ("content-type", "text/plain"),
+                                       ("content-length", str(len(body)))])
+                    conn.send_data(event.stream_id, body, end_stream=True)
+                elif isinstance(event, h2.events.ConnectionTerminated):
+                    self.request.sendall(conn.data_to_send())
+                    return
+            self.request.sendall(conn.data_to_send())
+
+class H2CServer(socketserver.ThreadingTCPServer):
+    allow_reuse_address = False
+    daemon_threads = True
+
 class Server(HTTPServer):
     # This pernicious flag is on by default in HTTPServer. But proper
     # operation of freeport() absolutely depends on it being off.
@@ -312,6 +358,14 @@ if __name__ == "__main__":
     # performed in TUT code rather than our own.
     os.environ["LL_TEST_PORT"] = str(httpd.server_port)
     debug("$LL_TEST_PORT = %s", httpd.server_port)
+
+    if h2 is not None:
+        # Serves on its own (daemon) thread, the main thread is busy
+        # with httpd until the test program exits.
+        h2cd = H2CServer(('127.0.0.1', 0), H2CRequestHandler)
+        threading.Thread(target=h2cd.serve_forever, daemon=True).start()
+        os.environ["LL_TEST_H2C_PORT"] = str(h2cd.server_address[1])
+        debug("$LL_TEST_H2C_PORT = %s", h2cd.server_address[1])
     if do_valgrind:
         args = ["valgrind", "--log-file=./valgrind.log"] + args
         path_search = True
@@ -49,20 +49,516 @@
   */
 static const std::string CACHE_FILENAME_PREFIX("sl_cache");
 
+/**
+ * The name of the journal that persists the cache index. It deliberately
+ * does not contain CACHE_FILENAME_PREFIX so it is never mistaken for a
+ * cache file.
+ */
+static const std::string JOURNAL_FILENAME("cache_index.journal");
+
+/**
+ * Journal header: magic, version and a flag telling whether the journal
+ * was closed cleanly and so holds the complete index, or is still open for
+ * appending and may miss the changes that were pending when the viewer quit.
+ */
+static const U32 JOURNAL_MAGIC = 0x43444c4c; // "LLDC"
+static const U32 JOURNAL_VERSION = 1;
+static const U32 JOURNAL_CLEAN = 0;
+static const U32 JOURNAL_OPEN = 1;
+
+struct JournalHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U32 mState;
+    U32 mReserved;
+};
+
+static const U32 JOURNAL_UPDATE = 1;
+static const U32 JOURNAL_REMOVE = 2;
+
+/**
+ * The journal is rewritten as a snapshot once it holds more than this many
+ * records and more than twice as many records as there are index entries.
+ */
+static const U32 JOURNAL_MIN_COMPACT_RECORDS = 4096;
+
+/**
+ * Threshold in seconds that is used to decide if a read of a file is worth
+ * a journal record. Reads always update the in-memory index, this only
+ * keeps frequently read files from bloating the journal. Same one hour
+ * threshold as the modification time updates this replaces (SL-14582).
+ */
+static const U32 ACCESS_JOURNAL_THRESHOLD = 1 * 60 * 60;
+
+static U32 current_time()
+{
+    return (U32)std::time(nullptr);
+}
+
 std::string LLDiskCache::sCacheDir;
 
 LLDiskCache::LLDiskCache(const std::string& cache_dir,
                          const uintmax_t max_size_bytes,
-                         const bool enable_cache_debug_info) :
+                         const bool enable_cache_debug_info,
+                         const bool read_only) :
     mMaxSizeBytes(max_size_bytes),
-    mEnableCacheDebugInfo(enable_cache_debug_info)
+    mEnableCacheDebugInfo(enable_cache_debug_info),
+    mReadOnly(read_only),
+    mTotalSizeBytes(0),
+    mJournalRecordCount(0)
 {
+    static_assert(sizeof(JournalRecord) == 32, "Journal records must be packed");
+    static_assert(sizeof(JournalHeader) == 16, "Journal header must be packed");
+
     sCacheDir = cache_dir;
     LLFile::mkdir(cache_dir);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    if (!loadJournal())
+    {
+        LL_INFOS() << "Disk cache journal missing or incomplete, rebuilding index from " << sCacheDir << LL_ENDL;
+        rebuildIndex();
+    }
+
+    // From now on the journal is appended to, flag it as open until we
+    // write the final snapshot on shutdown. This also drops a partial last
+    // record left by a crash, which would misalign the appended ones.
+    if (!mReadOnly)
+    {
+        LLMutexLock lock(&mJournalMutex);
+        writeJournalSnapshot(false);
+    }
+
+    auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
+    LL_INFOS() << "Disk cache index holds " << mTotalSizeBytes << " bytes, loaded in " << execute_time << " ms" << LL_ENDL;
+}
+
+LLDiskCache::~LLDiskCache()
+{
+    if (mReadOnly)
+    {
+        return;
+    }
+
+    LLMutexLock lock(&mJournalMutex);
+    mPendingJournalRecords.clear();
+    writeJournalSnapshot(true);
+}
+
+const std::string LLDiskCache::getJournalFilename() const
+{
+    return sCacheDir + gDirUtilp->getDirDelimiter() + JOURNAL_FILENAME;
+}
+
+void LLDiskCache::setEntry(Shard& shard, const LLUUID& id, U64 file_size, U32 last_access)
+{
+    auto iter = shard.mEntries.find(id);
+    if (iter == shard.mEntries.end())
+    {
+        IndexEntry entry;
+        entry.mSize = file_size;
+        entry.mLastAccess = last_access;
+        entry.mJournaledAccess = last_access;
+        entry.mLRUIter = shard.mLRU.insert(shard.mLRU.end(), id);
+        shard.mEntries.emplace(id, entry);
+        mTotalSizeBytes += file_size;
+    }
+    else
+    {
+        IndexEntry& entry = iter->second;
+        mTotalSizeBytes -= entry.mSize;
+        mTotalSizeBytes += file_size;
+        entry.mSize = file_size;
+        entry.mLastAccess = last_access;
+        entry.mJournaledAccess = last_access;
+        shard.mLRU.splice(shard.mLRU.end(), shard.mLRU, entry.mLRUIter);
+    }
+}
+
+void LLDiskCache::queueJournalRecord(const LLUUID& id, U64 file_size, U32 last_access, U32 op)
+{
+    if (mReadOnly)
+    {
+        return;
+    }
+
+    JournalRecord record;
+    record.mID = id;
+    record.mSize = file_size;
+    record.mLastAccess = last_access;
+    record.mOp = op;
+
+    LLMutexLock lock(&mJournalMutex);
+    mPendingJournalRecords.push_back(record);
+}
+
+bool LLDiskCache::updateFileAccessTime(const LLUUID& id)
+{
+    const U32 cur_time = current_time();
+    U64 file_size = 0;
+    bool journal = false;
+    {
+        Shard& shard = getShard(id);
+        LLMutexLock lock(&shard.mMutex);
+        auto iter = shard.mEntries.find(id);
+        if (iter == shard.mEntries.end())
+        {
+            return false;
+        }
+
+        IndexEntry& entry = iter->second;
+        entry.mLastAccess = cur_time;
+        shard.mLRU.splice(shard.mLRU.end(), shard.mLRU, entry.mLRUIter);
+
+        if (cur_time - entry.mJournaledAccess > ACCESS_JOURNAL_THRESHOLD)
+        {
+            entry.mJournaledAccess = cur_time;
+            file_size = entry.mSize;
+            journal = true;
+        }
+    }
+
+    if (journal)
+    {
+        queueJournalRecord(id, file_size, cur_time, JOURNAL_UPDATE);
+    }
+    return true;
+}
+
+void LLDiskCache::updateFileEntry(const LLUUID& id, uintmax_t file_size)
+{
+    const U32 cur_time = current_time();
+    {
+        Shard& shard = getShard(id);
+        LLMutexLock lock(&shard.mMutex);
+        setEntry(shard, id, file_size, cur_time);
+    }
+    queueJournalRecord(id, file_size, cur_time, JOURNAL_UPDATE);
+}
+
+void LLDiskCache::removeFileEntry(const LLUUID& id)
+{
+    {
+        Shard& shard = getShard(id);
+        LLMutexLock lock(&shard.mMutex);
+        auto iter = shard.mEntries.find(id);
+        if (iter == shard.mEntries.end())
+        {
+            return;
+        }
+        mTotalSizeBytes -= iter->second.mSize;
+        shard.mLRU.erase(iter->second.mLRUIter);
+        shard.mEntries.erase(iter);
+    }
+    queueJournalRecord(id, 0, 0, JOURNAL_REMOVE);
+}
+
+void LLDiskCache::renameFileEntry(const LLUUID& old_id, const LLUUID& new_id)
+{
+    U64 file_size = 0;
+    {
+        Shard& shard = getShard(old_id);
+        LLMutexLock lock(&shard.mMutex);
+        auto iter = shard.mEntries.find(old_id);
+        if (iter == shard.mEntries.end())
+        {
+            return;
+        }
+        file_size = iter->second.mSize;
+    }
+    removeFileEntry(old_id);
+    updateFileEntry(new_id, file_size);
+}
+
+bool LLDiskCache::loadJournal()
+{
+    LLUniqueFile file(LLFile::fopen(getJournalFilename(), "rb"));
+    if (!file)
+    {
+        return false;
+    }
+
+    JournalHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || header.mMagic != JOURNAL_MAGIC
+        || header.mVersion != JOURNAL_VERSION
+        || (header.mState != JOURNAL_CLEAN && header.mState != JOURNAL_OPEN))
+    {
+        return false;
+    }
+
+    // An open journal was not closed cleanly: replay it up to its last
+    // complete record, then reconcile it with the cache directory since the
+    // changes that were still pending are lost.
+    const bool open = header.mState == JOURNAL_OPEN;
+    if (open)
+    {
+        LL_INFOS() << "Disk cache journal was not closed cleanly, replaying " << getJournalFilename() << LL_ENDL;
+    }
+
+    // Replay the records into a plain map first, the LRU lists can only be
+    // built once the final access times are known
+    std::unordered_map<LLUUID, std::pair<U64, U32>> entries;
+    constexpr size_t RECORDS_PER_READ = 1024;
+    std::vector<JournalRecord> records(RECORDS_PER_READ);
+    size_t count;
+    U32 record_count = 0;
+    bool torn = false;
+    // fread() only returns complete records, a partial last one is skipped
+    while (!torn && (count = fread(records.data(), sizeof(JournalRecord), RECORDS_PER_READ, file)) > 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const JournalRecord& record = records[i];
+            if (record.mOp == JOURNAL_UPDATE)
+            {
+                entries[record.mID] = std::make_pair(record.mSize, record.mLastAccess);
+            }
+            else if (record.mOp == JOURNAL_REMOVE)
+            {
+                entries.erase(record.mID);
+            }
+            else if (open)
+            {
+                // The tail of an interrupted append, keep what precedes it
+                LL_WARNS() << "Disk cache journal " << getJournalFilename() << " ends with a torn record, dropping the rest" << LL_ENDL;
+                count = i;
+                torn = true;
+                break;
+            }
+            else
+            {
+                LL_WARNS() << "Corrupted disk cache journal " << getJournalFilename() << LL_ENDL;
+                return false;
+            }
+        }
+        record_count += (U32)count;
+    }
+
+    if (open)
+    {
+        // Files written since the last flush would otherwise never be
+        // counted nor evicted, and files purged since are gone. Access
+        // times the journal knows of are kept, the others are the files'
+        // modification times like in rebuildIndex().
+        std::vector<CacheFile> files;
+        scanCacheDir(files);
+        std::unordered_map<LLUUID, std::pair<U64, U32>> reconciled;
+        reconciled.reserve(files.size());
+        for (const CacheFile& file : files)
+        {
+            auto iter = entries.find(file.mID);
+            const U32 last_access = iter != entries.end() ? iter->second.second : file.mLastWrite;
+            reconciled[file.mID] = std::make_pair(file.mSize, last_access);
+        }
+        LL_INFOS() << "Disk cache journal replayed " << entries.size() << " entries, "
+                   << reconciled.size() << " files found in " << sCacheDir << LL_ENDL;
+        entries.swap(reconciled);
+    }
+
+    typedef std::pair<U32, std::pair<LLUUID, U64>> sorted_entry_t;
+    std::vector<sorted_entry_t> sorted;
+    sorted.reserve(entries.size());
+    for (const auto& entry : entries)
+    {
+        sorted.push_back(sorted_entry_t(entry.second.second, { entry.first, entry.second.first }));
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const sorted_entry_t& x, const sorted_entry_t& y)
+    {
+        return x.first < y.first;
+    });
+
+    for (const sorted_entry_t& entry : sorted)
+    {
+        Shard& shard = getShard(entry.second.first);
+        LLMutexLock lock(&shard.mMutex);
+        setEntry(shard, entry.second.first, entry.second.second, entry.first);
+    }
+
+    LLMutexLock lock(&mJournalMutex);
+    mJournalRecordCount = record_count;
+    return true;
+}
+
+void LLDiskCache::rebuildIndex()
+{
+    for (Shard& shard : mShards)
+    {
+        LLMutexLock lock(&shard.mMutex);
+        shard.mEntries.clear();
+        shard.mLRU.clear();
+    }
+    mTotalSizeBytes = 0;
+
+    std::vector<CacheFile> files;
+    scanCacheDir(files);
+    std::sort(files.begin(), files.end(), [](const CacheFile& x, const CacheFile& y)
+    {
+        return x.mLastWrite < y.mLastWrite;
+    });
+
+    for (const CacheFile& file : files)
+    {
+        Shard& shard = getShard(file.mID);
+        LLMutexLock lock(&shard.mMutex);
+        setEntry(shard, file.mID, file.mSize, file.mLastWrite);
+    }
+}
+
+void LLDiskCache::scanCacheDir(std::vector<CacheFile>& files)
+{
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    std::wstring cache_path(ll_convert<std::wstring>(sCacheDir));
+#else
+    std::string cache_path(sCacheDir);
+#endif
+    const std::string id_prefix = CACHE_FILENAME_PREFIX + "_";
+    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
+    {
+        boost::filesystem::directory_iterator iter(cache_path, ec);
+        while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+        {
+            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
+            {
+                const std::string file_name = (*iter).path().filename().string();
+                if (file_name.compare(0, id_prefix.size(), id_prefix) == 0
+                    && file_name.size() >= id_prefix.size() + UUID_STR_LENGTH - 1)
+                {
+                    const std::string id_str = file_name.substr(id_prefix.size(), UUID_STR_LENGTH - 1);
+                    uintmax_t file_size = boost::filesystem::file_size(*iter, ec);
+                    if (!ec.failed() && LLUUID::validate(id_str))
+                    {
+                        const std::time_t file_time = boost::filesystem::last_write_time(*iter, ec);
+                        if (!ec.failed())
+                        {
+                            files.push_back({ LLUUID(id_str), (U64)file_size, (U32)file_time });
+                        }
+                    }
+                }
+            }
+            iter.increment(ec);
+        }
+    }
+}
+
+bool LLDiskCache::writeJournalSnapshot(bool clean)
+{
+    // mJournalMutex must be held by the caller
+    const std::string filename = getJournalFilename();
+    const std::string temp_filename = filename + ".tmp";
+
+    U32 record_count = 0;
+    {
+        LLUniqueFile file(LLFile::fopen(temp_filename, "wb"));
+        if (!file)
+        {
+            LL_WARNS() << "Unable to write disk cache journal " << temp_filename << LL_ENDL;
+            return false;
+        }
+
+        JournalHeader header;
+        header.mMagic = JOURNAL_MAGIC;
+        header.mVersion = JOURNAL_VERSION;
+        header.mState = clean ? JOURNAL_CLEAN : JOURNAL_OPEN;
+        header.mReserved = 0;
+        bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+        std::vector<JournalRecord> records;
+        for (Shard& shard : mShards)
+        {
+            records.clear();
+            {
+                LLMutexLock lock(&shard.mMutex);
+                records.reserve(shard.mLRU.size());
+                for (const LLUUID& id : shard.mLRU)
+                {
+                    const IndexEntry& entry = shard.mEntries[id];
+                    JournalRecord record;
+                    record.mID = id;
+                    record.mSize = entry.mSize;
+                    record.mLastAccess = entry.mLastAccess;
+                    record.mOp = JOURNAL_UPDATE;
+                    records.push_back(record);
+                }
+            }
+            if (!records.empty())
+            {
+                success = success && fwrite(records.data(), sizeof(JournalRecord), records.size(), file) == records.size();
+                record_count += (U32)records.size();
+            }
+        }
+
+        if (!success)
+        {
+            LL_WARNS() << "Failed to write disk cache journal " << temp_filename << LL_ENDL;
+            file.close();
+            LLFile::remove(temp_filename);
+            return false;
+        }
+    }
+
+    if (LLFile::rename(temp_filename, filename) != 0)
+    {
+        LL_WARNS() << "Failed to replace disk cache journal " << filename << LL_ENDL;
+        return false;
+    }
+
+    mJournalRecordCount = record_count;
+    return true;
+}
+
+void LLDiskCache::flushJournal()
+{
+    if (mReadOnly)
+    {
+        return;
+    }
+
+    LLMutexLock lock(&mJournalMutex);
+
+    if (mJournalRecordCount > JOURNAL_MIN_COMPACT_RECORDS)
+    {
+        size_t entry_count = 0;
+        for (Shard& shard : mShards)
+        {
+            LLMutexLock shard_lock(&shard.mMutex);
+            entry_count += shard.mEntries.size();
+        }
+        if (mJournalRecordCount > 2 * entry_count)
+        {
+            // The snapshot already contains every pending change
+            mPendingJournalRecords.clear();
+            writeJournalSnapshot(false);
+            return;
+        }
+    }
+
+    if (mPendingJournalRecords.empty())
+    {
+        return;
+    }
+
+    bool appended;
+    {
+        LLUniqueFile file(LLFile::fopen(getJournalFilename(), "ab"));
+        appended = file
+            && fwrite(mPendingJournalRecords.data(), sizeof(JournalRecord), mPendingJournalRecords.size(), file) == mPendingJournalRecords.size();
+    }
+    mJournalRecordCount += (U32)mPendingJournalRecords.size();
+    mPendingJournalRecords.clear();
+    if (!appended)
+    {
+        // A partial record would misalign the ones appended after it,
+        // replace the journal with a snapshot which has all the changes
+        LL_WARNS() << "Failed to append to disk cache journal " << getJournalFilename() << LL_ENDL;
+        writeJournalSnapshot(false);
+    }
 }
 
 // WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-// NOT touch any LLDiskCache data without introducing and locking a mutex!
+// NOT touch any LLDiskCache data without locking the relevant mutex!
 
 // Interaction through the filesystem itself should be safe. Let’s say thread
 // A is accessing the cache file for reading/writing and thread B is trimming
@@ -91,124 +587,128 @@ LLDiskCache::LLDiskCache(const std::string& cache_dir,
 // asset will have to be re-requested.
 void LLDiskCache::purge()
 {
+    LLMutexLock purge_lock(&mPurgeMutex);
+
     if (mEnableCacheDebugInfo)
     {
         LL_INFOS() << "Total dir size before purge is " << dirFileSize(sCacheDir) << LL_ENDL;
     }
 
-    boost::system::error_code ec;
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    typedef std::pair<std::time_t, std::pair<uintmax_t, std::string>> file_info_t;
-    std::vector<file_info_t> file_info;
+    flushJournal();
 
-#if LL_WINDOWS
-    std::wstring cache_path(ll_convert<std::wstring>(sCacheDir));
-#else
-    std::string cache_path(sCacheDir);
-#endif
-    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
+    if (mTotalSizeBytes <= mMaxSizeBytes)
     {
-        boost::filesystem::directory_iterator iter(cache_path, ec);
-        while (iter != boost::filesystem::directory_iterator() && !ec.failed())
-        {
-            if(!LLApp::isRunning())
-            {
-                return;
-            }
-
-            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
-            {
-                if ((*iter).path().string().find(CACHE_FILENAME_PREFIX) != std::string::npos)
-                {
-                    uintmax_t file_size = boost::filesystem::file_size(*iter, ec);
-                    if (ec.failed())
-                    {
-                        continue;
-                    }
-                    const std::string file_path = (*iter).path().string();
-                    const std::time_t file_time = boost::filesystem::last_write_time(*iter, ec);
-                    if (ec.failed())
-                    {
-                        continue;
-                    }
-
-                    file_info.push_back(file_info_t(file_time, { file_size, file_path }));
-                }
-            }
-            iter.increment(ec);
-        }
+        return;
     }
 
-    std::sort(file_info.begin(), file_info.end(), [](file_info_t& x, file_info_t& y)
-    {
-        return x.first > y.first;
-    });
+    LL_INFOS() << "Purging cache from " << mTotalSizeBytes << " to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
 
-    LL_INFOS() << "Purging cache to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
-
-    std::vector<bool> file_removed;
-    if (mEnableCacheDebugInfo)
-    {
-        file_removed.reserve(file_info.size());
-    }
-    uintmax_t file_size_total = 0;
-    for (file_info_t& entry : file_info)
+    typedef std::pair<U32, std::pair<uintmax_t, LLUUID>> file_info_t;
+    std::vector<file_info_t> evicted;
+    size_t evicted_count = 0;
+    while (mTotalSizeBytes > mMaxSizeBytes)
     {
         if (!LLApp::isRunning())
         {
             return;
         }
 
-        file_size_total += entry.second.first;
+        // Find the shard holding the least recently used entry, along with
+        // the access time of the least recently used entry of all the others
+        Shard* oldest_shard = nullptr;
+        U32 oldest_time = U32_MAX;
+        U32 next_time = U32_MAX;
+        for (Shard& shard : mShards)
+        {
+            LLMutexLock lock(&shard.mMutex);
+            if (shard.mLRU.empty())
+            {
+                continue;
+            }
+            const U32 access_time = shard.mEntries[shard.mLRU.front()].mLastAccess;
+            if (access_time < oldest_time)
+            {
+                next_time = oldest_time;
+                oldest_time = access_time;
+                oldest_shard = &shard;
+            }
+            else if (access_time < next_time)
+            {
+                next_time = access_time;
+            }
+        }
 
-        bool should_remove = file_size_total > mMaxSizeBytes;
-        if (mEnableCacheDebugInfo)
+        if (!oldest_shard)
         {
-            file_removed.push_back(should_remove);
+            break;
         }
-        if (should_remove)
+
+        // Evict from that shard until it is no longer the oldest
+        evicted.clear();
         {
-            boost::filesystem::remove(entry.second.second, ec);
-            if (ec.failed())
+            LLMutexLock lock(&oldest_shard->mMutex);
+            while (!oldest_shard->mLRU.empty() && mTotalSizeBytes > mMaxSizeBytes)
             {
-                LL_WARNS() << "Failed to delete cache file " << entry.second.second << ": " << ec.message() << LL_ENDL;
-                continue;
+                const LLUUID id = oldest_shard->mLRU.front();
+                auto iter = oldest_shard->mEntries.find(id);
+                if (!evicted.empty() && iter->second.mLastAccess > next_time)
+                {
+                    break;
+                }
+                evicted.push_back(file_info_t(iter->second.mLastAccess, { iter->second.mSize, id }));
+                mTotalSizeBytes -= iter->second.mSize;
+                oldest_shard->mLRU.pop_front();
+                oldest_shard->mEntries.erase(iter);
             }
         }
-    }
-
-    if (mEnableCacheDebugInfo)
-    {
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
 
-        // Log afterward so it doesn't affect the time measurement
-        // Logging thousands of file results can take hundreds of milliseconds
-        for (size_t i = 0; i < file_info.size(); ++i)
+        boost::system::error_code ec;
+        size_t removed_count = 0;
+        for (const file_info_t& entry : evicted)
         {
-            if (!LLApp::isRunning())
+            const std::string file_path = metaDataToFilepath(entry.second.second, LLAssetType::AT_NONE);
+#if LL_WINDOWS
+            boost::filesystem::remove(ll_convert<std::wstring>(file_path), ec);
+#else
+            boost::filesystem::remove(file_path, ec);
+#endif
+            if (ec.failed())
             {
-                return;
+                // Most likely in use, keep it in the index so a later purge
+                // can try again
+                LL_WARNS() << "Failed to delete cache file " << file_path << ": " << ec.message() << LL_ENDL;
+                updateFileEntry(entry.second.second, entry.second.first);
+                continue;
             }
 
-            const file_info_t& entry = file_info[i];
-            const bool removed = file_removed[i];
-            const std::string action = removed ? "DELETE:" : "KEEP:";
+            queueJournalRecord(entry.second.second, 0, 0, JOURNAL_REMOVE);
+            ++removed_count;
 
-            // have to do this because of LL_INFO/LL_END weirdness
-            std::ostringstream line;
+            if (mEnableCacheDebugInfo)
+            {
+                LL_INFOS() << "DELETE:  " << entry.first << "  " << entry.second.first << "  " << file_path << LL_ENDL;
+            }
+        }
 
-            line << action << "  ";
-            line << entry.first << "  ";
-            line << entry.second.first << "  ";
-            line << entry.second.second;
-            line << " (" << file_size_total << "/" << mMaxSizeBytes << ")";
-            LL_INFOS() << line.str() << LL_ENDL;
+        if (!removed_count)
+        {
+            // Nothing could be deleted, don't spin on the same files
+            break;
         }
+        evicted_count += removed_count;
+    }
+
+    flushJournal();
+
+    if (mEnableCacheDebugInfo)
+    {
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
 
         LL_INFOS() << "Total dir size after purge is " << dirFileSize(sCacheDir) << LL_ENDL;
-        LL_INFOS() << "Cache purge took " << execute_time << " ms to execute for " << file_info.size() << " files" << LL_ENDL;
+        LL_INFOS() << "Cache purge took " << execute_time << " ms to delete " << evicted_count << " files" << LL_ENDL;
     }
 }
 
@@ -222,7 +722,7 @@ const std::string LLDiskCache::getCacheInfo()
     std::ostringstream cache_info;
 
     F32 max_in_mb = (F32)mMaxSizeBytes / (1024.0f * 1024.0f);
-    F32 percent_used = ((F32)dirFileSize(sCacheDir) / (F32)mMaxSizeBytes) * 100.0f;
+    F32 percent_used = ((F32)mTotalSizeBytes / (F32)mMaxSizeBytes) * 100.0f;
 
     cache_info << std::fixed;
     cache_info << std::setprecision(1);
@@ -265,6 +765,21 @@ void LLDiskCache::clearCache()
             iter.increment(ec);
         }
     }
+
+    for (Shard& shard : mShards)
+    {
+        LLMutexLock lock(&shard.mMutex);
+        shard.mEntries.clear();
+        shard.mLRU.clear();
+    }
+    mTotalSizeBytes = 0;
+
+    if (!mReadOnly)
+    {
+        LLMutexLock lock(&mJournalMutex);
+        mPendingJournalRecords.clear();
+        writeJournalSnapshot(false);
+    }
 }
 
 void LLDiskCache::removeOldVFSFiles()
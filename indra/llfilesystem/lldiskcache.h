@@ -22,20 +22,25 @@
                     that identifies the type of asset being stored.
         .asset      A file extension of .asset is used to help
                     identify this as a Viewer asset file
- * 2/ The time of last access for a file can be updated instantly
- *    for file reads and automatically as part of the file writes.
- * 3/ The purge algorithm collects a list of all files in the
- *    directory, sorts them by date of last access (write) and then
- *    deletes any files based on age until the total size of all
- *    the files is less than the maximum size specified.
- * 4/ An LLSingleton idiom is used since there will only ever be
+ * 2/ The size and time of last access of every file are kept in an
+ *    in-memory index, sharded by the first byte of the asset ID so
+ *    that threads reading and writing different assets rarely
+ *    contend. Reads only update the index - there is no filesystem
+ *    call to touch the file modification time any more.
+ * 3/ The index is persisted as a compact append-only journal of
+ *    fixed size records in the cache folder. Changes are buffered
+ *    in memory and appended by the purge thread, and the journal
+ *    is rewritten as a snapshot once it grows too large. A journal
+ *    that was not closed cleanly is replayed up to its last complete
+ *    record and then reconciled with a scan of the cache directory,
+ *    since the changes still pending when the viewer went down are
+ *    lost. If the journal is missing or corrupted, the index is
+ *    rebuilt once from a scan of the cache directory.
+ * 4/ Each shard keeps its entries in least recently used order, so
+ *    the purge algorithm only visits the entries it deletes rather
+ *    than collecting, sorting and stat'ing every file in the folder.
+ * 5/ An LLSingleton idiom is used since there will only ever be
  *    a single cache and we want to access it from numerous places.
- * 5/ Performance on my modest system seems very acceptable. For
- *    example, in testing, I was able to purge a directory of
- *    10,000 files, deleting about half of them in ~ 1700ms. For
- *    the same sized directory of files, writing the last updated
- *    time to each took less than 600ms indicating that this
- *    important part of the mechanism has almost no overhead.
  *
  * $LicenseInfo:firstyear=2009&license=viewerlgpl$
  * Second Life Viewer Source Code
@@ -63,6 +68,13 @@
 #define _LLDISKCACHE
 
 #include "llsingleton.h"
+#include "llmutex.h"
+#include "lluuid.h"
+
+#include <atomic>
+#include <list>
+#include <unordered_map>
+#include <vector>
 
 class LLDiskCache :
     public LLParamSingleton<LLDiskCache>
@@ -92,9 +104,14 @@ class LLDiskCache :
                      * if there are bugs, we can ask uses to enable this
                      * setting and send us their logs
                      */
-                    const bool enable_cache_debug_info);
+                    const bool enable_cache_debug_info,
+                    /**
+                     * Set for a second viewer instance sharing the cache of
+                     * the first one: the journal is read but never written
+                     */
+                    const bool read_only);
 
-        virtual ~LLDiskCache() = default;
+        virtual ~LLDiskCache();
 
     public:
         /**
@@ -107,18 +124,41 @@ class LLDiskCache :
         static const std::string metaDataToFilepath(const LLUUID& id, LLAssetType::EType at);
 
         /**
-         * Purge the oldest items in the cache so that the combined size of all files
-         * is no bigger than mMaxSizeBytes.
+         * Purge the least recently used items in the cache so that the combined
+         * size of all files is no bigger than mMaxSizeBytes. Pending index changes
+         * are appended to the journal first.
          *
          * WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-         * NOT touch any LLDiskCache data without introducing and locking a mutex!
+         * NOT touch any LLDiskCache data without locking the relevant mutex!
          *
-         * Purging the disk cache involves nontrivial work on the viewer's
-         * filesystem. If called on the main thread, this causes a noticeable
-         * freeze.
+         * The cost is proportional to the number of files deleted, but deleting
+         * many files at once is still nontrivial work on the viewer's filesystem.
          */
         void purge();
 
+        /**
+         * Record that the cache file for this asset was just read so that it
+         * moves to the back of the eviction order. Only the in-memory index is
+         * updated. Returns false if the asset is not in the index.
+         */
+        bool updateFileAccessTime(const LLUUID& id);
+
+        /**
+         * Record that the cache file for this asset was just written and now
+         * has the given size, adding it to the index if it is new.
+         */
+        void updateFileEntry(const LLUUID& id, uintmax_t file_size);
+
+        /**
+         * Record that the cache file for this asset was removed.
+         */
+        void removeFileEntry(const LLUUID& id);
+
+        /**
+         * Record that the cache file for old_id was renamed to new_id.
+         */
+        void renameFileEntry(const LLUUID& old_id, const LLUUID& new_id);
+
         /**
          * Clear the cache by removing all the files in the specified cache
          * directory individually. Only the files that contain a prefix defined
@@ -136,11 +176,106 @@ class LLDiskCache :
     private:
         /**
          * Utility function to gather the total size the files in a given
-         * directory. Primarily used here to determine the directory size
-         * before and after the cache purge
+         * directory. Only used for debugging now that the index keeps
+         * track of the cache size.
          */
         uintmax_t dirFileSize(const std::string& dir);
 
+        /**
+         * Fixed size record of the on-disk journal. A JOURNAL_UPDATE record
+         * sets the size and access time of an entry and a JOURNAL_REMOVE
+         * record drops it. Replaying all the records in order rebuilds the
+         * index.
+         */
+        struct JournalRecord
+        {
+            LLUUID  mID;
+            U64     mSize;
+            U32     mLastAccess;
+            U32     mOp;
+        };
+
+        /**
+         * An entry of the index. Times are in seconds since the epoch, which
+         * fits in 32 bits and keeps the journal records small.
+         */
+        struct IndexEntry
+        {
+            U64                         mSize;
+            U32                         mLastAccess;
+            U32                         mJournaledAccess;
+            std::list<LLUUID>::iterator mLRUIter;
+        };
+
+        /**
+         * A cache file found by scanning the cache directory.
+         */
+        struct CacheFile
+        {
+            LLUUID  mID;
+            U64     mSize;
+            U32     mLastWrite;
+        };
+
+        /**
+         * One slice of the index, selected by the first byte of the asset ID.
+         * mLRU holds the IDs of the shard ordered from least to most recently
+         * used.
+         */
+        struct Shard
+        {
+            LLMutex                                 mMutex;
+            std::unordered_map<LLUUID, IndexEntry>  mEntries;
+            std::list<LLUUID>                       mLRU;
+        };
+
+        static constexpr U32 NUM_SHARDS = 16;
+
+        Shard& getShard(const LLUUID& id) { return mShards[id.mData[0] % NUM_SHARDS]; }
+
+        /**
+         * Insert or update an entry of a shard. The shard mutex must be held.
+         */
+        void setEntry(Shard& shard, const LLUUID& id, U64 file_size, U32 last_access);
+
+        /**
+         * Append a record to the list of pending journal records.
+         */
+        void queueJournalRecord(const LLUUID& id, U64 file_size, U32 last_access, U32 op);
+
+        /**
+         * Load the index from the journal. A journal that was not closed
+         * cleanly is replayed up to its last complete record, then files
+         * missing from it are added and entries without a file dropped.
+         * Returns false if the journal is missing, unreadable or corrupted.
+         */
+        bool loadJournal();
+
+        /**
+         * Rebuild the index from a scan of the cache directory.
+         */
+        void rebuildIndex();
+
+        /**
+         * List the cache files of the cache directory.
+         */
+        void scanCacheDir(std::vector<CacheFile>& files);
+
+        /**
+         * Append the pending records to the journal, rewriting it as a compact
+         * snapshot first if it has grown too large.
+         */
+        void flushJournal();
+
+        /**
+         * Rewrite the journal with one record per entry of the index. If
+         * clean is true, the journal is flagged as an exact copy of the
+         * index, otherwise it is flagged as open for appending.
+         */
+        bool writeJournalSnapshot(bool clean);
+
+        const std::string getJournalFilename() const;
+
     private:
         /**
          * The maximum size of the cache in bytes. After purge is called, the
@@ -162,6 +297,35 @@ class LLDiskCache :
          * various parts of the code
          */
         bool mEnableCacheDebugInfo;
+
+        /**
+         * When set, the journal is never written to
+         */
+        bool mReadOnly;
+
+        /**
+         * The index of the cache files, split in shards with their own mutex
+         */
+        Shard mShards[NUM_SHARDS];
+
+        /**
+         * The combined size of all the files in the index
+         */
+        std::atomic<uintmax_t> mTotalSizeBytes;
+
+        /**
+         * Protects the journal file and the list of records not yet written
+         * to it
+         */
+        LLMutex mJournalMutex;
+        std::vector<JournalRecord> mPendingJournalRecords;
+        U32 mJournalRecordCount;
+
+        /**
+         * Serializes purges, which may come from the purge thread as well as
+         * from the main thread
+         */
+        LLMutex mPurgeMutex;
 };
 
 class LLPurgeDiskCacheThread : public LLThread
@@ -34,8 +34,6 @@
 #include "llfasttimer.h"
 #include "lldiskcache.h"
 
-#include "boost/filesystem.hpp"
-
 constexpr S32 LLFileSystem::READ        = 0x00000001;
 constexpr S32 LLFileSystem::WRITE       = 0x00000002;
 constexpr S32 LLFileSystem::READ_WRITE  = 0x00000003;  // LLFileSystem::READ & LLFileSystem::WRITE
@@ -51,22 +49,20 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
     mBytesRead = 0;
     mMode = mode;
 
-    // This block of code was originally called in the read() method but after comments here:
-    // https://bitbucket.org/lindenlab/viewer/commits/e28c1b46e9944f0215a13cab8ee7dded88d7fc90#comment-10537114
-    // we decided to follow Henri's suggestion and move the code to update the last access time here.
-    if (mode == LLFileSystem::READ)
+    // update the last access time for the file if it is in the cache - this
+    // is required even though we are reading and not writing because this is
+    // the way the cache works - it relies on a valid "last accessed time" for
+    // each file so it knows how to remove the oldest, unused files. Only the
+    // in-memory cache index is touched, not the file itself.
+    if (mode == LLFileSystem::READ && LLDiskCache::instanceExists()
+        && !LLDiskCache::getInstance()->updateFileAccessTime(mFileID))
     {
-        // build the filename (TODO: we do this in a few places - perhaps we should factor into a single function)
-        const std::string filename = LLDiskCache::metaDataToFilepath(mFileID, mFileType);
-
-        // update the last access time for the file if it exists - this is required
-        // even though we are reading and not writing because this is the
-        // way the cache works - it relies on a valid "last accessed time" for
-        // each file so it knows how to remove the oldest, unused files
-        bool exists = gDirUtilp->fileExists(filename);
-        if (exists)
+        // A file the index does not know about, e.g. written by another
+        // viewer sharing the cache: count it so that it can be evicted
+        S32 file_size = getFileSize(mFileID, mFileType);
+        if (file_size > 0)
         {
-            updateFileAccessTime(filename);
+            LLDiskCache::getInstance()->updateFileEntry(mFileID, file_size);
         }
     }
 }
@@ -93,6 +89,11 @@ bool LLFileSystem::removeFile(const LLUUID& file_id, const LLAssetType::EType fi
 
     LLFile::remove(filename.c_str(), suppress_error);
 
+    if (LLDiskCache::instanceExists())
+    {
+        LLDiskCache::getInstance()->removeFileEntry(file_id);
+    }
+
     return true;
 }
 
@@ -114,6 +115,10 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
         //return false;
         LL_WARNS() << "Failed to rename " << old_file_id << " to " << new_file_id << " reason: " << strerror(errno) << LL_ENDL;
     }
+    else if (LLDiskCache::instanceExists())
+    {
+        LLDiskCache::getInstance()->renameFileEntry(old_file_id, new_file_id);
+    }
 
     return true;
 }
@@ -183,6 +188,7 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
     const std::string filename = LLDiskCache::metaDataToFilepath(mFileID, mFileType);
 
     bool success = false;
+    S32 file_size = 0;
 
     if (mMode == APPEND)
     {
@@ -192,6 +198,7 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
             ofs.write((const char*)buffer, bytes);
 
             mPosition = (S32)ofs.tellp();
+            file_size = mPosition;
 
             success = true;
         }
@@ -205,6 +212,8 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
             ofs.seekp(mPosition, std::ios::beg);
             ofs.write((const char*)buffer, bytes);
             mPosition += bytes;
+            ofs.seekp(0, std::ios::end);
+            file_size = llmax(mPosition, (S32)ofs.tellp());
             success = true;
         }
         else
@@ -215,6 +224,7 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
             {
                 ofs.write((const char*)buffer, bytes);
                 mPosition += bytes;
+                file_size = mPosition;
                 success = true;
             }
         }
@@ -227,11 +237,17 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
             ofs.write((const char*)buffer, bytes);
 
             mPosition += bytes;
+            file_size = bytes;
 
             success = true;
         }
     }
 
+    if (success && LLDiskCache::instanceExists())
+    {
+        LLDiskCache::getInstance()->updateFileEntry(mFileID, file_size);
+    }
+
     return success;
 }
 
@@ -296,64 +312,3 @@ bool LLFileSystem::remove() const
     LLFileSystem::removeFile(mFileID, mFileType);
     return true;
 }
-
-void LLFileSystem::updateFileAccessTime(const std::string& file_path)
-{
-    /**
-     * Threshold in time_t units that is used to decide if the last access time
-     * time of the file is updated or not. Added as a precaution for the concern
-     * outlined in SL-14582  about frequent writes on older SSDs reducing their
-     * lifespan. I think this is the right place for the threshold value - rather
-     * than it being a pref - do comment on that Jira if you disagree...
-     *
-     * Let's start with 1 hour in time_t units and see how that unfolds
-     */
-    constexpr std::time_t time_threshold = 1 * 60 * 60;
-
-    // current time
-    const std::time_t cur_time = std::time(nullptr);
-
-    boost::system::error_code ec;
-#if LL_WINDOWS
-    // file last write time
-    const std::time_t last_write_time = boost::filesystem::last_write_time(ll_convert<std::wstring>(file_path), ec);
-    if (ec.failed())
-    {
-        LL_WARNS() << "Failed to read last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
-        return;
-    }
-
-    // delta between cur time and last time the file was written
-    const std::time_t delta_time = cur_time - last_write_time;
-
-    // we only write the new value if the time in time_threshold has elapsed
-    // before the last one
-    if (delta_time > time_threshold)
-    {
-        boost::filesystem::last_write_time(ll_convert<std::wstring>(file_path), cur_time, ec);
-    }
-#else
-    // file last write time
-    const std::time_t last_write_time = boost::filesystem::last_write_time(file_path, ec);
-    if (ec.failed())
-    {
-        LL_WARNS() << "Failed to read last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
-        return;
-    }
-
-    // delta between cur time and last time the file was written
-    const std::time_t delta_time = cur_time - last_write_time;
-
-    // we only write the new value if the time in time_threshold has elapsed
-    // before the last one
-    if (delta_time > time_threshold)
-    {
-        boost::filesystem::last_write_time(file_path, cur_time, ec);
-    }
-#endif
-
-    if (ec.failed())
-    {
-        LL_WARNS() << "Failed to update last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
-    }
-}
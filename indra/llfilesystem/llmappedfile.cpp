@@ -0,0 +1,233 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#include "llwin32headers.h"
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+LLMappedFile::LLMappedFile()
+:   mData(nullptr),
+    mSize(0),
+    mReadOnly(true),
+#if LL_WINDOWS
+    mFileHandle(INVALID_HANDLE_VALUE),
+    mMappingHandle(nullptr)
+#else
+    mFileDescriptor(-1)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+    unmap();
+}
+
+#if LL_WINDOWS
+
+bool LLMappedFile::map(const std::string& filename, size_t size, bool read_only)
+{
+    unmap();
+    mReadOnly = read_only;
+
+    std::wstring utf16filename = ll_convert<std::wstring>(filename);
+    mFileHandle = CreateFileW(utf16filename.c_str(),
+                              read_only ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr,
+                              read_only ? OPEN_EXISTING : OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (mFileHandle == INVALID_HANDLE_VALUE)
+    {
+        LL_WARNS() << "Unable to open " << filename << " for mapping, error " << GetLastError() << LL_ENDL;
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(mFileHandle, &file_size))
+    {
+        LL_WARNS() << "Unable to get the size of " << filename << LL_ENDL;
+        unmap();
+        return false;
+    }
+    if (read_only)
+    {
+        size = llmin(size, (size_t)file_size.QuadPart);
+    }
+    if (!size)
+    {
+        unmap();
+        return false;
+    }
+
+    LARGE_INTEGER map_size;
+    map_size.QuadPart = (read_only || (LONGLONG)size <= file_size.QuadPart) ? 0 : size;
+    if (map_size.QuadPart)
+    {
+        // Growing the file through the mapping allocates the whole range
+        // unless the file is sparse. Not all file systems support it.
+        DWORD bytes_returned = 0;
+        DeviceIoControl(mFileHandle, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytes_returned, nullptr);
+    }
+    mMappingHandle = CreateFileMappingW(mFileHandle, nullptr, read_only ? PAGE_READONLY : PAGE_READWRITE,
+                                        map_size.HighPart, map_size.LowPart, nullptr);
+    if (!mMappingHandle)
+    {
+        LL_WARNS() << "Unable to create a mapping of " << filename << ", error " << GetLastError() << LL_ENDL;
+        unmap();
+        return false;
+    }
+
+    mData = (U8*)MapViewOfFile(mMappingHandle, read_only ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+    if (!mData)
+    {
+        LL_WARNS() << "Unable to map " << filename << ", error " << GetLastError() << LL_ENDL;
+        unmap();
+        return false;
+    }
+    mSize = size;
+    return true;
+}
+
+void LLMappedFile::unmap()
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+        mData = nullptr;
+    }
+    if (mMappingHandle)
+    {
+        CloseHandle(mMappingHandle);
+        mMappingHandle = nullptr;
+    }
+    if (mFileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFileHandle);
+        mFileHandle = INVALID_HANDLE_VALUE;
+    }
+    mSize = 0;
+}
+
+bool LLMappedFile::flush(bool async)
+{
+    if (!mData || mReadOnly)
+    {
+        return false;
+    }
+    if (!FlushViewOfFile(mData, 0))
+    {
+        return false;
+    }
+    return async || FlushFileBuffers(mFileHandle);
+}
+
+#else // LL_WINDOWS
+
+bool LLMappedFile::map(const std::string& filename, size_t size, bool read_only)
+{
+    unmap();
+    mReadOnly = read_only;
+
+    mFileDescriptor = ::open(filename.c_str(), read_only ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+    if (mFileDescriptor < 0)
+    {
+        LL_WARNS() << "Unable to open " << filename << " for mapping: " << strerror(errno) << LL_ENDL;
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(mFileDescriptor, &file_stat) != 0)
+    {
+        LL_WARNS() << "Unable to get the size of " << filename << ": " << strerror(errno) << LL_ENDL;
+        unmap();
+        return false;
+    }
+    if (read_only)
+    {
+        size = llmin(size, (size_t)file_stat.st_size);
+    }
+    else if ((size_t)file_stat.st_size < size && ftruncate(mFileDescriptor, size) != 0)
+    {
+        LL_WARNS() << "Unable to grow " << filename << " to " << size << " bytes: " << strerror(errno) << LL_ENDL;
+        unmap();
+        return false;
+    }
+    if (!size)
+    {
+        unmap();
+        return false;
+    }
+
+    void* data = mmap(nullptr, size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, mFileDescriptor, 0);
+    if (data == MAP_FAILED)
+    {
+        LL_WARNS() << "Unable to map " << filename << ": " << strerror(errno) << LL_ENDL;
+        unmap();
+        return false;
+    }
+    mData = (U8*)data;
+    mSize = size;
+    return true;
+}
+
+void LLMappedFile::unmap()
+{
+    if (mData)
+    {
+        munmap(mData, mSize);
+        mData = nullptr;
+    }
+    if (mFileDescriptor >= 0)
+    {
+        ::close(mFileDescriptor);
+        mFileDescriptor = -1;
+    }
+    mSize = 0;
+}
+
+bool LLMappedFile::flush(bool async)
+{
+    if (!mData || mReadOnly)
+    {
+        return false;
+    }
+    return msync(mData, mSize, async ? MS_ASYNC : MS_SYNC) == 0;
+}
+
+#endif // LL_WINDOWS
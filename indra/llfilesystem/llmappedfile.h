@@ -0,0 +1,67 @@
+/**
+ * @file llmappedfile.h
+ * @brief Memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <boost/noncopyable.hpp>
+
+// Maps a file in memory so that fixed layout records can be read and
+// updated in place, leaving it to the OS to write dirty pages back.
+class LLMappedFile : boost::noncopyable
+{
+public:
+    LLMappedFile();
+    ~LLMappedFile();
+
+    // Map the first size bytes of filename. Unless read_only is set, the
+    // file is created if missing and grown to size if it is shorter.
+    // A read only mapping covers at most the current size of the file.
+    bool map(const std::string& filename, size_t size, bool read_only);
+    void unmap();
+
+    // Write the dirty pages back to the file. If async is set, only
+    // schedule the write.
+    bool flush(bool async = true);
+
+    bool isMapped() const { return mData != nullptr; }
+    bool isReadOnly() const { return mReadOnly; }
+    U8* getData() const { return mData; }
+    size_t getSize() const { return mSize; }
+
+private:
+    U8*     mData;
+    size_t  mSize;
+    bool    mReadOnly;
+#if LL_WINDOWS
+    void*   mFileHandle;
+    void*   mMappingHandle;
+#else
+    int     mFileDescriptor;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
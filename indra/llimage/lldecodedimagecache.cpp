@@ -0,0 +1,656 @@
+/**
+ * @file lldecodedimagecache.cpp
+ * @brief Disk cache of decoded texture mip chains.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lldecodedimagecache.h"
+
+#include "lldir.h"
+#include "llfile.h"
+#include "threadpool.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+
+static const std::string CACHE_FILE_EXTENSION(".mips");
+static const std::string TEMP_FILE_EXTENSION(".tmp");
+
+static const U32 CACHE_MAGIC = 0x5350494d; // "MIPS"
+// bump when the file layout changes, older files are then ignored and evicted
+static const U32 CACHE_VERSION = 1;
+
+namespace
+{
+    S32 level_dimension(S32 full, S32 discard)
+    {
+        // the decoder rounds partial pixels up
+        return (full + (1 << discard) - 1) >> discard;
+    }
+
+    bool ends_with(const std::string& str, const std::string& suffix)
+    {
+        return str.size() >= suffix.size()
+            && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+#if LL_WINDOWS
+    std::wstring to_path(const std::string& filename) { return ll_convert<std::wstring>(filename); }
+#else
+    const std::string& to_path(const std::string& filename) { return filename; }
+#endif
+}
+
+LLDecodedImageCache::LLDecodedImageCache(const std::string& cache_dir,
+                                         const uintmax_t max_size_bytes,
+                                         const bool read_only) :
+    mCacheDir(cache_dir),
+    mMaxSizeBytes(max_size_bytes),
+    mReadOnly(read_only),
+    mTotalSizeBytes(0),
+    mQueuedBytes(0),
+    mWriteSerial(0),
+    mHits(0),
+    mMisses(0)
+{
+    if (!mReadOnly)
+    {
+        LLFile::mkdir(mCacheDir);
+    }
+
+    // Scanning a large cache stats every file, keep it off the caller's
+    // thread
+    mThreadPool.reset(new LL::ThreadPool("DecodedImageCache", 1));
+    mThreadPool->start();
+    if (!mThreadPool->getQueue().tryPost([this]() { loadIndex(); }))
+    {
+        loadIndex();
+    }
+}
+
+LLDecodedImageCache::~LLDecodedImageCache()
+{
+    // finishes the queued writes
+    mThreadPool->close();
+}
+
+std::string LLDecodedImageCache::getFilename(const LLUUID& id) const
+{
+    return mCacheDir + gDirUtilp->getDirDelimiter() + id.asString() + CACHE_FILE_EXTENSION;
+}
+
+//static
+bool LLDecodedImageCache::readHeader(LLFILE* file, Header& header)
+{
+    return fread(&header, sizeof(header), 1, file) == 1
+        && header.mMagic == CACHE_MAGIC
+        && header.mVersion == CACHE_VERSION
+        && header.mLevelCount > 0;
+}
+
+//static
+U8 LLDecodedImageCache::countLevels(S32 discard, S32 width, S32 height)
+{
+    U8 count = 1;
+    while (discard + count <= MAX_DISCARD_LEVEL
+           && width > 1 && height > 1
+           && (width & 1) == 0 && (height & 1) == 0)
+    {
+        width >>= 1;
+        height >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+void LLDecodedImageCache::loadIndex()
+{
+    LLMutexLock scan_lock(&mScanMutex);
+
+    typedef std::pair<std::time_t, std::pair<uintmax_t, LLUUID>> file_info_t;
+    std::vector<file_info_t> file_info;
+    std::vector<std::string> stale_files;
+
+    boost::system::error_code ec;
+    if (boost::filesystem::is_directory(to_path(mCacheDir), ec) && !ec.failed())
+    {
+        boost::filesystem::directory_iterator iter(to_path(mCacheDir), ec);
+        while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+        {
+            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
+            {
+                const std::string file_name = (*iter).path().filename().string();
+                if (ends_with(file_name, TEMP_FILE_EXTENSION))
+                {
+                    // left behind by a writer that did not finish
+                    stale_files.push_back(file_name);
+                }
+                else if (file_name.size() == UUID_STR_LENGTH - 1 + CACHE_FILE_EXTENSION.size()
+                         && ends_with(file_name, CACHE_FILE_EXTENSION))
+                {
+                    const std::string id_str = file_name.substr(0, UUID_STR_LENGTH - 1);
+                    uintmax_t file_size = boost::filesystem::file_size(*iter, ec);
+                    if (!ec.failed() && LLUUID::validate(id_str))
+                    {
+                        const std::time_t file_time = boost::filesystem::last_write_time(*iter, ec);
+                        if (!ec.failed())
+                        {
+                            file_info.push_back(file_info_t(file_time, { file_size, LLUUID(id_str) }));
+                        }
+                    }
+                }
+            }
+            iter.increment(ec);
+        }
+    }
+
+    std::sort(file_info.begin(), file_info.end(), [](const file_info_t& x, const file_info_t& y)
+    {
+        return x.first < y.first;
+    });
+
+    {
+        LLMutexLock lock(&mMutex);
+        for (const file_info_t& entry : file_info)
+        {
+            const LLUUID& id = entry.second.second;
+            if (mEntries.find(id) != mEntries.end())
+            {
+                // written since the scan started
+                continue;
+            }
+            IndexEntry& index_entry = mEntries[id];
+            index_entry.mSize = entry.second.first;
+            index_entry.mTopDiscard = -1;
+            index_entry.mLRUIter = mLRU.insert(mLRU.end(), id);
+            mTotalSizeBytes += index_entry.mSize;
+        }
+    }
+
+    if (!mReadOnly)
+    {
+        for (const std::string& file_name : stale_files)
+        {
+            removeFile(mCacheDir + gDirUtilp->getDirDelimiter() + file_name);
+        }
+
+        // the budget may have shrunk since the last session
+        std::vector<LLUUID> evicted;
+        {
+            LLMutexLock lock(&mMutex);
+            while (mTotalSizeBytes > mMaxSizeBytes && !mLRU.empty())
+            {
+                const LLUUID id = mLRU.front();
+                evicted.push_back(id);
+                removeEntry(id);
+            }
+        }
+        for (const LLUUID& id : evicted)
+        {
+            removeFile(getFilename(id));
+        }
+    }
+
+    LL_INFOS("TextureCache") << "Decoded texture cache: " << getCacheInfo() << LL_ENDL;
+}
+
+std::vector<LLUUID> LLDecodedImageCache::addEntry(const LLUUID& id, uintmax_t size, S32 top_discard)
+{
+    std::vector<LLUUID> evicted;
+
+    LLMutexLock lock(&mMutex);
+    auto iter = mEntries.find(id);
+    if (iter != mEntries.end())
+    {
+        mTotalSizeBytes -= iter->second.mSize;
+        mLRU.splice(mLRU.end(), mLRU, iter->second.mLRUIter);
+    }
+    else
+    {
+        iter = mEntries.emplace(id, IndexEntry()).first;
+        iter->second.mLRUIter = mLRU.insert(mLRU.end(), id);
+    }
+    iter->second.mSize = size;
+    iter->second.mTopDiscard = top_discard;
+    mTotalSizeBytes += size;
+
+    while (mTotalSizeBytes > mMaxSizeBytes && mLRU.front() != id)
+    {
+        const LLUUID oldest = mLRU.front();
+        evicted.push_back(oldest);
+        removeEntry(oldest);
+    }
+    return evicted;
+}
+
+void LLDecodedImageCache::touchEntry(const LLUUID& id, S32 top_discard)
+{
+    LLMutexLock lock(&mMutex);
+    auto iter = mEntries.find(id);
+    if (iter != mEntries.end())
+    {
+        iter->second.mTopDiscard = top_discard;
+        mLRU.splice(mLRU.end(), mLRU, iter->second.mLRUIter);
+    }
+}
+
+void LLDecodedImageCache::removeEntry(const LLUUID& id)
+{
+    // mMutex must be held by the caller
+    auto iter = mEntries.find(id);
+    if (iter != mEntries.end())
+    {
+        mTotalSizeBytes -= iter->second.mSize;
+        mLRU.erase(iter->second.mLRUIter);
+        mEntries.erase(iter);
+    }
+}
+
+//static
+void LLDecodedImageCache::removeFile(const std::string& filename)
+{
+    boost::system::error_code ec;
+    boost::filesystem::remove(to_path(filename), ec);
+    if (ec.failed())
+    {
+        // Most likely open in another thread, a later eviction or the next
+        // startup scan will pick it up again
+        LL_WARNS("TextureCache") << "Failed to delete decoded cache file " << filename << ": " << ec.message() << LL_ENDL;
+    }
+}
+
+bool LLDecodedImageCache::read(const LLUUID& id, S32 discard, bool needs_aux,
+                               S32 full_width, S32 full_height, S8 components,
+                               LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+    {
+        LLMutexLock lock(&mMutex);
+        auto iter = mEntries.find(id);
+        if (iter == mEntries.end()
+            || (iter->second.mTopDiscard >= 0 && iter->second.mTopDiscard > discard))
+        {
+            ++mMisses;
+            return false;
+        }
+    }
+
+    const std::string filename = getFilename(id);
+    LLUniqueFile file(LLFile::fopen(filename, "rb"));
+    Header header;
+    if (!file || !readHeader(file, header)
+        || header.mFullWidth != full_width || header.mFullHeight != full_height
+        || header.mComponents != components)
+    {
+        // gone, damaged or from another format version: drop it
+        if (!mReadOnly)
+        {
+            file.close();
+            {
+                LLMutexLock lock(&mMutex);
+                removeEntry(id);
+            }
+            removeFile(filename);
+        }
+        ++mMisses;
+        return false;
+    }
+
+    S32 level = discard - header.mTopDiscard;
+    if (level < 0 || level >= header.mLevelCount || (needs_aux && !header.mHasAux))
+    {
+        ++mMisses;
+        return false;
+    }
+
+    // skip the larger levels
+    S32 width = header.mTopWidth;
+    S32 height = header.mTopHeight;
+    const S32 planes = header.mHasAux ? components + 1 : components;
+    long offset = sizeof(Header);
+    for (S32 i = 0; i < level; ++i)
+    {
+        offset += (long)width * height * planes;
+        width >>= 1;
+        height >>= 1;
+    }
+
+    bool success = fseek(file, offset, SEEK_SET) == 0;
+    if (success)
+    {
+        raw = new LLImageRaw(width, height, components);
+        success = raw->getData() && fread(raw->getData(), raw->getDataSize(), 1, file) == 1;
+    }
+    if (success && needs_aux)
+    {
+        aux = new LLImageRaw(width, height, 1);
+        success = aux->getData() && fread(aux->getData(), aux->getDataSize(), 1, file) == 1;
+    }
+    file.close();
+
+    if (!success)
+    {
+        raw = nullptr;
+        aux = nullptr;
+        ++mMisses;
+        return false;
+    }
+
+    touchEntry(id, header.mTopDiscard);
+    if (!mReadOnly)
+    {
+        // so the next session's index starts in the same order
+        boost::system::error_code ec;
+        boost::filesystem::last_write_time(to_path(filename), std::time(nullptr), ec);
+    }
+
+    ++mHits;
+    return true;
+}
+
+void LLDecodedImageCache::write(const LLUUID& id, S32 discard,
+                                S32 full_width, S32 full_height, S8 components,
+                                const LLImageRaw* raw, const LLImageRaw* aux)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+    if (mReadOnly || id.isNull() || !raw || !raw->getData()
+        || discard < 0 || discard > MAX_DISCARD_LEVEL
+        || full_width > MAX_IMAGE_SIZE || full_height > MAX_IMAGE_SIZE)
+    {
+        return;
+    }
+
+    const S32 width = raw->getWidth();
+    const S32 height = raw->getHeight();
+    if (width < MIN_DIMENSION || height < MIN_DIMENSION
+        || raw->getComponents() != components
+        || width != level_dimension(full_width, discard)
+        || height != level_dimension(full_height, discard))
+    {
+        return;
+    }
+    if (aux && (!aux->getData() || aux->getComponents() != 1
+                || aux->getWidth() != width || aux->getHeight() != height))
+    {
+        aux = nullptr;
+    }
+
+    const std::string filename = getFilename(id);
+
+    // only replace what we have with something better
+    S32 cached_discard = MAX_DISCARD_LEVEL + 1;
+    {
+        LLMutexLock lock(&mMutex);
+        auto iter = mEntries.find(id);
+        if (iter != mEntries.end())
+        {
+            cached_discard = iter->second.mTopDiscard;
+        }
+    }
+    if (cached_discard < 0)
+    {
+        LLUniqueFile file(LLFile::fopen(filename, "rb"));
+        Header header;
+        if (file && readHeader(file, header)
+            && header.mFullWidth == full_width && header.mFullHeight == full_height
+            && header.mComponents == components)
+        {
+            cached_discard = header.mTopDiscard;
+        }
+        else
+        {
+            cached_discard = MAX_DISCARD_LEVEL + 1;
+        }
+    }
+    if (cached_discard <= discard)
+    {
+        return;
+    }
+
+    Header header;
+    header.mMagic = CACHE_MAGIC;
+    header.mVersion = CACHE_VERSION;
+    header.mFullWidth = (U16)full_width;
+    header.mFullHeight = (U16)full_height;
+    header.mTopWidth = (U16)width;
+    header.mTopHeight = (U16)height;
+    header.mComponents = (U8)components;
+    header.mTopDiscard = (U8)discard;
+    header.mLevelCount = countLevels(discard, width, height);
+    header.mHasAux = aux ? 1 : 0;
+
+    const std::string temp_filename = filename + "." + std::to_string(++mWriteSerial) + TEMP_FILE_EXTENSION;
+    uintmax_t file_size = sizeof(header);
+    {
+        LLUniqueFile file(LLFile::fopen(temp_filename, "wb"));
+        if (!file)
+        {
+            LL_WARNS("TextureCache") << "Unable to write decoded cache file " << temp_filename << LL_ENDL;
+            return;
+        }
+
+        bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+        // each level is box filtered from the previous one
+        std::vector<U8> raw_levels[2], aux_levels[2];
+        const U8* raw_data = raw->getData();
+        const U8* aux_data = aux ? aux->getData() : nullptr;
+        S32 level_width = width, level_height = height;
+        for (S32 level = 0; success && level < header.mLevelCount; ++level)
+        {
+            if (level > 0)
+            {
+                level_width >>= 1;
+                level_height >>= 1;
+                std::vector<U8>& raw_mip = raw_levels[level & 1];
+                raw_mip.resize((size_t)level_width * level_height * components);
+                LLImageBase::generateMip(raw_data, raw_mip.data(), level_width, level_height, components);
+                raw_data = raw_mip.data();
+                if (aux_data)
+                {
+                    std::vector<U8>& aux_mip = aux_levels[level & 1];
+                    aux_mip.resize((size_t)level_width * level_height);
+                    LLImageBase::generateMip(aux_data, aux_mip.data(), level_width, level_height, 1);
+                    aux_data = aux_mip.data();
+                }
+            }
+
+            const size_t level_size = (size_t)level_width * level_height;
+            success = fwrite(raw_data, level_size * components, 1, file) == 1;
+            file_size += level_size * components;
+            if (success && aux_data)
+            {
+                success = fwrite(aux_data, level_size, 1, file) == 1;
+                file_size += level_size;
+            }
+        }
+
+        if (!success)
+        {
+            LL_WARNS("TextureCache") << "Failed to write decoded cache file " << temp_filename << LL_ENDL;
+            file.close();
+            LLFile::remove(temp_filename);
+            return;
+        }
+    }
+
+#if LL_WINDOWS
+    // rename() does not replace an existing file on Windows
+    LLFile::remove(filename, ENOENT);
+#endif
+    if (LLFile::rename(temp_filename, filename) != 0)
+    {
+        LLFile::remove(temp_filename);
+        LLMutexLock lock(&mMutex);
+        removeEntry(id);
+        return;
+    }
+
+    for (const LLUUID& evicted : addEntry(id, file_size, discard))
+    {
+        removeFile(getFilename(evicted));
+    }
+}
+
+void LLDecodedImageCache::queueWrite(const LLUUID& id, S32 discard,
+                                     S32 full_width, S32 full_height, S8 components,
+                                     const LLImageRaw* raw, const LLImageRaw* aux)
+{
+    if (mReadOnly || id.isNull() || !raw || !raw->getData()
+        || raw->getWidth() < MIN_DIMENSION || raw->getHeight() < MIN_DIMENSION)
+    {
+        return;
+    }
+
+    {
+        LLMutexLock lock(&mMutex);
+        auto iter = mEntries.find(id);
+        if (iter != mEntries.end() && iter->second.mTopDiscard >= 0 && iter->second.mTopDiscard <= discard)
+        {
+            return;
+        }
+        auto queued = mQueuedWrites.find(id);
+        if (queued != mQueuedWrites.end() && queued->second <= discard)
+        {
+            return;
+        }
+    }
+
+    const U64 bytes = (U64)raw->getDataSize() + (aux && aux->getData() ? (U64)aux->getDataSize() : 0);
+    if (mQueuedBytes + bytes > MAX_QUEUED_BYTES)
+    {
+        return;
+    }
+
+    // the decoded images go on to the main thread, write copies
+    LLPointer<LLImageRaw> raw_copy = new LLImageRaw(raw->getData(), raw->getWidth(), raw->getHeight(), raw->getComponents());
+    LLPointer<LLImageRaw> aux_copy;
+    if (aux && aux->getData())
+    {
+        aux_copy = new LLImageRaw(aux->getData(), aux->getWidth(), aux->getHeight(), aux->getComponents());
+    }
+
+    {
+        LLMutexLock lock(&mMutex);
+        mQueuedWrites[id] = discard;
+    }
+    mQueuedBytes += bytes;
+
+    bool posted = mThreadPool->getQueue().tryPost(
+        [this, id, discard, full_width, full_height, components, raw_copy, aux_copy, bytes]()
+        {
+            bool superseded = false;
+            {
+                LLMutexLock lock(&mMutex);
+                auto queued = mQueuedWrites.find(id);
+                if (queued != mQueuedWrites.end())
+                {
+                    // a better level queued since is written instead
+                    superseded = queued->second < discard;
+                    if (!superseded)
+                    {
+                        mQueuedWrites.erase(queued);
+                    }
+                }
+            }
+            if (!superseded)
+            {
+                write(id, discard, full_width, full_height, components, raw_copy, aux_copy);
+            }
+            mQueuedBytes -= bytes;
+        });
+    if (!posted)
+    {
+        // closed on shutdown
+        mQueuedBytes -= bytes;
+        LLMutexLock lock(&mMutex);
+        auto queued = mQueuedWrites.find(id);
+        if (queued != mQueuedWrites.end() && queued->second == discard)
+        {
+            mQueuedWrites.erase(queued);
+        }
+    }
+}
+
+void LLDecodedImageCache::clearCache()
+{
+    if (mReadOnly)
+    {
+        return;
+    }
+
+    LLMutexLock scan_lock(&mScanMutex);
+    {
+        LLMutexLock lock(&mMutex);
+        mEntries.clear();
+        mLRU.clear();
+        mTotalSizeBytes = 0;
+    }
+
+    boost::system::error_code ec;
+    if (boost::filesystem::is_directory(to_path(mCacheDir), ec) && !ec.failed())
+    {
+        std::vector<std::string> file_names;
+        boost::filesystem::directory_iterator iter(to_path(mCacheDir), ec);
+        while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+        {
+            const std::string file_name = (*iter).path().filename().string();
+            if (ends_with(file_name, CACHE_FILE_EXTENSION) || ends_with(file_name, TEMP_FILE_EXTENSION))
+            {
+                file_names.push_back(file_name);
+            }
+            iter.increment(ec);
+        }
+        for (const std::string& file_name : file_names)
+        {
+            removeFile(mCacheDir + gDirUtilp->getDirDelimiter() + file_name);
+        }
+    }
+}
+
+uintmax_t LLDecodedImageCache::getTotalSizeBytes()
+{
+    LLMutexLock lock(&mMutex);
+    return mTotalSizeBytes;
+}
+
+std::string LLDecodedImageCache::getCacheInfo()
+{
+    size_t file_count;
+    uintmax_t total_size;
+    {
+        LLMutexLock lock(&mMutex);
+        file_count = mEntries.size();
+        total_size = mTotalSizeBytes;
+    }
+
+    const F64 MB = 1024.0 * 1024.0;
+    return llformat("%.1f MB / %.1f MB in %d files, %llu hits, %llu misses",
+                    total_size / MB, mMaxSizeBytes / MB, (S32)file_count,
+                    (unsigned long long)mHits.load(), (unsigned long long)mMisses.load());
+}
@@ -0,0 +1,228 @@
+/**
+ * @file lldecodedimagecache.h
+ * @brief Disk cache of decoded texture mip chains.
+ *
+ * The texture cache only keeps the formatted (J2C) bytes of a texture so
+ * every session pays for decoding it again. This cache sits behind the
+ * decode thread and keeps what the decoder produced: a raw mip chain per
+ * texture, starting at the best discard level decoded so far. When a decode
+ * is requested for a level that is in the chain, the pixels are read back
+ * from disk and the decoder is not run at all.
+ *
+ * 1/ There is one file per texture, named after its id. A file is written
+ *    to a temporary name and renamed into place so a reader never sees a
+ *    partial file.
+ * 2/ An in-memory index keeps the files in least recently used order and
+ *    their combined size under a fixed budget; writes evict the oldest
+ *    entries. The index is rebuilt at startup from a scan of the folder,
+ *    ordered by modification time, which hits refresh.
+ * 3/ The startup scan and the writes queued by the decode threads run on
+ *    a thread of the cache's own, so neither the main thread nor the
+ *    decode threads wait on the disk for them. Lookups miss until the
+ *    scan is done.
+ * 4/ Levels below the decoded one are box filtered from it, they are not
+ *    the wavelet reconstruction the decoder would have produced.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLDECODEDIMAGECACHE_H
+#define LL_LLDECODEDIMAGECACHE_H
+
+#include "llimage.h"
+#include "llmutex.h"
+#include "llsingleton.h"
+#include "lluuid.h"
+#include "threadpool_fwd.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class LLDecodedImageCache :
+    public LLParamSingleton<LLDecodedImageCache>
+{
+    LLSINGLETON(LLDecodedImageCache,
+                /**
+                 * The folder holding the cache files, created if needed
+                 */
+                const std::string& cache_dir,
+                /**
+                 * The maximum combined size of the cache files in bytes
+                 */
+                const uintmax_t max_size_bytes,
+                /**
+                 * A read only cache serves hits but never writes, evicts
+                 * or touches files. Used by a second viewer instance.
+                 */
+                const bool read_only);
+    ~LLDecodedImageCache();
+
+public:
+    /**
+     * Textures smaller than this on either side are not worth a file:
+     * decoding them is cheaper than the disk round trip.
+     */
+    static const S32 MIN_DIMENSION = 64;
+
+    /**
+     * Look up the decoded pixels of a texture at the given discard level.
+     * full_width, full_height and components describe the formatted image
+     * at discard 0 and must match what was cached. On success raw (and aux
+     * when needs_aux is set) hold newly allocated images.
+     *
+     * Safe to call from any thread.
+     */
+    bool read(const LLUUID& id, S32 discard, bool needs_aux,
+              S32 full_width, S32 full_height, S8 components,
+              LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux);
+
+    /**
+     * Store a freshly decoded image. Does nothing if the cache already
+     * holds this texture at the same or a better discard level. aux may be
+     * null if the texture has no aux channel. Writes the whole mip chain
+     * before returning, see queueWrite().
+     *
+     * Safe to call from any thread.
+     */
+    void write(const LLUUID& id, S32 discard,
+               S32 full_width, S32 full_height, S8 components,
+               const LLImageRaw* raw, const LLImageRaw* aux);
+
+    /**
+     * Copy the images and write() them on the cache thread. The write is
+     * dropped when a better level of the texture is already cached or
+     * queued, or when MAX_QUEUED_BYTES are already waiting.
+     *
+     * Safe to call from any thread.
+     */
+    void queueWrite(const LLUUID& id, S32 discard,
+                    S32 full_width, S32 full_height, S8 components,
+                    const LLImageRaw* raw, const LLImageRaw* aux);
+
+    /**
+     * Pixels waiting to be written beyond which queueWrite() drops writes.
+     */
+    static const U64 MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+
+    /**
+     * Remove every cache file and empty the index. Waits for the startup
+     * scan to finish.
+     */
+    void clearCache();
+
+    /**
+     * Return some information about the cache for use in About Box etc.
+     */
+    std::string getCacheInfo();
+
+    U64 getHits() const { return mHits; }
+    U64 getMisses() const { return mMisses; }
+    uintmax_t getTotalSizeBytes();
+
+private:
+    /**
+     * File header, followed by the levels of the raw mip chain from
+     * mTopDiscard down, each followed by its aux level when mHasAux is set.
+     */
+    struct Header
+    {
+        U32 mMagic;
+        U32 mVersion;
+        U16 mFullWidth;
+        U16 mFullHeight;
+        U16 mTopWidth;
+        U16 mTopHeight;
+        U8  mComponents;
+        U8  mTopDiscard;
+        U8  mLevelCount;
+        U8  mHasAux;
+    };
+
+    struct IndexEntry
+    {
+        uintmax_t                   mSize;
+        // -1 until the file header has been read
+        S32                         mTopDiscard;
+        std::list<LLUUID>::iterator mLRUIter;
+    };
+
+    std::string getFilename(const LLUUID& id) const;
+
+    /**
+     * Read and validate the header of a cache file
+     */
+    static bool readHeader(LLFILE* file, Header& header);
+
+    /**
+     * Number of levels of a chain starting at the given discard level and
+     * size. Halving stops at the first odd dimension, where a box filtered
+     * level would no longer have the size the decoder gives it.
+     */
+    static U8 countLevels(S32 discard, S32 width, S32 height);
+
+    /**
+     * Scan the cache folder to build the index, oldest files first. Runs
+     * on the cache thread.
+     */
+    void loadIndex();
+
+    /**
+     * Add or refresh an entry, evicting older entries until the cache fits
+     * its budget again. Returns the files to delete; the caller removes
+     * them without holding mMutex.
+     */
+    std::vector<LLUUID> addEntry(const LLUUID& id, uintmax_t size, S32 top_discard);
+    void touchEntry(const LLUUID& id, S32 top_discard);
+    void removeEntry(const LLUUID& id);
+
+    static void removeFile(const std::string& filename);
+
+private:
+    const std::string mCacheDir;
+    const uintmax_t mMaxSizeBytes;
+    const bool mReadOnly;
+
+    // protects the index
+    LLMutex mMutex;
+    std::list<LLUUID> mLRU;
+    std::unordered_map<LLUUID, IndexEntry> mEntries;
+    uintmax_t mTotalSizeBytes;
+    // best discard level queued for writing per texture, under mMutex
+    std::unordered_map<LLUUID, S32> mQueuedWrites;
+    std::atomic<U64> mQueuedBytes;
+
+    // held by loadIndex() for the whole scan
+    LLMutex mScanMutex;
+
+    // makes the temporary file names of concurrent writers unique
+    std::atomic<U32> mWriteSerial;
+    std::atomic<U64> mHits;
+    std::atomic<U64> mMisses;
+
+    // runs loadIndex() and the queued writes
+    std::unique_ptr<LL::ThreadPool> mThreadPool;
+};
+
+#endif // LL_LLDECODEDIMAGECACHE_H
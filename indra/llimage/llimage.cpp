@@ -34,6 +34,7 @@
 #include "v3color.h"
 
 #include "llimagebmp.h"
+#include "llimagebufferpool.h"
 #include "llimagetga.h"
 #include "llimagej2c.h"
 #include "llimagejpeg.h"
@@ -43,6 +44,18 @@
 
 #include <boost/preprocessor.hpp>
 
+#if LL_ARM64
+#include "sse2neon.h"
+#elif LL_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_1__) || defined(LL_ARM64)
+#define LL_IMAGE_SIMD 1
+#else
+#define LL_IMAGE_SIMD 0
+#endif
+
 //..................................................................................
 //..................................................................................
 // Helper macrose's for generate cycle unwrap templates
@@ -219,8 +232,155 @@ private:
     }
 };
 
+#if LL_IMAGE_SIMD
+//..................................................................................
+// SSE4.1 (NEON through sse2neon) kernels. Each one reproduces the integer
+// arithmetic of the scalar code above exactly, one pixel or one row at a
+// time; LLImage::setUseSIMD(false) switches back to the scalar code.
+//..................................................................................
+namespace
+{
+    // one RGBA pixel widened to four S32 lanes
+    inline __m128i load_pixel4(const U8* pix)
+    {
+        S32 packed;
+        memcpy(&packed, pix, sizeof(packed));
+        return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+    }
 
-template<U8 ch>
+    inline __m128i load_s32x4(const S32* v)
+    {
+        return _mm_loadu_si128((const __m128i*)v);
+    }
+
+    inline void store_s32x4(S32* v, __m128i val)
+    {
+        _mm_storeu_si128((__m128i*)v, val);
+    }
+
+    inline __m128i mul_s32(__m128i a, S32 b)
+    {
+        return _mm_mullo_epi32(a, _mm_set1_epi32(b));
+    }
+
+    // low byte of each S32 lane, i.e. (val & 0xff) for the four channels
+    inline void store_pixel4(U8*& dptr, __m128i val)
+    {
+        const __m128i low_bytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        S32 packed = _mm_cvtsi128_si32(_mm_shuffle_epi8(val, low_bytes));
+        memcpy(dptr, &packed, sizeof(packed));
+        dptr += 4;
+    }
+
+    // (U8)(255*(a/255.f)*(b/255.f) + 0.5f) on eight U16 lanes, as
+    // LLImageRaw::fastFractionalMult()
+    inline __m128i fractional_mult_u16(__m128i a, __m128i b)
+    {
+        __m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+    }
+}
+
+// Same operations as the uroll_*<4> templates, four channels at once
+struct scale_ops_simd4
+{
+    struct uroll_zeroze_cx_comp_t
+    {
+        inline void operator()(S32* cx, S32* comp)
+        {
+            store_s32x4(cx, _mm_setzero_si128());
+            store_s32x4(comp, _mm_setzero_si128());
+        }
+    };
+    struct uroll_comp_rshftasgn_constval_t
+    {
+        inline void operator()(S32* comp, const S32 cval)
+        {
+            store_s32x4(comp, _mm_sra_epi32(load_s32x4(comp), _mm_cvtsi32_si128(cval)));
+        }
+    };
+    struct uroll_comp_asgn_cx_rshft_cval_all_mul_val_t
+    {
+        inline void operator()(S32* comp, S32* cx, const S32 cval, S32 val)
+        {
+            store_s32x4(comp, mul_s32(_mm_sra_epi32(load_s32x4(cx), _mm_cvtsi32_si128(cval)), val));
+        }
+    };
+    struct uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t
+    {
+        inline void operator()(S32* comp, S32* cx, const S32 cval, S32 val)
+        {
+            __m128i prod = mul_s32(_mm_sra_epi32(load_s32x4(cx), _mm_cvtsi32_si128(cval)), val);
+            store_s32x4(comp, _mm_add_epi32(load_s32x4(comp), prod));
+        }
+    };
+    struct uroll_inp_plusasgn_pix_mul_val_t
+    {
+        inline void operator()(S32* comp, const U8* pix, S32 val)
+        {
+            store_s32x4(comp, _mm_add_epi32(load_s32x4(comp), mul_s32(load_pixel4(pix), val)));
+        }
+    };
+    struct uroll_inp_asgn_pix_mul_val_t
+    {
+        inline void operator()(S32* comp, const U8* pix, S32 val)
+        {
+            store_s32x4(comp, mul_s32(load_pixel4(pix), val));
+        }
+    };
+    struct uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r_t
+    {
+        inline void operator()(S32* comp, S32* cx, S32 apoint)
+        {
+            __m128i sum = _mm_add_epi32(mul_s32(load_s32x4(cx), apoint), mul_s32(load_s32x4(comp), 256 - apoint));
+            store_s32x4(comp, _mm_srai_epi32(sum, 16));
+        }
+    };
+    struct uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t
+    {
+        inline void operator()(S32* comp, const U8* pix, S32 apoint)
+        {
+            __m128i sum = _mm_add_epi32(load_s32x4(comp), mul_s32(load_pixel4(pix), apoint));
+            store_s32x4(comp, _mm_srai_epi32(sum, 8));
+        }
+    };
+    struct uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t
+    {
+        inline void operator()(S32* comp, S32 apoint, S32* cx)
+        {
+            __m128i sum = _mm_add_epi32(mul_s32(load_s32x4(comp), 256 - apoint), mul_s32(load_s32x4(cx), apoint));
+            store_s32x4(comp, _mm_srai_epi32(sum, 12));
+        }
+    };
+    struct uroll_uref_dptr_inc_asgn_comp_and_ff_t
+    {
+        inline void operator()(U8*& dptr, S32* comp)
+        {
+            store_pixel4(dptr, load_s32x4(comp));
+        }
+    };
+    struct uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff_t
+    {
+        inline void operator()(U8*& dptr, const U8* sptr, S32 apoint)
+        {
+            memcpy(dptr, sptr + apoint, 4);
+            dptr += 4;
+        }
+    };
+    struct uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t
+    {
+        inline void operator()(U8*& dptr, S32* comp, const S32 cval)
+        {
+            store_pixel4(dptr, _mm_sra_epi32(load_s32x4(comp), _mm_cvtsi32_si128(cval)));
+        }
+    };
+};
+#endif // LL_IMAGE_SIMD
+
+
+// ops_t supplies the per-pixel operations: the unrolled scalar templates
+// of scale_info<ch> by default
+template<U8 ch, typename ops_t = scale_info<ch> >
 inline void bilinear_scale(
     const U8 *src, U32 srcW, U32 srcH, U32 srcStride
     , U8 *dst, U32 dstW, U32 dstH, U32 dstStride
@@ -250,24 +410,24 @@ inline void bilinear_scale(
                 for(x = 0; x < dstW; ++x)
                 {
                     //for(c = 0; c < ch; ++c) cx[c] = comp[c] = 0;
-                    typename scale_info_t::uroll_zeroze_cx_comp_t()(cx, comp);
+                    typename ops_t::uroll_zeroze_cx_comp_t()(cx, comp);
 
                     if(0 < info.xapoints[x])
                     {
                         pix = info.ystrides[y] + info.xpoints[x] * ch;
 
                         //for(c = 0; c < ch; ++c) comp[c] = pix[c] * (256 - info.xapoints[x]);
-                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256 - info.xapoints[x]);
+                        typename ops_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256 - info.xapoints[x]);
 
                         pix += ch;
 
                         //for(c = 0; c < ch; ++c) comp[c] += pix[c] * info.xapoints[x];
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, info.xapoints[x]);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, info.xapoints[x]);
 
                         pix += srcStride;
 
                         //for(c = 0; c < ch; ++c) cx[c] = pix[c] * info.xapoints[x];
-                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, info.xapoints[x]);
+                        typename ops_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, info.xapoints[x]);
 
                         pix -= ch;
 
@@ -276,16 +436,16 @@ inline void bilinear_scale(
                         //  comp[c] = ((cx[c] * info.yapoints[y]) + (comp[c] * (256 - info.yapoints[y]))) >> 16;
                         //  *dptr++ = comp[c]&0xff;
                         //}
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, 256 - info.xapoints[x]);
-                        typename scale_info_t::uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r_t()(comp, cx, info.yapoints[y]);
-                        typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, 256 - info.xapoints[x]);
+                        typename ops_t::uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r_t()(comp, cx, info.yapoints[y]);
+                        typename ops_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
                     }
                     else
                     {
                         pix = info.ystrides[y] + info.xpoints[x] * ch;
 
                         //for(c = 0; c < ch; ++c) comp[c] = pix[c] * (256 - info.yapoints[y]);
-                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256-info.yapoints[y]);
+                        typename ops_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256-info.yapoints[y]);
 
                         pix += srcStride;
 
@@ -293,8 +453,8 @@ inline void bilinear_scale(
                         //  comp[c] = (comp[c] + pix[c] * info.yapoints[y]) >> 8;
                         //  *dptr++ = comp[c]&0xff;
                         //}
-                        typename scale_info_t::uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t()(comp, pix, info.yapoints[y]);
-                        typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
+                        typename ops_t::uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t()(comp, pix, info.yapoints[y]);
+                        typename ops_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
                     }
                 }
             }
@@ -311,14 +471,14 @@ inline void bilinear_scale(
                         //  comp[c] = (comp[c] + pix[c] * info.xapoints[x]) >> 8;
                         //  *dptr++ = comp[c]&0xff;
                         //}
-                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256 - info.xapoints[x]);
-                        typename scale_info_t::uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t()(comp, pix, info.xapoints[x]);
-                        typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
+                        typename ops_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256 - info.xapoints[x]);
+                        typename ops_t::uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t()(comp, pix, info.xapoints[x]);
+                        typename ops_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
                     }
                     else
                     {
                         //for(c = 0; c < ch; ++c) *dptr++ = (sptr[info.xpoints[x]*ch + c])&0xff;
-                        typename scale_info_t::uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff_t()(dptr, sptr, info.xpoints[x]*ch);
+                        typename ops_t::uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff_t()(dptr, sptr, info.xpoints[x]*ch);
                     }
                 }
             }
@@ -341,53 +501,53 @@ inline void bilinear_scale(
                 pix = info.ystrides[y] + info.xpoints[x] * ch;
 
                 //for(c = 0; c < ch; ++c) comp[c] = pix[c] * yap;
-                typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, yap);
+                typename ops_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, yap);
 
                 pix += srcStride;
 
                 for(j = (1 << 14) - yap; j > Cy; j -= Cy, pix += srcStride)
                 {
                     //for(c = 0; c < ch; ++c) comp[c] += pix[c] * Cy;
-                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, Cy);
+                    typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, Cy);
                 }
 
                 if(j > 0)
                 {
                     //for(c = 0; c < ch; ++c) comp[c] += pix[c] * j;
-                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, j);
+                    typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, j);
                 }
 
                 if(info.xapoints[x] > 0)
                 {
                     pix = info.ystrides[y] + info.xpoints[x]*ch + ch;
                     //for(c = 0; c < ch; ++c) cx[c] = pix[c] * yap;
-                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, yap);
+                    typename ops_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, yap);
 
                     pix += srcStride;
                     for(j = (1 << 14) - yap; j > Cy; j -= Cy)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cy;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cy);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cy);
                         pix += srcStride;
                     }
 
                     if(j > 0)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * j;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, j);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, j);
                     }
 
                     //for(c = 0; c < ch; ++c) comp[c] = ((comp[c]*(256 - info.xapoints[x])) + ((cx[c] * info.xapoints[x]))) >> 12;
-                    typename scale_info_t::uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t()(comp, info.xapoints[x], cx);
+                    typename ops_t::uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t()(comp, info.xapoints[x], cx);
                 }
                 else
                 {
                     //for(c = 0; c < ch; ++c) comp[c] >>= 4;
-                    typename scale_info_t::uroll_comp_rshftasgn_constval_t()(comp, 4);
+                    typename ops_t::uroll_comp_rshftasgn_constval_t()(comp, 4);
                 }
 
                 //for(c = 0; c < ch; ++c) *dptr++ = (comp[c]>>10)&0xff;
-                typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 10);
+                typename ops_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 10);
             }
         }
     }
@@ -408,53 +568,53 @@ inline void bilinear_scale(
                 pix = info.ystrides[y] + info.xpoints[x] * ch;
 
                 //for(c = 0; c < ch; ++c) comp[c] = pix[c] * xap;
-                typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, xap);
+                typename ops_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, xap);
 
                 pix+=ch;
                 for(j = (1 << 14) - xap; j > Cx; j -= Cx)
                 {
                     //for(c = 0; c < ch; ++c) comp[c] += pix[c] * Cx;
-                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, Cx);
+                    typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, Cx);
                     pix+=ch;
                 }
 
                 if(j > 0)
                 {
                     //for(c = 0; c < ch; ++c) comp[c] += pix[c] * j;
-                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, j);
+                    typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, j);
                 }
 
                 if(info.yapoints[y] > 0)
                 {
                     pix = info.ystrides[y] + info.xpoints[x]*ch + srcStride;
                     //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
-                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+                    typename ops_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
 
                     pix+=ch;
                     for(j = (1 << 14) - xap; j > Cx; j -= Cx)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
                         pix+=ch;
                     }
 
                     if(j > 0)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * j;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, j);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, j);
                     }
 
                     //for(c = 0; c < ch; ++c) comp[c] = ((comp[c] * (256 - info.yapoints[y])) + ((cx[c] * info.yapoints[y]))) >> 12;
-                    typename scale_info_t::uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t()(comp, info.yapoints[y], cx);
+                    typename ops_t::uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t()(comp, info.yapoints[y], cx);
                 }
                 else
                 {
                     //for(c = 0; c < ch; ++c) comp[c] >>= 4;
-                    typename scale_info_t::uroll_comp_rshftasgn_constval_t()(comp, 4);
+                    typename ops_t::uroll_comp_rshftasgn_constval_t()(comp, 4);
                 }
 
                 //for(c = 0; c < ch; ++c) *dptr++ = (comp[c]>>10)&0xff;
-                typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 10);
+                typename ops_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 10);
             }
         }
     }
@@ -479,24 +639,24 @@ inline void bilinear_scale(
                 sptr += srcStride;
 
                 //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
-                typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+                typename ops_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
 
                 pix+=ch;
                 for(i = (1 << 14) - xap; i > Cx; i -= Cx)
                 {
                     //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
-                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                    typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
                     pix+=ch;
                 }
 
                 if(i > 0)
                 {
                     //for(c = 0; c < ch; ++c) cx[c] += pix[c] * i;
-                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
+                    typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
                 }
 
                 //for(c = 0; c < ch; ++c) comp[c] = (cx[c] >> 5) * yap;
-                typename scale_info_t::uroll_comp_asgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, yap);
+                typename ops_t::uroll_comp_asgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, yap);
 
                 for(j = (1 << 14) - yap; j > Cy; j -= Cy)
                 {
@@ -504,24 +664,24 @@ inline void bilinear_scale(
                     sptr += srcStride;
 
                     //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
-                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+                    typename ops_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
 
                     pix+=ch;
                     for(i = (1 << 14) - xap; i > Cx; i -= Cx)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
                         pix+=ch;
                     }
 
                     if(i > 0)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * i;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
                     }
 
                     //for(c = 0; c < ch; ++c) comp[c] += (cx[c] >> 5) * Cy;
-                    typename scale_info_t::uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, Cy);
+                    typename ops_t::uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, Cy);
                 }
 
                 if(j > 0)
@@ -530,28 +690,28 @@ inline void bilinear_scale(
                     sptr += srcStride;
 
                     //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
-                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+                    typename ops_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
 
                     pix+=ch;
                     for(i = (1 << 14) - xap; i > Cx; i -= Cx)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
                         pix+=ch;
                     }
 
                     if(i > 0)
                     {
                         //for(c = 0; c < ch; ++c) cx[c] += pix[c] * i;
-                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
+                        typename ops_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
                     }
 
                     //for(c = 0; c < ch; ++c) comp[c] += (cx[c] >> 5) * j;
-                    typename scale_info_t::uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, j);
+                    typename ops_t::uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, j);
                 }
 
                 //for(c = 0; c < ch; ++c) *dptr++ = (comp[c]>>23)&0xff;
-                typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 23);
+                typename ops_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 23);
             }
         }
     } //else
@@ -571,6 +731,13 @@ static void bilinear_scale(const U8 *src, U32 srcW, U32 srcH, U32 srcCh, U32 src
         bilinear_scale<3>(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
         break;
     case 4:
+#if LL_IMAGE_SIMD
+        if (LLImage::useSIMD())
+        {
+            bilinear_scale<4, scale_ops_simd4>(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
+            break;
+        }
+#endif
         bilinear_scale<4>(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
         break;
     default:
@@ -587,6 +754,7 @@ static void bilinear_scale(const U8 *src, U32 srcW, U32 srcH, U32 srcCh, U32 src
 //static
 thread_local std::string LLImage::sLastThreadErrorMessage;
 bool LLImage::sUseNewByteRange = false;
+bool LLImage::sUseSIMD = LL_IMAGE_SIMD;
 S32  LLImage::sMinimalReverseByteRangePercent = 75;
 
 //static
@@ -599,6 +767,13 @@ void LLImage::initClass(bool use_new_byte_range, S32 minimal_reverse_byte_range_
 //static
 void LLImage::cleanupClass()
 {
+    LLImageBufferPool::clear();
+}
+
+//static
+void LLImage::setUseSIMD(bool use)
+{
+    sUseSIMD = use && LL_IMAGE_SIMD;
 }
 
 //static
@@ -667,7 +842,7 @@ void LLImageBase::sanityCheck()
 // virtual
 void LLImageBase::deleteData()
 {
-    ll_aligned_free_16(mData);
+    LLImageBufferPool::release(mData, mDataSize);
     mDataSize = 0;
     mData = NULL;
 }
@@ -706,7 +881,7 @@ U8* LLImageBase::allocateData(S32 size)
     if (!mBadBufferAllocation && (!mData || size != mDataSize))
     {
         deleteData(); // virtual
-        mData = (U8*)ll_aligned_malloc_16(size);
+        mData = LLImageBufferPool::allocate(size);
         if (!mData)
         {
             LL_WARNS() << "Failed to allocate image data size [" << size << "]" << LL_ENDL;
@@ -732,7 +907,7 @@ U8* LLImageBase::allocateData(S32 size)
 // virtual
 U8* LLImageBase::reallocateData(S32 size)
 {
-    U8 *new_datap = (U8*)ll_aligned_malloc_16(size);
+    U8 *new_datap = LLImageBufferPool::allocate(size);
     if (!new_datap)
     {
         LL_WARNS() << "Out of memory in LLImageBase::reallocateData" << LL_ENDL;
@@ -742,7 +917,7 @@ U8* LLImageBase::reallocateData(S32 size)
     {
         S32 bytes = llmin(mDataSize, size);
         memcpy(new_datap, mData, bytes);    /* Flawfinder: ignore */
-        ll_aligned_free_16(mData) ;
+        LLImageBufferPool::release(mData, mDataSize);
     }
     mData = new_datap;
     mDataSize = size;
@@ -1045,7 +1220,7 @@ bool LLImageRaw::optimizeAwayAlpha()
         }
 
         // alpha channel is all 255, make a new copy of data without alpha channel
-        U8* new_data = (U8*) ll_aligned_malloc_16(getWidth() * getHeight() * 3);
+        U8* new_data = LLImageBufferPool::allocate(getWidth() * getHeight() * 3);
 
         for (U32 i = 0; i < pixels; ++i)
         {
@@ -1073,7 +1248,7 @@ bool LLImageRaw::makeAlpha()
         U32 pixels = getWidth() * getHeight();
 
         // alpha channel doesn't exist, make a new copy of data with alpha channel
-        U8* new_data = (U8*) ll_aligned_malloc_16(getWidth() * getHeight() * 4);
+        U8* new_data = LLImageBufferPool::allocate(getWidth() * getHeight() * 4);
 
         for (U32 i = 0; i < pixels; ++i)
         {
@@ -1248,6 +1423,50 @@ void LLImageRaw::compositeScaled4onto3(const LLImageRaw* src)
 }
 
 
+#if LL_IMAGE_SIMD
+// Blends RGBA src over RGB dst four pixels at a time, with the same
+// fastFractionalMult() rounding as the scalar loop. The alpha 0 and 255
+// shortcuts of that loop give the same result as the blend, so there is no
+// need for them here. Returns the number of pixels done.
+static S32 composite_4onto3_simd(const U8* src, U8* dst, S32 pixels)
+{
+    const __m128i alpha_mask = _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i all_ones = _mm_set1_epi8(-1);
+    const __m128i low_byte = _mm_set1_epi16(0xff);
+    const __m128i zero = _mm_setzero_si128();
+
+    S32 i = 0;
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+
+        // 12 bytes of RGB without reading past the end of dst
+        S32 tail;
+        memcpy(&tail, dst + i * 3 + 8, sizeof(tail));
+        __m128i d = _mm_insert_epi32(_mm_loadl_epi64((const __m128i*)(dst + i * 3)), tail, 2);
+        d = _mm_shuffle_epi8(d, expand);
+
+        __m128i alpha = _mm_shuffle_epi8(s, alpha_mask);
+        __m128i transparency = _mm_sub_epi8(all_ones, alpha);
+
+        __m128i lo = _mm_add_epi16(fractional_mult_u16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(transparency, zero)),
+                                   fractional_mult_u16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(alpha, zero)));
+        __m128i hi = _mm_add_epi16(fractional_mult_u16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(transparency, zero)),
+                                   fractional_mult_u16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(alpha, zero)));
+
+        // the scalar code sums into a U8, keep the wrap around
+        __m128i out = _mm_packus_epi16(_mm_and_si128(lo, low_byte), _mm_and_si128(hi, low_byte));
+        out = _mm_shuffle_epi8(out, compact);
+        _mm_storel_epi64((__m128i*)(dst + i * 3), out);
+        tail = _mm_extract_epi32(out, 2);
+        memcpy(dst + i * 3 + 8, &tail, sizeof(tail));
+    }
+    return i;
+}
+#endif // LL_IMAGE_SIMD
+
 // Src and dst are same size.  Src has 4 components.  Dst has 3 components.
 void LLImageRaw::compositeUnscaled4onto3( const LLImageRaw* src )
 {
@@ -1261,6 +1480,15 @@ void LLImageRaw::compositeUnscaled4onto3( const LLImageRaw* src )
     const U8* src_data = src->getData();
     U8* dst_data = dst->getData();
     S32 pixels = getWidth() * getHeight();
+#if LL_IMAGE_SIMD
+    if (LLImage::useSIMD())
+    {
+        S32 done = composite_4onto3_simd(src_data, dst_data, pixels);
+        src_data += done * 4;
+        dst_data += done * 3;
+        pixels -= done;
+    }
+#endif
     while( pixels-- )
     {
         U8 alpha = src_data[3];
@@ -1613,7 +1841,7 @@ bool LLImageRaw::scale( S32 new_width, S32 new_height, bool scale_image_data )
 
         if (new_data_size > 0)
         {
-            U8 *new_data = (U8*)ll_aligned_malloc_16(new_data_size);
+            U8 *new_data = LLImageBufferPool::allocate(new_data_size);
             if(NULL == new_data)
             {
                 return false;
@@ -1867,6 +2095,32 @@ void LLImageRaw::compositeRowScaled4onto3( const U8* in, U8* out, S32 in_pixel_l
             in_scaled_b = in[t1 + 0];
             in_scaled_a = in[t1 + 0];
         }
+#if LL_IMAGE_SIMD
+        else if (LLImage::useSIMD())
+        {
+            // Same sums as below, the four channels of a pixel at once
+            __m128 sum = _mm_mul_ps(_mm_cvtepi32_ps(load_pixel4(in + index0 * IN_COMPONENTS)), _mm_set1_ps(fract0));
+            for( S32 u = index0 + 1; u < index1; u++ )
+            {
+                sum = _mm_add_ps(sum, _mm_cvtepi32_ps(load_pixel4(in + u * IN_COMPONENTS)));
+            }
+            if( fract1 && index1 < in_pixel_len )
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(load_pixel4(in + index1 * IN_COMPONENTS)), _mm_set1_ps(fract1)));
+            }
+            sum = _mm_mul_ps(sum, _mm_set1_ps(norm_factor));
+
+            // ll_round()
+            __m128i rounded = _mm_cvttps_epi32(_mm_floor_ps(_mm_add_ps(sum, _mm_set1_ps(0.5f))));
+            U8 rgba[4];
+            U8* rgba_ptr = rgba;
+            store_pixel4(rgba_ptr, rounded);
+            in_scaled_r = rgba[0];
+            in_scaled_g = rgba[1];
+            in_scaled_b = rgba[2];
+            in_scaled_a = rgba[3];
+        }
+#endif
         else
         {
             // Left straddle
@@ -2068,6 +2322,42 @@ EImageCodec LLImageBase::getCodecFromExtension(const std::string& exten)
     }
     return IMG_CODEC_INVALID;
 }
+
+EImageCodec LLImageBase::getCodecFromData(const U8* data, S32 size)
+{
+    static const U8 png_signature[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    static const U8 j2c_signature[] = { 0xFF, 0x4F, 0xFF, 0x51 };
+    // the JP2 signature box
+    static const U8 jp2_signature[] = { 0x00, 0x00, 0x00, 0x0C, 'j', 'P', ' ', ' ', 0x0D, 0x0A, 0x87, 0x0A };
+
+    if (!data)
+    {
+        return IMG_CODEC_INVALID;
+    }
+    if (size >= (S32)sizeof(png_signature) && !memcmp(data, png_signature, sizeof(png_signature)))
+    {
+        return IMG_CODEC_PNG;
+    }
+    if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+    {
+        return IMG_CODEC_JPEG;
+    }
+    if (size >= (S32)sizeof(j2c_signature) && !memcmp(data, j2c_signature, sizeof(j2c_signature)))
+    {
+        return IMG_CODEC_J2C;
+    }
+    if (size >= (S32)sizeof(jp2_signature) && !memcmp(data, jp2_signature, sizeof(jp2_signature)))
+    {
+        return IMG_CODEC_J2C;
+    }
+    // a BITMAPFILEHEADER, checking the reserved fields are zero as "BM"
+    // alone is too common
+    if (size >= 10 && data[0] == 'B' && data[1] == 'M' && !data[6] && !data[7] && !data[8] && !data[9])
+    {
+        return IMG_CODEC_BMP;
+    }
+    return IMG_CODEC_INVALID;
+}
 #if 0
 bool LLImageRaw::createFromFile(const std::string &filename, bool j2c_lowest_mip_only)
 {
@@ -2571,6 +2861,108 @@ void LLImageBase::setDataAndSize(U8 *data, S32 size)
     mDataSize = size;
 }
 
+#if LL_IMAGE_SIMD
+// 2x2 box filter over one output row, ((a + b + c + d) >> 2) per channel
+// like avg4_colors*(). Each returns how many output pixels it did, the
+// caller finishes the row.
+static S32 mip_row4_simd(const U8* row0, const U8* row1, U8* out, S32 width)
+{
+    S32 w = 0;
+#if defined(__AVX2__)
+    const __m256i zero8 = _mm256_setzero_si256();
+    for (; w + 8 <= width; w += 8)
+    {
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(row0 + w * 8));
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(row0 + w * 8 + 32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(row1 + w * 8));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(row1 + w * 8 + 32));
+
+        // vertical sums, two input pixels per 128 bit lane
+        __m256i s0 = _mm256_add_epi16(_mm256_unpacklo_epi8(a0, zero8), _mm256_unpacklo_epi8(b0, zero8));
+        __m256i s1 = _mm256_add_epi16(_mm256_unpackhi_epi8(a0, zero8), _mm256_unpackhi_epi8(b0, zero8));
+        __m256i s2 = _mm256_add_epi16(_mm256_unpacklo_epi8(a1, zero8), _mm256_unpacklo_epi8(b1, zero8));
+        __m256i s3 = _mm256_add_epi16(_mm256_unpackhi_epi8(a1, zero8), _mm256_unpackhi_epi8(b1, zero8));
+
+        // horizontal sums of neighbouring pixels
+        __m256i h0 = _mm256_add_epi16(_mm256_unpacklo_epi64(s0, s1), _mm256_unpackhi_epi64(s0, s1));
+        __m256i h1 = _mm256_add_epi16(_mm256_unpacklo_epi64(s2, s3), _mm256_unpackhi_epi64(s2, s3));
+
+        __m256i packed = _mm256_packus_epi16(_mm256_srli_epi16(h0, 2), _mm256_srli_epi16(h1, 2));
+        _mm256_storeu_si256((__m256i*)(out + w * 4), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+#endif
+    const __m128i zero = _mm_setzero_si128();
+    for (; w + 4 <= width; w += 4)
+    {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + w * 8));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + w * 8 + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + w * 8));
+        __m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + w * 8 + 16));
+
+        __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        __m128i h0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+        __m128i h1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+
+        _mm_storeu_si128((__m128i*)(out + w * 4), _mm_packus_epi16(_mm_srli_epi16(h0, 2), _mm_srli_epi16(h1, 2)));
+    }
+    return w;
+}
+
+static S32 mip_row3_simd(const U8* row0, const U8* row1, U8* out, S32 width)
+{
+    // spread eight RGB pixels over two registers of four RGB0 pixels
+    const __m128i expand_lo = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i expand_hi = _mm_setr_epi8(4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+    const __m128i compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i zero = _mm_setzero_si128();
+
+    S32 w = 0;
+    for (; w + 4 <= width; w += 4)
+    {
+        // the second load starts 8 bytes in so it ends on the last input byte
+        __m128i a0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(row0 + w * 6)), expand_lo);
+        __m128i a1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(row0 + w * 6 + 8)), expand_hi);
+        __m128i b0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(row1 + w * 6)), expand_lo);
+        __m128i b1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(row1 + w * 6 + 8)), expand_hi);
+
+        __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        __m128i h0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+        __m128i h1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+
+        __m128i packed = _mm_shuffle_epi8(_mm_packus_epi16(_mm_srli_epi16(h0, 2), _mm_srli_epi16(h1, 2)), compact);
+        _mm_storel_epi64((__m128i*)(out + w * 3), packed);
+        S32 tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        memcpy(out + w * 3 + 8, &tail, sizeof(tail));
+    }
+    return w;
+}
+
+static S32 mip_row1_simd(const U8* row0, const U8* row1, U8* out, S32 width)
+{
+    const __m128i ones = _mm_set1_epi8(1);
+
+    S32 w = 0;
+    for (; w + 16 <= width; w += 16)
+    {
+        // pairwise horizontal sums, then the vertical ones
+        __m128i lo = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row0 + w * 2)), ones),
+                                   _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row1 + w * 2)), ones));
+        __m128i hi = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row0 + w * 2 + 16)), ones),
+                                   _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row1 + w * 2 + 16)), ones));
+        _mm_storeu_si128((__m128i*)(out + w), _mm_packus_epi16(_mm_srli_epi16(lo, 2), _mm_srli_epi16(hi, 2)));
+    }
+    return w;
+}
+#endif // LL_IMAGE_SIMD
+
 //static
 void LLImageBase::generateMip(const U8* indata, U8* mipdata, S32 width, S32 height, S32 nchannels)
 {
@@ -2579,7 +2971,30 @@ void LLImageBase::generateMip(const U8* indata, U8* mipdata, S32 width, S32 heig
     S32 in_width = width*2;
     for (S32 h=0; h<height; h++)
     {
-        for (S32 w=0; w<width; w++)
+        S32 start = 0;
+#if LL_IMAGE_SIMD
+        if (LLImage::useSIMD())
+        {
+            const U8* row1 = indata + nchannels*in_width;
+            switch (nchannels)
+            {
+              case 4:
+                start = mip_row4_simd(indata, row1, data, width);
+                break;
+              case 3:
+                start = mip_row3_simd(indata, row1, data, width);
+                break;
+              case 1:
+                start = mip_row1_simd(indata, row1, data, width);
+                break;
+              default:
+                break;
+            }
+            indata += nchannels*2*start;
+            data += nchannels*start;
+        }
+#endif
+        for (S32 w=start; w<width; w++)
         {
             switch(nchannels)
             {
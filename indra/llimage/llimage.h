@@ -102,10 +102,16 @@ public:
     static bool useNewByteRange() { return sUseNewByteRange; }
     static S32  getReverseByteRangePercent() { return sMinimalReverseByteRangePercent; }
 
+    // Use the SIMD versions of the scaling, mip and compositing kernels.
+    // Always false when the build has none (no SSE4.1 or NEON).
+    static bool useSIMD() { return sUseSIMD; }
+    static void setUseSIMD(bool use);
+
 protected:
     static thread_local std::string sLastThreadErrorMessage;
     static bool sUseNewByteRange;
     static S32  sMinimalReverseByteRangePercent;
+    static bool sUseSIMD;
 };
 
 //============================================================================
@@ -159,6 +165,10 @@ public:
     static F32 calc_download_priority(F32 virtual_size, F32 visible_area, S32 bytes_sent);
 
     static EImageCodec getCodecFromExtension(const std::string& exten);
+    // Identify a file from its first bytes, at least SNIFF_BYTES of them if
+    // the file is that long. TGA has no signature: IMG_CODEC_INVALID.
+    static const S32 SNIFF_BYTES = 12;
+    static EImageCodec getCodecFromData(const U8* data, S32 size);
 
     //static LLTrace::MemStatHandle sMemStat;
 
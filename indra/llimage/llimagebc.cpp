@@ -0,0 +1,988 @@
+/**
+ * @file llimagebc.cpp
+ * @brief Block compression (BC1, BC3, BC7) of raw images.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagebc.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#if LL_ARM64
+#include "sse2neon.h"
+#elif LL_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_1__) || defined(LL_ARM64)
+#define LL_IMAGE_SIMD 1
+#else
+#define LL_IMAGE_SIMD 0
+#endif
+
+//..................................................................................
+// All encoders follow the same steps: find the principal axis of the block's
+// colors, take the two pixels furthest apart along it as endpoints, pick the
+// nearest palette entry for every pixel, then refit the endpoints to those
+// indices by least squares and keep the result if it lowered the error.
+//
+// Only the index search and the block bounds have SIMD versions. They are
+// integer code that gives the same answer as the scalar loops, so the
+// compressed output does not depend on LLImage::useSIMD().
+//..................................................................................
+namespace
+{
+    // One S32 per channel and pixel: the layout both index searches read
+    struct Block
+    {
+        S32 mChannels[4][LLImageBC::BLOCK_PIXELS];
+        S32 mMin[4];
+        S32 mMax[4];
+    };
+
+    struct Palette
+    {
+        S32 mChannels[4][16];
+        S32 mCount;
+    };
+
+    void block_bounds_scalar(const U8* rgba, Block& block)
+    {
+        for (S32 c = 0; c < 4; ++c)
+        {
+            block.mMin[c] = 255;
+            block.mMax[c] = 0;
+        }
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            for (S32 c = 0; c < 4; ++c)
+            {
+                block.mMin[c] = llmin(block.mMin[c], (S32)rgba[i * 4 + c]);
+                block.mMax[c] = llmax(block.mMax[c], (S32)rgba[i * 4 + c]);
+            }
+        }
+    }
+
+    // Nearest entry of the palette for every pixel, over channels
+    // [begin, end). The first of equally close entries wins. Returns the
+    // total squared error.
+    U32 select_indices_scalar(const Block& block, const Palette& palette, S32 begin, S32 end, U8* indices)
+    {
+        U32 total = 0;
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            S32 best = INT_MAX;
+            S32 best_index = 0;
+            for (S32 j = 0; j < palette.mCount; ++j)
+            {
+                S32 dist = 0;
+                for (S32 c = begin; c < end; ++c)
+                {
+                    S32 d = block.mChannels[c][i] - palette.mChannels[c][j];
+                    dist += d * d;
+                }
+                if (dist < best)
+                {
+                    best = dist;
+                    best_index = j;
+                }
+            }
+            indices[i] = (U8)best_index;
+            total += best;
+        }
+        return total;
+    }
+
+#if LL_IMAGE_SIMD
+    void block_bounds_simd(const U8* rgba, Block& block)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i*)rgba);
+        __m128i hi = lo;
+        for (S32 i = 1; i < 4; ++i)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(rgba + i * 16));
+            lo = _mm_min_epu8(lo, pixels);
+            hi = _mm_max_epu8(hi, pixels);
+        }
+        // fold the four pixels of each register into the first one
+        lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+        hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+        lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+        hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+        _mm_storeu_si128((__m128i*)block.mMin, _mm_cvtepu8_epi32(lo));
+        _mm_storeu_si128((__m128i*)block.mMax, _mm_cvtepu8_epi32(hi));
+    }
+
+    // Four pixels at a time against each palette entry
+    U32 select_indices_simd(const Block& block, const Palette& palette, S32 begin, S32 end, U8* indices)
+    {
+        U32 total = 0;
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; i += 4)
+        {
+            __m128i pixels[4];
+            for (S32 c = begin; c < end; ++c)
+            {
+                pixels[c] = _mm_loadu_si128((const __m128i*)&block.mChannels[c][i]);
+            }
+
+            __m128i best = _mm_set1_epi32(INT_MAX);
+            __m128i best_index = _mm_setzero_si128();
+            for (S32 j = 0; j < palette.mCount; ++j)
+            {
+                __m128i dist = _mm_setzero_si128();
+                for (S32 c = begin; c < end; ++c)
+                {
+                    __m128i d = _mm_sub_epi32(pixels[c], _mm_set1_epi32(palette.mChannels[c][j]));
+                    dist = _mm_add_epi32(dist, _mm_mullo_epi32(d, d));
+                }
+                __m128i closer = _mm_cmplt_epi32(dist, best);
+                best = _mm_blendv_epi8(best, dist, closer);
+                best_index = _mm_blendv_epi8(best_index, _mm_set1_epi32(j), closer);
+            }
+
+            alignas(16) S32 best_out[4];
+            alignas(16) S32 index_out[4];
+            _mm_store_si128((__m128i*)best_out, best);
+            _mm_store_si128((__m128i*)index_out, best_index);
+            for (S32 k = 0; k < 4; ++k)
+            {
+                indices[i + k] = (U8)index_out[k];
+                total += best_out[k];
+            }
+        }
+        return total;
+    }
+#endif // LL_IMAGE_SIMD
+
+    void load_block(const U8* rgba, Block& block)
+    {
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            for (S32 c = 0; c < 4; ++c)
+            {
+                block.mChannels[c][i] = rgba[i * 4 + c];
+            }
+        }
+#if LL_IMAGE_SIMD
+        if (LLImage::useSIMD())
+        {
+            block_bounds_simd(rgba, block);
+            return;
+        }
+#endif
+        block_bounds_scalar(rgba, block);
+    }
+
+    U32 select_indices(const Block& block, const Palette& palette, S32 begin, S32 end, U8* indices)
+    {
+#if LL_IMAGE_SIMD
+        if (LLImage::useSIMD())
+        {
+            return select_indices_simd(block, palette, begin, end, indices);
+        }
+#endif
+        return select_indices_scalar(block, palette, begin, end, indices);
+    }
+
+    bool is_flat(const Block& block, S32 begin, S32 end)
+    {
+        for (S32 c = begin; c < end; ++c)
+        {
+            if (block.mMin[c] != block.mMax[c])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The two pixels furthest apart along the principal axis of channels
+    // [begin, end), found by power iteration on their covariance
+    void find_endpoints(const Block& block, S32 begin, S32 end, F32* lo, F32* hi)
+    {
+        F32 mean[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (S32 c = begin; c < end; ++c)
+        {
+            S32 sum = 0;
+            for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+            {
+                sum += block.mChannels[c][i];
+            }
+            mean[c] = sum / (F32)LLImageBC::BLOCK_PIXELS;
+        }
+
+        F32 cov[4][4] = {};
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            for (S32 c = begin; c < end; ++c)
+            {
+                F32 dc = block.mChannels[c][i] - mean[c];
+                for (S32 k = c; k < end; ++k)
+                {
+                    cov[c][k] += dc * (block.mChannels[k][i] - mean[k]);
+                }
+            }
+        }
+        for (S32 c = begin; c < end; ++c)
+        {
+            for (S32 k = begin; k < c; ++k)
+            {
+                cov[c][k] = cov[k][c];
+            }
+        }
+
+        F32 axis[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (S32 c = begin; c < end; ++c)
+        {
+            axis[c] = (F32)(block.mMax[c] - block.mMin[c]);
+        }
+        for (S32 iter = 0; iter < 8; ++iter)
+        {
+            F32 next[4] = { 0.f, 0.f, 0.f, 0.f };
+            F32 largest = 0.f;
+            for (S32 c = begin; c < end; ++c)
+            {
+                for (S32 k = begin; k < end; ++k)
+                {
+                    next[c] += cov[c][k] * axis[k];
+                }
+                largest = llmax(largest, fabsf(next[c]));
+            }
+            if (largest <= 0.f)
+            {
+                // uncorrelated: keep the bounding box diagonal
+                break;
+            }
+            for (S32 c = begin; c < end; ++c)
+            {
+                axis[c] = next[c] / largest;
+            }
+        }
+
+        S32 lo_index = 0, hi_index = 0;
+        F32 lo_dot = FLT_MAX, hi_dot = -FLT_MAX;
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            F32 dot = 0.f;
+            for (S32 c = begin; c < end; ++c)
+            {
+                dot += (block.mChannels[c][i] - mean[c]) * axis[c];
+            }
+            if (dot < lo_dot)
+            {
+                lo_dot = dot;
+                lo_index = i;
+            }
+            if (dot > hi_dot)
+            {
+                hi_dot = dot;
+                hi_index = i;
+            }
+        }
+        for (S32 c = begin; c < end; ++c)
+        {
+            lo[c] = (F32)block.mChannels[c][lo_index];
+            hi[c] = (F32)block.mChannels[c][hi_index];
+        }
+    }
+
+    // Least squares endpoints for the given indices, where index i blends
+    // the endpoints as (1 - weights[i]) * e0 + weights[i] * e1. Returns false
+    // if the indices do not pin both endpoints down.
+    bool refit_endpoints(const Block& block, S32 begin, S32 end, const U8* indices, const F32* weights,
+                         F32* e0, F32* e1)
+    {
+        F32 aa = 0.f, ab = 0.f, bb = 0.f;
+        F32 ax[4] = { 0.f, 0.f, 0.f, 0.f };
+        F32 bx[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            F32 b = weights[indices[i]];
+            F32 a = 1.f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (S32 c = begin; c < end; ++c)
+            {
+                ax[c] += a * block.mChannels[c][i];
+                bx[c] += b * block.mChannels[c][i];
+            }
+        }
+
+        F32 det = aa * bb - ab * ab;
+        if (fabsf(det) < 1e-6f)
+        {
+            return false;
+        }
+        F32 inv_det = 1.f / det;
+        for (S32 c = begin; c < end; ++c)
+        {
+            e0[c] = llclamp((bb * ax[c] - ab * bx[c]) * inv_det, 0.f, 255.f);
+            e1[c] = llclamp((aa * bx[c] - ab * ax[c]) * inv_det, 0.f, 255.f);
+        }
+        return true;
+    }
+
+    S32 round_to(F32 value, S32 max)
+    {
+        return llclamp((S32)(value * max / 255.f + 0.5f), 0, max);
+    }
+
+    //..............................................................................
+    // BC1 color block, also the color half of BC3
+    //..............................................................................
+
+    U16 pack_565(const F32* color)
+    {
+        return (U16)((round_to(color[0], 31) << 11) | (round_to(color[1], 63) << 5) | round_to(color[2], 31));
+    }
+
+    void unpack_565(U16 packed, S32* color)
+    {
+        S32 r = (packed >> 11) & 0x1f;
+        S32 g = (packed >> 5) & 0x3f;
+        S32 b = packed & 0x1f;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Four color mode: both endpoints and two thirds in between
+    void palette_565(U16 c0, U16 c1, Palette& palette)
+    {
+        S32 e0[3], e1[3];
+        unpack_565(c0, e0);
+        unpack_565(c1, e1);
+        for (S32 c = 0; c < 3; ++c)
+        {
+            palette.mChannels[c][0] = e0[c];
+            palette.mChannels[c][1] = e1[c];
+            palette.mChannels[c][2] = (2 * e0[c] + e1[c]) / 3;
+            palette.mChannels[c][3] = (e0[c] + 2 * e1[c]) / 3;
+        }
+        palette.mCount = 4;
+    }
+
+    const F32 BC1_WEIGHTS[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+    void encode_color_block(const Block& block, U8* out)
+    {
+        U16 c0, c1;
+        U8 indices[LLImageBC::BLOCK_PIXELS] = {};
+
+        if (is_flat(block, 0, 3))
+        {
+            F32 color[3] = { (F32)block.mMin[0], (F32)block.mMin[1], (F32)block.mMin[2] };
+            c0 = c1 = pack_565(color);
+        }
+        else
+        {
+            F32 lo[4], hi[4];
+            find_endpoints(block, 0, 3, lo, hi);
+            c0 = pack_565(hi);
+            c1 = pack_565(lo);
+
+            Palette palette;
+            palette_565(c0, c1, palette);
+            U32 error = select_indices(block, palette, 0, 3, indices);
+
+            for (S32 iter = 0; iter < 2 && error > 0; ++iter)
+            {
+                F32 e0[4], e1[4];
+                if (!refit_endpoints(block, 0, 3, indices, BC1_WEIGHTS, e0, e1))
+                {
+                    break;
+                }
+                U16 r0 = pack_565(e0), r1 = pack_565(e1);
+                if (r0 == c0 && r1 == c1)
+                {
+                    break;
+                }
+                U8 refit_indices[LLImageBC::BLOCK_PIXELS];
+                palette_565(r0, r1, palette);
+                U32 refit_error = select_indices(block, palette, 0, 3, refit_indices);
+                if (refit_error >= error)
+                {
+                    break;
+                }
+                c0 = r0;
+                c1 = r1;
+                error = refit_error;
+                memcpy(indices, refit_indices, sizeof(indices));
+            }
+        }
+
+        if (c0 < c1)
+        {
+            // c0 > c1 selects the four color mode, index 0 <-> 1 and 2 <-> 3
+            std::swap(c0, c1);
+            for (U8& index : indices)
+            {
+                index ^= 1;
+            }
+        }
+        else if (c0 == c1)
+        {
+            memset(indices, 0, sizeof(indices));
+        }
+
+        U32 bits = 0;
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            bits |= (U32)indices[i] << (i * 2);
+        }
+        out[0] = (U8)(c0 & 0xff);
+        out[1] = (U8)(c0 >> 8);
+        out[2] = (U8)(c1 & 0xff);
+        out[3] = (U8)(c1 >> 8);
+        for (S32 i = 0; i < 4; ++i)
+        {
+            out[4 + i] = (U8)(bits >> (i * 8));
+        }
+    }
+
+    void decode_color_block(const U8* in, bool allow_alpha, U8* rgba)
+    {
+        U16 c0 = in[0] | (in[1] << 8);
+        U16 c1 = in[2] | (in[3] << 8);
+        S32 e0[3], e1[3];
+        unpack_565(c0, e0);
+        unpack_565(c1, e1);
+
+        S32 colors[4][4];
+        for (S32 c = 0; c < 3; ++c)
+        {
+            colors[0][c] = e0[c];
+            colors[1][c] = e1[c];
+            if (c0 > c1 || !allow_alpha)
+            {
+                colors[2][c] = (2 * e0[c] + e1[c]) / 3;
+                colors[3][c] = (e0[c] + 2 * e1[c]) / 3;
+            }
+            else
+            {
+                colors[2][c] = (e0[c] + e1[c]) / 2;
+                colors[3][c] = 0;
+            }
+        }
+        colors[0][3] = colors[1][3] = colors[2][3] = 255;
+        colors[3][3] = (c0 > c1 || !allow_alpha) ? 255 : 0;
+
+        U32 bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((U32)in[7] << 24);
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            const S32* color = colors[(bits >> (i * 2)) & 3];
+            for (S32 c = 0; c < 4; ++c)
+            {
+                rgba[i * 4 + c] = (U8)color[c];
+            }
+        }
+    }
+
+    //..............................................................................
+    // BC3 alpha block: two endpoints and six values in between
+    //..............................................................................
+
+    void palette_alpha(S32 a0, S32 a1, Palette& palette)
+    {
+        palette.mChannels[3][0] = a0;
+        palette.mChannels[3][1] = a1;
+        if (a0 > a1)
+        {
+            for (S32 i = 1; i < 7; ++i)
+            {
+                palette.mChannels[3][i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+            }
+        }
+        else
+        {
+            for (S32 i = 1; i < 5; ++i)
+            {
+                palette.mChannels[3][i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+            }
+            palette.mChannels[3][6] = 0;
+            palette.mChannels[3][7] = 255;
+        }
+        palette.mCount = 8;
+    }
+
+    void encode_alpha_block(const Block& block, U8* out)
+    {
+        const S32 a0 = block.mMax[3];
+        const S32 a1 = block.mMin[3];
+        U8 indices[LLImageBC::BLOCK_PIXELS] = {};
+        if (a0 != a1)
+        {
+            Palette palette;
+            palette_alpha(a0, a1, palette);
+            select_indices(block, palette, 3, 4, indices);
+        }
+
+        U64 bits = 0;
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            bits |= (U64)indices[i] << (i * 3);
+        }
+        out[0] = (U8)a0;
+        out[1] = (U8)a1;
+        for (S32 i = 0; i < 6; ++i)
+        {
+            out[2 + i] = (U8)(bits >> (i * 8));
+        }
+    }
+
+    void decode_alpha_block(const U8* in, U8* rgba)
+    {
+        Palette palette;
+        palette_alpha(in[0], in[1], palette);
+        U64 bits = 0;
+        for (S32 i = 0; i < 6; ++i)
+        {
+            bits |= (U64)in[2 + i] << (i * 8);
+        }
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            rgba[i * 4 + 3] = (U8)palette.mChannels[3][(bits >> (i * 3)) & 7];
+        }
+    }
+
+    //..............................................................................
+    // BC7 mode 6: 7 bit RGBA endpoints, each with its own extra low bit (the
+    // p-bit), and 4 bit indices
+    //..............................................................................
+
+    const S32 BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct BC7Endpoint
+    {
+        S32 mValue[4]; // 7 bits
+        S32 mPBit;
+
+        S32 expanded(S32 c) const { return (mValue[c] << 1) | mPBit; }
+        bool operator==(const BC7Endpoint& other) const
+        {
+            return mPBit == other.mPBit && memcmp(mValue, other.mValue, sizeof(mValue)) == 0;
+        }
+    };
+
+    // Nearest endpoint, trying both p-bits
+    BC7Endpoint quantize_bc7(const F32* color)
+    {
+        BC7Endpoint best = {};
+        F32 best_error = FLT_MAX;
+        for (S32 p = 0; p < 2; ++p)
+        {
+            BC7Endpoint candidate;
+            candidate.mPBit = p;
+            F32 error = 0.f;
+            for (S32 c = 0; c < 4; ++c)
+            {
+                candidate.mValue[c] = llclamp((S32)((color[c] - p) * 0.5f + 0.5f), 0, 127);
+                F32 d = candidate.expanded(c) - color[c];
+                error += d * d;
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                best = candidate;
+            }
+        }
+        return best;
+    }
+
+    void palette_bc7(const BC7Endpoint& e0, const BC7Endpoint& e1, Palette& palette)
+    {
+        for (S32 c = 0; c < 4; ++c)
+        {
+            S32 v0 = e0.expanded(c), v1 = e1.expanded(c);
+            for (S32 i = 0; i < 16; ++i)
+            {
+                palette.mChannels[c][i] = ((64 - BC7_WEIGHTS4[i]) * v0 + BC7_WEIGHTS4[i] * v1 + 32) >> 6;
+            }
+        }
+        palette.mCount = 16;
+    }
+
+    class BitWriter
+    {
+    public:
+        BitWriter(U8* out) : mOut(out), mBit(0) { memset(out, 0, 16); }
+        void write(U32 value, S32 count)
+        {
+            for (S32 i = 0; i < count; ++i, ++mBit)
+            {
+                mOut[mBit >> 3] |= (U8)(((value >> i) & 1) << (mBit & 7));
+            }
+        }
+    private:
+        U8* mOut;
+        S32 mBit;
+    };
+
+    class BitReader
+    {
+    public:
+        BitReader(const U8* in) : mIn(in), mBit(0) {}
+        U32 read(S32 count)
+        {
+            U32 value = 0;
+            for (S32 i = 0; i < count; ++i, ++mBit)
+            {
+                value |= (U32)((mIn[mBit >> 3] >> (mBit & 7)) & 1) << i;
+            }
+            return value;
+        }
+    private:
+        const U8* mIn;
+        S32 mBit;
+    };
+
+    void encode_bc7_block(const Block& block, U8* out)
+    {
+        BC7Endpoint e0, e1;
+        U8 indices[LLImageBC::BLOCK_PIXELS] = {};
+
+        if (is_flat(block, 0, 4))
+        {
+            F32 color[4];
+            for (S32 c = 0; c < 4; ++c)
+            {
+                color[c] = (F32)block.mMin[c];
+            }
+            e0 = e1 = quantize_bc7(color);
+        }
+        else
+        {
+            F32 lo[4], hi[4];
+            find_endpoints(block, 0, 4, lo, hi);
+            e0 = quantize_bc7(lo);
+            e1 = quantize_bc7(hi);
+
+            Palette palette;
+            palette_bc7(e0, e1, palette);
+            U32 error = select_indices(block, palette, 0, 4, indices);
+
+            F32 weights[16];
+            for (S32 i = 0; i < 16; ++i)
+            {
+                weights[i] = BC7_WEIGHTS4[i] / 64.f;
+            }
+            for (S32 iter = 0; iter < 2 && error > 0; ++iter)
+            {
+                F32 f0[4], f1[4];
+                if (!refit_endpoints(block, 0, 4, indices, weights, f0, f1))
+                {
+                    break;
+                }
+                BC7Endpoint r0 = quantize_bc7(f0), r1 = quantize_bc7(f1);
+                if (r0 == e0 && r1 == e1)
+                {
+                    break;
+                }
+                U8 refit_indices[LLImageBC::BLOCK_PIXELS];
+                palette_bc7(r0, r1, palette);
+                U32 refit_error = select_indices(block, palette, 0, 4, refit_indices);
+                if (refit_error >= error)
+                {
+                    break;
+                }
+                e0 = r0;
+                e1 = r1;
+                error = refit_error;
+                memcpy(indices, refit_indices, sizeof(indices));
+            }
+        }
+
+        // the first index is stored without its top bit, which must be 0
+        if (indices[0] & 8)
+        {
+            std::swap(e0, e1);
+            for (U8& index : indices)
+            {
+                index = 15 - index;
+            }
+        }
+
+        BitWriter writer(out);
+        writer.write(1 << 6, 7); // mode 6
+        for (S32 c = 0; c < 4; ++c)
+        {
+            writer.write(e0.mValue[c], 7);
+            writer.write(e1.mValue[c], 7);
+        }
+        writer.write(e0.mPBit, 1);
+        writer.write(e1.mPBit, 1);
+        writer.write(indices[0], 3);
+        for (S32 i = 1; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            writer.write(indices[i], 4);
+        }
+    }
+
+    bool decode_bc7_block(const U8* in, U8* rgba)
+    {
+        if ((in[0] & 0x7f) != 0x40)
+        {
+            memset(rgba, 0, LLImageBC::BLOCK_PIXELS * 4);
+            return false;
+        }
+
+        BitReader reader(in);
+        reader.read(7);
+        BC7Endpoint e0, e1;
+        for (S32 c = 0; c < 4; ++c)
+        {
+            e0.mValue[c] = reader.read(7);
+            e1.mValue[c] = reader.read(7);
+        }
+        e0.mPBit = reader.read(1);
+        e1.mPBit = reader.read(1);
+
+        Palette palette;
+        palette_bc7(e0, e1, palette);
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            S32 index = reader.read(i == 0 ? 3 : 4);
+            for (S32 c = 0; c < 4; ++c)
+            {
+                rgba[i * 4 + c] = (U8)palette.mChannels[c][index];
+            }
+        }
+        return true;
+    }
+}
+
+//----------------------------------------------------------------------------
+// LLImageBC
+//----------------------------------------------------------------------------
+
+//static
+S32 LLImageBC::getBlockBytes(EFormat format)
+{
+    switch (format)
+    {
+    case FORMAT_BC1: return 8;
+    case FORMAT_BC3: return 16;
+    case FORMAT_BC7: return 16;
+    default:         return 0;
+    }
+}
+
+//static
+S32 LLImageBC::getDataSize(EFormat format, S32 width, S32 height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * getBlockBytes(format);
+}
+
+//static
+void LLImageBC::encodeBlock(EFormat format, const U8* rgba, U8* out)
+{
+    Block block;
+    load_block(rgba, block);
+    switch (format)
+    {
+    case FORMAT_BC1:
+        encode_color_block(block, out);
+        break;
+    case FORMAT_BC3:
+        encode_alpha_block(block, out);
+        encode_color_block(block, out + 8);
+        break;
+    case FORMAT_BC7:
+        encode_bc7_block(block, out);
+        break;
+    default:
+        break;
+    }
+}
+
+//static
+bool LLImageBC::decodeBlock(EFormat format, const U8* in, U8* rgba)
+{
+    switch (format)
+    {
+    case FORMAT_BC1:
+        decode_color_block(in, true, rgba);
+        return true;
+    case FORMAT_BC3:
+        decode_color_block(in + 8, false, rgba);
+        decode_alpha_block(in, rgba);
+        return true;
+    case FORMAT_BC7:
+        return decode_bc7_block(in, rgba);
+    default:
+        return false;
+    }
+}
+
+//static
+bool LLImageBC::encode(EFormat format, const U8* data, S32 width, S32 height, S32 components, U8* out)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+    if (getBlockBytes(format) == 0 || !data || width <= 0 || height <= 0
+        || (components != 3 && components != 4))
+    {
+        return false;
+    }
+
+    const S32 block_bytes = getBlockBytes(format);
+    U8 rgba[BLOCK_PIXELS * 4];
+    for (S32 by = 0; by < height; by += 4)
+    {
+        for (S32 bx = 0; bx < width; bx += 4)
+        {
+            for (S32 y = 0; y < 4; ++y)
+            {
+                const U8* row = data + (size_t)llmin(by + y, height - 1) * width * components;
+                for (S32 x = 0; x < 4; ++x)
+                {
+                    const U8* pixel = row + llmin(bx + x, width - 1) * components;
+                    U8* dst = rgba + (y * 4 + x) * 4;
+                    dst[0] = pixel[0];
+                    dst[1] = pixel[1];
+                    dst[2] = pixel[2];
+                    dst[3] = components == 4 ? pixel[3] : 255;
+                }
+            }
+            encodeBlock(format, rgba, out);
+            out += block_bytes;
+        }
+    }
+    return true;
+}
+
+//static
+bool LLImageBC::decode(EFormat format, const U8* in, S32 width, S32 height, U8* rgba)
+{
+    const S32 block_bytes = getBlockBytes(format);
+    if (block_bytes == 0 || !in || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    bool success = true;
+    U8 block[BLOCK_PIXELS * 4];
+    for (S32 by = 0; by < height; by += 4)
+    {
+        for (S32 bx = 0; bx < width; bx += 4)
+        {
+            success = decodeBlock(format, in, block) && success;
+            in += block_bytes;
+            for (S32 y = 0; y < 4 && by + y < height; ++y)
+            {
+                for (S32 x = 0; x < 4 && bx + x < width; ++x)
+                {
+                    memcpy(rgba + ((size_t)(by + y) * width + bx + x) * 4, block + (y * 4 + x) * 4, 4);
+                }
+            }
+        }
+    }
+    return success;
+}
+
+//----------------------------------------------------------------------------
+// LLImageBCMips
+//----------------------------------------------------------------------------
+
+LLImageBCMips::LLImageBCMips(LLImageBC::EFormat format, S32 width, S32 height, S32 components, S32 levels)
+    : mFormat(format),
+      mWidth(width),
+      mHeight(height),
+      mComponents(components),
+      mLevels(levels)
+{
+    size_t size = 0;
+    for (S32 level = 0; level < levels; ++level)
+    {
+        size += getLevelSize(level);
+    }
+    mData.resize(size);
+}
+
+S32 LLImageBCMips::getLevelSize(S32 level) const
+{
+    return LLImageBC::getDataSize(mFormat, llmax(mWidth >> level, 1), llmax(mHeight >> level, 1));
+}
+
+const U8* LLImageBCMips::getLevelData(S32 level) const
+{
+    size_t offset = 0;
+    for (S32 smaller = mLevels - 1; smaller > level; --smaller)
+    {
+        offset += getLevelSize(smaller);
+    }
+    return mData.data() + offset;
+}
+
+U8* LLImageBCMips::getLevelData(S32 level)
+{
+    return const_cast<U8*>(static_cast<const LLImageBCMips*>(this)->getLevelData(level));
+}
+
+//static
+LLPointer<LLImageBCMips> LLImageBCMips::create(const LLImageRaw* raw, LLImageBC::EFormat format, S32 levels)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+    if (!raw || !raw->getData() || levels < 1)
+    {
+        return nullptr;
+    }
+
+    const S32 width = raw->getWidth();
+    const S32 height = raw->getHeight();
+    const S32 components = raw->getComponents();
+    const bool format_ok = (format == LLImageBC::FORMAT_BC1 && components == 3)
+                           || ((format == LLImageBC::FORMAT_BC3 || format == LLImageBC::FORMAT_BC7) && components == 4);
+    if (!format_ok || (width & (width - 1)) != 0 || (height & (height - 1)) != 0
+        // every mip must halve both sides
+        || (width >> (levels - 1)) == 0 || (height >> (levels - 1)) == 0)
+    {
+        return nullptr;
+    }
+
+    LLPointer<LLImageBCMips> mips = new LLImageBCMips(format, width, height, components, levels);
+
+    std::vector<U8> buffers[2];
+    const U8* level_data = raw->getData();
+    for (S32 level = 0; level < levels; ++level)
+    {
+        const S32 w = width >> level;
+        const S32 h = height >> level;
+        if (level > 0)
+        {
+            std::vector<U8>& mip = buffers[level & 1];
+            mip.resize((size_t)w * h * components);
+            LLImageBase::generateMip(level_data, mip.data(), w, h, components);
+            level_data = mip.data();
+        }
+        LLImageBC::encode(format, level_data, w, h, components, mips->getLevelData(level));
+    }
+    return mips;
+}
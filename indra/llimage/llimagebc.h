@@ -0,0 +1,112 @@
+/**
+ * @file llimagebc.h
+ * @brief Block compression (BC1, BC3, BC7) of raw images.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGEBC_H
+#define LL_LLIMAGEBC_H
+
+#include "llimage.h"
+#include "llpointer.h"
+#include "llrefcount.h"
+
+#include <vector>
+
+// Software encoder for the block compressed formats GL can sample
+// directly, so textures can be compressed on the decode threads instead of
+// by the driver at upload time.
+//
+// BC1 (DXT1) stores opaque RGB, BC3 (DXT5) adds an interpolated alpha
+// block, BC7 is written in mode 6 only: one RGBA subset with 4 bit indices,
+// which is better than BC3 on color at the same size.
+class LLImageBC
+{
+public:
+    enum EFormat
+    {
+        FORMAT_NONE = -1,
+        FORMAT_BC1 = 0,
+        FORMAT_BC3,
+        FORMAT_BC7,
+    };
+
+    static const S32 BLOCK_PIXELS = 16;
+
+    // Bytes of one 4x4 block
+    static S32 getBlockBytes(EFormat format);
+    // Bytes of a width x height image, partial blocks round up
+    static S32 getDataSize(EFormat format, S32 width, S32 height);
+
+    // Compress a 4x4 block of RGBA pixels, row by row
+    static void encodeBlock(EFormat format, const U8* rgba, U8* out);
+    // The reverse, for tests and read backs. BC7 blocks in modes other than
+    // 6 are not supported and decode as transparent black.
+    static bool decodeBlock(EFormat format, const U8* in, U8* rgba);
+
+    // Compress a whole image with 3 or 4 components, edge blocks replicate
+    // the last row and column. out must hold getDataSize() bytes.
+    static bool encode(EFormat format, const U8* data, S32 width, S32 height, S32 components, U8* out);
+    // Decode to width * height RGBA pixels
+    static bool decode(EFormat format, const U8* in, S32 width, S32 height, U8* rgba);
+};
+
+// A block compressed mip chain built from a decoded image, ready to be
+// handed to glCompressedTexImage2D level by level.
+class LLImageBCMips : public LLThreadSafeRefCount
+{
+protected:
+    ~LLImageBCMips() = default;
+
+public:
+    LLImageBCMips(LLImageBC::EFormat format, S32 width, S32 height, S32 components, S32 levels);
+
+    // Compress raw and levels - 1 box filtered mips below it. Returns null
+    // if the image is not a power of two or has no matching format.
+    static LLPointer<LLImageBCMips> create(const LLImageRaw* raw, LLImageBC::EFormat format, S32 levels);
+
+    LLImageBC::EFormat getFormat() const { return mFormat; }
+    // of level 0
+    S32 getWidth() const { return mWidth; }
+    S32 getHeight() const { return mHeight; }
+    // of the source image
+    S32 getComponents() const { return mComponents; }
+    S32 getLevels() const { return mLevels; }
+
+    // Levels are stored smallest first, so level 0 is at the end: the layout
+    // LLImageGL::setImage() expects of data that comes with its mips.
+    const U8* getLevelData(S32 level) const;
+    U8* getLevelData(S32 level);
+    S32 getLevelSize(S32 level) const;
+    S32 getDataSize() const { return (S32)mData.size(); }
+
+private:
+    LLImageBC::EFormat mFormat;
+    S32 mWidth;
+    S32 mHeight;
+    S32 mComponents;
+    S32 mLevels;
+    std::vector<U8> mData;
+};
+
+#endif // LL_LLIMAGEBC_H
@@ -0,0 +1,319 @@
+/**
+ * @file llimagebufferpool.cpp
+ * @brief Size class pool of image data buffers.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagebufferpool.h"
+
+#include "llmemory.h"
+#include "lltrace.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // powers of two from MIN_POOLED_SIZE to MAX_POOLED_SIZE, then three
+    // times the powers of two in the same range
+    const S32 MIN_POWER_LOG2 = 12;
+    const S32 MAX_POWER_LOG2 = 24;
+    const S32 MIN_THREE_LOG2 = 11;
+    const S32 MAX_THREE_LOG2 = 22;
+    const S32 POWER_CLASS_COUNT = MAX_POWER_LOG2 - MIN_POWER_LOG2 + 1;
+    const S32 SIZE_CLASS_COUNT = POWER_CLASS_COUNT + MAX_THREE_LOG2 - MIN_THREE_LOG2 + 1;
+
+    // per thread
+    const size_t MAX_THREAD_BUFFERS = 2;
+    const S64 MAX_THREAD_BYTES = 16 * 1024 * 1024;
+
+    std::atomic<S64> sMaxBytes(64 * 1024 * 1024);
+    std::atomic<S64> sCachedBytes(0);
+    // bumped by clear(), thread caches of an older generation drop their
+    // buffers the next time their thread uses the pool
+    std::atomic<U32> sGeneration(0);
+    std::atomic<U64> sHits(0);
+    std::atomic<U64> sMisses(0);
+
+    LLTrace::CountStatHandle<S32> sPoolHits("image_buffer_pool_hits", "Image buffers reused from the pool");
+    LLTrace::CountStatHandle<S32> sPoolMisses("image_buffer_pool_misses", "Image buffers of pooled sizes allocated from the heap");
+    LLTrace::SampleStatHandle<LLUnit<F32, LLUnits::Percent> > sPoolHitRate("image_buffer_pool_hit_rate", "Share of pooled size image buffers reused since the last update");
+    LLTrace::SampleStatHandle<F64Megabytes> sPoolSize("image_buffer_pool_size", "Memory held by idle image buffers");
+
+    S32 class_size(S32 size_class)
+    {
+        return size_class < POWER_CLASS_COUNT ? 1 << (size_class + MIN_POWER_LOG2)
+                                              : 3 << (size_class - POWER_CLASS_COUNT + MIN_THREE_LOG2);
+    }
+
+    // Reserves the room for one more idle buffer under the cap
+    bool reserve(S32 size)
+    {
+        S64 cached = sCachedBytes.load();
+        do
+        {
+            if (cached + size > sMaxBytes.load())
+            {
+                return false;
+            }
+        } while (!sCachedBytes.compare_exchange_weak(cached, cached + size));
+        return true;
+    }
+
+    struct SharedCache
+    {
+        std::mutex mMutex;
+        std::vector<U8*> mBuffers[SIZE_CLASS_COUNT];
+    };
+
+    // never destroyed, exiting threads may still release to it
+    SharedCache& shared_cache()
+    {
+        static SharedCache* cache = new SharedCache;
+        return *cache;
+    }
+
+    // set once the thread's cache is gone, images freed by later thread_local
+    // and static destructors skip it
+    thread_local bool sThreadCacheDestroyed = false;
+
+    struct ThreadCache
+    {
+        std::vector<U8*> mBuffers[SIZE_CLASS_COUNT];
+        S64 mBytes = 0;
+        U32 mGeneration = 0;
+
+        ~ThreadCache()
+        {
+            drain();
+            sThreadCacheDestroyed = true;
+        }
+
+        void drain()
+        {
+            for (S32 size_class = 0; size_class < SIZE_CLASS_COUNT; ++size_class)
+            {
+                for (U8* data : mBuffers[size_class])
+                {
+                    ll_aligned_free_16(data);
+                    sCachedBytes -= class_size(size_class);
+                }
+                mBuffers[size_class].clear();
+            }
+            mBytes = 0;
+        }
+    };
+
+    thread_local ThreadCache sThreadCache;
+
+    ThreadCache* thread_cache()
+    {
+        if (sThreadCacheDestroyed)
+        {
+            return nullptr;
+        }
+        const U32 generation = sGeneration.load();
+        if (sThreadCache.mGeneration != generation)
+        {
+            sThreadCache.drain();
+            sThreadCache.mGeneration = generation;
+        }
+        return &sThreadCache;
+    }
+}
+
+//static
+S32 LLImageBufferPool::getSizeClass(S32 size)
+{
+    if (size < MIN_POOLED_SIZE || size > MAX_POOLED_SIZE)
+    {
+        return -1;
+    }
+    const bool three = size % 3 == 0;
+    const U32 power = three ? size / 3 : size;
+    if (power & (power - 1))
+    {
+        return -1;
+    }
+    S32 log2 = 0;
+    while ((1u << log2) < power)
+    {
+        ++log2;
+    }
+    return three ? POWER_CLASS_COUNT + log2 - MIN_THREE_LOG2 : log2 - MIN_POWER_LOG2;
+}
+
+//static
+U8* LLImageBufferPool::allocate(S32 size)
+{
+    const S32 size_class = getSizeClass(size);
+    if (size_class < 0)
+    {
+        return (U8*)ll_aligned_malloc_16(size);
+    }
+
+    // before the cap check, so a disabled pool still drops this thread's buffers
+    ThreadCache* local = thread_cache();
+    if (sMaxBytes.load() <= 0)
+    {
+        return (U8*)ll_aligned_malloc_16(size);
+    }
+
+    U8* data = nullptr;
+    if (local && !local->mBuffers[size_class].empty())
+    {
+        data = local->mBuffers[size_class].back();
+        local->mBuffers[size_class].pop_back();
+        local->mBytes -= size;
+    }
+    else
+    {
+        SharedCache& shared = shared_cache();
+        std::lock_guard<std::mutex> lock(shared.mMutex);
+        if (!shared.mBuffers[size_class].empty())
+        {
+            data = shared.mBuffers[size_class].back();
+            shared.mBuffers[size_class].pop_back();
+        }
+    }
+
+    if (data)
+    {
+        sCachedBytes -= size;
+        ++sHits;
+        return data;
+    }
+    ++sMisses;
+    return (U8*)ll_aligned_malloc_16(size);
+}
+
+//static
+void LLImageBufferPool::release(U8* data, S32 size)
+{
+    if (!data)
+    {
+        return;
+    }
+
+    const S32 size_class = getSizeClass(size);
+    if (size_class < 0)
+    {
+        ll_aligned_free_16(data);
+        return;
+    }
+
+    ThreadCache* local = thread_cache();
+    if (!reserve(size))
+    {
+        ll_aligned_free_16(data);
+        return;
+    }
+
+    if (local && local->mBuffers[size_class].size() < MAX_THREAD_BUFFERS && local->mBytes + size <= MAX_THREAD_BYTES)
+    {
+        local->mBuffers[size_class].push_back(data);
+        local->mBytes += size;
+        return;
+    }
+
+    SharedCache& shared = shared_cache();
+    std::lock_guard<std::mutex> lock(shared.mMutex);
+    shared.mBuffers[size_class].push_back(data);
+}
+
+//static
+void LLImageBufferPool::setMaxBytes(S64 max_bytes)
+{
+    sMaxBytes = llmax(max_bytes, (S64)0);
+    if (sCachedBytes.load() > sMaxBytes.load())
+    {
+        clear();
+    }
+}
+
+//static
+S64 LLImageBufferPool::getMaxBytes()
+{
+    return sMaxBytes.load();
+}
+
+//static
+void LLImageBufferPool::clear()
+{
+    ++sGeneration;
+
+    SharedCache& shared = shared_cache();
+    std::lock_guard<std::mutex> lock(shared.mMutex);
+    for (S32 size_class = 0; size_class < SIZE_CLASS_COUNT; ++size_class)
+    {
+        for (U8* data : shared.mBuffers[size_class])
+        {
+            ll_aligned_free_16(data);
+            sCachedBytes -= class_size(size_class);
+        }
+        shared.mBuffers[size_class].clear();
+    }
+}
+
+//static
+void LLImageBufferPool::updateStats()
+{
+    static U64 last_hits = 0;
+    static U64 last_misses = 0;
+
+    const U64 hits = sHits.load();
+    const U64 misses = sMisses.load();
+    const U64 new_hits = hits - last_hits;
+    const U64 new_misses = misses - last_misses;
+    last_hits = hits;
+    last_misses = misses;
+
+    add(sPoolHits, (S32)new_hits);
+    add(sPoolMisses, (S32)new_misses);
+    if (new_hits + new_misses)
+    {
+        sample(sPoolHitRate, LLUnits::Ratio::fromValue((F32)new_hits / (F32)(new_hits + new_misses)));
+    }
+    sample(sPoolSize, F64Bytes((F64)sCachedBytes.load()));
+}
+
+//static
+S64 LLImageBufferPool::getCachedBytes()
+{
+    return sCachedBytes.load();
+}
+
+//static
+U64 LLImageBufferPool::getHits()
+{
+    return sHits.load();
+}
+
+//static
+U64 LLImageBufferPool::getMisses()
+{
+    return sMisses.load();
+}
@@ -0,0 +1,72 @@
+/**
+ * @file llimagebufferpool.h
+ * @brief Size class pool of image data buffers.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGEBUFFERPOOL_H
+#define LL_LLIMAGEBUFFERPOOL_H
+
+#include "stdtypes.h"
+
+// Recycles the data buffers of images whose size is a power of two, or three
+// times one, which covers raw images of power of two textures with 1 to 4
+// components. Decodes and scales allocate and free such buffers all the time,
+// keeping them around spares the heap that churn.
+//
+// Each thread keeps a few buffers of each size for itself, the rest are
+// shared. Buffers of other sizes, or past the cap on the bytes held by the
+// pool, go straight to ll_aligned_malloc_16() and ll_aligned_free_16(), so
+// any buffer from either can be released to the pool.
+class LLImageBufferPool
+{
+public:
+    static const S32 MIN_POOLED_SIZE = 4 * 1024;
+    static const S32 MAX_POOLED_SIZE = 2048 * 2048 * 4;
+
+    // A buffer of at least size bytes, 16 byte aligned
+    static U8* allocate(S32 size);
+    // data must come from allocate() or ll_aligned_malloc_16() and hold at
+    // least size bytes
+    static void release(U8* data, S32 size);
+
+    // Cap on the bytes of all idle buffers, 0 to disable the pool. Lowering
+    // it below the bytes held clear()s the pool.
+    static void setMaxBytes(S64 max_bytes);
+    static S64 getMaxBytes();
+    // Frees the shared buffers. Each thread frees its own the next time it
+    // calls allocate() or release(), or when it exits.
+    static void clear();
+
+    // Publishes the hit rate and pool size to LLTrace. Call it from the main
+    // thread: the decode threads have no LLTrace recorder.
+    static void updateStats();
+
+    // Index of the size class of size, or -1 if it is not pooled
+    static S32 getSizeClass(S32 size);
+    static S64 getCachedBytes();
+    static U64 getHits();
+    static U64 getMisses();
+};
+
+#endif // LL_LLIMAGEBUFFERPOOL_H
@@ -35,6 +35,117 @@
 #include "v3math.h"
 #include "llsdserialize.h"
 #include "llstring.h"
+#include "workqueue.h"
+
+#if LL_ARM64
+#include "sse2neon.h"
+#elif LL_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_1__) || defined(LL_ARM64)
+#define LL_IMAGE_SIMD 1
+#else
+#define LL_IMAGE_SIMD 0
+#endif
+
+// Rows per band when filtering in parallel
+static const S32 ROWS_PER_BAND = 32;
+
+// A pointwise step queued by colorCorrect(), colorTransform() or
+// filterScreen(), with the stencil that was current at the time.
+struct LLImageFilter::PointStep
+{
+    enum EType
+    {
+        STEP_TABLE,     // per channel table, with the uniform stencil folded in
+        STEP_LUT,       // per channel table, blended through the stencil
+        STEP_TRANSFORM, // color matrix, blended through the stencil
+        STEP_SCREEN     // screen pattern, mLUT[0] holds the gamma table
+    };
+
+    EType mType;
+    Stencil mStencil;
+    U32 mStencilGeneration;
+    U8 mLUT[3][256];
+    LLMatrix3 mTransform;
+    EScreenMode mScreenMode;
+    F32 mWaveLength;
+    F32 mSine;
+    F32 mCosine;
+};
+
+#if LL_IMAGE_SIMD
+namespace
+{
+    inline __m128 load_rgb(const U8* pixel)
+    {
+        return _mm_cvtepi32_ps(_mm_setr_epi32(pixel[VRED], pixel[VGREEN], pixel[VBLUE], 0));
+    }
+
+    // Loads 4 bytes, so the pixel after this one must be readable
+    inline __m128 load_rgbx(const U8* pixel)
+    {
+        S32 value;
+        memcpy(&value, pixel, sizeof(value));
+        return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(value)));
+    }
+
+    // Truncates like the (U8) casts of the scalar code
+    inline void store_rgb(U8* pixel, __m128 value)
+    {
+        alignas(16) S32 out[4];
+        _mm_store_si128((__m128i*)out, _mm_cvttps_epi32(value));
+        pixel[VRED] = (U8)out[0];
+        pixel[VGREEN] = (U8)out[1];
+        pixel[VBLUE] = (U8)out[2];
+    }
+
+    inline __m128 clamp_255(__m128 value)
+    {
+        return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(255.f));
+    }
+
+    // Same as LLImageFilter::Stencil::blend() with a color that is already a
+    // whole number in [0, 255]
+    inline void blend_rgb(EStencilBlendMode mode, F32 alpha, U8* pixel, __m128 color)
+    {
+        const __m128 a = _mm_set1_ps(alpha);
+        const __m128 inv_a = _mm_set1_ps(1.0f - alpha);
+        const __m128 background = load_rgb(pixel);
+        switch (mode)
+        {
+            case STENCIL_BLEND_MODE_BLEND:
+#if defined(__FMA__)
+                // compilers contract the scalar expression into this
+                store_rgb(pixel, _mm_fmadd_ps(inv_a, background, _mm_mul_ps(a, color)));
+#else
+                store_rgb(pixel, _mm_add_ps(_mm_mul_ps(inv_a, background), _mm_mul_ps(a, color)));
+#endif
+                break;
+            case STENCIL_BLEND_MODE_ADD:
+                store_rgb(pixel, clamp_255(_mm_add_ps(background, _mm_mul_ps(a, color))));
+                break;
+            case STENCIL_BLEND_MODE_ABACK:
+                store_rgb(pixel, clamp_255(_mm_add_ps(_mm_mul_ps(inv_a, background), color)));
+                break;
+            case STENCIL_BLEND_MODE_FADE:
+                store_rgb(pixel, _mm_mul_ps(a, color));
+                break;
+        }
+    }
+
+    // (F32)(U8)value for a value already clamped to [0, 255]
+    inline __m128 truncate_u8(__m128 value)
+    {
+        return _mm_cvtepi32_ps(_mm_cvttps_epi32(value));
+    }
+}
+#endif
+
+// Below this many pixels, handing bands to other threads costs more than it
+// saves.
+S32 LLImageFilter::sParallelMinPixels = 512 * 512;
 
 //---------------------------------------------------------------------------
 // LLImageFilter
@@ -43,15 +154,12 @@
 LLImageFilter::LLImageFilter(const std::string& file_path) :
     mFilterData(LLSD::emptyArray()),
     mImage(NULL),
+    mQueue(NULL),
     mHistoRed(NULL),
     mHistoGreen(NULL),
     mHistoBlue(NULL),
     mHistoBrightness(NULL),
-    mStencilBlendMode(STENCIL_BLEND_MODE_BLEND),
-    mStencilShape(STENCIL_SHAPE_UNIFORM),
-    mStencilGamma(1.0),
-    mStencilMin(0.0),
-    mStencilMax(1.0)
+    mStencilGeneration(0)
 {
     // Load filter description from file
     llifstream filter_xml(file_path.c_str());
@@ -76,7 +184,6 @@ LLImageFilter::~LLImageFilter()
 /*
  *TODO
  * Rename stencil to mask
- * Improve perf: use LUT for alpha blending in uniform case
  * Add gradient coloring as a filter
  */
 
@@ -84,12 +191,20 @@ LLImageFilter::~LLImageFilter()
 // Apply the filter data to the image passed as parameter
 //============================================================================
 
-void LLImageFilter::executeFilter(LLPointer<LLImageRaw> raw_image)
+void LLImageFilter::executeFilter(LLPointer<LLImageRaw> raw_image, LL::WorkQueueBase* queue)
 {
     mImage = raw_image;
+    mQueue = queue;
 
     LLImageDataLock lock(mImage);
 
+    if (mImage->getComponents() < 3)
+    {
+        LL_WARNS() << "Filters need an RGB or RGBA image, cannot filter image with components : " << (S32)mImage->getComponents() << LL_ENDL;
+        mQueue = NULL;
+        return;
+    }
+
     //std::cout << "Filter : size = " << mFilterData.size() << std::endl;
     for (S32 i = 0; i < mFilterData.size(); ++i)
     {
@@ -271,16 +386,19 @@ void LLImageFilter::executeFilter(LLPointer<LLImageRaw> raw_image)
             LL_WARNS() << "Filter unknown, cannot execute filter command : " << filter_name << LL_ENDL;
         }
     }
+
+    applyPendingSteps();
+    mQueue = NULL;
 }
 
 //============================================================================
 // Filter Primitives
 //============================================================================
 
-void LLImageFilter::blendStencil(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue)
+void LLImageFilter::Stencil::blend(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue) const
 {
     F32 inv_alpha = 1.0f - alpha;
-    switch (mStencilBlendMode)
+    switch (mBlendMode)
     {
         case STENCIL_BLEND_MODE_BLEND:
             // Classic blend of incoming color with the background image
@@ -311,51 +429,62 @@ void LLImageFilter::blendStencil(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue
 
 void LLImageFilter::colorCorrect(const U8* lut_red, const U8* lut_green, const U8* lut_blue)
 {
-    const S32 components = mImage->getComponents();
-    llassert( components >= 1 && components <= 4 );
-
-    S32 width  = mImage->getWidth();
-    S32 height = mImage->getHeight();
-
-    U8* dst_data = mImage->getData();
-    for (S32 j = 0; j < height; j++)
+    PointStep step;
+    if (mStencil.mShape == STENCIL_SHAPE_UNIFORM)
     {
-        for (S32 i = 0; i < width; i++)
+        // With a uniform stencil each channel of the result only depends on
+        // the same channel of the source, so the blend goes into the tables.
+        // Consecutive tables then collapse into one.
+        F32 alpha = mStencil.getAlpha(0, 0);
+        for (S32 i = 0; i < 256; i++)
         {
-            // Blend LUT value
-            blendStencil(getStencilAlpha(i,j), dst_data, lut_red[dst_data[VRED]], lut_green[dst_data[VGREEN]], lut_blue[dst_data[VBLUE]]);
-            dst_data += components;
+            U8 pixel[3] = { (U8)i, (U8)i, (U8)i };
+            mStencil.blend(alpha, pixel, lut_red[i], lut_green[i], lut_blue[i]);
+            step.mLUT[VRED][i]   = pixel[VRED];
+            step.mLUT[VGREEN][i] = pixel[VGREEN];
+            step.mLUT[VBLUE][i]  = pixel[VBLUE];
         }
+        if (!mPendingSteps.empty() && mPendingSteps.back().mType == PointStep::STEP_TABLE)
+        {
+            PointStep& previous = mPendingSteps.back();
+            for (S32 c = 0; c < 3; c++)
+            {
+                for (S32 i = 0; i < 256; i++)
+                {
+                    previous.mLUT[c][i] = step.mLUT[c][previous.mLUT[c][i]];
+                }
+            }
+            return;
+        }
+        step.mType = PointStep::STEP_TABLE;
+    }
+    else
+    {
+        step.mType = PointStep::STEP_LUT;
+        memcpy(step.mLUT[VRED], lut_red, 256);      /* Flawfinder: ignore */
+        memcpy(step.mLUT[VGREEN], lut_green, 256);  /* Flawfinder: ignore */
+        memcpy(step.mLUT[VBLUE], lut_blue, 256);    /* Flawfinder: ignore */
     }
+    step.mStencil = mStencil;
+    step.mStencilGeneration = mStencilGeneration;
+    mPendingSteps.push_back(step);
 }
 
 void LLImageFilter::colorTransform(const LLMatrix3 &transform)
 {
-    const S32 components = mImage->getComponents();
-    llassert( components >= 1 && components <= 4 );
-
-    S32 width  = mImage->getWidth();
-    S32 height = mImage->getHeight();
-
-    U8* dst_data = mImage->getData();
-    for (S32 j = 0; j < height; j++)
-    {
-        for (S32 i = 0; i < width; i++)
-        {
-            // Compute transform
-            LLVector3 src((F32)(dst_data[VRED]),(F32)(dst_data[VGREEN]),(F32)(dst_data[VBLUE]));
-            LLVector3 dst = src * transform;
-            dst.clamp(0.0f,255.0f);
-
-            // Blend result
-            blendStencil(getStencilAlpha(i,j), dst_data, (U8)dst.mV[VRED], (U8)dst.mV[VGREEN], (U8)dst.mV[VBLUE]);
-            dst_data += components;
-        }
-    }
+    PointStep step;
+    step.mType = PointStep::STEP_TRANSFORM;
+    step.mTransform = transform;
+    step.mStencil = mStencil;
+    step.mStencilGeneration = mStencilGeneration;
+    mPendingSteps.push_back(step);
 }
 
 void LLImageFilter::convolve(const LLMatrix3 &kernel, bool normalize, bool abs_value)
 {
+    // Works on the result of everything before it
+    applyPendingSteps();
+
     const S32 components = mImage->getComponents();
     llassert( components >= 1 && components <= 4 );
 
@@ -381,7 +510,6 @@ void LLImageFilter::convolve(const LLMatrix3 &kernel, bool normalize, bool abs_v
     }
     F32 kernel_range = kernel_max - kernel_min;
 
-    // Allocate temporary buffers and initialize algorithm's data
     S32 width  = mImage->getWidth();
     S32 height = mImage->getHeight();
 
@@ -389,212 +517,393 @@ void LLImageFilter::convolve(const LLMatrix3 &kernel, bool normalize, bool abs_v
 
     S32 buffer_size = width * components;
     llassert_always(buffer_size > 0);
-    std::vector<U8> even_buffer(buffer_size);
-    std::vector<U8> odd_buffer(buffer_size);
 
-    U8* south_data = dst_data + buffer_size;
-    U8* east_west_data;
-    U8* north_data;
+    // Rows are filtered out of order, so every row reads its neighbours from
+    // a copy of the image. The extra bytes let the last pixel be loaded as 4.
+    std::vector<U8> src_buffer(buffer_size * height + 4);
+    memcpy( &src_buffer[0], dst_data, buffer_size * height );  /* Flawfinder: ignore */
 
-    // Line 0 : we set the line to 0 (debatable)
-    memcpy( &even_buffer[0], dst_data, buffer_size );   /* Flawfinder: ignore */
-    for (S32 i = 0; i < width; i++)
-    {
-        blendStencil(getStencilAlpha(i,0), dst_data, 0, 0, 0);
-        dst_data += components;
-    }
-    south_data += buffer_size;
+    const bool use_simd = LLImage::useSIMD();
 
-    // All other lines
-    for (S32 j = 1; j < (height-1); j++)
+    forEachBand([&](S32 first_row, S32 end_row)
     {
-        // We need to buffer 2 lines. We flip north and east-west (current) to avoid moving too much memory around
-        if (j % 2)
-        {
-            memcpy( &odd_buffer[0], dst_data, buffer_size );    /* Flawfinder: ignore */
-            east_west_data = &odd_buffer[0];
-            north_data = &even_buffer[0];
-        }
-        else
-        {
-            memcpy( &even_buffer[0], dst_data, buffer_size );   /* Flawfinder: ignore */
-            east_west_data = &even_buffer[0];
-            north_data = &odd_buffer[0];
-        }
-        // First pixel : set to 0
-        blendStencil(getStencilAlpha(0,j), dst_data, 0, 0, 0);
-        dst_data += components;
-        // Set pointers to kernel
-        U8* NW = north_data;
-        U8* N = NW+components;
-        U8* NE = N+components;
-        U8* W = east_west_data;
-        U8* C = W+components;
-        U8* E = C+components;
-        U8* SW = south_data;
-        U8* S = SW+components;
-        U8* SE = S+components;
-        // All other pixels
-        for (S32 i = 1; i < (width-1); i++)
+        std::vector<F32> alpha(width);
+        for (S32 j = first_row; j < end_row; j++)
         {
-            // Compute convolution
-            LLVector3 dst;
-            dst.mV[VRED] = (kernel.mMatrix[0][0]*NW[VRED] + kernel.mMatrix[0][1]*N[VRED] + kernel.mMatrix[0][2]*NE[VRED] +
-                            kernel.mMatrix[1][0]*W[VRED]  + kernel.mMatrix[1][1]*C[VRED] + kernel.mMatrix[1][2]*E[VRED] +
-                            kernel.mMatrix[2][0]*SW[VRED] + kernel.mMatrix[2][1]*S[VRED] + kernel.mMatrix[2][2]*SE[VRED]);
-            dst.mV[VGREEN] = (kernel.mMatrix[0][0]*NW[VGREEN] + kernel.mMatrix[0][1]*N[VGREEN] + kernel.mMatrix[0][2]*NE[VGREEN] +
-                              kernel.mMatrix[1][0]*W[VGREEN]  + kernel.mMatrix[1][1]*C[VGREEN] + kernel.mMatrix[1][2]*E[VGREEN] +
-                              kernel.mMatrix[2][0]*SW[VGREEN] + kernel.mMatrix[2][1]*S[VGREEN] + kernel.mMatrix[2][2]*SE[VGREEN]);
-            dst.mV[VBLUE] = (kernel.mMatrix[0][0]*NW[VBLUE] + kernel.mMatrix[0][1]*N[VBLUE] + kernel.mMatrix[0][2]*NE[VBLUE] +
-                             kernel.mMatrix[1][0]*W[VBLUE]  + kernel.mMatrix[1][1]*C[VBLUE] + kernel.mMatrix[1][2]*E[VBLUE] +
-                             kernel.mMatrix[2][0]*SW[VBLUE] + kernel.mMatrix[2][1]*S[VBLUE] + kernel.mMatrix[2][2]*SE[VBLUE]);
-            if (abs_value)
+            U8* dst_row = dst_data + j * buffer_size;
+
+            // First and last lines : we set the line to 0 (debatable). The
+            // last line has always been blended with the alpha of the first.
+            S32 alpha_j = (j == height - 1 ? 0 : j);
+            for (S32 i = 0; i < width; i++)
             {
-                dst.mV[VRED]   = llabs(dst.mV[VRED]);
-                dst.mV[VGREEN] = llabs(dst.mV[VGREEN]);
-                dst.mV[VBLUE]  = llabs(dst.mV[VBLUE]);
+                alpha[i] = mStencil.getAlpha(i, alpha_j);
             }
-            if (normalize)
+            if ((j == 0) || (j == height - 1))
             {
-                dst.mV[VRED]   = (dst.mV[VRED] - kernel_min)/kernel_range;
-                dst.mV[VGREEN] = (dst.mV[VGREEN] - kernel_min)/kernel_range;
-                dst.mV[VBLUE]  = (dst.mV[VBLUE] - kernel_min)/kernel_range;
+                for (S32 i = 0; i < width; i++)
+                {
+                    mStencil.blend(alpha[i], dst_row + i * components, 0, 0, 0);
+                }
+                continue;
             }
-            dst.clamp(0.0f,255.0f);
-
-            // Blend result
-            blendStencil(getStencilAlpha(i,j), dst_data, (U8)dst.mV[VRED], (U8)dst.mV[VGREEN], (U8)dst.mV[VBLUE]);
-
-            // Next pixel
-            dst_data += components;
-            NW += components;
-            N += components;
-            NE += components;
-            W += components;
-            C += components;
-            E += components;
-            SW += components;
-            S += components;
-            SE += components;
-        }
-        // Last pixel : set to 0
-        blendStencil(getStencilAlpha(width-1,j), dst_data, 0, 0, 0);
-        dst_data += components;
-        south_data += buffer_size;
-    }
 
-    // Last line
-    for (S32 i = 0; i < width; i++)
-    {
-        blendStencil(getStencilAlpha(i,0), dst_data, 0, 0, 0);
-        dst_data += components;
-    }
+            // First and last pixels : set to 0
+            mStencil.blend(alpha[0], dst_row, 0, 0, 0);
+            if (width > 1)
+            {
+                mStencil.blend(alpha[width - 1], dst_row + (width - 1) * components, 0, 0, 0);
+            }
+
+            // Set pointers to kernel
+            const U8* NW = &src_buffer[(j - 1) * buffer_size];
+            const U8* N = NW+components;
+            const U8* NE = N+components;
+            const U8* W = NW + buffer_size;
+            const U8* C = W+components;
+            const U8* E = C+components;
+            const U8* SW = W + buffer_size;
+            const U8* S = SW+components;
+            const U8* SE = S+components;
+            U8* dst = dst_row + components;
+
+#if LL_IMAGE_SIMD
+            if (use_simd && width > 2)
+            {
+                // Each lane does the scalar sum in the scalar order, so the
+                // result is the same. The 3x3 window slides right one column
+                // at a time, loading only the new column.
+                __m128 k[NUM_VALUES_IN_MAT3][NUM_VALUES_IN_MAT3];
+                for (S32 r = 0; r < NUM_VALUES_IN_MAT3; r++)
+                {
+                    for (S32 c = 0; c < NUM_VALUES_IN_MAT3; c++)
+                    {
+                        k[r][c] = _mm_set1_ps(kernel.mMatrix[r][c]);
+                    }
+                }
+                const __m128 sign = _mm_set1_ps(-0.0f);
+                const __m128 k_min = _mm_set1_ps(kernel_min);
+                const __m128 k_range = _mm_set1_ps(kernel_range);
+
+                __m128 nw = load_rgbx(NW), n = load_rgbx(N);
+                __m128 w = load_rgbx(W), c = load_rgbx(C);
+                __m128 sw = load_rgbx(SW), s = load_rgbx(S);
+                for (S32 i = 1; i < (width-1); i++)
+                {
+                    const S32 offset = (i + 1) * components;
+                    __m128 ne = load_rgbx(NW + offset);
+                    __m128 e = load_rgbx(W + offset);
+                    __m128 se = load_rgbx(SW + offset);
+
+                    __m128 v = _mm_mul_ps(k[0][0], nw);
+                    v = _mm_add_ps(v, _mm_mul_ps(k[0][1], n));
+                    v = _mm_add_ps(v, _mm_mul_ps(k[0][2], ne));
+                    v = _mm_add_ps(v, _mm_mul_ps(k[1][0], w));
+                    v = _mm_add_ps(v, _mm_mul_ps(k[1][1], c));
+                    v = _mm_add_ps(v, _mm_mul_ps(k[1][2], e));
+                    v = _mm_add_ps(v, _mm_mul_ps(k[2][0], sw));
+                    v = _mm_add_ps(v, _mm_mul_ps(k[2][1], s));
+                    v = _mm_add_ps(v, _mm_mul_ps(k[2][2], se));
+                    if (abs_value)
+                    {
+                        v = _mm_andnot_ps(sign, v);
+                    }
+                    if (normalize)
+                    {
+                        v = _mm_div_ps(_mm_sub_ps(v, k_min), k_range);
+                    }
+                    blend_rgb(mStencil.mBlendMode, alpha[i], dst, truncate_u8(clamp_255(v)));
+
+                    dst += components;
+                    nw = n; n = ne;
+                    w = c; c = e;
+                    sw = s; s = se;
+                }
+                continue;
+            }
+#endif
+
+            for (S32 i = 1; i < (width-1); i++)
+            {
+                // Compute convolution
+                LLVector3 dst_value;
+                dst_value.mV[VRED] = (kernel.mMatrix[0][0]*NW[VRED] + kernel.mMatrix[0][1]*N[VRED] + kernel.mMatrix[0][2]*NE[VRED] +
+                                      kernel.mMatrix[1][0]*W[VRED]  + kernel.mMatrix[1][1]*C[VRED] + kernel.mMatrix[1][2]*E[VRED] +
+                                      kernel.mMatrix[2][0]*SW[VRED] + kernel.mMatrix[2][1]*S[VRED] + kernel.mMatrix[2][2]*SE[VRED]);
+                dst_value.mV[VGREEN] = (kernel.mMatrix[0][0]*NW[VGREEN] + kernel.mMatrix[0][1]*N[VGREEN] + kernel.mMatrix[0][2]*NE[VGREEN] +
+                                        kernel.mMatrix[1][0]*W[VGREEN]  + kernel.mMatrix[1][1]*C[VGREEN] + kernel.mMatrix[1][2]*E[VGREEN] +
+                                        kernel.mMatrix[2][0]*SW[VGREEN] + kernel.mMatrix[2][1]*S[VGREEN] + kernel.mMatrix[2][2]*SE[VGREEN]);
+                dst_value.mV[VBLUE] = (kernel.mMatrix[0][0]*NW[VBLUE] + kernel.mMatrix[0][1]*N[VBLUE] + kernel.mMatrix[0][2]*NE[VBLUE] +
+                                       kernel.mMatrix[1][0]*W[VBLUE]  + kernel.mMatrix[1][1]*C[VBLUE] + kernel.mMatrix[1][2]*E[VBLUE] +
+                                       kernel.mMatrix[2][0]*SW[VBLUE] + kernel.mMatrix[2][1]*S[VBLUE] + kernel.mMatrix[2][2]*SE[VBLUE]);
+                if (abs_value)
+                {
+                    dst_value.mV[VRED]   = llabs(dst_value.mV[VRED]);
+                    dst_value.mV[VGREEN] = llabs(dst_value.mV[VGREEN]);
+                    dst_value.mV[VBLUE]  = llabs(dst_value.mV[VBLUE]);
+                }
+                if (normalize)
+                {
+                    dst_value.mV[VRED]   = (dst_value.mV[VRED] - kernel_min)/kernel_range;
+                    dst_value.mV[VGREEN] = (dst_value.mV[VGREEN] - kernel_min)/kernel_range;
+                    dst_value.mV[VBLUE]  = (dst_value.mV[VBLUE] - kernel_min)/kernel_range;
+                }
+                dst_value.clamp(0.0f,255.0f);
+
+                // Blend result
+                mStencil.blend(alpha[i], dst, (U8)dst_value.mV[VRED], (U8)dst_value.mV[VGREEN], (U8)dst_value.mV[VBLUE]);
+
+                // Next pixel
+                dst += components;
+                NW += components;
+                N += components;
+                NE += components;
+                W += components;
+                C += components;
+                E += components;
+                SW += components;
+                S += components;
+                SE += components;
+            }
+        }
+    });
 }
 
 void LLImageFilter::filterScreen(EScreenMode mode, const F32 wave_length, const F32 angle)
 {
-    const S32 components = mImage->getComponents();
-    llassert( components >= 1 && components <= 4 );
-
-    S32 width  = mImage->getWidth();
-    S32 height = mImage->getHeight();
-
-    F32 wave_length_pixels = wave_length * (F32)(height) / 2.0f;
-    F32 sin = sinf(angle*DEG_TO_RAD);
-    F32 cos = cosf(angle*DEG_TO_RAD);
+    PointStep step;
+    step.mType = PointStep::STEP_SCREEN;
+    step.mScreenMode = mode;
+    step.mWaveLength = wave_length * (F32)(mImage->getHeight()) / 2.0f;
+    step.mSine = sinf(angle*DEG_TO_RAD);
+    step.mCosine = cosf(angle*DEG_TO_RAD);
 
     // Precompute the gamma table : gives us the gray level to use when cutting outside the screen (prevents strong aliasing on the screen)
-    U8 gamma[256];
     for (S32 i = 0; i < 256; i++)
     {
         F32 gamma_i = llclampf((float)(powf((float)(i)/255.0f,1.0f/4.0f)));
-        gamma[i] = (U8)(255.0 * gamma_i);
+        step.mLUT[0][i] = (U8)(255.0 * gamma_i);
     }
 
-    U8* dst_data = mImage->getData();
-    for (S32 j = 0; j < height; j++)
+    step.mStencil = mStencil;
+    step.mStencilGeneration = mStencilGeneration;
+    mPendingSteps.push_back(step);
+}
+
+void LLImageFilter::applyPendingSteps()
+{
+    if (mPendingSteps.empty())
+    {
+        return;
+    }
+
+    const S32 components = mImage->getComponents();
+    const S32 width = mImage->getWidth();
+    U8* data = mImage->getData();
+
+    forEachBand([&](S32 first_row, S32 end_row)
+    {
+        // Stencil alphas of the current row, shared by the steps that use
+        // the same stencil settings
+        std::vector<F32> alpha(width);
+        U32 alpha_generation = 0;
+        S32 alpha_row = -1;
+        for (S32 j = first_row; j < end_row; j++)
+        {
+            U8* row = data + j * width * components;
+            for (const PointStep& step : mPendingSteps)
+            {
+                if (step.mType != PointStep::STEP_TABLE &&
+                    (alpha_row != j || alpha_generation != step.mStencilGeneration))
+                {
+                    for (S32 i = 0; i < width; i++)
+                    {
+                        alpha[i] = step.mStencil.getAlpha(i, j);
+                    }
+                    alpha_row = j;
+                    alpha_generation = step.mStencilGeneration;
+                }
+                applyStep(step, row, j, alpha.data());
+            }
+        }
+    });
+
+    mPendingSteps.clear();
+}
+
+void LLImageFilter::applyStep(const PointStep& step, U8* row, S32 j, const F32* alpha) const
+{
+    const S32 components = mImage->getComponents();
+    const S32 width = mImage->getWidth();
+    const Stencil& stencil = step.mStencil;
+    U8* dst_data = row;
+
+    switch (step.mType)
     {
-        for (S32 i = 0; i < width; i++)
+        case PointStep::STEP_TABLE:
+            for (S32 i = 0; i < width; i++)
+            {
+                dst_data[VRED]   = step.mLUT[VRED][dst_data[VRED]];
+                dst_data[VGREEN] = step.mLUT[VGREEN][dst_data[VGREEN]];
+                dst_data[VBLUE]  = step.mLUT[VBLUE][dst_data[VBLUE]];
+                dst_data += components;
+            }
+            break;
+
+        case PointStep::STEP_LUT:
+            for (S32 i = 0; i < width; i++)
+            {
+                // Blend LUT value
+                stencil.blend(alpha[i], dst_data, step.mLUT[VRED][dst_data[VRED]], step.mLUT[VGREEN][dst_data[VGREEN]], step.mLUT[VBLUE][dst_data[VBLUE]]);
+                dst_data += components;
+            }
+            break;
+
+        case PointStep::STEP_TRANSFORM:
         {
-            // Compute screen value
-            F32 value = 0.0;
-            F32 di = 0.0;
-            F32 dj = 0.0;
-            switch (mode)
+#if LL_IMAGE_SIMD
+            if (LLImage::useSIMD())
+            {
+                // Lane k sums r * m[0][k] + g * m[1][k] + b * m[2][k], in the
+                // order LLVector3 * LLMatrix3 does
+                const LLMatrix3& m = step.mTransform;
+                const __m128 m0 = _mm_setr_ps(m.mMatrix[0][0], m.mMatrix[0][1], m.mMatrix[0][2], 0.f);
+                const __m128 m1 = _mm_setr_ps(m.mMatrix[1][0], m.mMatrix[1][1], m.mMatrix[1][2], 0.f);
+                const __m128 m2 = _mm_setr_ps(m.mMatrix[2][0], m.mMatrix[2][1], m.mMatrix[2][2], 0.f);
+                for (S32 i = 0; i < width; i++)
+                {
+                    __m128 src = load_rgb(dst_data);
+                    __m128 dst = _mm_mul_ps(_mm_shuffle_ps(src, src, _MM_SHUFFLE(0, 0, 0, 0)), m0);
+                    dst = _mm_add_ps(dst, _mm_mul_ps(_mm_shuffle_ps(src, src, _MM_SHUFFLE(1, 1, 1, 1)), m1));
+                    dst = _mm_add_ps(dst, _mm_mul_ps(_mm_shuffle_ps(src, src, _MM_SHUFFLE(2, 2, 2, 2)), m2));
+                    blend_rgb(stencil.mBlendMode, alpha[i], dst_data, truncate_u8(clamp_255(dst)));
+                    dst_data += components;
+                }
+                break;
+            }
+#endif
+            for (S32 i = 0; i < width; i++)
             {
-                case SCREEN_MODE_2DSINE:
-                    di =  cos*i + sin*j;
-                    dj = -sin*i + cos*j;
-                    value = (sinf(2*F_PI*di/wave_length_pixels)*sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0f/2.0f;
-                    break;
-                case SCREEN_MODE_LINE:
-                    dj = sin*i - cos*j;
-                    value = (sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0f/2.0f;
-                    break;
+                // Compute transform
+                LLVector3 src((F32)(dst_data[VRED]),(F32)(dst_data[VGREEN]),(F32)(dst_data[VBLUE]));
+                LLVector3 dst = src * step.mTransform;
+                dst.clamp(0.0f,255.0f);
+
+                // Blend result
+                stencil.blend(alpha[i], dst_data, (U8)dst.mV[VRED], (U8)dst.mV[VGREEN], (U8)dst.mV[VBLUE]);
+                dst_data += components;
             }
-            U8 dst_value = (dst_data[VRED] >= (U8)(value) ? gamma[dst_data[VRED] - (U8)(value)] : 0);
+            break;
+        }
 
-            // Blend result
-            blendStencil(getStencilAlpha(i,j), dst_data, dst_value, dst_value, dst_value);
-            dst_data += components;
+        case PointStep::STEP_SCREEN:
+        {
+            const F32 wave_length_pixels = step.mWaveLength;
+            const F32 sin = step.mSine;
+            const F32 cos = step.mCosine;
+            for (S32 i = 0; i < width; i++)
+            {
+                // Compute screen value
+                F32 value = 0.0;
+                F32 di = 0.0;
+                F32 dj = 0.0;
+                switch (step.mScreenMode)
+                {
+                    case SCREEN_MODE_2DSINE:
+                        di =  cos*i + sin*j;
+                        dj = -sin*i + cos*j;
+                        value = (sinf(2*F_PI*di/wave_length_pixels)*sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0f/2.0f;
+                        break;
+                    case SCREEN_MODE_LINE:
+                        dj = sin*i - cos*j;
+                        value = (sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0f/2.0f;
+                        break;
+                }
+                U8 dst_value = (dst_data[VRED] >= (U8)(value) ? step.mLUT[0][dst_data[VRED] - (U8)(value)] : 0);
+
+                // Blend result
+                stencil.blend(alpha[i], dst_data, dst_value, dst_value, dst_value);
+                dst_data += components;
+            }
+            break;
         }
     }
 }
 
+void LLImageFilter::forEachBand(const std::function<void(S32, S32)>& fn)
+{
+    const S32 height = mImage->getHeight();
+    const S32 bands = (height + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+    if (mQueue && (bands > 1) && (mImage->getWidth() * height >= sParallelMinPixels))
+    {
+        LL::parallel_for(mQueue, bands, [&](S32 band)
+            {
+                fn(band * ROWS_PER_BAND, llmin((band + 1) * ROWS_PER_BAND, height));
+            });
+    }
+    else
+    {
+        fn(0, height);
+    }
+}
+
 //============================================================================
 // Procedural Stencils
 //============================================================================
 void LLImageFilter::setStencil(EStencilShape shape, EStencilBlendMode mode, F32 min, F32 max, F32* params)
 {
-    mStencilShape = shape;
-    mStencilBlendMode = mode;
-    mStencilMin = llmin(llmax(min, -1.0f), 1.0f);
-    mStencilMax = llmin(llmax(max, -1.0f), 1.0f);
+    // Steps already queued keep the settings they were given
+    mStencilGeneration++;
+
+    mStencil.mShape = shape;
+    mStencil.mBlendMode = mode;
+    mStencil.mMin = llmin(llmax(min, -1.0f), 1.0f);
+    mStencil.mMax = llmin(llmax(max, -1.0f), 1.0f);
 
     // Each shape will interpret the 4 params differenly.
     // We compute each systematically, though, clearly, values are meaningless when the shape doesn't correspond to the parameters
-    mStencilCenterX = (S32)(mImage->getWidth()  + params[0] * (F32)(mImage->getHeight()))/2;
-    mStencilCenterY = (S32)(mImage->getHeight() + params[1] * (F32)(mImage->getHeight()))/2;
-    mStencilWidth = (S32)(params[2] * (F32)(mImage->getHeight()))/2;
-    mStencilGamma = (params[3] <= 0.0f ? 1.0f : params[3]);
-
-    mStencilWavelength = (params[0] <= 0.0f ? 10.0f : params[0] * (F32)(mImage->getHeight()) / 2.0f);
-    mStencilSine   = sinf(params[1]*DEG_TO_RAD);
-    mStencilCosine = cosf(params[1]*DEG_TO_RAD);
-
-    mStencilStartX = ((F32)(mImage->getWidth())  + params[0] * (F32)(mImage->getHeight()))/2.0f;
-    mStencilStartY = ((F32)(mImage->getHeight()) + params[1] * (F32)(mImage->getHeight()))/2.0f;
-    F32 end_x      = ((F32)(mImage->getWidth())  + params[2] * (F32)(mImage->getHeight()))/2.0f;
-    F32 end_y      = ((F32)(mImage->getHeight()) + params[3] * (F32)(mImage->getHeight()))/2.0f;
-    mStencilGradX  = end_x - mStencilStartX;
-    mStencilGradY  = end_y - mStencilStartY;
-    mStencilGradN  = mStencilGradX*mStencilGradX + mStencilGradY*mStencilGradY;
+    mStencil.mCenterX = (S32)(mImage->getWidth()  + params[0] * (F32)(mImage->getHeight()))/2;
+    mStencil.mCenterY = (S32)(mImage->getHeight() + params[1] * (F32)(mImage->getHeight()))/2;
+    mStencil.mWidth = (S32)(params[2] * (F32)(mImage->getHeight()))/2;
+    mStencil.mGamma = (params[3] <= 0.0f ? 1.0f : params[3]);
+
+    mStencil.mWavelength = (params[0] <= 0.0f ? 10.0f : params[0] * (F32)(mImage->getHeight()) / 2.0f);
+    mStencil.mSine   = sinf(params[1]*DEG_TO_RAD);
+    mStencil.mCosine = cosf(params[1]*DEG_TO_RAD);
+
+    mStencil.mStartX = ((F32)(mImage->getWidth())  + params[0] * (F32)(mImage->getHeight()))/2.0f;
+    mStencil.mStartY = ((F32)(mImage->getHeight()) + params[1] * (F32)(mImage->getHeight()))/2.0f;
+    F32 end_x        = ((F32)(mImage->getWidth())  + params[2] * (F32)(mImage->getHeight()))/2.0f;
+    F32 end_y        = ((F32)(mImage->getHeight()) + params[3] * (F32)(mImage->getHeight()))/2.0f;
+    mStencil.mGradX  = end_x - mStencil.mStartX;
+    mStencil.mGradY  = end_y - mStencil.mStartY;
+    mStencil.mGradN  = mStencil.mGradX*mStencil.mGradX + mStencil.mGradY*mStencil.mGradY;
 }
 
-F32 LLImageFilter::getStencilAlpha(S32 i, S32 j)
+F32 LLImageFilter::Stencil::getAlpha(S32 i, S32 j) const
 {
     F32 alpha = 1.0;    // That init actually takes care of the STENCIL_SHAPE_UNIFORM case...
-    if (mStencilShape == STENCIL_SHAPE_VIGNETTE)
+    if (mShape == STENCIL_SHAPE_VIGNETTE)
     {
         // alpha is a modified gaussian value, with a center and fading in a circular pattern toward the edges
         // The gamma parameter controls the intensity of the drop down from alpha 1.0 (center) to 0.0
-        F32 d_center_square = (F32)((i - mStencilCenterX)*(i - mStencilCenterX) + (j - mStencilCenterY)*(j - mStencilCenterY));
-        alpha = powf(F_E, -(powf((d_center_square/(mStencilWidth*mStencilWidth)),mStencilGamma)/2.0f));
+        F32 d_center_square = (F32)((i - mCenterX)*(i - mCenterX) + (j - mCenterY)*(j - mCenterY));
+        alpha = powf(F_E, -(powf((d_center_square/(mWidth*mWidth)),mGamma)/2.0f));
     }
-    else if (mStencilShape == STENCIL_SHAPE_SCAN_LINES)
+    else if (mShape == STENCIL_SHAPE_SCAN_LINES)
     {
         // alpha varies according to a squared sine function.
-        F32 d = mStencilSine*i - mStencilCosine*j;
-        alpha = (sinf(2*F_PI*d/mStencilWavelength) > 0.0f ? 1.0f : 0.0f);
+        F32 d = mSine*i - mCosine*j;
+        alpha = (sinf(2*F_PI*d/mWavelength) > 0.0f ? 1.0f : 0.0f);
     }
-    else if (mStencilShape == STENCIL_SHAPE_GRADIENT)
+    else if (mShape == STENCIL_SHAPE_GRADIENT)
     {
-        alpha = (((F32)(i) - mStencilStartX)*mStencilGradX + ((F32)(j) - mStencilStartY)*mStencilGradY) / mStencilGradN;
+        alpha = (((F32)(i) - mStartX)*mGradX + ((F32)(j) - mStartY)*mGradY) / mGradN;
         alpha = llclampf(alpha);
     }
 
     // We rescale alpha between min and max
-    return (mStencilMin + alpha * (mStencilMax - mStencilMin));
+    return (mMin + alpha * (mMax - mMin));
 }
 
 //============================================================================
@@ -612,6 +921,9 @@ U32* LLImageFilter::getBrightnessHistogram()
 
 void LLImageFilter::computeHistograms()
 {
+    // Count what the filter steps so far produced
+    applyPendingSteps();
+
     const S32 components = mImage->getComponents();
     llassert( components >= 1 && components <= 4 );
 
@@ -30,11 +30,19 @@
 #include "llsd.h"
 #include "llimage.h"
 
+#include <functional>
+#include <vector>
+
 class LLImageRaw;
 class LLColor4U;
 class LLColor3;
 class LLMatrix3;
 
+namespace LL
+{
+    class WorkQueueBase;
+}
+
 typedef enum e_stencil_blend_mode
 {
     STENCIL_BLEND_MODE_BLEND = 0,
@@ -67,9 +75,45 @@ public:
     LLImageFilter(const std::string& file_path);
     ~LLImageFilter();
 
-    void executeFilter(LLPointer<LLImageRaw> raw_image);
+    // If queue is given, large images are filtered in bands of rows with
+    // help from its workers.
+    void executeFilter(LLPointer<LLImageRaw> raw_image, LL::WorkQueueBase* queue = nullptr);
+
+    // Minimum pixel count in an image before executeFilter() uses the queue
+    static S32 sParallelMinPixels;
 
 private:
+    // Procedural stencil: how much of a filter result is blended into the
+    // image at each pixel, and how
+    struct Stencil
+    {
+        F32 getAlpha(S32 i, S32 j) const;
+        void blend(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue) const;
+
+        EStencilBlendMode mBlendMode = STENCIL_BLEND_MODE_BLEND;
+        EStencilShape mShape = STENCIL_SHAPE_UNIFORM;
+        F32 mMin = 0.f;
+        F32 mMax = 1.f;
+
+        S32 mCenterX = 0;
+        S32 mCenterY = 0;
+        S32 mWidth = 0;
+        F32 mGamma = 1.f;
+
+        F32 mWavelength = 10.f;
+        F32 mSine = 0.f;
+        F32 mCosine = 1.f;
+
+        F32 mStartX = 0.f;
+        F32 mStartY = 0.f;
+        F32 mGradX = 0.f;
+        F32 mGradY = 0.f;
+        F32 mGradN = 1.f;
+    };
+
+    // Pointwise filter step waiting to be applied, see applyPendingSteps()
+    struct PointStep;
+
     // Filter Operations : Transforms
     void filterGrayScale();                         // Convert to grayscale
     void filterSepia();                             // Convert to sepia
@@ -91,12 +135,19 @@ private:
     void colorTransform(const LLMatrix3 &transform);
     void colorCorrect(const U8* lut_red, const U8* lut_green, const U8* lut_blue);
     void filterScreen(EScreenMode mode, const F32 wave_length, const F32 angle);
-    void blendStencil(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue);
     void convolve(const LLMatrix3 &kernel, bool normalize, bool abs_value);
 
+    // Pointwise primitives only queue a step. Queued steps are applied row
+    // by row in a single pass over the image, before anything that needs to
+    // see their result.
+    void applyPendingSteps();
+    void applyStep(const PointStep& step, U8* row, S32 j, const F32* alpha) const;
+    // Runs fn(first_row, end_row) over the whole image, in parallel bands
+    // when a queue was given and the image is large enough
+    void forEachBand(const std::function<void(S32, S32)>& fn);
+
     // Procedural Stencils
     void setStencil(EStencilShape shape, EStencilBlendMode mode, F32 min, F32 max, F32* params);
-    F32 getStencilAlpha(S32 i, S32 j);
 
     // Histograms
     U32* getBrightnessHistogram();
@@ -104,6 +155,8 @@ private:
 
     LLSD mFilterData;
     LLPointer<LLImageRaw> mImage;
+    LL::WorkQueueBase* mQueue;
+    std::vector<PointStep> mPendingSteps;
 
     // Histograms (if we ever happen to need them)
     U32 *mHistoRed;
@@ -111,26 +164,9 @@ private:
     U32 *mHistoBlue;
     U32 *mHistoBrightness;
 
-    // Current Stencil Settings
-    EStencilBlendMode mStencilBlendMode;
-    EStencilShape mStencilShape;
-    F32 mStencilMin;
-    F32 mStencilMax;
-
-    S32 mStencilCenterX;
-    S32 mStencilCenterY;
-    S32 mStencilWidth;
-    F32 mStencilGamma;
-
-    F32 mStencilWavelength;
-    F32 mStencilSine;
-    F32 mStencilCosine;
-
-    F32 mStencilStartX;
-    F32 mStencilStartY;
-    F32 mStencilGradX;
-    F32 mStencilGradY;
-    F32 mStencilGradN;
+    // Current Stencil Settings, the generation changes with each setStencil()
+    Stencil mStencil;
+    U32 mStencilGeneration;
 };
 
 
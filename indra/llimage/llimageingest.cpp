@@ -0,0 +1,345 @@
+/**
+ * @file llimageingest.cpp
+ * @brief Loads, scales and encodes local image files on a thread pool.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimageingest.h"
+
+#include "llapr.h"
+#include "lltimer.h"
+#include "threadpool.h"
+
+namespace
+{
+    U8 codec_from_filename(const std::string& filename)
+    {
+        size_t dot = filename.rfind('.');
+        if (dot == std::string::npos)
+        {
+            return IMG_CODEC_INVALID;
+        }
+        std::string exten = filename.substr(dot + 1);
+        LLStringUtil::toLower(exten);
+        return LLImageBase::getCodecFromExtension(exten);
+    }
+}
+
+//----------------------------------------------------------------------------
+
+LLImageIngestThread::LLImageIngestThread(size_t threads)
+{
+    mThreadPool.reset(new LL::PriorityThreadPool("ImageIngest", threads));
+    mThreadPool->start();
+}
+
+LLImageIngestThread::~LLImageIngestThread()
+{
+}
+
+LLImageIngestThread::handle_t LLImageIngestThread::ingest(const Request& request,
+                                                          const LLPointer<Responder>& responder,
+                                                          F32 priority)
+{
+    handle_t handle = mThreadPool->getQueue().makeHandle();
+    {
+        LLMutexLock lock(&mMutex);
+        mActive.insert(handle);
+    }
+
+    bool posted = mThreadPool->getQueue().post(
+        [this, request, responder, handle]()
+        {
+            Result result;
+            ingestFile(request, result,
+                       [this, &responder, handle](EStage stage) { return reportStage(handle, responder, stage); });
+            finish(handle, responder, result);
+        },
+        priority,
+        handle);
+    if (!posted)
+    {
+        LL_DEBUGS() << "Tried to ingest " << request.mFilename << " on shutdown" << LL_ENDL;
+        LLMutexLock lock(&mMutex);
+        mActive.erase(handle);
+        return 0;
+    }
+
+    return handle;
+}
+
+bool LLImageIngestThread::cancel(handle_t handle)
+{
+    LLMutexLock lock(&mMutex);
+
+    bool cancelled = false;
+    for (auto it = mEvents.begin(); it != mEvents.end(); )
+    {
+        if (it->mHandle == handle)
+        {
+            it = mEvents.erase(it);
+            cancelled = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (mActive.count(handle))
+    {
+        cancelled = true;
+        if (mThreadPool->getQueue().cancel(handle))
+        {
+            // never started
+            mActive.erase(handle);
+        }
+        else
+        {
+            // stops at its next stage
+            mCancelled.insert(handle);
+        }
+    }
+    return cancelled;
+}
+
+size_t LLImageIngestThread::getPending()
+{
+    LLMutexLock lock(&mMutex);
+    return mActive.size() + mEvents.size();
+}
+
+size_t LLImageIngestThread::update(F32 max_time_ms)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    // One event at a time, so that a responder can cancel other ingests
+    LLTimer timer;
+    while (true)
+    {
+        Event event;
+        {
+            LLMutexLock lock(&mMutex);
+            if (mEvents.empty())
+            {
+                break;
+            }
+            event = std::move(mEvents.front());
+            mEvents.pop_front();
+        }
+
+        if (event.mCompleted)
+        {
+            event.mResponder->completed(event.mHandle, event.mResult);
+        }
+        else
+        {
+            event.mResponder->progress(event.mHandle, event.mStage);
+        }
+
+        if (timer.getElapsedTimeF32() * 1000.f > max_time_ms)
+        {
+            break;
+        }
+    }
+    return getPending();
+}
+
+void LLImageIngestThread::shutdown()
+{
+    mThreadPool->close();
+
+    LLMutexLock lock(&mMutex);
+    mActive.clear();
+    mCancelled.clear();
+    mEvents.clear();
+}
+
+bool LLImageIngestThread::reportStage(handle_t handle, const LLPointer<Responder>& responder, EStage stage)
+{
+    LLMutexLock lock(&mMutex);
+    if (mCancelled.count(handle))
+    {
+        return false;
+    }
+    if (responder.notNull())
+    {
+        mEvents.push_back({ handle, responder, stage, false, Result() });
+    }
+    return true;
+}
+
+void LLImageIngestThread::finish(handle_t handle, const LLPointer<Responder>& responder, const Result& result)
+{
+    LLMutexLock lock(&mMutex);
+    mActive.erase(handle);
+    if (mCancelled.erase(handle))
+    {
+        return;
+    }
+    if (responder.notNull())
+    {
+        mEvents.push_back({ handle, responder, STAGE_COUNT, true, result });
+    }
+}
+
+//static
+bool LLImageIngestThread::ingestFile(const Request& request, Result& result, const stage_callback_t& stage_callback)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    result = Result();
+    auto stage_done = [&](EStage stage)
+    {
+        if (stage_callback && !stage_callback(stage))
+        {
+            result.mError = "Cancelled.";
+            return false;
+        }
+        return true;
+    };
+
+    // Identify the file, its extension may be wrong or missing
+    U8 codec = request.mCodec;
+    if (codec == IMG_CODEC_INVALID)
+    {
+        U8 header[LLImageBase::SNIFF_BYTES];
+        S32 bytes = LLAPRFile::readEx(request.mFilename, header, 0, LLImageBase::SNIFF_BYTES);
+        codec = LLImageBase::getCodecFromData(header, bytes);
+        if (codec == IMG_CODEC_INVALID)
+        {
+            codec = codec_from_filename(request.mFilename);
+        }
+    }
+    result.mCodec = codec;
+
+    LLPointer<LLImageFormatted> image = LLImageFormatted::createFromType(codec);
+    if (image.isNull())
+    {
+        result.mError = "Unknown image format. FILE: " + request.mFilename;
+        return false;
+    }
+
+    // Read the file and parse its header
+    if (!image->load(request.mFilename))
+    {
+        result.mError = LLImage::getLastThreadError();
+        return false;
+    }
+    // Local files are complete, see LLViewerTextureList::createUploadFile()
+    image->setDiscardLevel(0);
+
+    result.mOriginalWidth = image->getWidth();
+    result.mOriginalHeight = image->getHeight();
+    if (image->getWidth() < request.mMinDimension || image->getHeight() < request.mMinDimension)
+    {
+        result.mError = llformat("Images below %d x %d pixels are not allowed. Actual size: %d x %dpx",
+                                 request.mMinDimension, request.mMinDimension,
+                                 image->getWidth(), image->getHeight());
+        return false;
+    }
+    if (!stage_done(STAGE_PROBED))
+    {
+        return false;
+    }
+
+    LLPointer<LLImageRaw> raw_image = new LLImageRaw;
+    if (!image->decode(raw_image, 0.f))
+    {
+        result.mError = "Couldn't decode the image. " + LLImage::getLastThreadError();
+        return false;
+    }
+    if ((image->getComponents() != 3) && (image->getComponents() != 4))
+    {
+        result.mError = "Image files with less than 3 or more than 4 components are not supported.";
+        return false;
+    }
+    // no longer needed, free it before scaling
+    image = nullptr;
+    if (!stage_done(STAGE_DECODED))
+    {
+        return false;
+    }
+
+    const S32 width = raw_image->getWidth();
+    const S32 height = raw_image->getHeight();
+    if (request.mMaxWidth > 0 && request.mMaxHeight > 0 && (width > request.mMaxWidth || height > request.mMaxHeight))
+    {
+        F32 scale = llmin((F32)request.mMaxWidth / (F32)width, (F32)request.mMaxHeight / (F32)height);
+        S32 new_width = LLImageRaw::contractDimToPowerOfTwo(llclamp((S32)llroundf(width * scale), 4, request.mMaxWidth));
+        S32 new_height = LLImageRaw::contractDimToPowerOfTwo(llclamp((S32)llroundf(height * scale), 4, request.mMaxHeight));
+        if (!raw_image->scale(new_width, new_height))
+        {
+            result.mError = llformat("Failed to scale image from %dx%d to %dx%d", width, height, new_width, new_height);
+            return false;
+        }
+        result.mFitted = true;
+    }
+    if (request.mForceSquare)
+    {
+        S32 biggest_side = llmax(raw_image->getWidth(), raw_image->getHeight());
+        S32 square_size = LLImageRaw::biasedDimToPowerOfTwo(biggest_side, request.mMaxDimension);
+        raw_image->scale(square_size, square_size);
+    }
+    else
+    {
+        raw_image->biasedScaleToPowerOfTwo(request.mMaxDimension);
+    }
+    result.mRawImage = raw_image;
+    if (!stage_done(STAGE_SCALED))
+    {
+        return false;
+    }
+
+    if (request.mEncode)
+    {
+        LLPointer<LLImageJ2C> compressed_image = new LLImageJ2C;
+        if (raw_image->getWidth() * raw_image->getHeight() <= request.mReversibleMaxArea)
+        {
+            compressed_image->setReversible(true);
+        }
+        if (request.mBlockSize > 0 || request.mPrecinctSize > 0)
+        {
+            compressed_image->initEncode(*raw_image, request.mBlockSize, request.mPrecinctSize, 0);
+        }
+        if (!compressed_image->encode(raw_image, 0.f))
+        {
+            result.mError = "Couldn't convert the image to jpeg2000.";
+            return false;
+        }
+        result.mEncodedImage = compressed_image;
+        if (!stage_done(STAGE_ENCODED))
+        {
+            return false;
+        }
+    }
+
+    result.mSuccess = true;
+    return true;
+}
+
+LLImageIngestThread::Responder::~Responder()
+{
+}
@@ -0,0 +1,153 @@
+/**
+ * @file llimageingest.h
+ * @brief Loads, scales and encodes local image files on a thread pool.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGEINGEST_H
+#define LL_LLIMAGEINGEST_H
+
+#include "llimage.h"
+#include "llimagej2c.h"
+#include "llmutex.h"
+#include "llpointer.h"
+#include "threadpool_fwd.h"
+
+#include <deque>
+#include <functional>
+#include <set>
+
+// Turns image files on disk (PNG, JPEG, TGA, BMP, J2C) into power of two
+// raw images, and optionally J2C streams, on the "ImageIngest" thread pool
+// so that uploading or previewing many files does not stall the main
+// thread.
+//
+// Each file goes through these stages, reported to its Responder as they
+// complete: the codec is identified from the file signature (falling back
+// to the extension), the header is parsed and checked against the
+// requested minimum size before anything is decoded, then the image is
+// decoded, scaled and encoded. Responders are only called from update(),
+// on the thread calling it.
+class LLImageIngestThread
+{
+public:
+    typedef U32 handle_t;
+
+    enum EStage
+    {
+        STAGE_PROBED = 0,   // codec and dimensions known
+        STAGE_DECODED,
+        STAGE_SCALED,
+        STAGE_ENCODED,
+        STAGE_COUNT
+    };
+
+    struct Request
+    {
+        std::string mFilename;
+        // IMG_CODEC_INVALID to identify the file from its contents
+        U8 mCodec = IMG_CODEC_INVALID;
+        // Files narrower or shorter than this are rejected
+        S32 mMinDimension = 0;
+        // Images larger than mMaxWidth x mMaxHeight are first shrunk to fit,
+        // keeping their aspect ratio. 0 to skip.
+        S32 mMaxWidth = 0;
+        S32 mMaxHeight = 0;
+        // Then scaled to powers of two, square ones if mForceSquare
+        S32 mMaxDimension = MAX_IMAGE_SIZE;
+        bool mForceSquare = false;
+        // Encode the scaled image to J2C, reversibly if its area is at most
+        // mReversibleMaxArea. Negative block and precinct sizes keep the
+        // encoder defaults.
+        bool mEncode = true;
+        S32 mReversibleMaxArea = 0;
+        S32 mBlockSize = -1;
+        S32 mPrecinctSize = -1;
+    };
+
+    struct Result
+    {
+        bool mSuccess = false;
+        std::string mError;
+        U8 mCodec = IMG_CODEC_INVALID;
+        S32 mOriginalWidth = 0;
+        S32 mOriginalHeight = 0;
+        // true if the image was shrunk to mMaxWidth x mMaxHeight
+        bool mFitted = false;
+        LLPointer<LLImageRaw> mRawImage;
+        LLPointer<LLImageJ2C> mEncodedImage;
+    };
+
+    class Responder : public LLThreadSafeRefCount
+    {
+    protected:
+        virtual ~Responder();
+    public:
+        virtual void progress(handle_t handle, EStage stage) {}
+        virtual void completed(handle_t handle, const Result& result) = 0;
+    };
+
+    // Return false to abort the ingest
+    typedef std::function<bool(EStage stage)> stage_callback_t;
+
+public:
+    LLImageIngestThread(size_t threads = 2);
+    virtual ~LLImageIngestThread();
+
+    // Higher priority files are ingested first. Returns 0 on shutdown.
+    handle_t ingest(const Request& request, const LLPointer<Responder>& responder, F32 priority = 0.f);
+    // Responders of cancelled ingests are not called again. Files already
+    // being worked on stop at their next stage.
+    bool cancel(handle_t handle);
+    // Ingests queued, running or waiting for update() to report them
+    size_t getPending();
+    // Call the responders of stages completed since the last call
+    size_t update(F32 max_time_ms);
+    void shutdown();
+
+    // The whole pipeline, run synchronously on the calling thread
+    static bool ingestFile(const Request& request, Result& result, const stage_callback_t& stage_callback = stage_callback_t());
+
+private:
+    struct Event
+    {
+        handle_t mHandle;
+        LLPointer<Responder> mResponder;
+        EStage mStage;
+        bool mCompleted;
+        Result mResult;
+    };
+
+    bool reportStage(handle_t handle, const LLPointer<Responder>& responder, EStage stage);
+    void finish(handle_t handle, const LLPointer<Responder>& responder, const Result& result);
+
+    std::unique_ptr<LL::PriorityThreadPool> mThreadPool;
+
+    LLMutex mMutex;
+    // queued or running
+    std::set<handle_t> mActive;
+    std::set<handle_t> mCancelled;
+    std::deque<Event> mEvents;
+};
+
+#endif // LL_LLIMAGEINGEST_H
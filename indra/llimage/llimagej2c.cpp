@@ -40,6 +40,7 @@ LLImageJ2CImpl* fallbackCreateLLImageJ2CImpl();
 
 // Test data gathering handle
 LLImageCompressionTester* LLImageJ2C::sTesterp = NULL ;
+std::weak_ptr<LL::WorkQueueBase> LLImageJ2C::sDefaultEncodeQueue;
 const std::string sTesterName("ImageCompressionTester");
 
 //static
@@ -56,6 +57,7 @@ LLImageJ2C::LLImageJ2C() :  LLImageFormatted(IMG_CODEC_J2C),
                             mRawDiscardLevel(-1),
                             mRate(DEFAULT_COMPRESSION_RATE),
                             mReversible(false),
+                            mEncodeQueue(sDefaultEncodeQueue),
                             mAreaUsedForDataSizeCalcs(0)
 {
     mImpl.reset(fallbackCreateLLImageJ2CImpl());
@@ -358,6 +360,12 @@ void LLImageJ2C::setReversible(const bool reversible)
     mReversible = reversible;
 }
 
+//static
+void LLImageJ2C::setDefaultEncodeQueue(const std::weak_ptr<LL::WorkQueueBase>& queue)
+{
+    sDefaultEncodeQueue = queue;
+}
+
 
 bool LLImageJ2C::loadAndValidate(const std::string &filename)
 {
@@ -31,11 +31,19 @@
 #include "llassettype.h"
 #include "llmetricperformancetester.h"
 
+#include <memory>
+
 // JPEG2000 : compression rate used in j2c conversion.
 const F32 DEFAULT_COMPRESSION_RATE = 1.f/8.f;
+// JPEG2000 : tile size of multithreaded encodes.
+const S32 ENCODE_TILE_SIZE = 512;
 
 class LLImageJ2CImpl;
 class LLImageCompressionTester ;
+namespace LL
+{
+    class WorkQueueBase;
+}
 
 class LLImageJ2C : public LLImageFormatted
 {
@@ -70,6 +78,13 @@ public:
 
     // Encode accessors
     void setReversible(const bool reversible); // Use non-lossy?
+    // Images made of several ENCODE_TILE_SIZE tiles are encoded as that many
+    // tiles, shared between the calling thread and the idle workers of this
+    // queue. Without a queue they are encoded as one tile on the calling
+    // thread.
+    void setEncodeQueue(const std::weak_ptr<LL::WorkQueueBase>& queue) { mEncodeQueue = queue; }
+    std::shared_ptr<LL::WorkQueueBase> getEncodeQueue() const { return mEncodeQueue.lock(); }
+    static void setDefaultEncodeQueue(const std::weak_ptr<LL::WorkQueueBase>& queue);
     void setMaxBytes(S32 max_bytes);
     S32 getMaxBytes() const { return mMaxBytes; }
 
@@ -94,11 +109,14 @@ protected:
     S8  mRawDiscardLevel;
     F32 mRate;
     bool mReversible;
+    std::weak_ptr<LL::WorkQueueBase> mEncodeQueue;
     std::unique_ptr<LLImageJ2CImpl> mImpl;
     std::string mLastError;
 
     // Image compression/decompression tester
     static LLImageCompressionTester* sTesterp;
+
+    static std::weak_ptr<LL::WorkQueueBase> sDefaultEncodeQueue;
 };
 
 // Derive from this class to implement JPEG2000 decoding
@@ -27,6 +27,7 @@
 #include "linden_common.h"
 
 #include "llimageworker.h"
+#include "lldecodedimagecache.h"
 #include "llimagedxt.h"
 #include "threadpool.h"
 
@@ -38,13 +39,19 @@ public:
                  S32 discard,
                  bool needs_aux,
                  const LLPointer<LLImageDecodeThread::Responder>& responder,
-                 U32 request_id);
+                 U32 request_id,
+                 const LLUUID& cache_id,
+                 LLImageBC::EFormat compress_format);
     virtual ~ImageRequest();
 
     /*virtual*/ bool processRequest();
     /*virtual*/ void finishRequest(bool completed);
 
 private:
+    bool readFromCache();
+    void writeToCache();
+    void compress();
+
     // LLPointers stored in ImageRequest MUST be LLPointer instances rather
     // than references: we need to increment the refcount when storing these.
     // input
@@ -52,9 +59,12 @@ private:
     S32 mDiscardLevel;
     U32 mRequestId;
     bool mNeedsAux;
+    LLUUID mCacheId;
+    LLImageBC::EFormat mCompressFormat;
     // output
     LLPointer<LLImageRaw> mDecodedImageRaw;
     LLPointer<LLImageRaw> mDecodedImageAux;
+    LLPointer<LLImageBCMips> mCompressedImage;
     bool mDecodedRaw;
     bool mDecodedAux;
     LLPointer<LLImageDecodeThread::Responder> mResponder;
@@ -67,7 +77,7 @@ private:
 LLImageDecodeThread::LLImageDecodeThread(bool /*threaded*/)
     : mDecodeCount(0)
 {
-    mThreadPool.reset(new LL::ThreadPool("ImageDecode", 8));
+    mThreadPool.reset(new LL::PriorityThreadPool("ImageDecode", 8));
     mThreadPool->start();
 }
 
@@ -92,22 +102,26 @@ LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(
     const LLPointer<LLImageFormatted>& image,
     S32 discard,
     bool needs_aux,
-    const LLPointer<LLImageDecodeThread::Responder>& responder)
+    const LLPointer<LLImageDecodeThread::Responder>& responder,
+    F32 priority,
+    const LLUUID& cache_id,
+    LLImageBC::EFormat compress_format)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
 
-    U32 decode_id = ++mDecodeCount;
-    if (decode_id == 0)
-        decode_id = ++mDecodeCount;
+    ++mDecodeCount;
+    handle_t decode_id = mThreadPool->getQueue().makeHandle();
 
     // Instantiate the ImageRequest right in the lambda, why not?
     bool posted = mThreadPool->getQueue().post(
-        [req = ImageRequest(image, discard, needs_aux, responder, decode_id)]
+        [req = ImageRequest(image, discard, needs_aux, responder, decode_id, cache_id, compress_format)]
         () mutable
         {
             auto done = req.processRequest();
             req.finishRequest(done);
-        });
+        },
+        priority,
+        decode_id);
     if (! posted)
     {
         LL_DEBUGS() << "Tried to start decoding on shutdown" << LL_ENDL;
@@ -117,6 +131,16 @@ LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(
     return decode_id;
 }
 
+bool LLImageDecodeThread::setPriority(handle_t handle, F32 priority)
+{
+    return mThreadPool->getQueue().setPriority(handle, priority);
+}
+
+bool LLImageDecodeThread::cancel(handle_t handle)
+{
+    return mThreadPool->getQueue().cancel(handle);
+}
+
 void LLImageDecodeThread::shutdown()
 {
     mThreadPool->close();
@@ -132,10 +156,14 @@ ImageRequest::ImageRequest(const LLPointer<LLImageFormatted>& image,
                            S32 discard,
                            bool needs_aux,
                            const LLPointer<LLImageDecodeThread::Responder>& responder,
-                           U32 request_id)
+                           U32 request_id,
+                           const LLUUID& cache_id,
+                           LLImageBC::EFormat compress_format)
     : mFormattedImage(image),
       mDiscardLevel(discard),
       mNeedsAux(needs_aux),
+      mCacheId(cache_id),
+      mCompressFormat(compress_format),
       mDecodedRaw(false),
       mDecodedAux(false),
       mResponder(responder),
@@ -147,6 +175,7 @@ ImageRequest::~ImageRequest()
 {
     mDecodedImageRaw = NULL;
     mDecodedImageAux = NULL;
+    mCompressedImage = NULL;
     mFormattedImage = NULL;
 }
 
@@ -186,6 +215,11 @@ bool ImageRequest::processRequest()
             {
                 mFormattedImage->setDiscardLevel(mDiscardLevel);
             }
+            if (readFromCache())
+            {
+                compress();
+                return true; // done (decode skipped)
+            }
             mDecodedImageRaw = new LLImageRaw(mFormattedImage->getWidth(),
                                               mFormattedImage->getHeight(),
                                               mFormattedImage->getComponents());
@@ -213,16 +247,83 @@ bool ImageRequest::processRequest()
         mErrorString = LLImage::getLastThreadError();
     }
 
+    if (done && mDecodedRaw && (!mNeedsAux || mDecodedAux))
+    {
+        writeToCache();
+        compress();
+    }
+
     return done;
 }
 
+bool ImageRequest::readFromCache()
+{
+    if (mCacheId.isNull() || !LLDecodedImageCache::instanceExists())
+    {
+        return false;
+    }
+
+    LLPointer<LLImageRaw> raw, aux;
+    if (!LLDecodedImageCache::getInstance()->read(mCacheId, mFormattedImage->getDiscardLevel(), mNeedsAux,
+                                                  mFormattedImage->getWidth(), mFormattedImage->getHeight(),
+                                                  mFormattedImage->getComponents(), raw, aux))
+    {
+        return false;
+    }
+
+    mDecodedImageRaw = raw;
+    mDecodedRaw = true;
+    if (mNeedsAux)
+    {
+        mDecodedImageAux = aux;
+        mDecodedAux = true;
+    }
+    return true;
+}
+
+void ImageRequest::writeToCache()
+{
+    if (mCacheId.isNull() || !LLDecodedImageCache::instanceExists())
+    {
+        return;
+    }
+
+    LLDecodedImageCache::getInstance()->queueWrite(mCacheId, mFormattedImage->getDiscardLevel(),
+                                                   mFormattedImage->getWidth(), mFormattedImage->getHeight(),
+                                                   mFormattedImage->getComponents(),
+                                                   mDecodedImageRaw, mNeedsAux ? mDecodedImageAux.get() : nullptr);
+}
+
+void ImageRequest::compress()
+{
+    if (mCompressFormat == LLImageBC::FORMAT_NONE || mDecodedImageRaw.isNull())
+    {
+        return;
+    }
+
+    // Every level down to the one LLImageGL stops its mip chain at: both
+    // sides halve until one of them is 1
+    S32 levels = 1;
+    for (S32 w = mDecodedImageRaw->getWidth(), h = mDecodedImageRaw->getHeight();
+         w > 1 && h > 1 && mFormattedImage->getDiscardLevel() + levels <= MAX_DISCARD_LEVEL;
+         w >>= 1, h >>= 1)
+    {
+        ++levels;
+    }
+
+    // null when the image can not be compressed, which leaves the upload to
+    // the uncompressed path
+    const LLImageBC::EFormat format = mDecodedImageRaw->getComponents() == 3 ? LLImageBC::FORMAT_BC1 : mCompressFormat;
+    mCompressedImage = LLImageBCMips::create(mDecodedImageRaw, format, levels);
+}
+
 void ImageRequest::finishRequest(bool completed)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
     if (mResponder.notNull())
     {
         bool success = completed && mDecodedRaw && (!mNeedsAux || mDecodedAux);
-        mResponder->completed(success, mErrorString, mDecodedImageRaw, mDecodedImageAux, mRequestId);
+        mResponder->completed(success, mErrorString, mDecodedImageRaw, mDecodedImageAux, mCompressedImage, mRequestId);
     }
     // Will automatically be deleted
 }
@@ -28,7 +28,9 @@
 #define LL_LLIMAGEWORKER_H
 
 #include "llimage.h"
+#include "llimagebc.h"
 #include "llpointer.h"
+#include "lluuid.h"
 #include "threadpool_fwd.h"
 
 class LLImageDecodeThread
@@ -39,7 +41,10 @@ public:
     protected:
         virtual ~Responder();
     public:
-        virtual void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux, U32 request_id) = 0;
+        // compressed is only set when the decode was asked for a block
+        // compressed copy and the image could be compressed.
+        virtual void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux,
+                               LLImageBCMips* compressed, U32 request_id) = 0;
     };
 
 public:
@@ -48,9 +53,22 @@ public:
 
     // meant to resemble LLQueuedThread::handle_t
     typedef U32 handle_t;
+    // Higher priority decodes run first. The returned handle can be used to
+    // reprioritize or cancel the decode until a worker picks it up.
+    // A non null cache_id lets the decode be served from, and stored to, the
+    // LLDecodedImageCache when it has been initialized.
+    // With a compress_format the decoded image is also block compressed,
+    // with its full mip chain, on the decode thread: to compress_format if
+    // it has alpha, to BC1 if it does not.
     handle_t decodeImage(const LLPointer<LLImageFormatted>& image,
                          S32 discard, bool needs_aux,
-                         const LLPointer<Responder>& responder);
+                         const LLPointer<Responder>& responder,
+                         F32 priority = 0.f,
+                         const LLUUID& cache_id = LLUUID::null,
+                         LLImageBC::EFormat compress_format = LLImageBC::FORMAT_NONE);
+    bool setPriority(handle_t handle, F32 priority);
+    // A cancelled decode never calls its Responder.
+    bool cancel(handle_t handle);
     size_t getPending();
     size_t update(F32 max_time_ms);
     S32 getTotalDecodeCount() { return mDecodeCount; }
@@ -60,7 +78,7 @@ private:
     // As of SL-17483, LLImageDecodeThread is no longer itself an
     // LLQueuedThread - instead this is the API by which we submit work to the
     // "ImageDecode" ThreadPool.
-    std::unique_ptr<LL::ThreadPool> mThreadPool;
+    std::unique_ptr<LL::PriorityThreadPool> mThreadPool;
     LLAtomicU32 mDecodeCount;
 };
 
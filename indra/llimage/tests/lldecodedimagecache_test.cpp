@@ -0,0 +1,219 @@
+/**
+ * @file   lldecodedimagecache_test.cpp
+ * @brief  Test for the decoded texture disk cache.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../lldecodedimagecache.h"
+// STL headers
+#include <vector>
+// other Linden headers
+#include "../test/lltut.h"
+#include "llimagetestutil.h"
+#include "lldir.h"
+#include "llfile.h"
+#include "lltimer.h"
+
+namespace
+{
+    // 256x256 RGBA with every level is about 350KB on disk: the cache holds
+    // two of them but not three
+    const uintmax_t CACHE_BUDGET = 900 * 1024;
+
+    // What the cache should return for a level below the one it was given
+    std::vector<U8> box_filter(const LLImageRaw* image, S32 levels)
+    {
+        S32 width = image->getWidth(), height = image->getHeight();
+        const S8 components = image->getComponents();
+        std::vector<U8> level(image->getData(), image->getData() + image->getDataSize());
+        for (S32 i = 0; i < levels; ++i)
+        {
+            width >>= 1;
+            height >>= 1;
+            std::vector<U8> mip(width * height * components);
+            LLImageBase::generateMip(level.data(), mip.data(), width, height, components);
+            level.swap(mip);
+        }
+        return level;
+    }
+
+    bool same_pixels(const LLImageRaw* image, const std::vector<U8>& expected)
+    {
+        return image && (size_t)image->getDataSize() == expected.size()
+            && memcmp(image->getData(), expected.data(), expected.size()) == 0;
+    }
+
+    std::string cache_dir()
+    {
+        static std::string dir = std::string(LLFile::tmpdir()) + "lldecodedimagecache_test_" + LLUUID::generateNewID().asString();
+        return dir;
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct lldecodedimagecache_data
+    {
+        lldecodedimagecache_data()
+        {
+            LLFile::mkdir(cache_dir());
+            if (!LLDecodedImageCache::instanceExists())
+            {
+                LLDecodedImageCache::initParamSingleton(cache_dir(), CACHE_BUDGET, false);
+            }
+            mCache = LLDecodedImageCache::getInstance();
+            mCache->clearCache();
+        }
+        ~lldecodedimagecache_data()
+        {
+            mCache->clearCache();
+            LLFile::rmdir(cache_dir());
+        }
+
+        bool read(const LLUUID& id, S32 discard, bool needs_aux, S32 full_width, S32 full_height, S8 components,
+                  LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux)
+        {
+            raw = nullptr;
+            aux = nullptr;
+            return mCache->read(id, discard, needs_aux, full_width, full_height, components, raw, aux);
+        }
+
+        LLDecodedImageCache* mCache;
+    };
+    typedef test_group<lldecodedimagecache_data> lldecodedimagecache_group;
+    typedef lldecodedimagecache_group::object object;
+    lldecodedimagecache_group lldecodedimagecachegrp("lldecodedimagecache");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("write then read every level");
+
+        const LLUUID id("0c6e4d1a-58f2-4f0e-9d5b-7a1c2e3f4a5b");
+        LLPointer<LLImageRaw> raw = make_image(256, 128, 4, 1);
+        LLPointer<LLImageRaw> aux = make_image(256, 128, 1, 2);
+        mCache->write(id, 0, 256, 128, 4, raw, aux);
+
+        LLPointer<LLImageRaw> out_raw, out_aux;
+        for (S32 discard = 0; discard <= MAX_DISCARD_LEVEL; ++discard)
+        {
+            std::string level = llformat("discard %d ", discard);
+            ensure(level + "hit", read(id, discard, true, 256, 128, 4, out_raw, out_aux));
+            ensure_equals(level + "width", (S32)out_raw->getWidth(), 256 >> discard);
+            ensure_equals(level + "height", (S32)out_raw->getHeight(), 128 >> discard);
+            ensure(level + "pixels", same_pixels(out_raw, box_filter(raw, discard)));
+            ensure(level + "aux", same_pixels(out_aux, box_filter(aux, discard)));
+        }
+
+        ensure("other size", !read(id, 0, false, 512, 256, 4, out_raw, out_aux));
+        ensure("other id", !read(LLUUID::generateNewID(), 0, false, 256, 128, 4, out_raw, out_aux));
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("only better levels replace an entry");
+
+        const LLUUID id("7d3b9a20-1e4c-4b8a-a6f5-0e2d9c8b7a61");
+        LLPointer<LLImageRaw> half = make_image(128, 128, 3, 3);
+        LLPointer<LLImageRaw> full = make_image(256, 256, 3, 4);
+        LLPointer<LLImageRaw> quarter = make_image(64, 64, 3, 5);
+
+        LLPointer<LLImageRaw> out_raw, out_aux;
+        mCache->write(id, 1, 256, 256, 3, half, nullptr);
+        ensure("nothing above the written level", !read(id, 0, false, 256, 256, 3, out_raw, out_aux));
+        ensure("no aux was written", !read(id, 1, true, 256, 256, 3, out_raw, out_aux));
+        ensure("written level", read(id, 1, false, 256, 256, 3, out_raw, out_aux));
+        ensure("written pixels", same_pixels(out_raw, box_filter(half, 0)));
+
+        mCache->write(id, 2, 256, 256, 3, quarter, nullptr);
+        ensure("worse level kept out", read(id, 2, false, 256, 256, 3, out_raw, out_aux));
+        ensure("mip of the better level", same_pixels(out_raw, box_filter(half, 1)));
+
+        mCache->write(id, 0, 256, 256, 3, full, nullptr);
+        ensure("better level replaces", read(id, 2, false, 256, 256, 3, out_raw, out_aux));
+        ensure("mip of the new level", same_pixels(out_raw, box_filter(full, 2)));
+
+        // sizes the decoder would not have produced are not cached
+        const LLUUID odd_id("4f1a2b3c-5d6e-4f70-8192-a3b4c5d6e7f8");
+        mCache->write(odd_id, 1, 256, 256, 3, quarter, nullptr);
+        ensure("mismatched level", !read(odd_id, 1, false, 256, 256, 3, out_raw, out_aux));
+        mCache->write(odd_id, 0, 32, 32, 3, make_image(32, 32, 3, 6), nullptr);
+        ensure("too small", !read(odd_id, 0, false, 32, 32, 3, out_raw, out_aux));
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("least recently used entries are evicted");
+
+        const LLUUID first("11111111-2222-4333-8444-555555555555");
+        const LLUUID second("22222222-3333-4444-8555-666666666666");
+        const LLUUID third("33333333-4444-4555-8666-777777777777");
+        LLPointer<LLImageRaw> out_raw, out_aux;
+
+        mCache->write(first, 0, 256, 256, 4, make_image(256, 256, 4, 7), nullptr);
+        mCache->write(second, 0, 256, 256, 4, make_image(256, 256, 4, 8), nullptr);
+        ensure("first", read(first, 0, false, 256, 256, 4, out_raw, out_aux));
+
+        mCache->write(third, 0, 256, 256, 4, make_image(256, 256, 4, 9), nullptr);
+        ensure("under budget", mCache->getTotalSizeBytes() <= CACHE_BUDGET);
+        ensure("recently read entry kept", read(first, 0, false, 256, 256, 4, out_raw, out_aux));
+        ensure("new entry kept", read(third, 0, false, 256, 256, 4, out_raw, out_aux));
+        ensure("oldest entry evicted", !read(second, 0, false, 256, 256, 4, out_raw, out_aux));
+        ensure("evicted file removed",
+               !LLFile::isfile(cache_dir() + gDirUtilp->getDirDelimiter() + second.asString() + ".mips"));
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("queued writes");
+
+        const LLUUID id("5a6b7c8d-9e0f-4a1b-8c2d-3e4f5a6b7c8d");
+        LLPointer<LLImageRaw> half = make_image(128, 128, 4, 10);
+        LLPointer<LLImageRaw> full = make_image(256, 256, 4, 11);
+        mCache->queueWrite(id, 1, 256, 256, 4, half, nullptr);
+        mCache->queueWrite(id, 0, 256, 256, 4, full, nullptr);
+        // written from copies
+        memset(full->getData(), 0, full->getDataSize());
+
+        LLPointer<LLImageRaw> out_raw, out_aux;
+        LLTimer timer;
+        while (!read(id, 0, false, 256, 256, 4, out_raw, out_aux) && timer.getElapsedTimeF32() < 5.f)
+        {
+            ms_sleep(1);
+        }
+        ensure("better level written", out_raw.notNull());
+        ensure("copied pixels", same_pixels(out_raw, box_filter(make_image(256, 256, 4, 11), 0)));
+
+        mCache->queueWrite(id, 1, 256, 256, 4, half, nullptr);
+        ms_sleep(50);
+        ensure("worse level dropped", read(id, 1, false, 256, 256, 4, out_raw, out_aux));
+        ensure("mip of the better level", same_pixels(out_raw, box_filter(make_image(256, 256, 4, 11), 1)));
+    }
+} // namespace tut
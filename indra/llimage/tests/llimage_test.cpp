@@ -0,0 +1,279 @@
+/**
+ * @file   llimage_test.cpp
+ * @brief  Parity tests for the SIMD image kernels in llimage.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llimage.h"
+#include "../llimagej2c.h"
+// STL headers
+#include <cstdlib>
+#include <thread>
+#include <vector>
+// other Linden headers
+#include "../test/lltut.h"
+#include "llimagetestutil.h"
+#include "workqueue.h"
+
+namespace
+{
+    // Largest per-byte difference
+    S32 max_difference(const LLImageRaw* a, const LLImageRaw* b)
+    {
+        S32 worst = 0;
+        for (S32 i = 0; i < a->getDataSize(); ++i)
+        {
+            worst = llmax(worst, abs((S32)a->getData()[i] - (S32)b->getData()[i]));
+        }
+        return worst;
+    }
+
+    // One worker for tiled encodes, the encoding thread takes tiles as well
+    struct EncodeQueue
+    {
+        LL::WorkQueue mQueue{ "llimage_test encode" };
+        std::thread mWorker{ [this]() { mQueue.runUntilClose(); } };
+
+        ~EncodeQueue()
+        {
+            mQueue.close();
+            mWorker.join();
+        }
+    };
+
+    // The tile-parts of a codestream, from their SOT markers
+    struct TilePart
+    {
+        S32 mOffset;
+        S32 mTile;
+        S32 mPart;
+    };
+
+    std::vector<TilePart> tile_parts(const LLImageJ2C* j2c)
+    {
+        std::vector<TilePart> parts;
+        const U8* data = j2c->getData();
+        for (S32 pos = 0; pos + 12 <= j2c->getDataSize(); ++pos)
+        {
+            if (data[pos] == 0xFF && data[pos + 1] == 0x90 && data[pos + 2] == 0 && data[pos + 3] == 10)
+            {
+                parts.push_back({ pos, (data[pos + 4] << 8) | data[pos + 5], data[pos + 10] });
+                pos += ((data[pos + 6] << 24) | (data[pos + 7] << 16) | (data[pos + 8] << 8) | data[pos + 9]) - 1;
+            }
+        }
+        return parts;
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llimage_data
+    {
+        ~llimage_data()
+        {
+            LLImage::setUseSIMD(true);
+        }
+    };
+    typedef test_group<llimage_data> llimage_group;
+    typedef llimage_group::object object;
+    llimage_group llimagegrp("llimage");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("generateMip SIMD matches scalar");
+
+        const S8 channels[] = { 1, 2, 3, 4 };
+        for (S8 components : channels)
+        {
+            // odd output sizes leave a scalar tail on every row
+            const S32 width = 37, height = 19;
+            LLPointer<LLImageRaw> src = make_image(width * 2, height * 2, components, components, TEST_IMAGE_NOISE_EXTREMES);
+            std::vector<U8> scalar(width * height * components), simd(width * height * components);
+
+            LLImage::setUseSIMD(false);
+            LLImageBase::generateMip(src->getData(), scalar.data(), width, height, components);
+            LLImage::setUseSIMD(true);
+            LLImageBase::generateMip(src->getData(), simd.data(), width, height, components);
+
+            ensure(llformat("%d channel mip", components), scalar == simd);
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("bilinear scaling SIMD matches scalar");
+
+        // one pair per scale_info::xup_yup case
+        const S32 sizes[][4] = {
+            { 64, 64, 200, 150 },   // up both ways
+            { 100, 30, 160, 10 },   // up horizontally, down vertically
+            { 30, 100, 10, 160 },   // down horizontally, up vertically
+            { 257, 129, 64, 33 },   // down both ways
+        };
+        const S8 channels[] = { 1, 3, 4 };
+        for (const auto& size : sizes)
+        {
+            for (S8 components : channels)
+            {
+                LLPointer<LLImageRaw> src = make_image(size[0], size[1], components, size[2], TEST_IMAGE_NOISE_EXTREMES);
+                LLPointer<LLImageRaw> scalar = new LLImageRaw(size[2], size[3], components);
+                LLPointer<LLImageRaw> simd = new LLImageRaw(size[2], size[3], components);
+
+                LLImage::setUseSIMD(false);
+                scalar->copyScaled(src);
+                LLImage::setUseSIMD(true);
+                simd->copyScaled(src);
+
+                ensure_equals(llformat("%dx%d -> %dx%d, %d channels", size[0], size[1], size[2], size[3], components),
+                              max_difference(scalar, simd), 0);
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("compositing SIMD matches scalar");
+
+        LLPointer<LLImageRaw> src = make_image(67, 33, 4, 7, TEST_IMAGE_NOISE_EXTREMES);
+        LLPointer<LLImageRaw> dst = make_image(67, 33, 3, 8);
+
+        // same size: exact integer blend
+        LLPointer<LLImageRaw> scalar = copy_image(dst);
+        LLPointer<LLImageRaw> simd = copy_image(dst);
+        LLImage::setUseSIMD(false);
+        scalar->composite(src);
+        LLImage::setUseSIMD(true);
+        simd->composite(src);
+        ensure_equals("unscaled composite", max_difference(scalar, simd), 0);
+
+        // scaled: the float sums may round differently when the compiler
+        // fuses the scalar multiply-adds, allow one step
+        LLPointer<LLImageRaw> big_src = make_image(301, 77, 4, 9, TEST_IMAGE_NOISE_EXTREMES);
+        scalar = copy_image(dst);
+        simd = copy_image(dst);
+        LLImage::setUseSIMD(false);
+        scalar->composite(big_src);
+        LLImage::setUseSIMD(true);
+        simd->composite(big_src);
+        ensure("scaled composite", max_difference(scalar, simd) <= 1);
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("tiled j2c encode");
+
+        // two tiles across, lossless so the stitched tiles must decode to
+        // the exact source pixels
+        EncodeQueue queue;
+        LLPointer<LLImageRaw> src = make_image(2 * ENCODE_TILE_SIZE, ENCODE_TILE_SIZE, 3, 10);
+        LLPointer<LLImageJ2C> j2c = new LLImageJ2C;
+        j2c->setEncodeQueue(queue.mQueue.getWeak());
+        j2c->setReversible(true);
+        ensure("encoded", j2c->encode(src, 0.f));
+        ensure_equals("width", j2c->getWidth(), 2 * ENCODE_TILE_SIZE);
+        ensure_equals("height", j2c->getHeight(), ENCODE_TILE_SIZE);
+
+        // tile-parts alternate between the tiles, lowest resolution first
+        std::vector<TilePart> parts = tile_parts(j2c);
+        ensure("tile-parts", parts.size() >= 4);
+        ensure("interleaved", parts[0].mTile == 0 && parts[1].mTile == 1 && parts[2].mTile == 0 && parts[3].mTile == 1);
+        ensure("lowest resolution first", parts[0].mPart == 0 && parts[1].mPart == 0 && parts[2].mPart == 1);
+
+        LLPointer<LLImageRaw> decoded = new LLImageRaw;
+        j2c->setDiscardLevel(0);
+        ensure("decoded", j2c->decode(decoded, 0.f));
+        ensure_equals("decoded width", decoded->getWidth(), src->getWidth());
+        ensure_equals("decoded height", decoded->getHeight(), src->getHeight());
+        ensure_equals("lossless", max_difference(src, decoded), 0);
+
+        // images of a single tile are encoded as before
+        LLPointer<LLImageRaw> small = make_image(ENCODE_TILE_SIZE, ENCODE_TILE_SIZE, 3, 11);
+        LLPointer<LLImageJ2C> untiled = new LLImageJ2C;
+        untiled->setEncodeQueue(queue.mQueue.getWeak());
+        ensure("encoded untiled", untiled->encode(small, 0.f));
+        ensure_equals("untiled width", untiled->getWidth(), ENCODE_TILE_SIZE);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("tiled j2c lossy partial decode");
+
+        EncodeQueue queue;
+        LLPointer<LLImageRaw> src = make_image(2 * ENCODE_TILE_SIZE, ENCODE_TILE_SIZE, 4, 12, TEST_IMAGE_NOISE_EXTREMES);
+        LLPointer<LLImageJ2C> j2c = new LLImageJ2C;
+        j2c->setEncodeQueue(queue.mQueue.getWeak());
+        ensure("encoded", j2c->encode(src, 0.f));
+
+        LLPointer<LLImageRaw> full = new LLImageRaw;
+        j2c->setDiscardLevel(0);
+        ensure("decoded", j2c->decode(full, 0.f));
+        ensure_equals("decoded width", full->getWidth(), src->getWidth());
+        ensure_equals("decoded components", (S32)full->getComponents(), 4);
+
+        LLPointer<LLImageRaw> reduced = new LLImageRaw;
+        j2c->setDiscardLevel(1);
+        ensure("decoded at discard 1", j2c->decode(reduced, 0.f));
+        ensure_equals("reduced width", reduced->getWidth(), ENCODE_TILE_SIZE);
+        ensure_equals("reduced height", reduced->getHeight(), ENCODE_TILE_SIZE / 2);
+
+        // Cut the stream before the first tile-part of the highest
+        // resolution, as a partial fetch would: every tile must still decode
+        // at discard 1, to the same pixels as the whole stream
+        std::vector<TilePart> parts = tile_parts(j2c);
+        S32 last_part = 0;
+        for (const TilePart& part : parts)
+        {
+            last_part = llmax(last_part, part.mPart);
+        }
+        ensure("several resolutions", last_part > 1);
+        S32 cut = 0;
+        for (const TilePart& part : parts)
+        {
+            if (part.mPart == last_part)
+            {
+                cut = part.mOffset;
+                break;
+            }
+        }
+        LLPointer<LLImageJ2C> partial = new LLImageJ2C;
+        ensure("allocated", partial->allocateData(cut) != NULL);
+        memcpy(partial->getData(), j2c->getData(), cut);
+        ensure("partial header", partial->updateData());
+
+        LLPointer<LLImageRaw> partial_reduced = new LLImageRaw;
+        partial->setDiscardLevel(1);
+        ensure("partial decoded", partial->decode(partial_reduced, 0.f));
+        ensure_equals("partial width", partial_reduced->getWidth(), reduced->getWidth());
+        ensure_equals("partial height", partial_reduced->getHeight(), reduced->getHeight());
+        ensure_equals("partial matches", max_difference(reduced, partial_reduced), 0);
+    }
+} // namespace tut
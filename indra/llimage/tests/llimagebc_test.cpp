@@ -0,0 +1,201 @@
+/**
+ * @file   llimagebc_test.cpp
+ * @brief  Test for the software block compression encoder.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llimagebc.h"
+// STL headers
+#include <cmath>
+#include <vector>
+// other Linden headers
+#include "../test/lltut.h"
+#include "llimagetestutil.h"
+
+namespace
+{
+    // Peak signal to noise ratio of the decoded RGBA pixels against the
+    // source channels
+    F64 psnr(const LLImageRaw* src, const std::vector<U8>& rgba)
+    {
+        const S32 components = src->getComponents();
+        const S32 pixels = src->getWidth() * src->getHeight();
+        F64 error = 0.0;
+        for (S32 i = 0; i < pixels; ++i)
+        {
+            for (S32 c = 0; c < components; ++c)
+            {
+                F64 d = (F64)src->getData()[i * components + c] - rgba[i * 4 + c];
+                error += d * d;
+            }
+        }
+        F64 mse = error / (pixels * components);
+        return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 100.0;
+    }
+
+    struct FormatInfo
+    {
+        LLImageBC::EFormat mFormat;
+        S8 mComponents;
+        const char* mName;
+        F64 mMinPSNR;
+    };
+
+    const FormatInfo FORMATS[] =
+    {
+        { LLImageBC::FORMAT_BC1, 3, "BC1", 28.0 },
+        { LLImageBC::FORMAT_BC3, 4, "BC3", 28.0 },
+        { LLImageBC::FORMAT_BC7, 4, "BC7", 30.0 },
+    };
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llimagebc_data
+    {
+        ~llimagebc_data()
+        {
+            LLImage::setUseSIMD(true);
+        }
+    };
+    typedef test_group<llimagebc_data> llimagebc_group;
+    typedef llimagebc_group::object object;
+    llimagebc_group llimagebcgrp("llimagebc");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("SIMD encode matches scalar");
+
+        for (const FormatInfo& info : FORMATS)
+        {
+            // partial blocks on the right and bottom edges
+            LLPointer<LLImageRaw> src = make_image(70, 38, info.mComponents, info.mFormat + 1, TEST_IMAGE_SMOOTH);
+            const S32 size = LLImageBC::getDataSize(info.mFormat, 70, 38);
+            std::vector<U8> scalar(size), simd(size);
+
+            LLImage::setUseSIMD(false);
+            ensure(std::string(info.mName) + " scalar",
+                   LLImageBC::encode(info.mFormat, src->getData(), 70, 38, info.mComponents, scalar.data()));
+            LLImage::setUseSIMD(true);
+            ensure(std::string(info.mName) + " simd",
+                   LLImageBC::encode(info.mFormat, src->getData(), 70, 38, info.mComponents, simd.data()));
+
+            ensure(std::string(info.mName) + " parity", scalar == simd);
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("decoded blocks stay close to the source");
+
+        for (const FormatInfo& info : FORMATS)
+        {
+            LLPointer<LLImageRaw> src = make_image(128, 64, info.mComponents, 11, TEST_IMAGE_SMOOTH);
+            std::vector<U8> compressed(LLImageBC::getDataSize(info.mFormat, 128, 64));
+            std::vector<U8> rgba(128 * 64 * 4);
+            LLImageBC::encode(info.mFormat, src->getData(), 128, 64, info.mComponents, compressed.data());
+            ensure(std::string(info.mName) + " decode",
+                   LLImageBC::decode(info.mFormat, compressed.data(), 128, 64, rgba.data()));
+
+            F64 quality = psnr(src, rgba);
+            ensure(llformat("%s PSNR %.2f", info.mName, quality), quality >= info.mMinPSNR);
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("solid blocks");
+
+        U8 rgba[LLImageBC::BLOCK_PIXELS * 4];
+        for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+        {
+            rgba[i * 4 + 0] = 200;
+            rgba[i * 4 + 1] = 17;
+            rgba[i * 4 + 2] = 99;
+            rgba[i * 4 + 3] = 77;
+        }
+
+        U8 block[16];
+        U8 decoded[LLImageBC::BLOCK_PIXELS * 4];
+        for (const FormatInfo& info : FORMATS)
+        {
+            LLImageBC::encodeBlock(info.mFormat, rgba, block);
+            ensure(std::string(info.mName) + " decode", LLImageBC::decodeBlock(info.mFormat, block, decoded));
+
+            // within the endpoint precision: 5 or 6 bits for BC1 and BC3
+            // colors, 7 bits and a p-bit for BC7
+            const S32 tolerance = info.mFormat == LLImageBC::FORMAT_BC7 ? 1 : 4;
+            for (S32 i = 0; i < LLImageBC::BLOCK_PIXELS; ++i)
+            {
+                for (S32 c = 0; c < 3; ++c)
+                {
+                    ensure(llformat("%s pixel %d channel %d", info.mName, i, c),
+                           abs((S32)decoded[i * 4 + c] - (S32)rgba[i * 4 + c]) <= tolerance);
+                }
+                // BC1 is opaque, BC3 alpha endpoints are exact
+                const S32 alpha = info.mFormat == LLImageBC::FORMAT_BC1 ? 255 : 77;
+                ensure(llformat("%s pixel %d alpha", info.mName, i),
+                       abs((S32)decoded[i * 4 + 3] - alpha) <= (info.mFormat == LLImageBC::FORMAT_BC7 ? 1 : 0));
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("mip chain layout");
+
+        LLPointer<LLImageRaw> src = make_image(64, 32, 4, 5, TEST_IMAGE_SMOOTH);
+        LLPointer<LLImageBCMips> mips = LLImageBCMips::create(src, LLImageBC::FORMAT_BC7, 6);
+        ensure("created", mips.notNull());
+        ensure_equals("levels", mips->getLevels(), 6);
+
+        // 64x32 down to 2x1, levels under 4x4 still take a whole block
+        S32 total = 0;
+        const S32 expected_sizes[] = { 2048, 512, 128, 32, 16, 16 };
+        for (S32 level = 0; level < 6; ++level)
+        {
+            ensure_equals(llformat("level %d size", level), mips->getLevelSize(level), expected_sizes[level]);
+            total += expected_sizes[level];
+        }
+        ensure_equals("data size", mips->getDataSize(), total);
+        ensure("smallest level first", mips->getLevelData(5) < mips->getLevelData(4));
+        ensure("level 0 last", mips->getLevelData(0) + mips->getLevelSize(0) == mips->getLevelData(5) + total);
+
+        // level 0 is the image itself
+        std::vector<U8> level0(LLImageBC::getDataSize(LLImageBC::FORMAT_BC7, 64, 32));
+        LLImageBC::encode(LLImageBC::FORMAT_BC7, src->getData(), 64, 32, 4, level0.data());
+        ensure("level 0 data", memcmp(level0.data(), mips->getLevelData(0), level0.size()) == 0);
+
+        ensure("more levels than halvings", LLImageBCMips::create(src, LLImageBC::FORMAT_BC7, 7).isNull());
+        ensure("not a power of two", LLImageBCMips::create(make_image(48, 32, 4, 6, TEST_IMAGE_SMOOTH), LLImageBC::FORMAT_BC7, 1).isNull());
+        ensure("alpha needs BC3 or BC7", LLImageBCMips::create(src, LLImageBC::FORMAT_BC1, 1).isNull());
+    }
+} // namespace tut
@@ -0,0 +1,152 @@
+/**
+ * @file   llimagebufferpool_test.cpp
+ * @brief  Test for the image data buffer pool.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llimagebufferpool.h"
+#include "../llimage.h"
+// STL headers
+#include <algorithm>
+#include <thread>
+// other Linden headers
+#include "llmemory.h"
+#include "../test/lltut.h"
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llimagebufferpool_data
+    {
+        S64 mMaxBytes;
+
+        llimagebufferpool_data()
+        {
+            mMaxBytes = LLImageBufferPool::getMaxBytes();
+        }
+
+        ~llimagebufferpool_data()
+        {
+            LLImageBufferPool::setMaxBytes(mMaxBytes);
+            LLImageBufferPool::clear();
+        }
+    };
+    typedef test_group<llimagebufferpool_data> llimagebufferpool_group;
+    typedef llimagebufferpool_group::object object;
+    llimagebufferpool_group llimagebufferpoolgrp("llimagebufferpool");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("size classes");
+
+        ensure_equals("too small", LLImageBufferPool::getSizeClass(32 * 32 * 3), -1);
+        ensure_equals("too large", LLImageBufferPool::getSizeClass(4096 * 4096 * 3), -1);
+        ensure_equals("odd size", LLImageBufferPool::getSizeClass(100 * 100 * 4), -1);
+        ensure_equals("five times", LLImageBufferPool::getSizeClass(64 * 64 * 5), -1);
+
+        // 64x64x4 and 128x128x1 share a class, RGB has its own
+        S32 rgba = LLImageBufferPool::getSizeClass(64 * 64 * 4);
+        ensure("rgba", rgba >= 0);
+        ensure_equals("alpha", LLImageBufferPool::getSizeClass(128 * 128 * 1), rgba);
+        S32 rgb = LLImageBufferPool::getSizeClass(64 * 64 * 3);
+        ensure("rgb", rgb >= 0 && rgb != rgba);
+        ensure("largest", LLImageBufferPool::getSizeClass(2048 * 2048 * 4) >= 0);
+        ensure("largest rgb", LLImageBufferPool::getSizeClass(2048 * 2048 * 3) >= 0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("reuse and cap");
+
+        LLImageBufferPool::setMaxBytes(1024 * 1024);
+        const S32 size = 256 * 256 * 3;
+        U8* data = LLImageBufferPool::allocate(size);
+        ensure("allocated", data != nullptr);
+        ensure("aligned", ((uintptr_t)data & 15) == 0);
+
+        const S64 cached = LLImageBufferPool::getCachedBytes();
+        LLImageBufferPool::release(data, size);
+        ensure_equals("cached", LLImageBufferPool::getCachedBytes(), cached + size);
+
+        const U64 hits = LLImageBufferPool::getHits();
+        ensure("reused", LLImageBufferPool::allocate(size) == data);
+        ensure_equals("hit", LLImageBufferPool::getHits(), hits + 1);
+        ensure_equals("not cached", LLImageBufferPool::getCachedBytes(), cached);
+
+        // over the cap, the buffer is freed
+        U8* big = LLImageBufferPool::allocate(1024 * 1024);
+        LLImageBufferPool::release(data, size);
+        LLImageBufferPool::release(big, 1024 * 1024);
+        ensure("capped", LLImageBufferPool::getCachedBytes() <= 1024 * 1024);
+
+        // disabled: straight to the heap, and this thread's buffers are
+        // dropped on its next call
+        const S64 before = LLImageBufferPool::getCachedBytes();
+        LLImageBufferPool::setMaxBytes(0);
+        const U64 misses = LLImageBufferPool::getMisses();
+        data = LLImageBufferPool::allocate(size);
+        ensure("thread buffers dropped", LLImageBufferPool::getCachedBytes() <= before - size);
+        LLImageBufferPool::release(data, size);
+        ensure_equals("no miss when disabled", LLImageBufferPool::getMisses(), misses);
+        ensure("not cached when disabled", LLImageBufferPool::getCachedBytes() <= before - size);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("shared between threads");
+
+        LLImageBufferPool::setMaxBytes(16 * 1024 * 1024);
+        const S32 size = 128 * 128 * 4;
+
+        // past its own few buffers, a thread shares the rest
+        std::vector<U8*> released;
+        std::thread producer([&released, size]()
+        {
+            for (S32 i = 0; i < 4; ++i)
+            {
+                released.push_back(LLImageBufferPool::allocate(size));
+            }
+            for (U8* data : released)
+            {
+                LLImageBufferPool::release(data, size);
+            }
+        });
+        producer.join();
+
+        U8* data = LLImageBufferPool::allocate(size);
+        ensure("shared buffer", std::find(released.begin(), released.end(), data) != released.end());
+        LLImageBufferPool::release(data, size);
+
+        // raw images draw on the pool
+        const U64 hits = LLImageBufferPool::getHits();
+        LLPointer<LLImageRaw> raw = new LLImageRaw(128, 128, 4);
+        ensure("raw image from the pool", LLImageBufferPool::getHits() > hits);
+        raw = nullptr;
+    }
+} // namespace tut
@@ -0,0 +1,180 @@
+/**
+ * @file   llimagefilter_test.cpp
+ * @brief  Test for the fused, vectorized and banded paths of LLImageFilter.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llimagefilter.h"
+// STL headers
+#include <thread>
+#include <vector>
+// other Linden headers
+#include "../test/lltut.h"
+#include "../test/namedtempfile.h"
+#include "llimagetestutil.h"
+#include "llsdserialize.h"
+#include "llsdutil.h"
+#include "workqueue.h"
+
+namespace
+{
+    bool same_pixels(const LLImageRaw* a, const LLImageRaw* b)
+    {
+        return a->getDataSize() == b->getDataSize() && memcmp(a->getData(), b->getData(), a->getDataSize()) == 0;
+    }
+
+    LLSD make_step(std::initializer_list<LLSD> values)
+    {
+        LLSD step = LLSD::emptyArray();
+        for (const LLSD& value : values)
+        {
+            step.append(value);
+        }
+        return step;
+    }
+
+    void run_filter(const LLSD& steps, LLImageRaw* image, LL::WorkQueueBase* queue = nullptr)
+    {
+        NamedExtTempFile file("xml", [&steps](std::ostream& out) { LLSDSerialize::toPrettyXML(steps, out); });
+        LLImageFilter filter(file.getName());
+        filter.executeFilter(image, queue);
+    }
+
+    // Runs each step as its own filter, scalar and on the calling thread,
+    // with the stencil that was current for it
+    void run_steps_one_by_one(const LLSD& steps, LLImageRaw* image)
+    {
+        LLSD stencil;
+        for (const LLSD& step : llsd::inArray(steps))
+        {
+            if (step[0].asString() == "stencil")
+            {
+                stencil = step;
+                continue;
+            }
+            LLSD filter = LLSD::emptyArray();
+            if (stencil.isDefined())
+            {
+                filter.append(stencil);
+            }
+            filter.append(step);
+            run_filter(filter, image);
+        }
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llimagefilter_data
+    {
+        llimagefilter_data()
+        {
+            mSavedMinPixels = LLImageFilter::sParallelMinPixels;
+        }
+        ~llimagefilter_data()
+        {
+            LLImageFilter::sParallelMinPixels = mSavedMinPixels;
+            LLImage::setUseSIMD(true);
+        }
+
+        S32 mSavedMinPixels;
+    };
+    typedef test_group<llimagefilter_data> llimagefilter_group;
+    typedef llimagefilter_group::object object;
+    llimagefilter_group llimagefiltergrp("llimagefilter");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("fused parallel filter matches step by step");
+
+        // a bit of everything the shipped filters use
+        LLSD steps = LLSD::emptyArray();
+        steps.append(make_step({ "gamma", 1.5, 1.0, 1.0, 1.0 }));
+        steps.append(make_step({ "contrast", 1.4, 1.0, 0.5, 1.0 }));
+        steps.append(make_step({ "stencil", "vignette", "blend", 0.0, 1.0, 0.2, -0.1, 1.3, 2.0 }));
+        steps.append(make_step({ "colorize", 1.0, 0.2, 0.2, 0.5, 0.5, 0.5 }));
+        steps.append(make_step({ "sepia" }));
+        steps.append(make_step({ "blur" }));
+        steps.append(make_step({ "stencil", "gradient", "add", 0.0, 0.6, -1.0, -1.0, 1.0, 1.0 }));
+        steps.append(make_step({ "saturate", 1.6 }));
+        steps.append(make_step({ "sharpen" }));
+        steps.append(make_step({ "stencil", "uniform", "fade", 0.3, 0.9 }));
+        steps.append(make_step({ "brighten", 0.1, 1.0, 1.0, 1.0 }));
+        steps.append(make_step({ "darken", 0.05, 1.0, 1.0, 1.0 }));
+        steps.append(make_step({ "screen", "line", 0.03, 10.0 }));
+
+        LL::WorkQueue queue("llimagefilter_test");
+        std::vector<std::thread> workers;
+        for (S32 i = 0; i < 3; ++i)
+        {
+            workers.emplace_back([&queue]() { queue.runUntilClose(); });
+        }
+
+        const S8 channels[] = { 3, 4 };
+        for (S8 components : channels)
+        {
+            LLPointer<LLImageRaw> src = make_image(301, 157, components, components);
+
+            LLPointer<LLImageRaw> expected = copy_image(src);
+            LLImage::setUseSIMD(false);
+            run_steps_one_by_one(steps, expected);
+
+            LLPointer<LLImageRaw> fused = copy_image(src);
+            LLImage::setUseSIMD(true);
+            LLImageFilter::sParallelMinPixels = 0;
+            run_filter(steps, fused, &queue);
+
+            ensure(llformat("%d channels", components), same_pixels(expected, fused));
+        }
+
+        queue.close();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("histogram filters see earlier steps");
+
+        // linearize reads the histogram of what the steps before it produced
+        LLSD steps = LLSD::emptyArray();
+        steps.append(make_step({ "contrast", 0.3, 1.0, 1.0, 1.0 }));
+        steps.append(make_step({ "linearize", 0.05, 1.0, 1.0, 1.0 }));
+
+        LLPointer<LLImageRaw> src = make_image(64, 48, 3, 5);
+        LLPointer<LLImageRaw> expected = copy_image(src);
+        run_steps_one_by_one(steps, expected);
+        LLPointer<LLImageRaw> fused = copy_image(src);
+        run_filter(steps, fused);
+
+        ensure("same result", same_pixels(expected, fused));
+    }
+} // namespace tut
@@ -0,0 +1,228 @@
+/**
+ * @file   llimageingest_test.cpp
+ * @brief  Test for the local image file ingest pipeline.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llimageingest.h"
+#include "../llimagetga.h"
+// STL headers
+#include <vector>
+// other Linden headers
+#include "llfile.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "../test/lltut.h"
+
+namespace
+{
+    // A width x height RGB TGA file, removed at the end of the test
+    struct TempTGA
+    {
+        std::string mFilename;
+
+        TempTGA(S32 width, S32 height, const std::string& exten = "tga")
+        {
+            mFilename = std::string(LLFile::tmpdir()) + "llimageingest_test_" + LLUUID::generateNewID().asString() + "." + exten;
+
+            LLPointer<LLImageRaw> raw = new LLImageRaw(width, height, 3);
+            U8* data = raw->getData();
+            for (S32 i = 0; i < width * height * 3; ++i)
+            {
+                data[i] = (U8)(i * 7);
+            }
+            LLPointer<LLImageTGA> tga = new LLImageTGA;
+            tga->encode(raw);
+            tga->save(mFilename);
+        }
+
+        ~TempTGA()
+        {
+            LLFile::remove(mFilename);
+        }
+    };
+
+    struct responder_test : public LLImageIngestThread::Responder
+    {
+        std::vector<LLImageIngestThread::EStage> mStages;
+        bool mCompleted = false;
+        LLImageIngestThread::Result mResult;
+
+        void progress(LLImageIngestThread::handle_t handle, LLImageIngestThread::EStage stage) override
+        {
+            mStages.push_back(stage);
+        }
+
+        void completed(LLImageIngestThread::handle_t handle, const LLImageIngestThread::Result& result) override
+        {
+            mCompleted = true;
+            mResult = result;
+        }
+    };
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llimageingest_data
+    {
+    };
+    typedef test_group<llimageingest_data> llimageingest_group;
+    typedef llimageingest_group::object object;
+    llimageingest_group llimageingestgrp("llimageingest");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("codec signatures");
+
+        const U8 png[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A, 0, 0, 0, 0x0D };
+        const U8 jpeg[] = { 0xFF, 0xD8, 0xFF, 0xE0, 0, 0x10, 'J', 'F', 'I', 'F', 0, 1 };
+        const U8 j2c[] = { 0xFF, 0x4F, 0xFF, 0x51, 0, 0x2F, 0, 0, 0, 0, 0, 0 };
+        const U8 bmp[] = { 'B', 'M', 0x36, 0x10, 0, 0, 0, 0, 0, 0, 0x36, 0 };
+        const U8 text[] = { 'B', 'M', 'x', ' ', 'i', 's', ' ', 'n', 'o', 't', ' ', 'a' };
+
+        ensure_equals("png", LLImageBase::getCodecFromData(png, sizeof(png)), IMG_CODEC_PNG);
+        ensure_equals("jpeg", LLImageBase::getCodecFromData(jpeg, sizeof(jpeg)), IMG_CODEC_JPEG);
+        ensure_equals("j2c", LLImageBase::getCodecFromData(j2c, sizeof(j2c)), IMG_CODEC_J2C);
+        ensure_equals("bmp", LLImageBase::getCodecFromData(bmp, sizeof(bmp)), IMG_CODEC_BMP);
+        ensure_equals("text", LLImageBase::getCodecFromData(text, sizeof(text)), IMG_CODEC_INVALID);
+        ensure_equals("truncated png", LLImageBase::getCodecFromData(png, 4), IMG_CODEC_INVALID);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("ingest a file");
+
+        // TGA has no signature, the extension is used
+        TempTGA file(100, 60);
+        LLImageIngestThread::Request request;
+        request.mFilename = file.mFilename;
+        request.mMaxDimension = 64;
+        request.mEncode = false;
+
+        std::vector<LLImageIngestThread::EStage> stages;
+        LLImageIngestThread::Result result;
+        ensure("ingested", LLImageIngestThread::ingestFile(request, result,
+            [&stages](LLImageIngestThread::EStage stage) { stages.push_back(stage); return true; }));
+        ensure_equals("codec", result.mCodec, (U8)IMG_CODEC_TGA);
+        ensure_equals("original width", result.mOriginalWidth, 100);
+        ensure_equals("original height", result.mOriginalHeight, 60);
+        ensure("not fitted", !result.mFitted);
+        ensure_equals("width", result.mRawImage->getWidth(), 64);
+        ensure_equals("height", result.mRawImage->getHeight(), 64);
+        ensure("not encoded", result.mEncodedImage.isNull());
+        ensure_equals("stages", stages.size(), (size_t)3);
+        ensure("stage order", stages[0] == LLImageIngestThread::STAGE_PROBED &&
+                              stages[1] == LLImageIngestThread::STAGE_DECODED &&
+                              stages[2] == LLImageIngestThread::STAGE_SCALED);
+
+        // fitted to 32 x 16 first, keeping the aspect ratio
+        request.mMaxWidth = 32;
+        request.mMaxHeight = 32;
+        ensure("fitted", LLImageIngestThread::ingestFile(request, result));
+        ensure("fitted flag", result.mFitted);
+        ensure_equals("fitted width", result.mRawImage->getWidth(), 32);
+        ensure_equals("fitted height", result.mRawImage->getHeight(), 16);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("rejection and cancellation");
+
+        TempTGA file(40, 20);
+        LLImageIngestThread::Request request;
+        request.mFilename = file.mFilename;
+        request.mEncode = false;
+        request.mMinDimension = 32;
+
+        // rejected from the header, before decoding
+        bool decoded = false;
+        LLImageIngestThread::Result result;
+        ensure("too small", !LLImageIngestThread::ingestFile(request, result,
+            [&decoded](LLImageIngestThread::EStage stage) { decoded = true; return true; }));
+        ensure("no stage", !decoded);
+        ensure("error", !result.mError.empty());
+
+        request.mMinDimension = 0;
+        ensure("cancelled", !LLImageIngestThread::ingestFile(request, result,
+            [](LLImageIngestThread::EStage stage) { return stage != LLImageIngestThread::STAGE_DECODED; }));
+        ensure("no image", result.mRawImage.isNull());
+
+        request.mFilename += ".missing.tga";
+        ensure("missing file", !LLImageIngestThread::ingestFile(request, result));
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("threaded ingest");
+
+        // mislabelled: the contents are a TGA, the extension says PNG, so
+        // both the signature check and the fallback run
+        TempTGA tga(64, 64);
+        TempTGA png(64, 64, "png");
+        LLImageIngestThread thread;
+
+        LLImageIngestThread::Request request;
+        request.mFilename = tga.mFilename;
+        request.mEncode = false;
+        LLPointer<responder_test> good = new responder_test;
+        LLImageIngestThread::handle_t handle = thread.ingest(request, good);
+        ensure("handle", handle != 0);
+
+        request.mFilename = png.mFilename;
+        LLPointer<responder_test> bad = new responder_test;
+        thread.ingest(request, bad);
+
+        LLTimer timer;
+        while (thread.update(10.f) && timer.getElapsedTimeF32() < 10.f)
+        {
+            ms_sleep(10);
+        }
+        ensure("completed", good->mCompleted && bad->mCompleted);
+        ensure("success", good->mResult.mSuccess);
+        ensure_equals("progress", good->mStages.size(), (size_t)3);
+        ensure("wrong codec", !bad->mResult.mSuccess);
+        ensure_equals("nothing pending", thread.getPending(), (size_t)0);
+
+        // cancelled ingests never complete
+        request.mFilename = tga.mFilename;
+        LLPointer<responder_test> cancelled = new responder_test;
+        handle = thread.ingest(request, cancelled);
+        ensure("cancel", thread.cancel(handle));
+        timer.reset();
+        while (thread.update(10.f) && timer.getElapsedTimeF32() < 10.f)
+        {
+            ms_sleep(10);
+        }
+        ensure("not completed", !cancelled->mCompleted);
+
+        thread.shutdown();
+    }
+} // namespace tut
@@ -0,0 +1,83 @@
+/**
+ * @file   llimagetestutil.h
+ * @brief  Test images shared by the llimage tests.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLIMAGETESTUTIL_H)
+#define LL_LLIMAGETESTUTIL_H
+
+#include "../llimage.h"
+
+#include <cmath>
+
+enum ETestImage
+{
+    // Uniform noise
+    TEST_IMAGE_NOISE,
+    // Noise, with a few fully transparent and fully opaque pixels so the
+    // compositing shortcuts get exercised
+    TEST_IMAGE_NOISE_EXTREMES,
+    // Smooth gradients with a little noise, roughly what photographic
+    // textures look like to a block encoder
+    TEST_IMAGE_SMOOTH
+};
+
+// The same seed always gives the same image
+inline LLPointer<LLImageRaw> make_image(S32 width, S32 height, S8 components, U32 seed,
+                                        ETestImage pattern = TEST_IMAGE_NOISE)
+{
+    LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+    U8* data = image->getData();
+    U32 state = seed * 2654435761u + 1;
+    for (S32 y = 0; y < height; ++y)
+    {
+        for (S32 x = 0; x < width; ++x)
+        {
+            for (S32 c = 0; c < components; ++c)
+            {
+                state = state * 1664525u + 1013904223u;
+                U8 value = U8(state >> 24);
+                if (pattern == TEST_IMAGE_NOISE_EXTREMES && c == 3 && (state & 0x300) == 0)
+                {
+                    value = (state & 0x400) ? 255 : 0;
+                }
+                else if (pattern == TEST_IMAGE_SMOOTH)
+                {
+                    F32 wave = sinf((x * (c + 1) + y * (3 - c % 3)) * 0.05f + c);
+                    S32 smooth = (S32)(127.5f + 127.5f * wave) + (S32)(state >> 29) - 4;
+                    value = (U8)llclamp(smooth, 0, 255);
+                }
+                *data++ = value;
+            }
+        }
+    }
+    return image;
+}
+
+inline LLPointer<LLImageRaw> copy_image(const LLImageRaw* src)
+{
+    return new LLImageRaw(const_cast<U8*>(src->getData()), src->getWidth(), src->getHeight(), src->getComponents());
+}
+
+#endif /* ! defined(LL_LLIMAGETESTUTIL_H) */
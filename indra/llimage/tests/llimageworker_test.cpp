@@ -29,6 +29,7 @@
 #include "linden_common.h"
 // Class to test
 #include "../llimageworker.h"
+#include "../lldecodedimagecache.h"
 // For timer class
 #include "../llcommon/lltimer.h"
 // for lltrace class
@@ -70,6 +71,11 @@ const U8* LLImageBase::getData() const { return NULL; }
 U8* LLImageBase::getData() { return NULL; }
 const std::string& LLImage::getLastThreadError() { static std::string msg; return msg; }
 
+bool LLDecodedImageCache::read(const LLUUID&, S32, bool, S32, S32, S8, LLPointer<LLImageRaw>&, LLPointer<LLImageRaw>&) { return false; }
+void LLDecodedImageCache::queueWrite(const LLUUID&, S32, S32, S32, S8, const LLImageRaw*, const LLImageRaw*) { }
+
+LLPointer<LLImageBCMips> LLImageBCMips::create(const LLImageRaw*, LLImageBC::EFormat, S32) { return nullptr; }
+
 // End Stubbing
 // -------------------------------------------------------------------------------------------
 
@@ -99,7 +105,8 @@ namespace tut
                 done = res;
                 *done = false;
             }
-            virtual void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux, U32 request_id)
+            virtual void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux,
+                                   LLImageBCMips* compressed, U32 request_id)
             {
                 *done = true;
             }
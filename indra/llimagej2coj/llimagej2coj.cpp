@@ -31,6 +31,9 @@
 #include "openjpeg.h"
 
 #include "lltimer.h"
+#include "workqueue.h"
+
+#include <atomic>
 
 struct LLJp2StreamReader
 {
@@ -215,11 +218,116 @@ int ceildivpow2(int a, int b)
     return (a + (1 << b) - 1) >> b;
 }
 
+// OpenJPEG decoder kept alive between decodes of the same codestream.
+//
+// The texture pipeline decodes the same LLImageJ2C several times: once for
+// the color channels and once more for the aux channel, and again at a finer
+// discard level when a texture whose data is already complete gets closer.
+// For single tile codestreams OpenJPEG lets us call opj_decode() again on
+// the same codec with another reduce factor, which skips reparsing the main
+// header and rereading the tile data, and a repeat decode at the same
+// reduce factor needs no work at all since the last image is still here.
+// When more bytes arrive the codestream changes and we start over: OpenJPEG
+// has no way to resume code-block decoding on appended data.
+struct LLImageJ2COJ::DecodeState
+{
+    DecodeState(LLImageJ2C* image) : mReader(image) { }
+    ~DecodeState()
+    {
+        if (mCodec && mStream)
+        {
+            opj_end_decompress(mCodec, mStream);
+        }
+        if (mImage)
+        {
+            opj_image_destroy(mImage);
+        }
+        if (mStream)
+        {
+            opj_stream_destroy(mStream);
+        }
+        if (mCodec)
+        {
+            opj_destroy_codec(mCodec);
+        }
+        sRetainedBytes -= mRetainedBytes;
+    }
+
+    // Cheap identity check for the codestream: the fetcher replaces the
+    // buffer whenever data is appended, and new data lands at the end.
+    static U32 fingerprint(LLImageJ2C& base)
+    {
+        const U8* data = base.getData();
+        S32 size = base.getDataSize();
+        U32 hash = (U32)size;
+        for (S32 i = llmax(0, size - 64); i < size; ++i)
+        {
+            hash = hash * 31 + data[i];
+        }
+        return hash;
+    }
+
+    bool matches(LLImageJ2C& base) const
+    {
+        return mData == base.getData() && mDataSize == base.getDataSize() && mFingerprint == fingerprint(base);
+    }
+
+    void remember(LLImageJ2C& base)
+    {
+        mData = base.getData();
+        mDataSize = base.getDataSize();
+        mFingerprint = fingerprint(base);
+    }
+
+    // Decoded image plus the tile buffers OpenJPEG keeps for it, 32 bits
+    // per sample each
+    S64 estimateBytes() const
+    {
+        S64 bytes = 0;
+        for (U32 comp = 0; mImage && comp < mImage->numcomps; ++comp)
+        {
+            bytes += (S64)mImage->comps[comp].w * mImage->comps[comp].h * sizeof(OPJ_INT32) * 2;
+        }
+        return bytes;
+    }
+
+    // Returns false if keeping this decoder would exceed the global budget
+    bool retain()
+    {
+        S64 bytes = estimateBytes();
+        if (sRetainedBytes + bytes - mRetainedBytes > sMaxRetainedDecodeBytes)
+        {
+            return false;
+        }
+        sRetainedBytes += bytes - mRetainedBytes;
+        mRetainedBytes = bytes;
+        return true;
+    }
+
+    LLJp2StreamReader mReader;
+    opj_codec_t* mCodec = nullptr;
+    opj_stream_t* mStream = nullptr;
+    opj_image_t* mImage = nullptr;
+    const U8* mData = nullptr;
+    S32 mDataSize = 0;
+    U32 mFingerprint = 0;
+    S32 mReduce = -1;
+    bool mSingleTile = false;
+    S64 mRetainedBytes = 0;
+
+    static std::atomic<S64> sRetainedBytes;
+};
+
+std::atomic<S64> LLImageJ2COJ::DecodeState::sRetainedBytes{ 0 };
+S64 LLImageJ2COJ::sMaxRetainedDecodeBytes = 64 * 1024 * 1024;
+
 LLImageJ2COJ::LLImageJ2COJ()
     : LLImageJ2CImpl()
 {
 }
 
+LLImageJ2COJ::~LLImageJ2COJ() = default;
+
 bool LLImageJ2COJ::initDecode(LLImageJ2C &base, LLImageRaw &raw_image, int discard_level, int* region)
 {
     // No specific implementation for this method in the OpenJpeg case
@@ -275,70 +383,96 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
     //    ++position;
     //}
 
-    opj_dparameters_t parameters;   /* decompression parameters */
-    opj_image_t *image = NULL;
+    S32 reduce = base.getRawDiscardLevel();
+    opj_image_t* image = NULL;
+    bool success = false;
 
-    /* set decoding parameters to default values */
-    opj_set_default_decoder_parameters(&parameters);
+    /* reuse the decoder left by the last decode of this codestream */
+    if (mDecodeState && mDecodeState->matches(base))
+    {
+        DecodeState& state = *mDecodeState;
+        success = (reduce == state.mReduce) ||
+                  (opj_set_decoded_resolution_factor(state.mCodec, reduce) &&
+                   opj_decode(state.mCodec, state.mStream, state.mImage));
+        if (success)
+        {
+            state.mReduce = reduce;
+            image = state.mImage;
+        }
+    }
 
-    parameters.cp_reduce = base.getRawDiscardLevel();
+    if (!image)
+    {
+        mDecodeState = std::make_unique<DecodeState>(&base);
+        DecodeState& state = *mDecodeState;
 
-    /* decode the code-stream */
-    /* ---------------------- */
+        opj_dparameters_t parameters;   /* decompression parameters */
 
-    /* JPEG-2000 codestream */
+        /* set decoding parameters to default values */
+        opj_set_default_decoder_parameters(&parameters);
 
-    /* get a decoder handle */
-    opj_codec_t* opj_decoder_p = opj_create_decompress(OPJ_CODEC_J2K);
-    if (!opj_decoder_p)
-    {
+        parameters.cp_reduce = reduce;
+
+        /* decode the code-stream */
+        /* ---------------------- */
+
+        /* JPEG-2000 codestream */
+
+        /* get a decoder handle */
+        state.mCodec = opj_create_decompress(OPJ_CODEC_J2K);
+        if (!state.mCodec)
+        {
 #ifdef SHOW_DEBUG
-        LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to create decoder!" << LL_ENDL;
+            LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to create decoder!" << LL_ENDL;
 #endif
-        base.decodeFailed();
-        return true; // done
-    }
+            mDecodeState.reset();
+            base.decodeFailed();
+            return true; // done
+        }
 
 #if 0
-    /* catch events using our callbacks and give a local context */
-    opj_set_error_handler(opj_decoder_p, error_callback, nullptr);
-    opj_set_warning_handler(opj_decoder_p, warning_callback, nullptr);
-    opj_set_info_handler(opj_decoder_p, info_callback, nullptr);
+        /* catch events using our callbacks and give a local context */
+        opj_set_error_handler(state.mCodec, error_callback, nullptr);
+        opj_set_warning_handler(state.mCodec, warning_callback, nullptr);
+        opj_set_info_handler(state.mCodec, info_callback, nullptr);
 #endif
 
-    /* setup the decoder decoding parameters using user parameters */
-    if (!opj_setup_decoder(opj_decoder_p, &parameters))
-    {
+        /* setup the decoder decoding parameters using user parameters */
+        if (!opj_setup_decoder(state.mCodec, &parameters))
+        {
 #ifdef SHOW_DEBUG
-        LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to decode image!" << LL_ENDL;
+            LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to decode image!" << LL_ENDL;
 #endif
-        opj_destroy_codec(opj_decoder_p);
-        base.decodeFailed();
-        return true; // done
-    }
-
-    //opj_decoder_set_strict_mode(opj_decoder_p, OPJ_FALSE);
-
-    /* open a byte stream */
-    LLJp2StreamReader streamReader(&base);
-    opj_stream_t* opj_stream_p = opj_stream_default_create(OPJ_STREAM_READ);
-    opj_stream_set_read_function(opj_stream_p, LLJp2StreamReader::readStream);
-    opj_stream_set_skip_function(opj_stream_p, LLJp2StreamReader::skipStream);
-    opj_stream_set_seek_function(opj_stream_p, LLJp2StreamReader::seekStream);
-    opj_stream_set_user_data(opj_stream_p, &streamReader, nullptr);
-    opj_stream_set_user_data_length(opj_stream_p, base.getDataSize());
+            mDecodeState.reset();
+            base.decodeFailed();
+            return true; // done
+        }
 
-    /* decode the stream and fill the image structure */
-    bool success = opj_read_header(opj_stream_p, opj_decoder_p, &image) &&
-                    opj_decode(opj_decoder_p, opj_stream_p, image) &&
-                    opj_end_decompress(opj_decoder_p, opj_stream_p);
+        //opj_decoder_set_strict_mode(state.mCodec, OPJ_FALSE);
 
-    /* close the byte stream */
-    opj_stream_destroy(opj_stream_p);
+        /* open a byte stream */
+        state.mStream = opj_stream_default_create(OPJ_STREAM_READ);
+        opj_stream_set_read_function(state.mStream, LLJp2StreamReader::readStream);
+        opj_stream_set_skip_function(state.mStream, LLJp2StreamReader::skipStream);
+        opj_stream_set_seek_function(state.mStream, LLJp2StreamReader::seekStream);
+        opj_stream_set_user_data(state.mStream, &state.mReader, nullptr);
+        opj_stream_set_user_data_length(state.mStream, base.getDataSize());
 
-    /* free remaining structures */
-    opj_destroy_codec(opj_decoder_p);
+        /* decode the stream and fill the image structure */
+        success = opj_read_header(state.mStream, state.mCodec, &state.mImage) &&
+                  opj_decode(state.mCodec, state.mStream, state.mImage);
+        if (success)
+        {
+            state.remember(base);
+            state.mReduce = reduce;
 
+            /* only single tile codestreams can be decoded again */
+            opj_codestream_info_v2_t* info = opj_get_cstr_info(state.mCodec);
+            state.mSingleTile = info && (info->tw * info->th == 1);
+            opj_destroy_cstr_info(&info);
+        }
+        image = state.mImage;
+    }
 
     // The image decode failed if the return was NULL or the component
     // count was zero.  The latter is just a sanity check before we
@@ -348,10 +482,7 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 #ifdef SHOW_DEBUG
         LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to decode image!" << LL_ENDL;
 #endif
-        if (image)
-        {
-            opj_image_destroy(image);
-        }
+        mDecodeState.reset();
         base.decodeFailed();
         return true; // done
     }
@@ -359,10 +490,7 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
     if((S32)image->numcomps <= first_channel)
     {
         LL_WARNS() << "trying to decode more channels than are present in image: numcomps: " << image->numcomps << " first_channel: " << first_channel << LL_ENDL;
-        if (image)
-        {
-            opj_image_destroy(image);
-        }
+        mDecodeState.reset();
         base.decodeFailed();
 
         return true;
@@ -390,7 +518,7 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
     U8 *rawp = raw_image.getData();
     if (!rawp)
     {
-        opj_image_destroy(image);
+        mDecodeState.reset();
         base.setLastError("Memory error");
         base.decodeFailed();
         return true; // done
@@ -419,22 +547,393 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 #ifdef SHOW_DEBUG
             LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to decode image! (NULL comp data - OpenJPEG bug)" << LL_ENDL;
 #endif
-            opj_image_destroy(image);
+            mDecodeState.reset();
             base.decodeFailed();
             return true; // done
         }
     }
 
-    /* free image data structure */
-    opj_image_destroy(image);
+    /* keep the decoder if another decode of this codestream may follow:
+       the aux channel or a finer discard level */
+    bool more_to_decode = reduce > 0 || first_channel + channels < img_components;
+    if (!more_to_decode || !mDecodeState->mSingleTile || !mDecodeState->retain())
+    {
+        mDecodeState.reset();
+    }
 
     return true; // done
 }
 
 
+namespace
+{
+    // Sets the layers of a lossy encode of an image of layer_surface pixels,
+    // and the size of the codestream of its part of surface pixels
+    void set_quality_layers(opj_cparameters_t& parameters, U32 layer_surface, U32 surface, U32 numcomps)
+    {
+        // computes a number of layers
+        U32 nb_layers = 1;
+        U32 s = 64*64;
+        while (layer_surface > s)
+        {
+            nb_layers++;
+            s *= 4;
+        }
+        nb_layers = llclamp(nb_layers, 1, 6);
+        parameters.tcp_numlayers = nb_layers;
+        parameters.tcp_rates[nb_layers - 1] = (U32)(1.f / DEFAULT_COMPRESSION_RATE); // 1:8 by default
+        // for each subsequent layer, computes its rate and adds surface * numcomps * 1/rate to the max_cs_size
+        U32 max_cs_size = (U32)(surface * numcomps * DEFAULT_COMPRESSION_RATE);
+        U32 multiplier;
+        for (int i = nb_layers - 2; i >= 0; i--)
+        {
+            if( i == nb_layers - 2 )
+            {
+                multiplier = 15;
+            }
+            else if( i == nb_layers - 3 )
+            {
+                multiplier = 4;
+            }
+            else
+            {
+                multiplier = 2;
+            }
+            parameters.tcp_rates[i] = parameters.tcp_rates[i + 1] * multiplier;
+            max_cs_size += (U32)(surface * numcomps * (1 / parameters.tcp_rates[i]));
+        }
+        //ensure that we have at least a minimal size
+        max_cs_size = llmax(max_cs_size, (U32)FIRST_PACKET_SIZE);
+        parameters.max_cs_size = max_cs_size;
+    }
+
+    // The width x height region of raw_image at x0, y0 from the top, in
+    // OpenJPEG's top down, planar layout
+    opj_image_t* create_opj_image(const LLImageRaw& raw_image, const opj_cparameters_t& parameters,
+                                  S32 x0, S32 y0, S32 width, S32 height)
+    {
+        const S32 MAX_COMPS = 5;
+        OPJ_COLOR_SPACE color_space = OPJ_CLRSPC_SRGB;
+        opj_image_cmptparm_t cmptparm[MAX_COMPS];
+        S32 numcomps = raw_image.getComponents();
+        S32 raw_width = raw_image.getWidth();
+        S32 raw_height = raw_image.getHeight();
+
+        memset(&cmptparm[0], 0, MAX_COMPS * sizeof(opj_image_cmptparm_t));
+        for(S32 c = 0; c < numcomps; c++) {
+            cmptparm[c].prec = 8;
+            cmptparm[c].bpp = 8;
+            cmptparm[c].sgnd = 0;
+            cmptparm[c].dx = parameters.subsampling_dx;
+            cmptparm[c].dy = parameters.subsampling_dy;
+            cmptparm[c].x0 = x0;
+            cmptparm[c].y0 = y0;
+            cmptparm[c].w = width;
+            cmptparm[c].h = height;
+        }
+
+        /* create the image */
+        opj_image_t* image = opj_image_create(numcomps, &cmptparm[0], color_space);
+        if (!image)
+        {
+            return nullptr;
+        }
+
+        image->x0 = x0;
+        image->y0 = y0;
+        image->x1 = x0 + width;
+        image->y1 = y0 + height;
+
+        S32 i = 0;
+        const U8 *src_datap = raw_image.getData();
+        for (S32 y = raw_height - 1 - y0; y >= raw_height - y0 - height; y--)
+        {
+            for (S32 x = x0; x < x0 + width; x++)
+            {
+                const U8 *pixel = src_datap + (y*raw_width + x) * numcomps;
+                for (S32 c = 0; c < numcomps; c++)
+                {
+                    image->comps[c].data[i] = *pixel;
+                    pixel++;
+                }
+                i++;
+            }
+        }
+        return image;
+    }
+
+    bool encode_opj_image(opj_cparameters_t& parameters, opj_image_t* image, opj_stream_t* opj_stream_p)
+    {
+        /* get a J2K compressor handle */
+        opj_codec_t* opj_encoder_p = opj_create_compress(OPJ_CODEC_J2K);
+
+#ifdef SHOW_DEBUG
+        /* catch events using our callbacks and give a local context */
+        opj_set_error_handler(opj_encoder_p, error_callback, nullptr);
+        opj_set_warning_handler(opj_encoder_p, warning_callback, nullptr);
+        opj_set_info_handler(opj_encoder_p, info_callback, nullptr);
+#endif
+
+        /* setup the encoder parameters using the current image and using user parameters */
+        /* then encode the image */
+        bool success = opj_setup_encoder(opj_encoder_p, &parameters, image) &&
+                       opj_start_compress(opj_encoder_p, image, opj_stream_p) &&
+                       opj_encode(opj_encoder_p, opj_stream_p) &&
+                       opj_end_compress(opj_encoder_p, opj_stream_p);
+
+        /* free remaining compression structures */
+        opj_destroy_codec(opj_encoder_p);
+        return success;
+    }
+
+    // Codestream markers
+    const U8 MARKER_SIZ = 0x51;
+    const U8 MARKER_SOT = 0x90;
+    const U8 MARKER_EOC = 0xD9;
+
+    U32 read_be(const U8* data, S32 bytes)
+    {
+        U32 value = 0;
+        for (S32 i = 0; i < bytes; ++i)
+        {
+            value = (value << 8) | data[i];
+        }
+        return value;
+    }
+
+    void write_be(U8* data, S32 bytes, U32 value)
+    {
+        for (S32 i = bytes - 1; i >= 0; --i)
+        {
+            data[i] = U8(value);
+            value >>= 8;
+        }
+    }
+
+    // The main header and tile-parts of a codestream written by OpenJPEG
+    struct TileCodestream
+    {
+        std::vector<U8> mData;
+        size_t mSIZ = 0;        // SIZ marker segment
+        size_t mFirstSOT = 0;   // end of the main header
+        std::vector<std::pair<size_t, size_t>> mParts;  // offset and size
+
+        bool parse()
+        {
+            const U8* data = mData.data();
+            const size_t size = mData.size();
+            if (size < 4 || data[0] != 0xFF || data[1] != 0x4F)
+            {
+                return false;
+            }
+
+            // SOC has no length, every other main header marker has one
+            size_t pos = 2;
+            while (pos + 4 <= size && data[pos] == 0xFF && data[pos + 1] != MARKER_SOT)
+            {
+                if (data[pos + 1] == MARKER_SIZ)
+                {
+                    mSIZ = pos;
+                }
+                pos += 2 + read_be(data + pos + 2, 2);
+            }
+            mFirstSOT = pos;
+
+            while (pos + 12 <= size && data[pos] == 0xFF && data[pos + 1] == MARKER_SOT)
+            {
+                // Psot is 0 for a last tile-part running to the EOC
+                size_t part_size = read_be(data + pos + 6, 4);
+                if (!part_size)
+                {
+                    part_size = size - 2 - pos;
+                }
+                if (pos + part_size > size)
+                {
+                    return false;
+                }
+                mParts.emplace_back(pos, part_size);
+                pos += part_size;
+            }
+
+            return mSIZ && !mParts.empty() &&
+                   pos + 2 == size && data[pos] == 0xFF && data[pos + 1] == MARKER_EOC;
+        }
+    };
+
+    struct LLJp2BufferWriter
+    {
+        static OPJ_SIZE_T writeStream(void* pBufferIn, OPJ_SIZE_T szBufferIn, void* pUserData)
+        {
+            LLJp2BufferWriter* pStream = static_cast<LLJp2BufferWriter*>(pUserData);
+            std::vector<U8>& data = *pStream->m_pData;
+            if (pStream->m_Position + szBufferIn > data.size())
+            {
+                data.resize(pStream->m_Position + szBufferIn);
+            }
+            memcpy(data.data() + pStream->m_Position, pBufferIn, szBufferIn);
+            pStream->m_Position += szBufferIn;
+            return szBufferIn;
+        }
+
+        static OPJ_OFF_T skipStream(OPJ_OFF_T bufferOffset, void* pUserData)
+        {
+            LLJp2BufferWriter* pStream = static_cast<LLJp2BufferWriter*>(pUserData);
+            if (pStream->m_Position + bufferOffset < 0 ||
+                pStream->m_Position + bufferOffset > (OPJ_OFF_T)pStream->m_pData->size())
+            {
+                return -1;
+            }
+            pStream->m_Position += bufferOffset;
+            return bufferOffset;
+        }
+
+        static OPJ_BOOL seekStream(OPJ_OFF_T bufferOffset, void* pUserData)
+        {
+            LLJp2BufferWriter* pStream = static_cast<LLJp2BufferWriter*>(pUserData);
+            if (bufferOffset < 0 || bufferOffset > (OPJ_OFF_T)pStream->m_pData->size())
+            {
+                return OPJ_FALSE;
+            }
+            pStream->m_Position = bufferOffset;
+            return OPJ_TRUE;
+        }
+
+        std::vector<U8>* m_pData = nullptr;
+        OPJ_OFF_T m_Position = 0;
+    };
+
+    // Encodes the tile at tile_x, tile_y as a single tile codestream of an
+    // image whose origin is the tile's. The code-blocks and precincts are
+    // anchored to the image grid origin, so they are the same as in a tiled
+    // encode of the whole image.
+    bool encode_tile(opj_cparameters_t parameters, const LLImageRaw& raw_image, S32 tile_x, S32 tile_y,
+                     TileCodestream& tile)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+        opj_image_t* image = create_opj_image(raw_image, parameters, tile_x * ENCODE_TILE_SIZE, tile_y * ENCODE_TILE_SIZE,
+                                              ENCODE_TILE_SIZE, ENCODE_TILE_SIZE);
+        if (!image)
+        {
+            return false;
+        }
+
+        LLJp2BufferWriter writer;
+        writer.m_pData = &tile.mData;
+        opj_stream_t* opj_stream_p = opj_stream_default_create(OPJ_STREAM_WRITE);
+        opj_stream_set_write_function(opj_stream_p, LLJp2BufferWriter::writeStream);
+        opj_stream_set_skip_function(opj_stream_p, LLJp2BufferWriter::skipStream);
+        opj_stream_set_seek_function(opj_stream_p, LLJp2BufferWriter::seekStream);
+        opj_stream_set_user_data(opj_stream_p, &writer, nullptr);
+
+        bool success = encode_opj_image(parameters, image, opj_stream_p);
+        opj_stream_destroy(opj_stream_p);
+        opj_image_destroy(image);
+
+        tile.mData.resize(writer.m_Position);
+        return success && tile.parse();
+    }
+
+    // Encodes the ENCODE_TILE_SIZE tiles of raw_image as separate codestreams,
+    // sharing them with the idle workers of queue, then stitches them into one
+    // tiled codestream.
+    //
+    // Each tile is split into one tile-part per resolution level, and the
+    // tile-parts are written lowest resolution first across all tiles, so that
+    // the first bytes of the codestream hold the lower resolutions of the whole
+    // image as with untiled encodes, and partial fetches still decode to a
+    // coarser image.
+    bool encode_tiles(LLImageJ2C &base, const LLImageRaw &raw_image, opj_cparameters_t& parameters, LL::WorkQueueBase* queue)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+        const S32 tiles_x = raw_image.getWidth() / ENCODE_TILE_SIZE;
+        const S32 tiles_y = raw_image.getHeight() / ENCODE_TILE_SIZE;
+        const S32 tile_count = tiles_x * tiles_y;
+
+        parameters.tp_on = 1;
+        parameters.tp_flag = 'R';
+        if (parameters.irreversible)
+        {
+            // all tiles need the same layers, so that they share the main header
+            set_quality_layers(parameters, raw_image.getWidth() * raw_image.getHeight(),
+                               ENCODE_TILE_SIZE * ENCODE_TILE_SIZE, raw_image.getComponents());
+        }
+
+        std::vector<TileCodestream> tiles(tile_count);
+        std::atomic<bool> failed(false);
+        LL::parallel_for(queue, tile_count, [&](S32 t)
+        {
+            if (!failed && !encode_tile(parameters, raw_image, t % tiles_x, t / tiles_x, tiles[t]))
+            {
+                failed = true;
+            }
+        });
+        if (failed)
+        {
+            LL_DEBUGS("Texture") << "Failed to encode image tile." << LL_ENDL;
+            return false;
+        }
+
+        // the tiles share their main header but for the SIZ, which is rewritten below
+        const TileCodestream& first = tiles[0];
+        size_t size = first.mFirstSOT + 2;
+        size_t max_parts = 0;
+        for (const TileCodestream& tile : tiles)
+        {
+            for (const auto& part : tile.mParts)
+            {
+                size += part.second;
+            }
+            max_parts = llmax(max_parts, tile.mParts.size());
+        }
+
+        if (!base.allocateData(narrow(size)))
+        {
+            return false;
+        }
+        U8* out = base.getData();
+        memcpy(out, first.mData.data(), first.mFirstSOT);
+
+        // the whole image, in tiles_x x tiles_y tiles
+        U8* siz = out + first.mSIZ;
+        write_be(siz + 6, 4, raw_image.getWidth());     // Xsiz
+        write_be(siz + 10, 4, raw_image.getHeight());   // Ysiz
+        write_be(siz + 14, 4, 0);                       // XOsiz
+        write_be(siz + 18, 4, 0);                       // YOsiz
+        write_be(siz + 22, 4, ENCODE_TILE_SIZE);        // XTsiz
+        write_be(siz + 26, 4, ENCODE_TILE_SIZE);        // YTsiz
+        write_be(siz + 30, 4, 0);                       // XTOsiz
+        write_be(siz + 34, 4, 0);                       // YTOsiz
+
+        size_t pos = first.mFirstSOT;
+        for (size_t p = 0; p < max_parts; ++p)
+        {
+            for (S32 t = 0; t < tile_count; ++t)
+            {
+                const TileCodestream& tile = tiles[t];
+                if (p >= tile.mParts.size())
+                {
+                    continue;
+                }
+                const auto& part = tile.mParts[p];
+                memcpy(out + pos, tile.mData.data() + part.first, part.second);
+                write_be(out + pos + 4, 2, t);                  // Isot
+                write_be(out + pos + 6, 4, (U32)part.second);   // Psot, 0 only fits the last part
+                pos += part.second;
+            }
+        }
+        out[pos++] = 0xFF;
+        out[pos++] = MARKER_EOC;
+        llassert(pos == size);
+
+        base.updateData(); // set width, height
+        return true;
+    }
+}
+
 bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, const char* comment_text, F32 encode_time, bool reversible)
 {
-    const S32 MAX_COMPS = 5;
     opj_cparameters_t parameters;   /* compression parameters */
 
     /* set encoding parameters to default values */
@@ -466,108 +965,34 @@ bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
         parameters.cp_comment = (char *) comment_text;
     }
 
-    //
-    // Fill in the source image from our raw image
-    //
-    OPJ_COLOR_SPACE color_space = OPJ_CLRSPC_SRGB;
-    opj_image_cmptparm_t cmptparm[MAX_COMPS];
-    opj_image_t * image = NULL;
-    S32 numcomps = raw_image.getComponents();
     S32 width = raw_image.getWidth();
     S32 height = raw_image.getHeight();
 
-    memset(&cmptparm[0], 0, MAX_COMPS * sizeof(opj_image_cmptparm_t));
-    for(S32 c = 0; c < numcomps; c++) {
-        cmptparm[c].prec = 8;
-        cmptparm[c].bpp = 8;
-        cmptparm[c].sgnd = 0;
-        cmptparm[c].dx = parameters.subsampling_dx;
-        cmptparm[c].dy = parameters.subsampling_dy;
-        cmptparm[c].w = width;
-        cmptparm[c].h = height;
+    // large images whose tiles can be encoded in parallel
+    std::shared_ptr<LL::WorkQueueBase> queue = base.getEncodeQueue();
+    if (queue && width % ENCODE_TILE_SIZE == 0 && height % ENCODE_TILE_SIZE == 0 &&
+        width * height > ENCODE_TILE_SIZE * ENCODE_TILE_SIZE)
+    {
+        return encode_tiles(base, raw_image, parameters, queue.get());
     }
 
-    /* create the image */
-    image = opj_image_create(numcomps, &cmptparm[0], color_space);
-
-    image->x1 = width;
-    image->y1 = height;
-
-    S32 i = 0;
-    const U8 *src_datap = raw_image.getData();
-    for (S32 y = height - 1; y >= 0; y--)
+    //
+    // Fill in the source image from our raw image
+    //
+    opj_image_t * image = create_opj_image(raw_image, parameters, 0, 0, width, height);
+    if (!image)
     {
-        for (S32 x = 0; x < width; x++)
-        {
-            const U8 *pixel = src_datap + (y*width + x) * numcomps;
-            for (S32 c = 0; c < numcomps; c++)
-            {
-                image->comps[c].data[i] = *pixel;
-                pixel++;
-            }
-            i++;
-        }
+        LL_DEBUGS("Texture") << "Failed to encode image." << LL_ENDL;
+        return false;
     }
 
     /* encode the destination image */
     /* ---------------------------- */
 
-    /* get a J2K compressor handle */
-    opj_codec_t* opj_encoder_p = opj_create_compress(OPJ_CODEC_J2K);
-
-#ifdef SHOW_DEBUG
-    /* catch events using our callbacks and give a local context */
-    opj_set_error_handler(opj_encoder_p, error_callback, nullptr);
-    opj_set_warning_handler(opj_encoder_p, warning_callback, nullptr);
-    opj_set_info_handler(opj_encoder_p, info_callback, nullptr);
-#endif
-
     // if not lossless compression, computes tcp_numlayers and max_cs_size depending on the image dimensions
     if( parameters.irreversible ) {
-        // computes a number of layers
-        U32 surface = raw_image.getWidth() * raw_image.getHeight();
-        U32 nb_layers = 1;
-        U32 s = 64*64;
-        while (surface > s)
-        {
-            nb_layers++;
-            s *= 4;
-        }
-        nb_layers = llclamp(nb_layers, 1, 6);
-        parameters.tcp_numlayers = nb_layers;
-        parameters.tcp_rates[nb_layers - 1] = (U32)(1.f / DEFAULT_COMPRESSION_RATE); // 1:8 by default
-        // for each subsequent layer, computes its rate and adds surface * numcomps * 1/rate to the max_cs_size
-        U32 max_cs_size = (U32)(surface * image->numcomps * DEFAULT_COMPRESSION_RATE);
-        U32 multiplier;
-        for (int i = nb_layers - 2; i >= 0; i--)
-        {
-            if( i == nb_layers - 2 )
-            {
-                multiplier = 15;
-            }
-            else if( i == nb_layers - 3 )
-            {
-                multiplier = 4;
-            }
-            else
-            {
-                multiplier = 2;
-            }
-            parameters.tcp_rates[i] = parameters.tcp_rates[i + 1] * multiplier;
-            max_cs_size += (U32)(surface * image->numcomps * (1 / parameters.tcp_rates[i]));
-        }
-        //ensure that we have at least a minimal size
-        max_cs_size = llmax(max_cs_size, (U32)FIRST_PACKET_SIZE);
-        parameters.max_cs_size = max_cs_size;
-    }
-
-    /* setup the encoder parameters using the current image and using user parameters */
-    if (!opj_setup_encoder(opj_encoder_p, &parameters, image))
-    {
-        opj_destroy_codec(opj_encoder_p);
-        opj_image_destroy(image);
-        LL_DEBUGS("Texture") << "Failed to encode image." << LL_ENDL;
-        return false;
+        U32 surface = width * height;
+        set_quality_layers(parameters, surface, surface, image->numcomps);
     }
 
     /* open a byte stream for writing */
@@ -580,13 +1005,10 @@ bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
     opj_stream_set_user_data(opj_stream_p, &streamWriter, nullptr);
     opj_stream_set_user_data_length(opj_stream_p, raw_image.getDataSize());
 
-    /* encode the image */
-    if (!opj_start_compress(opj_encoder_p, image, opj_stream_p) ||
-        !opj_encode(opj_encoder_p, opj_stream_p) ||
-        !opj_end_compress(opj_encoder_p, opj_stream_p))
+    /* setup the encoder and encode the image */
+    if (!encode_opj_image(parameters, image, opj_stream_p))
     {
         opj_stream_destroy(opj_stream_p);
-        opj_destroy_codec(opj_encoder_p);
         opj_image_destroy(image);
         LL_DEBUGS("Texture") << "Failed to encode image." << LL_ENDL;
         return false;
@@ -597,9 +1019,6 @@ bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
     /* close and free the byte stream */
     opj_stream_destroy(opj_stream_p);
 
-    /* free remaining compression structures */
-    opj_destroy_codec(opj_encoder_p);
-
     /* free image data */
     opj_image_destroy(image);
 
@@ -35,7 +35,12 @@ class LLImageJ2COJ final : public LLImageJ2CImpl
 {
 public:
     LLImageJ2COJ();
-    virtual ~LLImageJ2COJ() = default;
+    virtual ~LLImageJ2COJ();
+
+    // Upper bound for the memory held by decoders kept alive between
+    // decodes of the same image, across all images.
+    static S64 sMaxRetainedDecodeBytes;
+
 protected:
     virtual bool getMetadata(LLImageJ2C &base);
     virtual bool decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decode_time, S32 first_channel, S32 max_channel_count);
@@ -44,6 +49,10 @@ protected:
     virtual bool initDecode(LLImageJ2C &base, LLImageRaw &raw_image, int discard_level = -1, int* region = NULL);
     virtual bool initEncode(LLImageJ2C &base, LLImageRaw &raw_image, int blocks_size = -1, int precincts_size = -1, int levels = 0);
     virtual std::string getEngineInfo() const;
+
+private:
+    struct DecodeState;
+    std::unique_ptr<DecodeState> mDecodeState;
 };
 
 #endif
@@ -33,6 +33,7 @@
 #endif
 #include <cmath>
 #include <unordered_map>
+#include <atomic>
 
 #include "llerror.h"
 
@@ -52,6 +53,7 @@
 #include "llmeshoptimizer.h"
 #include "lltimer.h"
 #include "llvolumeoctree.h"
+#include "workqueue.h"
 
 #include "mikktspace/mikktspace.hh"
 
@@ -2288,7 +2290,7 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
     return retval;
 }
 
-bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
+bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size, LL::WorkQueueBase* queue)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 
@@ -2301,10 +2303,10 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
         LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
         return false;
     }
-    return unpackVolumeFacesInternal(mdl);
+    return unpackVolumeFacesInternal(mdl, queue);
 }
 
-bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
+bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size, LL::WorkQueueBase* queue)
 {
     //input data is now pointing at a zlib compressed block of LLSD
     //decompress block
@@ -2315,398 +2317,716 @@ bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
         LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
         return false;
     }
-    return unpackVolumeFacesInternal(mdl);
+    return unpackVolumeFacesInternal(mdl, queue);
 }
 
-bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
+namespace
 {
+    // Converts the three U16 at v to floats with w = 0, exactly like
+    // set((F32)v[0], (F32)v[1], (F32)v[2]). Loads v[3] too, so never call it
+    // on the last triple of a buffer.
+    inline LLVector4a load_u16x3(const U16* v)
     {
-        auto face_count = mdl.size();
+        __m128i q = _mm_loadl_epi64((const __m128i*)v);
+        q = _mm_unpacklo_epi16(q, _mm_setzero_si128());
+        q = _mm_and_si128(q, _mm_setr_epi32(-1, -1, -1, 0));
+        return LLVector4a(_mm_cvtepi32_ps(q));
+    }
 
-        if (face_count == 0)
-        { //no faces unpacked, treat as failed decode
-            LL_WARNS() << "found no faces!" << LL_ENDL;
-            return false;
-        }
+    // Converts the four U16 at v to floats.
+    inline LLVector4a load_u16x4(const U16* v)
+    {
+        __m128i q = _mm_loadl_epi64((const __m128i*)v);
+        return LLVector4a(_mm_cvtepi32_ps(_mm_unpacklo_epi16(q, _mm_setzero_si128())));
+    }
+}
+
+// Below this many vertices in a LOD, handing faces to other threads costs
+// more than it saves.
+S32 LLVolume::sParallelUnpackMinVertices = 16384;
+
+bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl, LL::WorkQueueBase* queue)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 
-        mVolumeFaces.resize(face_count);
+    auto face_count = mdl.size();
+
+    if (face_count == 0)
+    { //no faces unpacked, treat as failed decode
+        LL_WARNS() << "found no faces!" << LL_ENDL;
+        return false;
+    }
+
+    mVolumeFaces.resize(face_count);
+
+    // Faces are independent of each other, so the faces of a large LOD are
+    // unpacked and optimized in parallel. Each face goes through exactly the
+    // same code either way, so the result does not depend on the path.
+    size_t total_verts = 0;
+    for (size_t i = 0; i < face_count; ++i)
+    {
+        total_verts += mdl[i]["Position"].asBinary().size() / (3*2);
+    }
+
+    std::atomic<bool> optimized{ true };
+    auto unpack = [&](S32 i)
+    {
+        LLVolumeFace& face = mVolumeFaces[i];
+        unpackVolumeFace(mdl[i], face, i, face_count);
+        if (!face.cacheOptimize(true))
+        {
+            optimized = false;
+        }
+    };
 
+    if (queue && face_count > 1 && total_verts >= (size_t)sParallelUnpackMinVertices)
+    {
+        LL::parallel_for(queue, (S32)face_count, unpack);
+    }
+    else
+    {
         for (size_t i = 0; i < face_count; ++i)
         {
-            LLVolumeFace& face = mVolumeFaces[i];
-
-            if (mdl[i].has("NoGeometry"))
-            { //face has no geometry, continue
-                face.resizeIndices(3);
-                face.resizeVertices(1);
-                face.mPositions->clear();
-                face.mNormals->clear();
-                face.mTexCoords->setZero();
-                memset(face.mIndices, 0, sizeof(U16)*3);
-                continue;
-            }
+            unpack((S32)i);
+        }
+    }
+
+    if (!optimized)
+    {
+        // Out of memory?
+        LL_WARNS() << "Failed to optimize!" << LL_ENDL;
+        mVolumeFaces.clear();
+        return false;
+    }
+
+    mSculptLevel = 0;  // success!
+
+    return true;
+}
+
+void LLVolume::unpackVolumeFace(const LLSD& face_sd, LLVolumeFace& face, size_t face_index, size_t face_count) const
+{
+    if (face_sd.has("NoGeometry"))
+    { //face has no geometry, continue
+        face.resizeIndices(3);
+        face.resizeVertices(1);
+        face.mPositions->clear();
+        face.mNormals->clear();
+        face.mTexCoords->setZero();
+        memset(face.mIndices, 0, sizeof(U16)*3);
+        return;
+    }
 
-            const LLSD::Binary& pos = mdl[i]["Position"].asBinary();
-            const LLSD::Binary& norm = mdl[i]["Normal"].asBinary();
+    const LLSD::Binary& pos = face_sd["Position"].asBinary();
+    const LLSD::Binary& norm = face_sd["Normal"].asBinary();
 #if 0 // keep this code for now in case we decide to add support for on-the-wire tangents
-            const LLSD::Binary& tangent = mdl[i]["Tangent"].asBinary();
+    const LLSD::Binary& tangent = face_sd["Tangent"].asBinary();
 #endif
-            const LLSD::Binary& tc = mdl[i]["TexCoord0"].asBinary();
-            const LLSD::Binary& idx = mdl[i]["TriangleList"].asBinary();
+    const LLSD::Binary& tc = face_sd["TexCoord0"].asBinary();
+    const LLSD::Binary& idx = face_sd["TriangleList"].asBinary();
 
-            //copy out indices
-            auto num_indices = idx.size() / 2;
-            const S32 indices_to_discard = num_indices % 3;
-            if (indices_to_discard > 0)
-            {
-                // Invalid number of triangle indices
-                LL_WARNS() << "Incomplete triangle discarded from face! Indices count " << num_indices << " was not divisible by 3. face index: " << i << " Total: " << face_count << LL_ENDL;
-                num_indices -= indices_to_discard;
-            }
-            face.resizeIndices(static_cast<S32>(num_indices));
+    //copy out indices
+    auto num_indices = idx.size() / 2;
+    const S32 indices_to_discard = num_indices % 3;
+    if (indices_to_discard > 0)
+    {
+        // Invalid number of triangle indices
+        LL_WARNS() << "Incomplete triangle discarded from face! Indices count " << num_indices << " was not divisible by 3. face index: " << face_index << " Total: " << face_count << LL_ENDL;
+        num_indices -= indices_to_discard;
+    }
+    face.resizeIndices(static_cast<S32>(num_indices));
 
-            if (num_indices > 2 && !face.mIndices)
-            {
-                LL_WARNS() << "Failed to allocate " << num_indices << " indices for face index: " << i << " Total: " << face_count << LL_ENDL;
-                continue;
-            }
+    if (num_indices > 2 && !face.mIndices)
+    {
+        LL_WARNS() << "Failed to allocate " << num_indices << " indices for face index: " << face_index << " Total: " << face_count << LL_ENDL;
+        return;
+    }
 
-            if (idx.empty() || face.mNumIndices < 3)
-            { //why is there an empty index list?
-                LL_WARNS() << "Empty face present! Face index: " << i << " Total: " << face_count << LL_ENDL;
-                continue;
-            }
+    if (idx.empty() || face.mNumIndices < 3)
+    { //why is there an empty index list?
+        LL_WARNS() << "Empty face present! Face index: " << face_index << " Total: " << face_count << LL_ENDL;
+        return;
+    }
 
-            U16* indices = (U16*) &(idx[0]);
-            for (U32 j = 0; j < num_indices; ++j)
-            {
-                face.mIndices[j] = indices[j];
-            }
+    U16* indices = (U16*) &(idx[0]);
+    for (U32 j = 0; j < num_indices; ++j)
+    {
+        face.mIndices[j] = indices[j];
+    }
 
-            //copy out vertices
-            U32 num_verts = static_cast<U32>(pos.size())/(3*2);
-            face.resizeVertices(num_verts);
+    //copy out vertices
+    U32 num_verts = static_cast<U32>(pos.size())/(3*2);
+    face.resizeVertices(num_verts);
 
-            if (num_verts > 0 && !face.mPositions)
-            {
-                LL_WARNS() << "Failed to allocate " << num_verts << " vertices for face index: " << i << " Total: " << face_count << LL_ENDL;
-                face.resizeIndices(0);
-                continue;
-            }
+    if (num_verts > 0 && !face.mPositions)
+    {
+        LL_WARNS() << "Failed to allocate " << num_verts << " vertices for face index: " << face_index << " Total: " << face_count << LL_ENDL;
+        face.resizeIndices(0);
+        return;
+    }
+
+    LLVector3 minp;
+    LLVector3 maxp;
+    LLVector2 min_tc;
+    LLVector2 max_tc;
+
+    minp.setValue(face_sd["PositionDomain"]["Min"]);
+    maxp.setValue(face_sd["PositionDomain"]["Max"]);
+    LLVector4a min_pos, max_pos;
+    min_pos.load3(minp.mV);
+    max_pos.load3(maxp.mV);
+
+    min_tc.setValue(face_sd["TexCoord0Domain"]["Min"]);
+    max_tc.setValue(face_sd["TexCoord0Domain"]["Max"]);
 
-            LLVector3 minp;
-            LLVector3 maxp;
-            LLVector2 min_tc;
-            LLVector2 max_tc;
+    //unpack normalized scale/translation
+    if (face_sd.has("NormalizedScale"))
+    {
+        face.mNormalizedScale.setValue(face_sd["NormalizedScale"]);
+    }
+    else
+    {
+        face.mNormalizedScale.set(1, 1, 1);
+    }
 
-            minp.setValue(mdl[i]["PositionDomain"]["Min"]);
-            maxp.setValue(mdl[i]["PositionDomain"]["Max"]);
-            LLVector4a min_pos, max_pos;
-            min_pos.load3(minp.mV);
-            max_pos.load3(maxp.mV);
+    LLVector4a pos_range;
+    pos_range.setSub(max_pos, min_pos);
+    LLVector2 tc_range2 = max_tc - min_tc;
 
-            min_tc.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
-            max_tc.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
+    LLVector4a tc_range;
+    tc_range.set(tc_range2[0], tc_range2[1], tc_range2[0], tc_range2[1]);
+    LLVector4a min_tc4(min_tc[0], min_tc[1], min_tc[0], min_tc[1]);
 
-            //unpack normalized scale/translation
-            if (mdl[i].has("NormalizedScale"))
+    LLVector4a* pos_out = face.mPositions;
+    LLVector4a* norm_out = face.mNormals;
+    LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
+
+    {
+        U16* v = (U16*) &(pos[0]);
+        for (U32 j = 0; j < num_verts; ++j)
+        {
+            if (j < num_verts - 1)
             {
-                face.mNormalizedScale.setValue(mdl[i]["NormalizedScale"]);
+                *pos_out = load_u16x3(v);
             }
             else
             {
-                face.mNormalizedScale.set(1, 1, 1);
+                pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
             }
+            pos_out->div(65535.f);
+            pos_out->mul(pos_range);
+            pos_out->add(min_pos);
+            pos_out++;
+            v += 3;
+        }
 
-            LLVector4a pos_range;
-            pos_range.setSub(max_pos, min_pos);
-            LLVector2 tc_range2 = max_tc - min_tc;
-
-            LLVector4a tc_range;
-            tc_range.set(tc_range2[0], tc_range2[1], tc_range2[0], tc_range2[1]);
-            LLVector4a min_tc4(min_tc[0], min_tc[1], min_tc[0], min_tc[1]);
-
-            LLVector4a* pos_out = face.mPositions;
-            LLVector4a* norm_out = face.mNormals;
-            LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
+    }
 
+    {
+        if (!norm.empty())
+        {
+            U16* n = (U16*) &(norm[0]);
+            for (U32 j = 0; j < num_verts; ++j)
             {
-                U16* v = (U16*) &(pos[0]);
-                for (U32 j = 0; j < num_verts; ++j)
+                if (j < num_verts - 1)
+                {
+                    *norm_out = load_u16x3(n);
+                }
+                else
                 {
-                    pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
-                    pos_out->div(65535.f);
-                    pos_out->mul(pos_range);
-                    pos_out->add(min_pos);
-                    pos_out++;
-                    v += 3;
+                    norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
                 }
+                norm_out->div(65535.f);
+                norm_out->mul(2.f);
+                norm_out->sub(1.f);
+                norm_out++;
+                n += 3;
+            }
+        }
+        else
+        {
+            for (U32 j = 0; j < num_verts; ++j)
+            {
+                norm_out->clear();
+                norm_out++; // or just norm_out[j].clear();
+            }
+        }
+    }
+
+#if 0 // keep this code for now in case we decide to add support for on-the-wire tangents
+    {
+        if (!tangent.empty())
+        {
+            face.allocateTangents(face.mNumVertices);
+            U16* t = (U16*)&(tangent[0]);
+
+            // NOTE: tangents coming from the asset may not be mikkt space, but they should always be used by the GLTF shaders to
+            // maintain compliance with the GLTF spec
+            LLVector4a* t_out = face.mTangents;
 
+            for (U32 j = 0; j < num_verts; ++j)
+            {
+                t_out->set((F32)t[0], (F32)t[1], (F32)t[2], (F32) t[3]);
+                t_out->div(65535.f);
+                t_out->mul(2.f);
+                t_out->sub(1.f);
+
+                F32* tp = t_out->getF32ptr();
+                tp[3] = tp[3] < 0.f ? -1.f : 1.f;
+
+                t_out++;
+                t += 4;
             }
+        }
+    }
+#endif
 
+    {
+        if (!tc.empty())
+        {
+            U16* t = (U16*) &(tc[0]);
+            for (U32 j = 0; j < num_verts; j+=2)
             {
-                if (!norm.empty())
+                if (j < num_verts-1)
                 {
-                    U16* n = (U16*) &(norm[0]);
-                    for (U32 j = 0; j < num_verts; ++j)
-                    {
-                        norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
-                        norm_out->div(65535.f);
-                        norm_out->mul(2.f);
-                        norm_out->sub(1.f);
-                        norm_out++;
-                        n += 3;
-                    }
+                    *tc_out = load_u16x4(t);
                 }
                 else
                 {
-                    for (U32 j = 0; j < num_verts; ++j)
-                    {
-                        norm_out->clear();
-                        norm_out++; // or just norm_out[j].clear();
-                    }
+                    tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
                 }
-            }
 
-#if 0 // keep this code for now in case we decide to add support for on-the-wire tangents
+                t += 4;
+
+                tc_out->div(65535.f);
+                tc_out->mul(tc_range);
+                tc_out->add(min_tc4);
+
+                tc_out++;
+            }
+        }
+        else
+        {
+            for (U32 j = 0; j < num_verts; j += 2)
             {
-                if (!tangent.empty())
-                {
-                    face.allocateTangents(face.mNumVertices);
-                    U16* t = (U16*)&(tangent[0]);
+                tc_out->clear();
+                tc_out++;
+            }
+        }
+    }
 
-                    // NOTE: tangents coming from the asset may not be mikkt space, but they should always be used by the GLTF shaders to
-                    // maintain compliance with the GLTF spec
-                    LLVector4a* t_out = face.mTangents;
+    if (face_sd.has("Weights"))
+    {
+        face.allocateWeights(num_verts);
+        if (!face.mWeights && num_verts)
+        {
+            LL_WARNS() << "Failed to allocate " << num_verts << " weights for face index: " << face_index << " Total: " << face_count << LL_ENDL;
+            face.resizeIndices(0);
+            face.resizeVertices(0);
+            return;
+        }
 
-                    for (U32 j = 0; j < num_verts; ++j)
-                    {
-                        t_out->set((F32)t[0], (F32)t[1], (F32)t[2], (F32) t[3]);
-                        t_out->div(65535.f);
-                        t_out->mul(2.f);
-                        t_out->sub(1.f);
+        const LLSD::Binary& weights = face_sd["Weights"].asBinary();
 
-                        F32* tp = t_out->getF32ptr();
-                        tp[3] = tp[3] < 0.f ? -1.f : 1.f;
+        U32 idx = 0;
 
-                        t_out++;
-                        t += 4;
-                    }
-                }
-            }
-#endif
+        U32 cur_vertex = 0;
+        while (idx < weights.size() && cur_vertex < num_verts)
+        {
+            const U8 END_INFLUENCES = 0xFF;
+            U8 joint = weights[idx++];
 
-            {
-                if (!tc.empty())
-                {
-                    U16* t = (U16*) &(tc[0]);
-                    for (U32 j = 0; j < num_verts; j+=2)
-                    {
-                        if (j < num_verts-1)
-                        {
-                            tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
-                        }
-                        else
-                        {
-                            tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
-                        }
+            U32 cur_influence = 0;
+            LLVector4 wght(0,0,0,0);
+            U32 joints[4] = {0,0,0,0};
+            LLVector4 joints_with_weights(0,0,0,0);
 
-                        t += 4;
+            while (joint != END_INFLUENCES && idx < weights.size())
+            {
+                U16 influence = weights[idx++];
+                influence |= ((U16) weights[idx++] << 8);
 
-                        tc_out->div(65535.f);
-                        tc_out->mul(tc_range);
-                        tc_out->add(min_tc4);
+                F32 w = llclamp((F32) influence / 65535.f, 0.001f, 0.999f);
+                wght.mV[cur_influence] = w;
+                joints[cur_influence] = joint;
+                cur_influence++;
 
-                        tc_out++;
-                    }
+                if (cur_influence >= 4)
+                {
+                    joint = END_INFLUENCES;
                 }
                 else
                 {
-                    for (U32 j = 0; j < num_verts; j += 2)
-                    {
-                        tc_out->clear();
-                        tc_out++;
-                    }
+                    joint = weights[idx++];
                 }
             }
-
-            if (mdl[i].has("Weights"))
+            F32 wsum = wght.mV[VX] + wght.mV[VY] + wght.mV[VZ] + wght.mV[VW];
+            if (wsum <= 0.f)
             {
-                face.allocateWeights(num_verts);
-                if (!face.mWeights && num_verts)
-                {
-                    LL_WARNS() << "Failed to allocate " << num_verts << " weights for face index: " << i << " Total: " << face_count << LL_ENDL;
-                    face.resizeIndices(0);
-                    face.resizeVertices(0);
-                    continue;
-                }
+                wght = LLVector4(0.999f,0.f,0.f,0.f);
+            }
+            for (U32 k=0; k<4; k++)
+            {
+                F32 f_combined = (F32) joints[k] + wght[k];
+                joints_with_weights[k] = f_combined;
+                // Any weights we added above should wind up non-zero and applied to a specific bone.
+                // A failure here would indicate a floating point precision error in the math.
+                llassert((k >= cur_influence) || (f_combined - S32(f_combined) > 0.0f));
+            }
+            face.mWeights[cur_vertex].loadua(joints_with_weights.mV);
 
-                const LLSD::Binary& weights = mdl[i]["Weights"].asBinary();
+            cur_vertex++;
+        }
 
-                U32 idx = 0;
+        if (cur_vertex != num_verts || idx != weights.size())
+        {
+            LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
+        }
 
-                U32 cur_vertex = 0;
-                while (idx < weights.size() && cur_vertex < num_verts)
-                {
-                    const U8 END_INFLUENCES = 0xFF;
-                    U8 joint = weights[idx++];
+    }
 
-                    U32 cur_influence = 0;
-                    LLVector4 wght(0,0,0,0);
-                    U32 joints[4] = {0,0,0,0};
-                    LLVector4 joints_with_weights(0,0,0,0);
+    // modifier flags?
+    bool do_mirror = (mParams.getSculptType() & LL_SCULPT_FLAG_MIRROR);
+    bool do_invert = (mParams.getSculptType() &LL_SCULPT_FLAG_INVERT);
 
-                    while (joint != END_INFLUENCES && idx < weights.size())
-                    {
-                        U16 influence = weights[idx++];
-                        influence |= ((U16) weights[idx++] << 8);
 
-                        F32 w = llclamp((F32) influence / 65535.f, 0.001f, 0.999f);
-                        wght.mV[cur_influence] = w;
-                        joints[cur_influence] = joint;
-                        cur_influence++;
+    // translate to actions:
+    bool do_reflect_x = false;
+    bool do_reverse_triangles = false;
+    bool do_invert_normals = false;
 
-                        if (cur_influence >= 4)
-                        {
-                            joint = END_INFLUENCES;
-                        }
-                        else
-                        {
-                            joint = weights[idx++];
-                        }
-                    }
-                    F32 wsum = wght.mV[VX] + wght.mV[VY] + wght.mV[VZ] + wght.mV[VW];
-                    if (wsum <= 0.f)
-                    {
-                        wght = LLVector4(0.999f,0.f,0.f,0.f);
-                    }
-                    for (U32 k=0; k<4; k++)
-                    {
-                        F32 f_combined = (F32) joints[k] + wght[k];
-                        joints_with_weights[k] = f_combined;
-                        // Any weights we added above should wind up non-zero and applied to a specific bone.
-                        // A failure here would indicate a floating point precision error in the math.
-                        llassert((k >= cur_influence) || (f_combined - S32(f_combined) > 0.0f));
-                    }
-                    face.mWeights[cur_vertex].loadua(joints_with_weights.mV);
+    if (do_mirror)
+    {
+        do_reflect_x = true;
+        do_reverse_triangles = !do_reverse_triangles;
+    }
 
-                    cur_vertex++;
-                }
+    if (do_invert)
+    {
+        do_invert_normals = true;
+        do_reverse_triangles = !do_reverse_triangles;
+    }
 
-                if (cur_vertex != num_verts || idx != weights.size())
-                {
-                    LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
-                }
+    // now do the work
 
-            }
+    if (do_reflect_x)
+    {
+        LLVector4a* p = (LLVector4a*) face.mPositions;
+        LLVector4a* n = (LLVector4a*) face.mNormals;
+
+        for (S32 i = 0; i < face.mNumVertices; i++)
+        {
+            p[i].mul(-1.0f);
+            n[i].mul(-1.0f);
+        }
+    }
+
+    if (do_invert_normals)
+    {
+        LLVector4a* n = (LLVector4a*) face.mNormals;
+
+        for (S32 i = 0; i < face.mNumVertices; i++)
+        {
+            n[i].mul(-1.0f);
+        }
+    }
+
+    if (do_reverse_triangles)
+    {
+        for (S32 j = 0; j < face.mNumIndices; j += 3)
+        {
+            // swap the 2nd and 3rd index
+            S32 swap = face.mIndices[j+1];
+            face.mIndices[j+1] = face.mIndices[j+2];
+            face.mIndices[j+2] = swap;
+        }
+    }
+
+    //calculate bounding box
+    // VFExtents change
+    LLVector4a& min = face.mExtents[0];
+    LLVector4a& max = face.mExtents[1];
+
+    if (face.mNumVertices < 3)
+    { //empty face, use a dummy 1cm (at 1m scale) bounding box
+        min.splat(-0.005f);
+        max.splat(0.005f);
+    }
+    else
+    {
+        min = max = face.mPositions[0];
 
-            // modifier flags?
-            bool do_mirror = (mParams.getSculptType() & LL_SCULPT_FLAG_MIRROR);
-            bool do_invert = (mParams.getSculptType() &LL_SCULPT_FLAG_INVERT);
+        for (S32 i = 1; i < face.mNumVertices; ++i)
+        {
+            min.setMin(min, face.mPositions[i]);
+            max.setMax(max, face.mPositions[i]);
+        }
 
+        if (face.mTexCoords)
+        {
+            LLVector2& min_tc = face.mTexCoordExtents[0];
+            LLVector2& max_tc = face.mTexCoordExtents[1];
 
-            // translate to actions:
-            bool do_reflect_x = false;
-            bool do_reverse_triangles = false;
-            bool do_invert_normals = false;
+            min_tc = face.mTexCoords[0];
+            max_tc = face.mTexCoords[0];
 
-            if (do_mirror)
+            for (S32 j = 1; j < face.mNumVertices; ++j)
             {
-                do_reflect_x = true;
-                do_reverse_triangles = !do_reverse_triangles;
+                update_min_max(min_tc, max_tc, face.mTexCoords[j]);
             }
+        }
+        else
+        {
+            face.mTexCoordExtents[0].set(0,0);
+            face.mTexCoordExtents[1].set(1,1);
+        }
+    }
+}
+
+namespace
+{
+    constexpr U32 DECODED_FACES_MAGIC = 0x4656444c; // "LDVF"
+    constexpr U32 DECODED_FACES_VERSION = 1;
+
+    enum : U32
+    {
+        DECODED_HAS_TANGENTS = 1 << 0,
+        DECODED_HAS_WEIGHTS = 1 << 1
+    };
+
+    struct DecodedFacesHeader
+    {
+        U32 mMagic;
+        U32 mVersion;
+        U32 mSculptType;
+        U32 mNumFaces;
+    };
+
+    struct DecodedFaceHeader
+    {
+        S32 mNumVertices;
+        S32 mNumIndices;
+        U32 mFlags;
+        U32 mPad;
+        LLVector4a mExtents[3]; // min, max, center
+        LLVector2 mTexCoordExtents[2];
+        LLVector3 mNormalizedScale;
+        U32 mPad2;
+    };
+
+    static_assert(sizeof(DecodedFacesHeader) % 16 == 0, "decoded faces header must keep 16 byte alignment");
+    static_assert(sizeof(DecodedFaceHeader) % 16 == 0, "decoded face header must keep 16 byte alignment");
+
+    // size of the interleaved block allocated by LLVolumeFace::resizeVertices()
+    S32 decoded_vertex_block_size(S32 num_verts)
+    {
+        return (S32)sizeof(LLVector4a) * 2 * num_verts + ((num_verts * (S32)sizeof(LLVector2) + 0xF) & ~0xF);
+    }
+
+    S32 decoded_index_block_size(S32 num_indices)
+    {
+        return (num_indices * (S32)sizeof(U16) + 0xF) & ~0xF;
+    }
+
+    void append_decoded(std::vector<U8>& out, const void* src, size_t bytes)
+    {
+        const U8* p = (const U8*)src;
+        out.insert(out.end(), p, p + bytes);
+    }
+}
+
+bool LLVolume::packDecodedFaces(std::vector<U8>& out) const
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 
-            if (do_invert)
+    out.clear();
+    if (mVolumeFaces.empty())
+    {
+        return false;
+    }
+
+    size_t total = sizeof(DecodedFacesHeader);
+    for (const LLVolumeFace& face : mVolumeFaces)
+    {
+        total += sizeof(DecodedFaceHeader);
+        if (face.mNumVertices > 0)
+        {
+            total += decoded_vertex_block_size(face.mNumVertices);
+            total += face.mTangents ? sizeof(LLVector4a) * face.mNumVertices : 0;
+            total += face.mWeights ? sizeof(LLVector4a) * face.mNumVertices : 0;
+        }
+        total += decoded_index_block_size(face.mNumIndices);
+    }
+    out.reserve(total);
+
+    DecodedFacesHeader header = { DECODED_FACES_MAGIC, DECODED_FACES_VERSION, mParams.getSculptType(), (U32)mVolumeFaces.size() };
+    append_decoded(out, &header, sizeof(header));
+
+    for (const LLVolumeFace& face : mVolumeFaces)
+    {
+        DecodedFaceHeader face_header = {};
+        face_header.mNumVertices = face.mNumVertices;
+        face_header.mNumIndices = face.mNumIndices;
+        if (face.mNumVertices > 0)
+        {
+            face_header.mFlags = (face.mTangents ? DECODED_HAS_TANGENTS : 0) | (face.mWeights ? DECODED_HAS_WEIGHTS : 0);
+        }
+        face_header.mExtents[0] = face.mExtents[0];
+        face_header.mExtents[1] = face.mExtents[1];
+        face_header.mExtents[2] = *face.mCenter;
+        face_header.mTexCoordExtents[0] = face.mTexCoordExtents[0];
+        face_header.mTexCoordExtents[1] = face.mTexCoordExtents[1];
+        face_header.mNormalizedScale = face.mNormalizedScale;
+        append_decoded(out, &face_header, sizeof(face_header));
+
+        if (face.mNumVertices > 0)
+        {
+            if (face.mNumAllocatedVertices == face.mNumVertices)
             {
-                do_invert_normals = true;
-                do_reverse_triangles = !do_reverse_triangles;
+                // positions, normals and texcoords are one contiguous block
+                append_decoded(out, face.mPositions, decoded_vertex_block_size(face.mNumVertices));
             }
+            else
+            {
+                // pushVertex() left slack between the arrays, repack them
+                size_t tc_bytes = face.mNumVertices * sizeof(LLVector2);
+                append_decoded(out, face.mPositions, sizeof(LLVector4a) * face.mNumVertices);
+                append_decoded(out, face.mNormals, sizeof(LLVector4a) * face.mNumVertices);
+                append_decoded(out, face.mTexCoords, tc_bytes);
+                out.resize(out.size() + (decoded_vertex_block_size(face.mNumVertices) - sizeof(LLVector4a) * 2 * face.mNumVertices - tc_bytes));
+            }
+            if (face.mTangents)
+            {
+                append_decoded(out, face.mTangents, sizeof(LLVector4a) * face.mNumVertices);
+            }
+            if (face.mWeights)
+            {
+                append_decoded(out, face.mWeights, sizeof(LLVector4a) * face.mNumVertices);
+            }
+        }
+
+        if (face.mNumIndices > 0)
+        {
+            size_t idx_bytes = face.mNumIndices * sizeof(U16);
+            append_decoded(out, face.mIndices, idx_bytes);
+            out.resize(out.size() + (decoded_index_block_size(face.mNumIndices) - idx_bytes));
+        }
+    }
 
-            // now do the work
+    llassert(out.size() == total);
+    return true;
+}
 
-            if (do_reflect_x)
-            {
-                LLVector4a* p = (LLVector4a*) face.mPositions;
-                LLVector4a* n = (LLVector4a*) face.mNormals;
+bool LLVolume::unpackDecodedFaces(const U8* data, S32 size)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 
-                for (S32 i = 0; i < face.mNumVertices; i++)
-                {
-                    p[i].mul(-1.0f);
-                    n[i].mul(-1.0f);
-                }
-            }
+    if (!data || size < (S32)sizeof(DecodedFacesHeader))
+    {
+        return false;
+    }
 
-            if (do_invert_normals)
-            {
-                LLVector4a* n = (LLVector4a*) face.mNormals;
+    DecodedFacesHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.mMagic != DECODED_FACES_MAGIC
+        || header.mVersion != DECODED_FACES_VERSION
+        || header.mSculptType != mParams.getSculptType()
+        || header.mNumFaces == 0
+        || header.mNumFaces > LL_SCULPT_MESH_MAX_FACES)
+    {
+        return false;
+    }
 
-                for (S32 i = 0; i < face.mNumVertices; i++)
+    const U8* cur = data + sizeof(header);
+    const U8* end = data + size;
+    auto take = [&cur, end](void* dst, size_t bytes)
+    {
+        if ((size_t)(end - cur) < bytes)
+        {
+            return false;
+        }
+        memcpy(dst, cur, bytes);
+        cur += bytes;
+        return true;
+    };
+
+    face_list_t faces(header.mNumFaces);
+    for (LLVolumeFace& face : faces)
+    {
+        DecodedFaceHeader face_header;
+        if (!take(&face_header, sizeof(face_header))
+            || face_header.mNumVertices < 0
+            || face_header.mNumVertices > 65536
+            || face_header.mNumIndices < 0
+            || face_header.mNumIndices % 3 != 0)
+        {
+            return false;
+        }
+
+        face.mExtents[0] = face_header.mExtents[0];
+        face.mExtents[1] = face_header.mExtents[1];
+        *face.mCenter = face_header.mExtents[2];
+        face.mTexCoordExtents[0] = face_header.mTexCoordExtents[0];
+        face.mTexCoordExtents[1] = face_header.mTexCoordExtents[1];
+        face.mNormalizedScale = face_header.mNormalizedScale;
+
+        S32 num_verts = face_header.mNumVertices;
+        if (num_verts > 0)
+        {
+            face.resizeVertices(num_verts);
+            if (!face.mPositions)
+            {
+                LL_WARNS() << "Failed to allocate " << num_verts << " cached vertices" << LL_ENDL;
+                return false;
+            }
+            if (!take(face.mPositions, decoded_vertex_block_size(num_verts)))
+            {
+                return false;
+            }
+            if (face_header.mFlags & DECODED_HAS_TANGENTS)
+            {
+                face.allocateTangents(num_verts);
+                if (!face.mTangents || !take(face.mTangents, sizeof(LLVector4a) * num_verts))
                 {
-                    n[i].mul(-1.0f);
+                    return false;
                 }
             }
-
-            if (do_reverse_triangles)
+            if (face_header.mFlags & DECODED_HAS_WEIGHTS)
             {
-                for (S32 j = 0; j < face.mNumIndices; j += 3)
+                face.allocateWeights(num_verts);
+                if (!face.mWeights || !take(face.mWeights, sizeof(LLVector4a) * num_verts))
                 {
-                    // swap the 2nd and 3rd index
-                    S32 swap = face.mIndices[j+1];
-                    face.mIndices[j+1] = face.mIndices[j+2];
-                    face.mIndices[j+2] = swap;
+                    return false;
                 }
             }
+        }
 
-            //calculate bounding box
-            // VFExtents change
-            LLVector4a& min = face.mExtents[0];
-            LLVector4a& max = face.mExtents[1];
-
-            if (face.mNumVertices < 3)
-            { //empty face, use a dummy 1cm (at 1m scale) bounding box
-                min.splat(-0.005f);
-                max.splat(0.005f);
+        if (face_header.mNumIndices > 0)
+        {
+            face.resizeIndices(face_header.mNumIndices);
+            if (!face.mIndices || !take(face.mIndices, decoded_index_block_size(face_header.mNumIndices)))
+            {
+                return false;
             }
-            else
+            for (S32 i = 0; i < face.mNumIndices; ++i)
             {
-                min = max = face.mPositions[0];
-
-                for (S32 i = 1; i < face.mNumVertices; ++i)
+                if (face.mIndices[i] >= num_verts)
                 {
-                    min.setMin(min, face.mPositions[i]);
-                    max.setMax(max, face.mPositions[i]);
-                }
-
-                if (face.mTexCoords)
-                {
-                    LLVector2& min_tc = face.mTexCoordExtents[0];
-                    LLVector2& max_tc = face.mTexCoordExtents[1];
-
-                    min_tc = face.mTexCoords[0];
-                    max_tc = face.mTexCoords[0];
-
-                    for (S32 j = 1; j < face.mNumVertices; ++j)
-                    {
-                        update_min_max(min_tc, max_tc, face.mTexCoords[j]);
-                    }
-                }
-                else
-                {
-                    face.mTexCoordExtents[0].set(0,0);
-                    face.mTexCoordExtents[1].set(1,1);
+                    LL_WARNS() << "Cached face index out of range" << LL_ENDL;
+                    return false;
                 }
             }
         }
+
+        face.mOptimized = true;
     }
 
-    if (!cacheOptimize(true))
+    if (cur != end)
     {
-        // Out of memory?
-        LL_WARNS() << "Failed to optimize!" << LL_ENDL;
-        mVolumeFaces.clear();
         return false;
     }
 
+    mVolumeFaces.swap(faces);
     mSculptLevel = 0;  // success!
 
     return true;
@@ -43,6 +43,11 @@ class LLVolume;
 class LLVolumeTriangle;
 class LLVolumeOctree;
 
+namespace LL
+{
+    class WorkQueueBase;
+}
+
 #include "lluuid.h"
 #include "v4color.h"
 #include "v2math.h"
@@ -1112,10 +1117,25 @@ protected:
     bool generate();
     void createVolumeFaces();
 public:
-    bool unpackVolumeFaces(std::istream& is, S32 size);
-    bool unpackVolumeFaces(U8* in_data, S32 size);
+    // If queue is given, the faces of a large LOD are unpacked in parallel
+    // with help from its workers. Safe to call from one of those workers.
+    bool unpackVolumeFaces(std::istream& is, S32 size, LL::WorkQueueBase* queue = nullptr);
+    bool unpackVolumeFaces(U8* in_data, S32 size, LL::WorkQueueBase* queue = nullptr);
+
+    // Minimum vertex count in a LOD before unpackVolumeFaces() uses the queue
+    static S32 sParallelUnpackMinVertices;
+
+    // Flat image of faces that have already been unpacked and optimized:
+    // the position/normal/texcoord block, tangents, weights and indices are
+    // stored exactly as they sit in memory, so unpackDecodedFaces() only has
+    // to copy them back. Used to cache decoded mesh LODs on disk. An image
+    // written by another format version or for other mirror/invert sculpt
+    // flags is rejected.
+    bool packDecodedFaces(std::vector<U8>& out) const;
+    bool unpackDecodedFaces(const U8* data, S32 size);
 private:
-    bool unpackVolumeFacesInternal(const LLSD& mdl);
+    bool unpackVolumeFacesInternal(const LLSD& mdl, LL::WorkQueueBase* queue);
+    void unpackVolumeFace(const LLSD& face_sd, LLVolumeFace& face, size_t face_index, size_t face_count) const;
 
 public:
     virtual void setMeshAssetLoaded(bool loaded);
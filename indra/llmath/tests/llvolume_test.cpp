@@ -0,0 +1,213 @@
+/**
+ * @file   llvolume_test.cpp
+ * @brief  Test for mesh face unpacking in llvolume.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llvolume.h"
+// STL headers
+#include <thread>
+#include <vector>
+// other Linden headers
+#include "../test/lltut.h"
+#include "llsdserialize.h"
+#include "workqueue.h"
+
+namespace
+{
+    // Binary blob holding n quantized U16 values produced by gen(i)
+    template <typename GEN>
+    LLSD::Binary make_u16s(size_t n, GEN gen)
+    {
+        LLSD::Binary out(n * sizeof(U16));
+        U16* p = (U16*)out.data();
+        for (size_t i = 0; i < n; ++i)
+        {
+            p[i] = gen(i);
+        }
+        return out;
+    }
+
+    // A wavy grid of side x side vertices, as the mesh uploader would
+    // encode it
+    LLSD make_face(U32 side, U32 seed, bool weights)
+    {
+        const U32 num_verts = side * side;
+        LLSD face;
+        face["Position"] = make_u16s(num_verts * 3, [side, seed](size_t i)
+            {
+                size_t v = i / 3;
+                switch (i % 3)
+                {
+                case 0:  return U16(v % side * 65535 / (side - 1));
+                case 1:  return U16(v / side * 65535 / (side - 1));
+                default: return U16((v * 7919 + seed * 104729) & 0xffff);
+                }
+            });
+        face["Normal"] = make_u16s(num_verts * 3, [seed](size_t i) { return U16((i * 40503 + seed) & 0xffff); });
+        face["TexCoord0"] = make_u16s(num_verts * 2, [side](size_t i) { return U16((i / 2) % side * 65535 / (side - 1)); });
+
+        std::vector<U16> tris;
+        for (U32 y = 0; y + 1 < side; ++y)
+        {
+            for (U32 x = 0; x + 1 < side; ++x)
+            {
+                U16 a = U16(y * side + x), b = U16(a + 1), c = U16(a + side), d = U16(c + 1);
+                tris.insert(tris.end(), { a, b, c, b, d, c });
+            }
+        }
+        face["TriangleList"] = make_u16s(tris.size(), [&tris](size_t i) { return tris[i]; });
+
+        face["PositionDomain"]["Min"] = LLVector3(-0.5f, -0.5f, -0.25f).getValue();
+        face["PositionDomain"]["Max"] = LLVector3(0.5f, 0.5f, 0.25f).getValue();
+        face["TexCoord0Domain"]["Min"] = LLVector2(0.f, 0.f).getValue();
+        face["TexCoord0Domain"]["Max"] = LLVector2(1.f, 1.f).getValue();
+
+        if (weights)
+        {
+            // one influence per vertex: joint, U16 weight, end marker
+            LLSD::Binary w;
+            for (U32 i = 0; i < num_verts; ++i)
+            {
+                w.insert(w.end(), { U8(i % 20), U8(0xff), U8(0x7f), U8(0xff) });
+            }
+            face["Weights"] = w;
+        }
+        return face;
+    }
+
+    std::string make_lod(U32 num_faces, U32 side)
+    {
+        LLSD mdl = LLSD::emptyArray();
+        for (U32 i = 0; i < num_faces; ++i)
+        {
+            mdl.append(make_face(side, i, i == 1));
+        }
+        return zip_llsd(mdl);
+    }
+
+    LLPointer<LLVolume> make_volume()
+    {
+        LLVolumeParams params;
+        params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+        params.setSculptID(LLUUID("4d4e7e1e-5a3b-4c1f-8a2e-2b8c9e7d6f10"), LL_SCULPT_TYPE_MESH);
+        return new LLVolume(params, 1.f);
+    }
+
+    template <typename T>
+    bool same_bytes(const T* a, const T* b, size_t count)
+    {
+        return (!a && !b) || (a && b && memcmp(a, b, count * sizeof(T)) == 0);
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llvolume_data
+    {
+        llvolume_data()
+        {
+            mSavedMinVertices = LLVolume::sParallelUnpackMinVertices;
+        }
+        ~llvolume_data()
+        {
+            LLVolume::sParallelUnpackMinVertices = mSavedMinVertices;
+        }
+
+        S32 mSavedMinVertices;
+    };
+    typedef test_group<llvolume_data> llvolume_group;
+    typedef llvolume_group::object object;
+    llvolume_group llvolumegrp("llvolume");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("parallel unpackVolumeFaces matches serial");
+
+        std::string lod = make_lod(LL_SCULPT_MESH_MAX_FACES, 48);
+
+        LLPointer<LLVolume> serial = make_volume();
+        ensure("serial unpack", serial->unpackVolumeFaces((U8*)lod.data(), (S32)lod.size()));
+
+        LL::WorkQueue queue("llvolume_test");
+        std::vector<std::thread> workers;
+        for (S32 i = 0; i < 3; ++i)
+        {
+            workers.emplace_back([&queue]() { queue.runUntilClose(); });
+        }
+
+        LLVolume::sParallelUnpackMinVertices = 0;
+        LLPointer<LLVolume> parallel = make_volume();
+        bool unpacked = parallel->unpackVolumeFaces((U8*)lod.data(), (S32)lod.size(), &queue);
+        queue.close();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        ensure("parallel unpack", unpacked);
+
+        ensure_equals("face count", parallel->getNumVolumeFaces(), serial->getNumVolumeFaces());
+        for (S32 i = 0; i < serial->getNumVolumeFaces(); ++i)
+        {
+            const LLVolumeFace& a = serial->getVolumeFace(i);
+            const LLVolumeFace& b = parallel->getVolumeFace(i);
+            std::string face = llformat("face %d ", i);
+            ensure_equals(face + "vertices", b.mNumVertices, a.mNumVertices);
+            ensure_equals(face + "indices", b.mNumIndices, a.mNumIndices);
+            ensure(face + "positions", same_bytes(a.mPositions, b.mPositions, a.mNumVertices));
+            ensure(face + "normals", same_bytes(a.mNormals, b.mNormals, a.mNumVertices));
+            ensure(face + "texcoords", same_bytes(a.mTexCoords, b.mTexCoords, a.mNumVertices));
+            ensure(face + "tangents", same_bytes(a.mTangents, b.mTangents, a.mNumVertices));
+            ensure(face + "weights", same_bytes(a.mWeights, b.mWeights, a.mNumVertices));
+            ensure(face + "index data", same_bytes(a.mIndices, b.mIndices, a.mNumIndices));
+            ensure(face + "extents", same_bytes(a.mExtents, b.mExtents, 2));
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("unpackVolumeFaces without free workers");
+
+        // Nobody services this queue: the caller must do every face itself
+        // rather than wait for help that never comes.
+        LL::WorkQueue queue("llvolume_test_idle");
+        LLVolume::sParallelUnpackMinVertices = 0;
+
+        std::string lod = make_lod(4, 16);
+        LLPointer<LLVolume> volume = make_volume();
+        ensure("unpack", volume->unpackVolumeFaces((U8*)lod.data(), (S32)lod.size(), &queue));
+        ensure_equals("face count", volume->getNumVolumeFaces(), 4);
+        for (S32 i = 0; i < 4; ++i)
+        {
+            ensure("vertices", volume->getVolumeFace(i).mNumVertices > 0);
+        }
+        queue.close();
+        queue.runUntilClose();
+    }
+} // namespace tut
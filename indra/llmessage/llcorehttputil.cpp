@@ -313,11 +313,12 @@ void HttpCoroHandler::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespons
         LLSD &httpStatus = result[HttpCoroutineAdapter::HTTP_RESULTS];
 
         LLCore::BufferArray *body = response->getBody();
-        LLCore::BufferArrayStream bas(body);
+        const char * bodyStart = body ? body->contiguousData() : NULL;
         LLSD::String bodyData;
-        bodyData.reserve(response->getBodySize());
-        bas >> std::noskipws;
-        bodyData.assign(std::istream_iterator<U8>(bas), std::istream_iterator<U8>());
+        if (bodyStart)
+        {
+            bodyData.assign(bodyStart, body->size());
+        }
         httpStatus["error_body"] = LLSD(bodyData);
         if (getBoolSetting(HTTP_LOGBODY_KEY))
         {
@@ -516,38 +517,16 @@ LLSD HttpCoroRawHandler::handleSuccess(LLCore::HttpResponse * response, LLCore::
         return result;
     }
 
-    size_t size = body->size();
-
-    LLCore::BufferArrayStream bas(body);
+    // Bodies sized from their Content-Length are already contiguous,
+    // making this a single copy into the LLSD.
+    const U8 * bodyStart = (const U8 *) body->contiguousData();
+    if (!bodyStart)
+    {
+        // Reported by onCompleted()
+        throw std::bad_alloc();
+    }
 
-#if 1
-    // This is the slower implementation.  It is safe vis-a-vi the const_cast<> and modification
-    // of a LLSD managed array but contains an extra (potentially large) copy.
-    //
-    // *TODO: https://jira.secondlife.com/browse/MAINT-5221
-
-    LLSD::Binary data;
-    data.reserve(size);
-    bas >> std::noskipws;
-    data.assign(std::istream_iterator<U8>(bas), std::istream_iterator<U8>());
-
-    result[HttpCoroutineAdapter::HTTP_RESULTS_RAW] = std::move(data);
-
-#else
-    // This is disabled because it's dangerous.  See the other case for an
-    // alternate implementation.
-    // We create a new LLSD::Binary object and assign it to the result map.
-    // The LLSD has created it's own copy so we retrieve it asBinary and const cast
-    // the reference so that we can modify it.
-    // *TODO: This is potentially dangerous... but I am trying to avoid a potentially
-    // large copy.
-    result[HttpCoroutineAdapter::HTTP_RESULTS_RAW] = LLSD::Binary();
-    LLSD::Binary &data = const_cast<LLSD::Binary &>( result[HttpCoroutineAdapter::HTTP_RESULTS_RAW].asBinary() );
-
-    data.reserve(size);
-    bas >> std::noskipws;
-    data.assign(std::istream_iterator<U8>(bas), std::istream_iterator<U8>());
-#endif
+    result[HttpCoroutineAdapter::HTTP_RESULTS_RAW] = LLSD::Binary(bodyStart, bodyStart + body->size());
 
     return result;
 }
@@ -591,10 +570,16 @@ LLSD HttpCoroJSONHandler::handleSuccess(LLCore::HttpResponse * response, LLCore:
         return result;
     }
 
-    LLCore::BufferArrayStream bas(body);
+    const char * bodyStart = body->contiguousData();
+    if (!bodyStart)
+    {
+        LL_WARNS("CoreHTTP") << "Unable to gather response body for JSON parsing." << LL_ENDL;
+        status = LLCore::HttpStatus(LLCore::HttpStatus::LLCORE, LLCore::HE_BAD_ALLOC);
+        return result;
+    }
 
     boost::system::error_code ec;
-    boost::json::value jsonRoot = boost::json::parse(bas, ec);
+    boost::json::value jsonRoot = boost::json::parse(boost::json::string_view(bodyStart, body->size()), ec);
     if(ec.failed())
     {   // deserialization failed.  Record the reason and pass back an empty map for markup.
         status = LLCore::HttpStatus(499, std::string(ec.what()));
@@ -616,10 +601,16 @@ LLSD HttpCoroJSONHandler::parseBody(LLCore::HttpResponse *response, bool &succes
         return LLSD();
     }
 
-    LLCore::BufferArrayStream bas(body);
+    const char * bodyStart = body->contiguousData();
+    if (!bodyStart)
+    {
+        LL_WARNS("CoreHTTP") << "Unable to gather response body for JSON parsing." << LL_ENDL;
+        success = false;
+        return LLSD();
+    }
 
     boost::system::error_code ec;
-    boost::json::value jsonRoot = boost::json::parse(bas, ec);
+    boost::json::value jsonRoot = boost::json::parse(boost::json::string_view(bodyStart, body->size()), ec);
     if (ec.failed())
     {
         success = false;
@@ -0,0 +1,132 @@
+/**
+ * @file llmessagethread.cpp
+ * @brief Receives and decodes template message packets off the main thread.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmessagethread.h"
+
+#include "llmessagetemplate.h"
+#include "net.h"
+
+// How long the thread blocks on an idle socket before checking whether it
+// should quit
+static const S32 IDLE_WAIT_MS = 50;
+
+LLMessageThread::Packet::~Packet()
+{
+    delete mData;
+}
+
+LLMessageThread::LLMessageThread(S32 socket,
+                                 LLTemplateMessageReader::message_template_number_map_t& message_numbers,
+                                 size_t capacity) :
+    LLThread("MessageThread"),
+    mSocket(socket),
+    mReader(message_numbers),
+    mQueue(capacity)
+{
+}
+
+LLMessageThread::~LLMessageThread()
+{
+    shutdown();
+}
+
+LLMessageThread::Packet* LLMessageThread::popPacket()
+{
+    Packet* packet = NULL;
+    mQueue.tryPop(packet);
+    return packet;
+}
+
+void LLMessageThread::shutdown()
+{
+    // unblocks a thread waiting for room in the queue
+    mQueue.close();
+    LLThread::shutdown();
+
+    Packet* packet = NULL;
+    while (mQueue.tryPop(packet))
+    {
+        delete packet;
+    }
+}
+
+void LLMessageThread::run()
+{
+    while (!isQuitting())
+    {
+        Packet* packet = receivePacket();
+        if (!packet)
+        {
+            wait_for_packet(mSocket, IDLE_WAIT_MS);
+            continue;
+        }
+        if (!mQueue.pushIfOpen(packet))
+        {
+            delete packet;
+            break;
+        }
+    }
+}
+
+LLMessageThread::Packet* LLMessageThread::receivePacket()
+{
+    // see LLMessageSystem::checkMessages()
+    while (true)
+    {
+        S32 receive_size = mPacketRing.receivePacket(mSocket, (char *)mReceiveBuffer);
+        if (receive_size <= 0)
+        {
+            return NULL;
+        }
+
+        Packet* packet = new Packet;
+        packet->mSender = mPacketRing.getLastSender();
+        packet->mReceivingIF = mPacketRing.getLastReceivingInterface();
+        packet->mTrueSize = receive_size;
+        packet->mSize = receive_size;
+        if (receive_size < (S32) LL_MINIMUM_VALID_PACKET_SIZE)
+        {
+            // reported by the main thread
+            return packet;
+        }
+
+        U8* buffer = mReceiveBuffer;
+        if (!LLMessageSystem::extractAcks(buffer, receive_size, packet->mAcks))
+        {
+            delete packet;
+            continue;
+        }
+        packet->mCompressedSize = LLMessageSystem::zeroCodeExpand(&buffer, &receive_size, mExpandBuffer, packet->mOverflowed);
+        packet->mSize = receive_size;
+        memcpy(packet->mHeader, buffer, LL_PACKET_ID_SIZE);
+
+        packet->mData = mReader.decodeMessage(buffer, receive_size, packet->mSender,
+                                              packet->mTemplate, packet->mRanOffEnd);
+        return packet;
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * @file llmessagethread.h
+ * @brief Receives and decodes template message packets off the main thread.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGETHREAD_H
+#define LL_LLMESSAGETHREAD_H
+
+#include "llthread.h"
+#include "llthreadsafequeue.h"
+#include "llpacketring.h"
+#include "lltemplatemessagereader.h"
+#include "message.h"
+
+#include <vector>
+
+// Takes the receive side of LLMessageSystem::checkMessages() to a thread of
+// its own: packets are read from the socket, their appended acks stripped,
+// zero-decoded, and their template and data decoded into a queue.  The main
+// thread pops them in the order they arrived and only does what needs the
+// circuits or the handlers: acks, duplicate and trust checks, and dispatch.
+// Sending, including acks and resends, stays on the main thread.
+class LLMessageThread : public LLThread
+{
+public:
+    struct Packet
+    {
+        ~Packet();
+
+        LLHost mSender;
+        LLHost mReceivingIF;
+        S32 mTrueSize = 0;          // as received, acks included
+        S32 mSize = 0;              // decoded, acks stripped
+        S32 mCompressedSize = 0;    // before zero-decoding, 0 if not zero coded
+        bool mOverflowed = false;   // zero-decoding ran past MAX_BUFFER_SIZE
+        U8 mHeader[LL_PACKET_ID_SIZE] = { 0 };  // flags, packet ID and offset
+        std::vector<TPACKETID> mAcks;
+        // NULL if the message is not registered
+        LLMessageTemplate* mTemplate = NULL;
+        // owned, NULL if the message could not be decoded
+        LLMsgData* mData = NULL;
+        bool mRanOffEnd = false;
+    };
+
+    // message_numbers must outlive the thread and not change while it runs
+    LLMessageThread(S32 socket,
+                    LLTemplateMessageReader::message_template_number_map_t& message_numbers,
+                    size_t capacity = 4096);
+    ~LLMessageThread();
+
+    // Set up before start(), the thread receives through it.  Once started
+    // only dropPackets() and getNumDroppedPackets() may be called on it.
+    LLPacketRing& getPacketRing() { return mPacketRing; }
+
+    // Returns the oldest decoded packet, NULL if none are waiting.  The
+    // caller owns it.
+    Packet* popPacket();
+    size_t getNumQueued() { return mQueue.size(); }
+
+    void shutdown() override;
+
+protected:
+    void run() override;
+
+private:
+    // returns NULL when nothing is waiting on the socket
+    Packet* receivePacket();
+
+    S32 mSocket;
+    LLPacketRing mPacketRing;
+    LLTemplateMessageReader mReader;
+    // a full queue blocks the thread, leaving packets in the socket buffer
+    // like a busy main thread does
+    LLThreadSafeQueue<Packet*> mQueue;
+
+    U8 mReceiveBuffer[MAX_BUFFER_SIZE];
+    U8 mExpandBuffer[MAX_BUFFER_SIZE];
+};
+
+#endif // LL_LLMESSAGETHREAD_H
@@ -82,3 +82,10 @@ void LLPacketBuffer::init(const char* buffer, S32 data_size, const LLHost& host)
     }
 }
 
+void LLPacketBuffer::setReceived(S32 data_size, const LLHost& host, const LLHost& receiving_if)
+{
+    llassert(data_size <= NET_BUFFER_SIZE);
+    mSize = data_size;
+    mHost = host;
+    mReceivingIF = receiving_if;
+}
@@ -46,6 +46,10 @@ public:
     void init(S32 hSocket);
     void init(const char* buffer, S32 data_size, const LLHost& host);
 
+    // For batched receives, which fill the data in place
+    char        *getBuffer()                    { return mData; }
+    void        setReceived(S32 data_size, const LLHost& host, const LLHost& receiving_if);
+
 protected:
     char    mData[NET_BUFFER_SIZE]; // packet data       /* Flawfinder : ignore */
     S32     mSize;                  // size of buffer in bytes
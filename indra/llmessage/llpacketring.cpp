@@ -63,6 +63,12 @@ LLPacketRing::~LLPacketRing ()
         delete packet;
     }
     mPacketRing.clear();
+    for (auto packet : mSendQueue)
+    {
+        delete packet;
+    }
+    mSendQueue.clear();
+    mNumQueuedSends = 0;
     mNumBufferedPackets = 0;
     mNumBufferedBytes = 0;
     mHeadIndex = 0;
@@ -70,10 +76,13 @@ LLPacketRing::~LLPacketRing ()
 
 S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 {
-    bool drop = computeDrop();
+    if (mBatchMode && mNumBufferedPackets == 0)
+    {
+        bufferInboundPackets(socket);
+    }
     return (mNumBufferedPackets > 0) ?
-        receiveOrDropBufferedPacket(datap, drop) :
-        receiveOrDropPacket(socket, datap, drop);
+        receiveOrDropBufferedPacket(datap) :
+        receiveOrDropPacket(socket, datap);
 }
 
 bool send_packet_helper(int socket, const char * datap, S32 data_size, LLHost host)
@@ -104,9 +113,115 @@ bool send_packet_helper(int socket, const char * datap, S32 data_size, LLHost ho
 bool LLPacketRing::sendPacket(int socket, const char * datap, S32 data_size, LLHost host)
 {
     mActualBytesOut += data_size;
+    if (mBatchMode)
+    {
+        return queueOutboundPacket(socket, datap, data_size, host);
+    }
     return send_packet_helper(socket, datap, data_size, host);
 }
 
+bool LLPacketRing::setBatchMode(bool batch)
+{
+#if LL_NET_BATCHED_IO
+    if (!batch && mBatchMode)
+    {
+        flushSends();
+    }
+    if (batch && mSendQueue.empty())
+    {
+        LLHost invalid_host;
+        mSendQueue.resize(NET_BATCH_SIZE, nullptr);
+        for (size_t i = 0; i < mSendQueue.size(); ++i)
+        {
+            mSendQueue[i] = new LLPacketBuffer(invalid_host, nullptr, 0);
+        }
+    }
+    mBatchMode = batch;
+#else
+    if (batch)
+    {
+        LL_WARNS("Messaging") << "Batched UDP I/O is not available on this platform" << LL_ENDL;
+    }
+#endif
+    return mBatchMode;
+}
+
+bool LLPacketRing::queueOutboundPacket(int socket, const char * datap, S32 data_size, LLHost host)
+{
+    if (mNumQueuedSends > 0 && socket != mSendSocket)
+    {
+        flushSends();
+    }
+    if (data_size > NET_BUFFER_SIZE)
+    {
+        // doesn't fit a queue entry, keep the order and send it now
+        flushSends();
+        return send_packet_helper(socket, datap, data_size, host);
+    }
+
+    mSendSocket = socket;
+    mSendQueue[mNumQueuedSends++]->init(datap, data_size, host);
+    if (mNumQueuedSends == (S32)mSendQueue.size())
+    {
+        flushSends();
+    }
+    return true;
+}
+
+S32 LLPacketRing::flushSends()
+{
+    if (mNumQueuedSends == 0)
+    {
+        return 0;
+    }
+
+    S32 sent = 0;
+#if LL_NET_BATCHED_IO
+    const bool use_proxy = LLProxy::isSOCKSProxyEnabled();
+    LLHost proxy_host;
+    if (use_proxy)
+    {
+        proxy_host = LLProxy::getInstance()->getUDPProxy();
+    }
+
+    net_packet_t packets[NET_BATCH_SIZE];
+    proxywrap_t socks_headers[NET_BATCH_SIZE];
+    for (S32 i = 0; i < mNumQueuedSends; ++i)
+    {
+        LLPacketBuffer* packet = mSendQueue[i];
+        net_packet_t& out = packets[i];
+        out.mData = packet->getBuffer();
+        out.mSize = packet->getSize();
+        out.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+        if (use_proxy)
+        {
+            // same wrapping as send_packet_helper(), gathered by the send
+            proxywrap_t& socks_header = socks_headers[i];
+            socks_header.rsv   = 0;
+            socks_header.addr  = packet->getHost().getAddress();
+            socks_header.port  = htons(packet->getHost().getPort());
+            socks_header.atype = ADDRESS_IPV4;
+            socks_header.frag  = 0;
+            out.mPrefix = (char*)&socks_header;
+            out.mPrefixSize = SOCKS_HEADER_SIZE;
+            out.mAddress = proxy_host.getAddress();
+            out.mPort = proxy_host.getPort();
+        }
+        else
+        {
+            out.mPrefix = nullptr;
+            out.mPrefixSize = 0;
+            out.mAddress = packet->getHost().getAddress();
+            out.mPort = packet->getHost().getPort();
+        }
+    }
+    sent = send_packets(mSendSocket, packets, mNumQueuedSends);
+    ++mNumBatchSends;
+#endif
+    mNumQueuedSends = 0;
+    return sent;
+}
+
 void LLPacketRing::dropPackets (U32 num_to_drop)
 {
     mPacketsToDrop += num_to_drop;
@@ -132,7 +247,7 @@ bool LLPacketRing::computeDrop()
     return drop;
 }
 
-S32 LLPacketRing::receiveOrDropPacket(S32 socket, char *datap, bool drop)
+S32 LLPacketRing::receiveOrDropPacket(S32 socket, char *datap)
 {
     S32 packet_size = 0;
 
@@ -148,7 +263,7 @@ S32 LLPacketRing::receiveOrDropPacket(S32 socket, char *datap, bool drop)
 
         if (packet_size > SOCKS_HEADER_SIZE)
         {
-            if (drop)
+            if (computeDrop())
             {
                 packet_size = 0;
             }
@@ -174,7 +289,7 @@ S32 LLPacketRing::receiveOrDropPacket(S32 socket, char *datap, bool drop)
         if (packet_size > 0)
         {
             mActualBytesIn += packet_size;
-            if (drop)
+            if (computeDrop())
             {
                 packet_size = 0;
             }
@@ -188,7 +303,7 @@ S32 LLPacketRing::receiveOrDropPacket(S32 socket, char *datap, bool drop)
     return packet_size;
 }
 
-S32 LLPacketRing::receiveOrDropBufferedPacket(char *datap, bool drop)
+S32 LLPacketRing::receiveOrDropBufferedPacket(char *datap)
 {
     assert(mNumBufferedPackets > 0);
     S32 packet_size = 0;
@@ -207,7 +322,7 @@ S32 LLPacketRing::receiveOrDropBufferedPacket(char *datap, bool drop)
         assert(mNumBufferedBytes == 0);
     }
 
-    if (!drop)
+    if (!computeDrop())
     {
         if (packet_size > 0)
         {
@@ -296,18 +411,100 @@ S32 LLPacketRing::bufferInboundPacket(S32 socket)
     return packet_size;
 }
 
+S32 LLPacketRing::bufferInboundPackets(S32 socket)
+{
+#if LL_NET_BATCHED_IO
+    if (mNumBufferedPackets == mPacketRing.size() && mNumBufferedPackets < MAX_BUFFER_RING_SIZE)
+    {
+        expandRing();
+    }
+
+    const S16 ring_size = (S16)(mPacketRing.size());
+    const S32 count = llmin(ring_size - mNumBufferedPackets, NET_BATCH_SIZE);
+    if (count <= 0)
+    {
+        // ring is maxed out, overwrite older packets one at a time
+        return bufferInboundPacket(socket) > 0 ? 1 : 0;
+    }
+
+    // receive straight into the free slots of the ring, with the SOCKS
+    // wrapper, if any, split off into its own buffer
+    const bool use_proxy = LLProxy::isSOCKSProxyEnabled();
+    net_packet_t packets[NET_BATCH_SIZE];
+    char socks_headers[NET_BATCH_SIZE][SOCKS_HEADER_SIZE];
+    for (S32 i = 0; i < count; ++i)
+    {
+        net_packet_t& in = packets[i];
+        in.mPrefix = use_proxy ? socks_headers[i] : nullptr;
+        in.mPrefixSize = use_proxy ? SOCKS_HEADER_SIZE : 0;
+        in.mData = mPacketRing[(mHeadIndex + i) % ring_size]->getBuffer();
+        in.mSize = 0;
+    }
+
+    const S32 received = receive_packets(socket, packets, count);
+    ++mNumBatchReceives;
+
+    const S16 first_index = mHeadIndex;
+    for (S32 i = 0; i < received; ++i)
+    {
+        const net_packet_t& in = packets[i];
+        S32 packet_size = in.mSize;
+        mActualBytesIn += packet_size;
+
+        LLHost sender(in.mAddress, in.mPort);
+        if (use_proxy)
+        {
+            if (packet_size <= SOCKS_HEADER_SIZE)
+            {
+                // leave the slot for the next packet
+                continue;
+            }
+            // *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+            proxywrap_t * header = static_cast<proxywrap_t*>(static_cast<void*>(socks_headers[i]));
+            sender.setAddress(header->addr);
+            sender.setPort(ntohs(header->port));
+            packet_size -= SOCKS_HEADER_SIZE;
+        }
+
+        // packets after a skipped one sit further along, move them up
+        S16 packet_index = (first_index + i) % ring_size;
+        if (packet_index != mHeadIndex)
+        {
+            std::swap(mPacketRing[packet_index], mPacketRing[mHeadIndex]);
+        }
+        mPacketRing[mHeadIndex]->setReceived(packet_size, sender, LLHost(in.mReceivingIF, INVALID_PORT));
+
+        mHeadIndex = (mHeadIndex + 1) % ring_size;
+        ++mNumBufferedPackets;
+        mNumBufferedBytes += packet_size;
+    }
+    return received;
+#else
+    return bufferInboundPacket(socket) > 0 ? 1 : 0;
+#endif
+}
+
 S32 LLPacketRing::drainSocket(S32 socket)
 {
     // drain into buffer
-    S32 packet_size = 1;
-    S32 num_loops = 0;
+    S32 num_received = 0;
     S32 old_num_packets = mNumBufferedPackets;
-    while (packet_size > 0)
+    if (mBatchMode)
+    {
+        S32 batch_size = 0;
+        while ((batch_size = bufferInboundPackets(socket)) > 0)
+        {
+            num_received += batch_size;
+        }
+    }
+    else
     {
-        packet_size = bufferInboundPacket(socket);
-        ++num_loops;
+        while (bufferInboundPacket(socket) > 0)
+        {
+            ++num_received;
+        }
     }
-    S32 num_dropped_packets = (num_loops - 1 + old_num_packets) - mNumBufferedPackets;
+    S32 num_dropped_packets = (num_received + old_num_packets) - mNumBufferedPackets;
     if (num_dropped_packets > 0)
     {
         // It will eventually be accounted by mDroppedPackets
@@ -358,14 +555,16 @@ F32 LLPacketRing::getBufferLoadRate() const
 
 void LLPacketRing::dumpPacketRingStats()
 {
-    mNumDroppedPacketsTotal += mNumDroppedPackets;
+    S32 num_dropped_packets = mNumDroppedPackets.exchange(0);
+    mNumDroppedPacketsTotal += num_dropped_packets;
     LL_INFOS("Messaging") << "Packet ring stats: " << std::endl
                           << "Buffered packets: " << mNumBufferedPackets << std::endl
                           << "Buffered bytes: " << mNumBufferedBytes << std::endl
-                          << "Dropped packets current: " << mNumDroppedPackets << std::endl
-                          << "Dropped packets total: " << mNumDroppedPacketsTotal << std::endl
+                          << "Dropped packets current: " << num_dropped_packets << std::endl
+                          << "Dropped packets total: " << mNumDroppedPacketsTotal.load() << std::endl
                           << "Dropped packets percentage: " << mDropPercentage << "%" << std::endl
                           << "Actual in bytes: " << mActualBytesIn << std::endl
-                          << "Actual out bytes: " << mActualBytesOut << LL_ENDL;
-    mNumDroppedPackets = 0;
+                          << "Actual out bytes: " << mActualBytesOut << std::endl
+                          << "Batched receives: " << mNumBatchReceives << std::endl
+                          << "Batched sends: " << mNumBatchSends << LL_ENDL;
 }
@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include "llhost.h"
@@ -49,8 +50,21 @@ public:
     // drains packets from socket and returns final mNumBufferedPackets
     S32 drainSocket(S32 socket);
 
+    // In batch mode packets are received from the socket as many as fit
+    // in the ring per recvmmsg() call, and sent packets are queued until
+    // flushSends() or a full batch goes out with one sendmmsg() call.
+    // Returns whether the mode is on, it needs LL_NET_BATCHED_IO.
+    bool setBatchMode(bool batch);
+    bool getBatchMode() const { return mBatchMode; }
+
+    // sends queued packets, returns the count sent
+    S32 flushSends();
+
+    // dropPackets() and getNumDroppedPackets() may be called from another
+    // thread than the one receiving, see LLMessageThread
     void dropPackets(U32);
     void setDropPercentage (F32 percent_to_drop);
+    F32 getDropPercentage() const { return mDropPercentage; }
 
     inline LLHost getLastSender() const;
     inline LLHost getLastReceivingInterface() const;
@@ -59,6 +73,8 @@ public:
     S32 getActualOutBytes() const { return mActualBytesOut; }
     S32 getAndResetActualInBits()   { S32 bits = mActualBytesIn * 8; mActualBytesIn = 0; return bits;}
     S32 getAndResetActualOutBits()  { S32 bits = mActualBytesOut * 8; mActualBytesOut = 0; return bits;}
+    // for packets received through another ring, see LLMessageThread
+    void addActualInBytes(S32 bytes) { mActualBytesIn += bytes; }
 
     S32 getNumBufferedPackets() const { return (S32)(mNumBufferedPackets); }
     S32 getNumBufferedBytes() const { return mNumBufferedBytes; }
@@ -67,16 +83,24 @@ public:
     F32 getBufferLoadRate() const; // from 0 to 4 (0 - empty, 1 - default size is full)
     void dumpPacketRingStats();
 protected:
-    // returns 'true' if we should intentionally drop a packet
+    // returns 'true' if we should intentionally drop a packet, only asked
+    // once a packet is there so requested drops are not spent on an empty
+    // socket
     bool computeDrop();
 
     // returns packet_size of received packet, zero or less if no packet found
-    S32 receiveOrDropPacket(S32 socket, char *datap, bool drop);
-    S32 receiveOrDropBufferedPacket(char *datap, bool drop);
+    S32 receiveOrDropPacket(S32 socket, char *datap);
+    S32 receiveOrDropBufferedPacket(char *datap);
 
     // returns packet_size of packet buffered
     S32 bufferInboundPacket(S32 socket);
 
+    // returns count of packets taken from the socket in one batch
+    S32 bufferInboundPackets(S32 socket);
+
+    // returns 'true' if the packet was queued or sent
+    bool queueOutboundPacket(int socket, const char * datap, S32 data_size, LLHost host);
+
     // returns 'true' if ring was expanded
     bool expandRing();
 
@@ -84,14 +108,21 @@ protected:
     std::vector<LLPacketBuffer*> mPacketRing;
     S16 mHeadIndex { 0 };
     S16 mNumBufferedPackets { 0 };
-    S32 mNumDroppedPackets { 0 };
-    S32 mNumDroppedPacketsTotal { 0 };
+    std::atomic<S32> mNumDroppedPackets { 0 };
+    std::atomic<S32> mNumDroppedPacketsTotal { 0 };
     S32 mNumBufferedBytes { 0 };
 
     S32 mActualBytesIn { 0 };
     S32 mActualBytesOut { 0 };
     F32 mDropPercentage { 0.0f };   // % of inbound packets to drop
-    U32 mPacketsToDrop { 0 };       // drop next inbound n packets
+    std::atomic<U32> mPacketsToDrop { 0 };  // drop next inbound n packets
+
+    bool mBatchMode { false };
+    std::vector<LLPacketBuffer*> mSendQueue;    // preallocated NET_BATCH_SIZE packets
+    S32 mNumQueuedSends { 0 };
+    int mSendSocket { -1 };
+    U32 mNumBatchReceives { 0 };
+    U32 mNumBatchSends { 0 };
 
     // These are the sender and receiving_interface for the last packet delivered by receivePacket()
     LLHost mLastSender;
@@ -43,7 +43,9 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
     mReceiveSize(0),
     mCurrentRMessageTemplate(NULL),
     mCurrentRMessageData(NULL),
-    mMessageNumbers(number_template_map)
+    mMessageNumbers(number_template_map),
+    mOffThread(false),
+    mRanOffEndOfPacket(false)
 {
 }
 
@@ -525,7 +527,15 @@ void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S3
 //              << mCurrentRecvPacketID << " "
                 << getMessageName() << LL_ENDL;
     }
-    gMessageSystem->callExceptionFunc(MX_RAN_OFF_END_OF_PACKET);
+    if (mOffThread)
+    {
+        // reported by the main thread, see LLMessageThread
+        mRanOffEndOfPacket = true;
+    }
+    else
+    {
+        gMessageSystem->callExceptionFunc(MX_RAN_OFF_END_OF_PACKET);
+    }
 }
 
 static LLTrace::BlockTimerStatHandle FTM_PROCESS_MESSAGES("Process Messages");
@@ -535,6 +545,17 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 {
     LL_RECORD_BLOCK_TIME(FTM_PROCESS_MESSAGES);
 
+    if (!buildData(buffer, sender))
+    {
+        return false;
+    }
+    callHandler(sender);
+    return true;
+}
+
+// build mCurrentRMessageData from a given message
+bool LLTemplateMessageReader::buildData(const U8* buffer, const LLHost& sender )
+{
     llassert( mReceiveSize >= 0 );
     llassert( mCurrentRMessageTemplate);
     llassert( !mCurrentRMessageData );
@@ -700,7 +721,11 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
         LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
         return false;
     }
+    return true;
+}
 
+void LLTemplateMessageReader::callHandler(const LLHost& sender)
+{
     {
         static LLTimer decode_timer;
 
@@ -747,7 +772,6 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
             }
         }
     }
-    return true;
 }
 
 bool LLTemplateMessageReader::validateMessage(const U8* buffer,
@@ -757,15 +781,18 @@ bool LLTemplateMessageReader::validateMessage(const U8* buffer,
 {
     mReceiveSize = buffer_size;
     bool valid = decodeTemplate(buffer, buffer_size, &mCurrentRMessageTemplate );
-    if(valid)
-    {
-        mCurrentRMessageTemplate->mReceiveCount++;
-        //LL_DEBUGS() << "MessageRecvd:"
-        //                       << mCurrentRMessageTemplate->mName
-        //                       << " from " << sender << LL_ENDL;
-    }
+    return valid && checkTemplate(sender, trusted);
+}
+
+bool LLTemplateMessageReader::checkTemplate(const LLHost& sender, bool trusted)
+{
+    bool valid = true;
+    mCurrentRMessageTemplate->mReceiveCount++;
+    //LL_DEBUGS() << "MessageRecvd:"
+    //                       << mCurrentRMessageTemplate->mName
+    //                       << " from " << sender << LL_ENDL;
 
-    if (valid && isBanned(trusted))
+    if (isBanned(trusted))
     {
         LL_WARNS("Messaging") << "LLMessageSystem::checkMessages "
             << "received banned message "
@@ -792,6 +819,63 @@ bool LLTemplateMessageReader::readMessage(const U8* buffer,
     return decodeData(buffer, sender);
 }
 
+LLMsgData* LLTemplateMessageReader::decodeMessage(const U8* buffer, S32 buffer_size, const LLHost& sender,
+                                                  LLMessageTemplate*& msg_template, bool& ran_off_end)
+{
+    clearMessage();
+    msg_template = NULL;
+    ran_off_end = false;
+
+    mReceiveSize = buffer_size;
+    if (!decodeTemplate(buffer, buffer_size, &mCurrentRMessageTemplate))
+    {
+        clearMessage();
+        return NULL;
+    }
+    msg_template = mCurrentRMessageTemplate;
+
+    mOffThread = true;
+    mRanOffEndOfPacket = false;
+    bool built = buildData(buffer, sender);
+    ran_off_end = mRanOffEndOfPacket;
+    mOffThread = false;
+
+    LLMsgData* msg_data = NULL;
+    if (built)
+    {
+        msg_data = mCurrentRMessageData;
+        mCurrentRMessageData = NULL;
+    }
+    clearMessage();
+    return msg_data;
+}
+
+bool LLTemplateMessageReader::validateDecodedMessage(LLMessageTemplate* msg_template,
+                                                     LLMsgData* msg_data,
+                                                     S32 buffer_size,
+                                                     const LLHost& sender,
+                                                     bool trusted)
+{
+    clearMessage();
+    mReceiveSize = buffer_size;
+    mCurrentRMessageTemplate = msg_template;
+    mCurrentRMessageData = msg_data;
+    return msg_template && checkTemplate(sender, trusted);
+}
+
+bool LLTemplateMessageReader::dispatchMessage(const LLHost& sender)
+{
+    LL_RECORD_BLOCK_TIME(FTM_PROCESS_MESSAGES);
+
+    if (!mCurrentRMessageTemplate || !mCurrentRMessageData)
+    {
+        // an empty message, see buildData()
+        return false;
+    }
+    callHandler(sender);
+    return true;
+}
+
 //virtual
 const char* LLTemplateMessageReader::getMessageName() const
 {
@@ -102,6 +102,21 @@ public:
                          const LLHost& sender, bool trusted = false);
     bool readMessage(const U8* buffer, const LLHost& sender);
 
+    // For LLMessageThread: finds the template and builds the data of a
+    // message like validateMessage() and readMessage(), without the ban
+    // checks or calling its handler and without touching anything the main
+    // thread uses. The caller owns the returned data, NULL if the message
+    // could not be decoded. msg_template is NULL if it is not registered.
+    LLMsgData* decodeMessage(const U8* buffer, S32 buffer_size, const LLHost& sender,
+                             LLMessageTemplate*& msg_template, bool& ran_off_end);
+
+    // Main thread half of the above: takes the decoded message, which may
+    // have no template or data, and checks it like validateMessage().
+    bool validateDecodedMessage(LLMessageTemplate* msg_template, LLMsgData* msg_data,
+                                S32 buffer_size, const LLHost& sender, bool trusted = false);
+    // Calls the handler of the message passed to validateDecodedMessage()
+    bool dispatchMessage(const LLHost& sender);
+
     bool isTrusted() const;
     bool isBanned(bool trusted_source) const;
     bool isUdpBanned() const;
@@ -117,11 +132,18 @@ private:
     void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
     bool decodeData(const U8* buffer, const LLHost& sender );
+    bool buildData(const U8* buffer, const LLHost& sender );
+    void callHandler(const LLHost& sender);
+    bool checkTemplate(const LLHost& sender, bool trusted);
 
     S32 mReceiveSize;
     LLMessageTemplate* mCurrentRMessageTemplate;
     LLMsgData* mCurrentRMessageData;
     message_template_number_map_t& mMessageNumbers;
+
+    // set by decodeMessage(), which must not call the exception callbacks
+    bool mOffThread;
+    bool mRanOffEndOfPacket;
 };
 
 #endif // LL_LLTEMPLATEMESSAGEREADER_H
@@ -38,6 +38,7 @@
 #endif
 #include <iomanip>
 #include <iterator>
+#include <memory>
 #include <sstream>
 
 #include "llapr.h"
@@ -55,6 +56,7 @@
 #include "llmd5.h"
 #include "llmessagebuilder.h"
 #include "llmessageconfig.h"
+#include "llmessagethread.h"
 #include "lltemplatemessagedispatcher.h"
 #include "llpumpio.h"
 #include "lltemplatemessagebuilder.h"
@@ -191,6 +193,8 @@ void LLMessageSystem::init()
 
     mMessageBuilder = NULL;
     LockMessageReader(mMessageReader, NULL);
+
+    mNetworkThread = NULL;
 }
 
 // Read file and build message templates
@@ -321,12 +325,16 @@ void LLMessageSystem::loadTemplateFile(const std::string& filename, bool failure
 
 LLMessageSystem::~LLMessageSystem()
 {
+    // before the templates it decodes with go away
+    stopNetworkThread();
+
     mMessageTemplates.clear(); // don't delete templates.
     for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
     mMessageNumbers.clear();
 
     if (!mbError)
     {
+        mPacketRing.flushSends();
         end_net(mSocket);
     }
     mSocket = 0;
@@ -509,17 +517,33 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
         bool recv_reliable = false;
         bool recv_resent = false;
         S32 acks = 0;
-        S32 true_rcv_size = 0;
 
         U8* buffer = mTrueReceiveBuffer;
 
-        mTrueReceiveSize = mPacketRing.receivePacket(mSocket, (char *)mTrueReceiveBuffer);
-        // If you want to dump all received packets into Alchemy.log, uncomment this
-        //dumpPacketToLog();
+        // received and decoded by mNetworkThread in threaded mode
+        std::unique_ptr<LLMessageThread::Packet> packet;
+        if (mNetworkThread)
+        {
+            packet.reset(mNetworkThread->popPacket());
+            mTrueReceiveSize = 0;
+            if (packet)
+            {
+                mTrueReceiveSize = packet->mTrueSize;
+                mLastSender = packet->mSender;
+                mLastReceivingIF = packet->mReceivingIF;
+                mPacketRing.addActualInBytes(packet->mTrueSize);
+            }
+        }
+        else
+        {
+            mTrueReceiveSize = mPacketRing.receivePacket(mSocket, (char *)mTrueReceiveBuffer);
+            // If you want to dump all received packets into Alchemy.log, uncomment this
+            //dumpPacketToLog();
 
+            mLastSender = mPacketRing.getLastSender();
+            mLastReceivingIF = mPacketRing.getLastReceivingInterface();
+        }
         receive_size = mTrueReceiveSize;
-        mLastSender = mPacketRing.getLastSender();
-        mLastReceivingIF = mPacketRing.getLastReceivingInterface();
 
         if (receive_size < (S32) LL_MINIMUM_VALID_PACKET_SIZE)
         {
@@ -538,29 +562,31 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
             LLHost host;
             LLCircuitData* cdp;
 
-            // note if packet acks are appended.
-            if(buffer[0] & LL_ACK_FLAG)
+            if (packet)
             {
-                acks += buffer[--receive_size];
-                true_rcv_size = receive_size;
-                if(receive_size >= ((S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE)))
-                {
-                    receive_size -= acks * sizeof(TPACKETID);
-                }
-                else
+                // Acks stripped and zero-decoded on the thread, only the
+                // header is left of the packet
+                mReceivedAcks.swap(packet->mAcks);
+                receive_size = packet->mSize;
+                mIncomingCompressedSize = packet->mCompressedSize;
+                countExpandedPacket(packet->mCompressedSize, packet->mSize, packet->mOverflowed);
+                buffer = packet->mHeader;
+            }
+            else
+            {
+                // note if packet acks are appended.
+                if (!extractAcks(buffer, receive_size, mReceivedAcks))
                 {
                     // mal-formed packet. ignore it and continue with
                     // the next one
-                    LL_WARNS("Messaging") << "Malformed packet received. Packet size "
-                        << receive_size << " with invalid no. of acks " << acks
-                        << LL_ENDL;
                     valid_packet = false;
                     continue;
                 }
-            }
 
-            // process the message as normal
-            mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+                // process the message as normal
+                mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+            }
+            acks = (S32)mReceivedAcks.size();
             mCurrentRecvPacketID = ntohl(*((U32*)(&buffer[1])));
             host = getSender();
 
@@ -571,16 +597,10 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
             // this message came in on if it's valid, and NULL if the
             // circuit was bogus.
 
-            if(cdp && (acks > 0) && ((S32)(acks * sizeof(TPACKETID)) < (true_rcv_size)))
+            if(cdp && (acks > 0))
             {
-                TPACKETID packet_id;
-                U32 mem_id=0;
-                for(S32 i = 0; i < acks; ++i)
+                for (TPACKETID packet_id : mReceivedAcks)
                 {
-                    true_rcv_size -= sizeof(TPACKETID);
-                    memcpy(&mem_id, &mTrueReceiveBuffer[true_rcv_size], /* Flawfinder: ignore*/
-                         sizeof(TPACKETID));
-                    packet_id = ntohl(mem_id);
                     //LL_INFOS("Messaging") << "got ack: " << packet_id << LL_ENDL;
                     cdp->ackReliablePacket(packet_id);
                 }
@@ -644,11 +664,25 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
             // But we don't want to acknowledge UseCircuitCode until the circuit is
             // available, which is why the acknowledgement test is done above.  JC
             bool trusted = cdp && cdp->getTrusted();
-            valid_packet = mTemplateMessageReader->validateMessage(
-                buffer,
-                receive_size,
-                host,
-                trusted);
+            if (packet)
+            {
+                // the reader takes the decoded data
+                valid_packet = mTemplateMessageReader->validateDecodedMessage(
+                    packet->mTemplate,
+                    packet->mData,
+                    receive_size,
+                    host,
+                    trusted);
+                packet->mData = NULL;
+            }
+            else
+            {
+                valid_packet = mTemplateMessageReader->validateMessage(
+                    buffer,
+                    receive_size,
+                    host,
+                    trusted);
+            }
             if (!valid_packet)
             {
                 clearReceiveState();
@@ -681,7 +715,18 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
             if ( valid_packet )
             {
                 logValidMsg(cdp, host, recv_reliable, recv_resent, acks>0 );
-                valid_packet = mTemplateMessageReader->readMessage(buffer, host);
+                if (packet)
+                {
+                    if (packet->mRanOffEnd)
+                    {
+                        callExceptionFunc(MX_RAN_OFF_END_OF_PACKET);
+                    }
+                    valid_packet = mTemplateMessageReader->dispatchMessage(host);
+                }
+                else
+                {
+                    valid_packet = mTemplateMessageReader->readMessage(buffer, host);
+                }
             }
 
             // It's possible that the circuit went away, because ANY message can disable the circuit
@@ -818,13 +863,74 @@ void LLMessageSystem::processAcks(LockMessageChecker&, F32 collect_time)
         mResendDumpTime = mt_sec;
         mCircuitInfo.dumpResends();
     }
+
+    // Send what this frame queued in batch mode, acks and resends included
+    mPacketRing.flushSends();
 }
 
 S32 LLMessageSystem::drainUdpSocket()
 {
+    if (mNetworkThread)
+    {
+        // the thread keeps the socket drained, report what it buffered
+        return (S32)mNetworkThread->getNumQueued();
+    }
     return mPacketRing.drainSocket(mSocket);
 }
 
+bool LLMessageSystem::startNetworkThread()
+{
+    if (mNetworkThread)
+    {
+        return true;
+    }
+    if (mbError || mPacketRing.getNumBufferedPackets() > 0)
+    {
+        LL_WARNS("Messaging") << "Not starting the network thread, packets are already being received" << LL_ENDL;
+        return false;
+    }
+
+    mNetworkThread = new LLMessageThread(mSocket, mMessageNumbers);
+    LLPacketRing& ring = mNetworkThread->getPacketRing();
+    ring.setDropPercentage(mPacketRing.getDropPercentage());
+    ring.setBatchMode(mPacketRing.getBatchMode());
+    mNetworkThread->start();
+    LL_INFOS("Messaging") << "Receiving messages on a network thread" << LL_ENDL;
+    return true;
+}
+
+void LLMessageSystem::dropPackets(U32 num_to_drop)
+{
+    if (mNetworkThread)
+    {
+        mNetworkThread->getPacketRing().dropPackets(num_to_drop);
+    }
+    else
+    {
+        mPacketRing.dropPackets(num_to_drop);
+    }
+}
+
+S32 LLMessageSystem::getNumDroppedPackets() const
+{
+    if (mNetworkThread)
+    {
+        return mNetworkThread->getPacketRing().getNumDroppedPackets();
+    }
+    return mPacketRing.getNumDroppedPackets();
+}
+
+void LLMessageSystem::stopNetworkThread()
+{
+    if (mNetworkThread)
+    {
+        // packets still queued are dropped
+        mNetworkThread->shutdown();
+        delete mNetworkThread;
+        mNetworkThread = NULL;
+    }
+}
+
 void LLMessageSystem::copyMessageReceivedToSend()
 {
     // NOTE: babbage: switch builder to match reader to avoid
@@ -2824,6 +2930,33 @@ S32 LLMessageSystem::zeroCodeAdjustCurrentSendTotal()
 
 
 S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
+{
+    bool overflowed = false;
+    S32 in_size = zeroCodeExpand(data, data_size, mEncodedRecvBuffer, overflowed);
+    countExpandedPacket(in_size, *data_size, overflowed);
+    return in_size;
+}
+
+void LLMessageSystem::countExpandedPacket(S32 in_size, S32 data_size, bool overflowed)
+{
+    if (overflowed)
+    {
+        callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+    }
+
+    if (!in_size)
+    {
+        mTotalBytesIn += data_size;
+        return;
+    }
+    mTotalBytesIn += in_size;
+    mCompressedPacketsIn++;
+    mCompressedBytesIn += in_size;
+    mUncompressedBytesIn += data_size;
+}
+
+//static
+S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size, U8* expand_buffer, bool& overflowed)
 {
     if ((*data_size ) < LL_MINIMUM_VALID_PACKET_SIZE)
     {
@@ -2831,8 +2964,6 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
             << LL_ENDL;
     }
 
-    mTotalBytesIn += *data_size;
-
     // if we're not zero-coded, simply return.
     if (!(*data[0] & LL_ZERO_CODE_FLAG))
     {
@@ -2840,15 +2971,13 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
     }
 
     S32 in_size = *data_size;
-    mCompressedPacketsIn++;
-    mCompressedBytesIn += *data_size;
 
     *data[0] &= (~LL_ZERO_CODE_FLAG);
 
     S32 count = (*data_size);
 
     U8 *inptr = (U8 *)*data;
-    U8 *outptr = (U8 *)mEncodedRecvBuffer;
+    U8 *outptr = (U8 *)expand_buffer;
 
 // skip the packet id field
 
@@ -2865,11 +2994,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
     while (count--)
     {
-        if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+        if (outptr > (&expand_buffer[MAX_BUFFER_SIZE-1]))
         {
             LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-            callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-            outptr = mEncodedRecvBuffer;
+            overflowed = true;
+            outptr = expand_buffer;
             break;
         }
         if (!((*outptr++ = *inptr++)))
@@ -2877,11 +3006,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
             while (((count--)) && (!(*inptr)))
             {
                 *outptr++ = *inptr++;
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
+                if (outptr > (&expand_buffer[MAX_BUFFER_SIZE-256]))
                 {
                     LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;
+                    overflowed = true;
+                    outptr = expand_buffer;
                     count = -1;
                     break;
                 }
@@ -2896,11 +3025,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
             else
             {
-                if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
+                if (outptr > (&expand_buffer[MAX_BUFFER_SIZE-(*inptr)]))
                 {
                     LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-                    callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-                    outptr = mEncodedRecvBuffer;
+                    overflowed = true;
+                    outptr = expand_buffer;
                 }
                 memset(outptr,0,(*inptr) - 1);
                 outptr += ((*inptr) - 1);
@@ -2909,13 +3038,44 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
         }
     }
 
-    *data = mEncodedRecvBuffer;
-    *data_size = (S32)(outptr - mEncodedRecvBuffer);
-    mUncompressedBytesIn += *data_size;
+    *data = expand_buffer;
+    *data_size = (S32)(outptr - expand_buffer);
 
     return(in_size);
 }
 
+//static
+bool LLMessageSystem::extractAcks(U8* buffer, S32& receive_size, std::vector<TPACKETID>& acks)
+{
+    acks.clear();
+    if (!(buffer[0] & LL_ACK_FLAG))
+    {
+        return true;
+    }
+
+    S32 ack_count = buffer[--receive_size];
+    if (receive_size < ((S32)(ack_count * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE)))
+    {
+        LL_WARNS("Messaging") << "Malformed packet received. Packet size "
+            << receive_size << " with invalid no. of acks " << ack_count
+            << LL_ENDL;
+        return false;
+    }
+
+    // read back to front, the last ack appended first
+    S32 ack_pos = receive_size;
+    receive_size -= ack_count * sizeof(TPACKETID);
+    U32 mem_id = 0;
+    for (S32 i = 0; i < ack_count; ++i)
+    {
+        ack_pos -= sizeof(TPACKETID);
+        memcpy(&mem_id, &buffer[ack_pos], /* Flawfinder: ignore*/
+             sizeof(TPACKETID));
+        acks.push_back(ntohl(mem_id));
+    }
+    return true;
+}
+
 
 void LLMessageSystem::addTemplate(LLMessageTemplate *templatep)
 {
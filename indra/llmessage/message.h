@@ -185,6 +185,7 @@ class LLSDMessageBuilder;
 class LLMessageReader;
 class LLTemplateMessageReader;
 class LLSDMessageReader;
+class LLMessageThread;
 
 
 
@@ -420,6 +421,18 @@ public:
     // returns total number of buffered packets after the drain
     S32     drainUdpSocket();
 
+    // Receive, zero-decode and decode packets on a thread of their own,
+    // leaving checkMessages() the circuit bookkeeping and the handlers.
+    // Call before any packets are received.
+    bool    startNetworkThread();
+    void    stopNetworkThread();
+    bool    isNetworkThreaded() const { return mNetworkThread != NULL; }
+
+    // On the ring packets are received through, the network thread's one
+    // when it runs
+    void    dropPackets(U32 num_to_drop);
+    S32     getNumDroppedPackets() const;
+
     bool    isMessageFast(const char *msg);
     bool    isMessage(const char *msg)
     {
@@ -541,6 +554,13 @@ public:
     S32     zeroCodeExpand(U8 **data, S32 *data_size);
     S32     zeroCodeAdjustCurrentSendTotal();
 
+    // Thread safe parts of the above, for LLMessageThread. Expands into
+    // expand_buffer, MAX_BUFFER_SIZE bytes, without counting the packet.
+    static S32 zeroCodeExpand(U8 **data, S32 *data_size, U8* expand_buffer, bool& overflowed);
+    // Strips the acks appended to a received packet into 'acks', returns
+    // false if the packet is malformed.
+    static bool extractAcks(U8* buffer, S32& receive_size, std::vector<TPACKETID>& acks);
+
     // Uses ping-based retry
     S32 sendReliable(const LLHost &host);
 
@@ -860,6 +880,13 @@ private:
     U8  mEncodedRecvBuffer[MAX_BUFFER_SIZE];
     U8  mTrueReceiveBuffer[MAX_BUFFER_SIZE];
     S32 mTrueReceiveSize;
+    std::vector<TPACKETID> mReceivedAcks;
+
+    LLMessageThread* mNetworkThread;
+
+    // counts a received packet after zeroCodeExpand(), in_size is 0 if
+    // it was not zero coded
+    void countExpandedPacket(S32 in_size, S32 data_size, bool overflowed);
 
     // Must be valid during decode
 
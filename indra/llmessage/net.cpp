@@ -40,6 +40,7 @@
     #include <arpa/inet.h>
     #include <fcntl.h>
     #include <errno.h>
+    #include <poll.h>
 #endif
 
 // linden library includes
@@ -332,6 +333,17 @@ S32 receive_packet(int hSocket, char * receiveBuffer)
     return nRet;
 }
 
+bool wait_for_packet(int hSocket, S32 timeout_ms)
+{
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    FD_SET((SOCKET)hSocket, &read_fds);
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    return select(0, &read_fds, NULL, NULL, &timeout) > 0;
+}
+
 // Returns true on success.
 bool send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort)
 {
@@ -592,6 +604,134 @@ int receive_packet(int hSocket, char * receiveBuffer)
     return nRet;
 }
 
+bool wait_for_packet(int hSocket, S32 timeout_ms)
+{
+    struct pollfd poll_fd;
+    poll_fd.fd = hSocket;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    return poll(&poll_fd, 1, timeout_ms) > 0;
+}
+
+#if LL_NET_BATCHED_IO
+// Headers for the batched calls, preallocated like the single packet
+// addresses above.  Receiving and sending each have their own set, as
+// LLMessageThread receives on another thread than the one sending.
+struct batch_headers_t
+{
+    struct mmsghdr mHeaders[NET_BATCH_SIZE];
+    struct iovec mIOVecs[NET_BATCH_SIZE][2];
+    struct sockaddr_in mAddrs[NET_BATCH_SIZE];
+    char mControl[NET_BATCH_SIZE][CMSG_SPACE(sizeof(struct in_pktinfo))];
+};
+static batch_headers_t gBatchReceive;
+static batch_headers_t gBatchSend;
+
+static void setup_batch_header(batch_headers_t& batch, S32 i, const net_packet_t& packet, S32 data_size, bool receive)
+{
+    struct iovec* iov = batch.mIOVecs[i];
+    S32 iov_count = 0;
+    if (packet.mPrefixSize > 0)
+    {
+        iov[iov_count].iov_base = packet.mPrefix;
+        iov[iov_count].iov_len = packet.mPrefixSize;
+        ++iov_count;
+    }
+    iov[iov_count].iov_base = packet.mData;
+    iov[iov_count].iov_len = data_size;
+    ++iov_count;
+
+    struct msghdr& msg = batch.mHeaders[i].msg_hdr;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &batch.mAddrs[i];
+    msg.msg_namelen = sizeof(batch.mAddrs[i]);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+    if (receive)
+    {
+        msg.msg_control = batch.mControl[i];
+        msg.msg_controllen = sizeof(batch.mControl[i]);
+    }
+    batch.mHeaders[i].msg_len = 0;
+}
+
+S32 receive_packets(int hSocket, net_packet_t* packets, S32 count)
+{
+    count = llmin(count, NET_BATCH_SIZE);
+    for (S32 i = 0; i < count; ++i)
+    {
+        setup_batch_header(gBatchReceive, i, packets[i], NET_BUFFER_SIZE, true);
+    }
+
+    int received = recvmmsg(hSocket, gBatchReceive.mHeaders, count, 0, NULL);
+    if (received <= 0)
+    {
+        // EAGAIN when nothing is waiting, like receive_packet() report none
+        return 0;
+    }
+
+    for (S32 i = 0; i < received; ++i)
+    {
+        net_packet_t& packet = packets[i];
+        struct msghdr& msg = gBatchReceive.mHeaders[i].msg_hdr;
+        packet.mSize = gBatchReceive.mHeaders[i].msg_len;
+        packet.mAddress = gBatchReceive.mAddrs[i].sin_addr.s_addr;
+        packet.mPort = ntohs(gBatchReceive.mAddrs[i].sin_port);
+        packet.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+        for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(&msg, cmsgptr))
+        {
+            if (cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO)
+            {
+                // see recvfrom_destip()
+                in_pktinfo* pktinfo = (in_pktinfo*)CMSG_DATA(cmsgptr);
+                packet.mReceivingIF = pktinfo->ipi_spec_dst.s_addr;
+            }
+        }
+    }
+    return received;
+}
+
+S32 send_packets(int hSocket, const net_packet_t* packets, S32 count)
+{
+    count = llmin(count, NET_BATCH_SIZE);
+    for (S32 i = 0; i < count; ++i)
+    {
+        setup_batch_header(gBatchSend, i, packets[i], packets[i].mSize, false);
+        gBatchSend.mAddrs[i].sin_family = AF_INET;
+        gBatchSend.mAddrs[i].sin_addr.s_addr = packets[i].mAddress;
+        gBatchSend.mAddrs[i].sin_port = htons(packets[i].mPort);
+    }
+
+    S32 sent = 0;
+    S32 done = 0;
+    S32 send_attempts = 0;
+    while (done < count)
+    {
+        int ret = sendmmsg(hSocket, gBatchSend.mHeaders + done, count - done, 0);
+        if (ret > 0)
+        {
+            sent += ret;
+            done += ret;
+            send_attempts = 0;
+            continue;
+        }
+
+        // The packet at 'done' failed
+        if ((errno == EAGAIN || errno == ECONNREFUSED) && ++send_attempts < 3)
+        {
+            LL_INFOS() << "sendmmsg() reported " << (errno == EAGAIN ? "buffer full" : "connection refused")
+                       << ", resending (attempt " << send_attempts << ")" << LL_ENDL;
+            continue;
+        }
+        LL_INFOS() << "sendmmsg() failed to " << u32_to_ip_string(packets[done].mAddress) << ":" << packets[done].mPort
+                   << ", " << errno << ", " << strerror(errno) << LL_ENDL;
+        ++done;
+        send_attempts = 0;
+    }
+    return sent;
+}
+#endif  // LL_NET_BATCHED_IO
+
 bool send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient, int nPort)
 {
     int     ret;
@@ -45,6 +45,42 @@ S32     receive_packet(int hSocket, char * receiveBuffer);
 
 bool    send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);   // Returns true on success.
 
+// Blocks until a packet is waiting on the socket or timeout_ms passes,
+// returns true if one is waiting.
+bool    wait_for_packet(int hSocket, S32 timeout_ms);
+
+// Batched datagram I/O with one recvmmsg()/sendmmsg() call for many
+// packets.  Only available where LL_NET_BATCHED_IO is set.
+#if LL_LINUX
+#define LL_NET_BATCHED_IO 1
+#else
+#define LL_NET_BATCHED_IO 0
+#endif
+
+// Most packets moved by one receive_packets() or send_packets() call
+const S32 NET_BATCH_SIZE = 64;
+
+struct net_packet_t
+{
+    char*   mPrefix;        // optional header read or written before mData, e.g. the SOCKS UDP wrapper
+    S32     mPrefixSize;
+    char*   mData;          // at most NET_BUFFER_SIZE bytes
+    S32     mSize;          // bytes of mData to send, or bytes received including the prefix
+    U32     mAddress;       // recipient or sender
+    U32     mPort;
+    U32     mReceivingIF;   // address the packet was sent to, receive only
+};
+
+#if LL_NET_BATCHED_IO
+// Returns the count of packets received into the first entries of
+// 'packets', zero if none are waiting.
+S32     receive_packets(int hSocket, net_packet_t* packets, S32 count);
+
+// Returns the count of packets sent, retrying full socket buffers
+// like send_packet().  Packets failing for other reasons are skipped.
+S32     send_packets(int hSocket, const net_packet_t* packets, S32 count);
+#endif
+
 //void  get_sender(char * tmp);
 LLHost  get_sender();
 U32     get_sender_port();
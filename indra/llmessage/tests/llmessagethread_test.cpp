@@ -0,0 +1,254 @@
+/**
+ * @file llmessagethread_test.cpp
+ * @brief LLMessageThread loopback tests.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llmessagethread.h"
+
+#include <memory>
+#include <vector>
+
+#include "../llmessagetemplate.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+    char* canonical(const char* name)
+    {
+        return LLMessageStringTable::getInstance()->getString(name);
+    }
+
+    std::vector<U8> header(U8 flags, TPACKETID packet_id)
+    {
+        std::vector<U8> packet(LL_PACKET_ID_SIZE, 0);
+        packet[PHL_FLAGS] = flags;
+        U32 id = htonl(packet_id);
+        memcpy(&packet[PHL_PACKET_ID], &id, sizeof(id));
+        return packet;
+    }
+
+    void append_ack(std::vector<U8>& packet, TPACKETID packet_id)
+    {
+        U32 id = htonl(packet_id);
+        const U8* bytes = (const U8*)&id;
+        packet.insert(packet.end(), bytes, bytes + sizeof(id));
+    }
+}
+
+namespace tut
+{
+    struct messagethread_data
+    {
+        LLTemplateMessageReader::message_template_number_map_t mNumbers;
+        S32 mSendSocket = -1;
+        S32 mRecvSocket = -1;
+        int mRecvPort = NET_USE_OS_ASSIGNED_PORT;
+
+        messagethread_data()
+        {
+            // TestMessage High 1: Data Single { Value U32 } { Text Variable 1 }
+            LLMessageTemplate* templatep = new LLMessageTemplate("TestMessage", 1, MFT_HIGH);
+            LLMessageBlock* blockp = new LLMessageBlock("Data", MBT_SINGLE);
+            blockp->addVariable(canonical("Value"), MVT_U32, 4);
+            blockp->addVariable(canonical("Text"), MVT_VARIABLE, 1);
+            templatep->addBlock(blockp);
+            mNumbers[1] = templatep;
+
+            int send_port = NET_USE_OS_ASSIGNED_PORT;
+            ensure_equals("send socket", start_net(mSendSocket, send_port), 0);
+            ensure_equals("receive socket", start_net(mRecvSocket, mRecvPort), 0);
+        }
+
+        ~messagethread_data()
+        {
+            end_net(mSendSocket);
+            end_net(mRecvSocket);
+            for_each(mNumbers.begin(), mNumbers.end(), DeletePairedPointer());
+        }
+
+        void send(const std::vector<U8>& packet)
+        {
+            ensure("send", send_packet(mSendSocket, (const char*)packet.data(), (int)packet.size(),
+                                       ip_string_to_u32(LOOPBACK_ADDRESS_STRING), mRecvPort));
+        }
+
+        LLMessageThread::Packet* pop(LLMessageThread& thread)
+        {
+            LLTimer timer;
+            while (timer.getElapsedTimeF32() < 5.f)
+            {
+                LLMessageThread::Packet* packet = thread.popPacket();
+                if (packet)
+                {
+                    return packet;
+                }
+                ms_sleep(1);
+            }
+            return NULL;
+        }
+    };
+    typedef test_group<messagethread_data> messagethread_test;
+    typedef messagethread_test::object messagethread_object;
+    tut::messagethread_test messagethread_testcase("LLMessageThread");
+
+    template<> template<>
+    void messagethread_object::test<1>()
+    {
+        set_test_name("decoding");
+
+        // zero coded, reliable, with two acks: Value 5, Text "hello"
+        std::vector<U8> good = header(LL_ZERO_CODE_FLAG | LL_RELIABLE_FLAG | LL_ACK_FLAG, 42);
+        const U8 body[] = { 1, 5, 0, 3, 6, 'h', 'e', 'l', 'l', 'o', 0, 1 };
+        good.insert(good.end(), body, body + sizeof(body));
+        append_ack(good, 7);
+        append_ack(good, 9);
+        good.push_back(2);
+
+        // more acks than the packet holds
+        std::vector<U8> malformed = header(LL_ACK_FLAG, 43);
+        malformed.push_back(1);
+        malformed.push_back(200);
+
+        std::vector<U8> unregistered = header(0, 44);
+        unregistered.push_back(2);
+
+        std::vector<U8> too_short(3, 0);
+
+        LLMessageThread thread(mRecvSocket, mNumbers);
+        thread.start();
+        send(good);
+        send(malformed);
+        send(unregistered);
+        send(too_short);
+
+        std::unique_ptr<LLMessageThread::Packet> packet(pop(thread));
+        ensure("good packet", packet.get() != NULL);
+        ensure_equals("true size", packet->mTrueSize, (S32)good.size());
+        ensure_equals("compressed size", packet->mCompressedSize, (S32)(LL_PACKET_ID_SIZE + sizeof(body)));
+        ensure_equals("size", packet->mSize, LL_PACKET_ID_SIZE + 1 + 4 + 1 + 6);
+        ensure_equals("flags", packet->mHeader[PHL_FLAGS], (U8)(LL_RELIABLE_FLAG | LL_ACK_FLAG));
+        ensure_equals("packet id", ntohl(*(U32*)&packet->mHeader[PHL_PACKET_ID]), (U32)42);
+        ensure_equals("acks", packet->mAcks.size(), (size_t)2);
+        ensure("last ack first", packet->mAcks[0] == 9 && packet->mAcks[1] == 7);
+        ensure("template", packet->mTemplate == mNumbers[1]);
+        ensure("data", packet->mData != NULL);
+        ensure("not ran off end", !packet->mRanOffEnd);
+
+        // the main thread half
+        LLTemplateMessageReader reader(mNumbers);
+        ensure("valid", reader.validateDecodedMessage(packet->mTemplate, packet->mData, packet->mSize, packet->mSender));
+        packet->mData = NULL;
+        U32 value = 0;
+        reader.getU32(canonical("Data"), canonical("Value"), value);
+        ensure_equals("value", value, (U32)5);
+        std::string text;
+        reader.getString(canonical("Data"), canonical("Text"), text);
+        ensure_equals("text", text, std::string("hello"));
+        ensure_equals("receive count", mNumbers[1]->mReceiveCount, (U32)1);
+
+        // the malformed packet is dropped
+        packet.reset(pop(thread));
+        ensure("unregistered packet", packet.get() != NULL);
+        ensure("no template", packet->mTemplate == NULL && packet->mData == NULL);
+        ensure("not valid", !reader.validateDecodedMessage(packet->mTemplate, packet->mData, packet->mSize, packet->mSender));
+
+        packet.reset(pop(thread));
+        ensure("short packet", packet.get() != NULL);
+        ensure_equals("short size", packet->mTrueSize, 3);
+        ensure("short not decoded", packet->mTemplate == NULL && packet->mData == NULL);
+
+        thread.shutdown();
+    }
+
+    template<> template<>
+    void messagethread_object::test<2>()
+    {
+        set_test_name("full queue");
+
+        LLMessageThread thread(mRecvSocket, mNumbers, 2);
+        thread.start();
+        for (TPACKETID id = 0; id < 5; ++id)
+        {
+            std::vector<U8> packet = header(0, id);
+            const U8 body[] = { 1, 1, 2, 3, 4, 0 };
+            packet.insert(packet.end(), body, body + sizeof(body));
+            send(packet);
+        }
+
+        LLTimer timer;
+        while (thread.getNumQueued() < 2 && timer.getElapsedTimeF32() < 5.f)
+        {
+            ms_sleep(1);
+        }
+        ms_sleep(50);
+        ensure_equals("capacity", thread.getNumQueued(), (size_t)2);
+
+        // the rest follow in order as room is made
+        for (TPACKETID id = 0; id < 5; ++id)
+        {
+            std::unique_ptr<LLMessageThread::Packet> packet(pop(thread));
+            ensure("packet", packet.get() != NULL);
+            ensure_equals("order", ntohl(*(U32*)&packet->mHeader[PHL_PACKET_ID]), id);
+        }
+
+        // a thread blocked on a full queue still shuts down
+        for (TPACKETID id = 0; id < 4; ++id)
+        {
+            send(header(0, id));
+        }
+        ms_sleep(50);
+        thread.shutdown();
+        ensure("stopped", thread.isStopped());
+        ensure("no packet after shutdown", thread.popPacket() == NULL);
+    }
+
+    template<> template<>
+    void messagethread_object::test<3>()
+    {
+        set_test_name("dropping packets");
+
+        LLMessageThread thread(mRecvSocket, mNumbers);
+        thread.start();
+        // asked for from the main thread while the thread polls an empty
+        // socket, the drop waits for the next packet
+        thread.getPacketRing().dropPackets(1);
+        ms_sleep(50);
+        for (TPACKETID id = 0; id < 3; ++id)
+        {
+            send(header(0, id));
+        }
+
+        for (TPACKETID id = 1; id < 3; ++id)
+        {
+            std::unique_ptr<LLMessageThread::Packet> packet(pop(thread));
+            ensure("packet", packet.get() != NULL);
+            ensure_equals("first one dropped", ntohl(*(U32*)&packet->mHeader[PHL_PACKET_ID]), id);
+        }
+        thread.shutdown();
+    }
+}
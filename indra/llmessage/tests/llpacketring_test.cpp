@@ -0,0 +1,147 @@
+/**
+ * @file llpacketring_test.cpp
+ * @brief LLPacketRing loopback tests and packet rate benchmark.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketring.h"
+
+#include <iostream>
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+    // Sends 'count' packets from one loopback socket to another through
+    // LLPacketRings, in bursts of 'burst' as the message system does in a
+    // frame, and checks that they all arrive in order with their sender.
+    // Returns the packets per second.
+    F64 loopback(bool batch, S32 count, S32 burst)
+    {
+        S32 send_socket = -1, recv_socket = -1;
+        int send_port = NET_USE_OS_ASSIGNED_PORT, recv_port = NET_USE_OS_ASSIGNED_PORT;
+        tut::ensure_equals("send socket", start_net(send_socket, send_port), 0);
+        tut::ensure_equals("receive socket", start_net(recv_socket, recv_port), 0);
+        const LLHost sender(LOOPBACK_ADDRESS_STRING, send_port);
+        const LLHost receiver(LOOPBACK_ADDRESS_STRING, recv_port);
+
+        LLPacketRing send_ring, recv_ring;
+        if (batch)
+        {
+            tut::ensure("batch send mode", send_ring.setBatchMode(true));
+            tut::ensure("batch receive mode", recv_ring.setBatchMode(true));
+        }
+
+        char packet[MTUBYTES];
+        char received[NET_BUFFER_SIZE];
+        S32 num_sent = 0, num_received = 0;
+        LLTimer timer;
+        while (num_received < count)
+        {
+            const S32 burst_end = llmin(num_sent + burst, count);
+            for (; num_sent < burst_end; ++num_sent)
+            {
+                // sizes vary like object updates do
+                const S32 size = 100 + (num_sent * 37) % (MTUBYTES - 100);
+                memset(packet, num_sent & 0xff, size);
+                memcpy(packet, &num_sent, sizeof(num_sent));
+                tut::ensure("send", send_ring.sendPacket(send_socket, packet, size, receiver));
+            }
+            send_ring.flushSends();
+
+            LLTimer wait;
+            while (num_received < num_sent)
+            {
+                S32 size = recv_ring.receivePacket(recv_socket, received);
+                if (size <= 0)
+                {
+                    tut::ensure("burst lost", wait.getElapsedTimeF32() < 5.f);
+                    continue;
+                }
+                S32 id = -1;
+                memcpy(&id, received, sizeof(id));
+                tut::ensure_equals("packet order", id, num_received);
+                tut::ensure_equals("packet size", size, 100 + (id * 37) % (MTUBYTES - 100));
+                tut::ensure_equals("packet data", (U8)received[size - 1], (U8)(id & 0xff));
+                tut::ensure("packet sender", recv_ring.getLastSender().getPort() == sender.getPort());
+                ++num_received;
+            }
+        }
+        F64 seconds = timer.getElapsedTimeF64();
+
+        end_net(send_socket);
+        end_net(recv_socket);
+        return seconds > 0. ? count / seconds : 0.;
+    }
+}
+
+namespace tut
+{
+    struct packetring_data
+    {
+    };
+    typedef test_group<packetring_data> packetring_test;
+    typedef packetring_test::object packetring_object;
+    tut::packetring_test packetring_testcase("LLPacketRing");
+
+    template<> template<>
+    void packetring_object::test<1>()
+    {
+        set_test_name("unbatched loopback");
+        loopback(false, 1000, 50);
+    }
+
+    template<> template<>
+    void packetring_object::test<2>()
+    {
+        set_test_name("batched loopback");
+#if LL_NET_BATCHED_IO
+        // bursts smaller and larger than a batch
+        loopback(true, 1000, 50);
+        loopback(true, 2000, NET_BATCH_SIZE + 3);
+#else
+        LLPacketRing ring;
+        ensure("no batch mode", !ring.setBatchMode(true));
+        skip("batched UDP I/O not available");
+#endif
+    }
+
+    template<> template<>
+    void packetring_object::test<3>()
+    {
+        set_test_name("packets per second");
+        const S32 count = 50000;
+        const S32 burst = 100;
+        F64 unbatched = loopback(false, count, burst);
+        std::cout << "\nLLPacketRing loopback, " << count << " packets in bursts of " << burst << ":\n"
+                  << "  unbatched " << (S64)unbatched << " packets/s\n";
+#if LL_NET_BATCHED_IO
+        F64 batched = loopback(true, count, burst);
+        std::cout << "  batched   " << (S64)batched << " packets/s\n";
+#endif
+    }
+}
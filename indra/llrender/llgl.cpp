@@ -1465,6 +1465,13 @@ void LLGLManager::initExtensions()
     {
         mHasAnisotropic = mGLExtensions.contains("GL_EXT_texture_filter_anisotropic");
     }
+    mHasBPTC = mGLVersion >= 4.19f;
+    if (!mHasBPTC)
+    {
+        mHasBPTC = mGLExtensions.contains("GL_ARB_texture_compression_bptc");
+    }
+    // never core, but exposed by every desktop driver
+    mHasS3TC = mGLExtensions.contains("GL_EXT_texture_compression_s3tc");
 
     mHasNVXGpuMemoryInfo = mGLExtensions.contains("GL_NVX_gpu_memory_info");
     mHasATIMemInfo = mGLExtensions.contains("GL_ATI_meminfo"); //Basic AMD method, also see mHasAMDAssociations
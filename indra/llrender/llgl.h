@@ -95,6 +95,8 @@ public:
     bool mHasDebugOutput = false;
     bool mHasTransformFeedback = false;
     bool mHasAnisotropic = false;
+    bool mHasBPTC = false;
+    bool mHasS3TC = false;
 
     // Vendor-specific extensions
     bool mHasAMDAssociations = false;
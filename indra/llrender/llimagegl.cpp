@@ -142,6 +142,7 @@ bool LLImageGL::sGlobalUseAnisotropic   = false;
 F32 LLImageGL::sLastFrameTime           = 0.f;
 LLImageGL* LLImageGL::sDefaultGLTexture = NULL ;
 bool LLImageGL::sCompressTextures = false;
+bool LLImageGL::sCompressTexturesBC7 = false;
 boost::unordered_set<LLImageGL*> LLImageGL::sImageList;
 
 
@@ -310,12 +311,14 @@ S32 LLImageGL::dataFormatBits(S32 dataformat)
     case GL_COMPRESSED_LUMINANCE:                   return 8;
     case GL_COMPRESSED_LUMINANCE_ALPHA:             return 16;
     case GL_COMPRESSED_ALPHA:                       return 8;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:           return 4;
     case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:          return 4;
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:    return 4;
     case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:          return 8;
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:    return 8;
     case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:          return 8;
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:    return 8;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:             return 8;
     case GL_LUMINANCE:                              return 8;
     case GL_LUMINANCE8:                             return 8;
     case GL_ALPHA:                                  return 8;
@@ -358,12 +361,14 @@ S64 LLImageGL::dataFormatBytes(S32 dataformat, S32 width, S32 height)
 {
     switch (dataformat)
     {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
     case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
     case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
     case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
         if (width < 4) width = 4;
         if (height < 4) height = 4;
         break;
@@ -380,12 +385,14 @@ S32 LLImageGL::dataFormatComponents(S32 dataformat)
 {
     switch (dataformat)
     {
+      case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:     return 3;
       case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:    return 3;
       case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: return 3;
       case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:    return 4;
       case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: return 4;
       case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:    return 4;
       case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: return 4;
+      case GL_COMPRESSED_RGBA_BPTC_UNORM:       return 4;
       case GL_LUMINANCE:                        return 1;
       case GL_ALPHA:                            return 1;
       case GL_RED:                              return 1;
@@ -1513,7 +1520,8 @@ bool LLImageGL::createGLTexture()
     return true ;
 }
 
-bool LLImageGL::createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S32 usename/*=0*/, bool to_create, S32 category, bool defer_copy, LLGLuint* tex_name)
+bool LLImageGL::createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S32 usename/*=0*/, bool to_create, S32 category, bool defer_copy, LLGLuint* tex_name,
+                                const LLImageBCMips* compressed)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
     checkActiveThread();
@@ -1608,9 +1616,47 @@ bool LLImageGL::createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S
 
     setCategory(category);
     const U8* rawdata = imageraw->getData();
+
+    if (compressed && mAllowCompression && sCompressTextures && !mHasExplicitFormat && mUseMipMaps
+        && compressed->getWidth() == raw_w && compressed->getHeight() == raw_h
+        && compressed->getComponents() == mComponents
+        && compressed->getLevels() >= mMaxDiscardLevel - discard_level + 1)
+    {
+        // The compressed upload skips both, do them on the raw pixels while
+        // the formats still describe them
+        analyzeAlpha(rawdata, raw_w, raw_h);
+        updatePickMask(raw_w, raw_h, rawdata);
+
+        switch (compressed->getFormat())
+        {
+        case LLImageBC::FORMAT_BC1:
+            mFormatInternal = mFormatPrimary = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            break;
+        case LLImageBC::FORMAT_BC3:
+            mFormatInternal = mFormatPrimary = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            break;
+        case LLImageBC::FORMAT_BC7:
+            mFormatInternal = mFormatPrimary = GL_COMPRESSED_RGBA_BPTC_UNORM;
+            break;
+        default:
+            return createGLTexture(discard_level, rawdata, false, usename, defer_copy, tex_name);
+        }
+        return createGLTexture(discard_level, compressed->getLevelData(0), true, usename, defer_copy, tex_name);
+    }
+
     return createGLTexture(discard_level, rawdata, false, usename, defer_copy, tex_name);
 }
 
+//static
+LLImageBC::EFormat LLImageGL::getBlockCompressionFormat()
+{
+    if (!sCompressTextures || !gGLManager.mHasS3TC)
+    {
+        return LLImageBC::FORMAT_NONE;
+    }
+    return sCompressTexturesBC7 && gGLManager.mHasBPTC ? LLImageBC::FORMAT_BC7 : LLImageBC::FORMAT_BC3;
+}
+
 bool LLImageGL::createGLTexture(S32 discard_level, const U8* data_in, bool data_hasmips, S32 usename, bool defer_copy, LLGLuint* tex_name)
 // Call with void data, vmem is allocated but unitialized
 {
@@ -2313,12 +2359,14 @@ bool LLImageGL::isCompressed()
     bool is_compressed = false;
     switch (mFormatPrimary)
     {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
     case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
     case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
     case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
     case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
         is_compressed = true;
         break;
     default:
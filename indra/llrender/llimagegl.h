@@ -29,6 +29,7 @@
 #define LL_LLIMAGEGL_H
 
 #include "llimage.h"
+#include "llimagebc.h"
 
 #include "llgltypes.h"
 #include "llpointer.h"
@@ -124,8 +125,11 @@ public:
     static void setManualImage(U32 target, S32 miplevel, S32 intformat, S32 width, S32 height, U32 pixformat, U32 pixtype, const void *pixels, bool allow_compression = true);
 
     bool createGLTexture() ;
+    // compressed, when given, is a block compressed copy of imageraw with its
+    // mips. It is uploaded instead of imageraw if it matches the texture.
     bool createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S32 usename = 0, bool to_create = true,
-        S32 category = sMaxCategories-1, bool defer_copy = false, LLGLuint* tex_name = nullptr);
+        S32 category = sMaxCategories-1, bool defer_copy = false, LLGLuint* tex_name = nullptr,
+        const LLImageBCMips* compressed = nullptr);
     bool createGLTexture(S32 discard_level, const U8* data, bool data_hasmips = false, S32 usename = 0, bool defer_copy = false, LLGLuint* tex_name = nullptr);
     void setImage(const LLImageRaw* imageraw);
     bool setImage(const U8* data_in, bool data_hasmips = false, S32 usename = 0);
@@ -292,6 +296,12 @@ public:
     static LLImageGL* sDefaultGLTexture ;
     static bool sAutomatedTest;
     static bool sCompressTextures;          //use GL texture compression
+    static bool sCompressTexturesBC7;       //block compress textures with alpha as BC7 rather than BC3
+
+    // The block compression format the decode threads should encode images
+    // with alpha to (opaque ones always use BC1), FORMAT_NONE when textures
+    // are not compressed or the GL can not sample the formats
+    static LLImageBC::EFormat getBlockCompressionFormat();
 #if DEBUG_MISS
     bool mMissed; // Missed on last bind?
     bool getMissed() const { return mMissed; };
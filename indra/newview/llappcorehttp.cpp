@@ -415,6 +415,33 @@ void LLAppCoreHttp::refreshSettings(bool initial)
                 }
             }
 
+            // HTTP/2 for the CDN classes, the same ones that pipeline
+            static const std::string http2("HttpHTTP2");
+            static const std::string http2_streams("HttpHTTP2StreamLimit");
+            if (init_data[i].mPipelined && gSavedSettings.controlExists(http2) && gSavedSettings.getU32(http2))
+            {
+                status = LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_HTTP2,
+                                                                    mHttpClasses[app_policy].mPolicy,
+                                                                    gSavedSettings.getU32(http2),
+                                                                    NULL);
+                if (status && gSavedSettings.controlExists(http2_streams))
+                {
+                    status = LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_HTTP2_STREAM_LIMIT,
+                                                                        mHttpClasses[app_policy].mPolicy,
+                                                                        gSavedSettings.getU32(http2_streams),
+                                                                        NULL);
+                }
+                if (! status)
+                {
+                    LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+                                     << " HTTP/2 options.  Reason:  " << status.toString()
+                                     << LL_ENDL;
+                }
+                else
+                {
+                    LL_INFOS("Init") << "HTTP/2 enabled for " << init_data[i].mUsage << LL_ENDL;
+                }
+            }
         }
 
         // Init- or run-time settings.  Must use the queued request API.
@@ -100,6 +100,7 @@
 #include "lllogininstance.h"
 #include "llprogressview.h"
 #include "llvocache.h"
+#include "lldecodedimagecache.h"
 #include "lldiskcache.h"
 #include "llvopartgroup.h"
 // [SL:KB] - Patch: Appearance-Misc | Checked: 2013-02-12 (Catznip-3.4)
@@ -171,6 +172,8 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "llimagebufferpool.h"
+#include "llimageingest.h"
 #include "llevents.h"
 
 // The files below handle dependencies from cleanup.
@@ -565,6 +568,7 @@ static void settings_to_globals()
     LLRender::sNsightDebugSupport = gSavedSettings.getBOOL("RenderNsightDebugSupport");
     LLImageGL::sGlobalUseAnisotropic    = gSavedSettings.getBOOL("RenderAnisotropic");
     LLImageGL::sCompressTextures        = gSavedSettings.getBOOL("RenderCompressTextures");
+    LLImageGL::sCompressTexturesBC7     = gSavedSettings.getBOOL("RenderCompressTexturesBC7");
     LLVOVolume::sLODFactor              = llclamp(gSavedSettings.getF32("RenderVolumeLODFactor"), 0.01f, MAX_LOD_FACTOR);
     LLVOVolume::sDistanceFactor         = 1.f-LLVOVolume::sLODFactor * 0.1f;
     LLVolumeImplFlexible::sUpdateFactor = gSavedSettings.getF32("RenderFlexTimeFactor");
@@ -656,6 +660,7 @@ bool LLAppViewer::sendURLToOtherInstance(const std::string& url)
 LLAppViewer* LLAppViewer::sInstance = NULL;
 LLTextureCache* LLAppViewer::sTextureCache = NULL;
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL;
+LLImageIngestThread* LLAppViewer::sImageIngestThread = NULL;
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL;
 LLPurgeDiskCacheThread* LLAppViewer::sPurgeDiskCacheThread = NULL;
 
@@ -1688,6 +1693,11 @@ S32 LLAppViewer::updateTextureThreads(F32 max_time)
     {
         LL_PROFILE_ZONE_NAMED_CATEGORY_APP("Image Decode");
         work_pending += LLAppViewer::getImageDecodeThread()->update(max_time); // unpauses the image thread
+        LLImageBufferPool::updateStats();
+    }
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_APP("Image Ingest");
+        work_pending += LLAppViewer::getImageIngestThread()->update(max_time); // calls back the local image loads
     }
     {
         LL_PROFILE_ZONE_NAMED_CATEGORY_APP("Image Fetch");
@@ -2040,6 +2050,7 @@ bool LLAppViewer::cleanup()
     sTextureFetch->shutdown();
     sTextureCache->shutdown();
     sImageDecodeThread->shutdown();
+    sImageIngestThread->shutdown();
     sPurgeDiskCacheThread->shutdown();
     if (mGeneralThreadPool)
     {
@@ -2100,6 +2111,8 @@ bool LLAppViewer::cleanup()
     }
     delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+    delete sImageIngestThread;
+    sImageIngestThread = NULL;
     delete mFastTimerLogThread;
     mFastTimerLogThread = NULL;
     delete sPurgeDiskCacheThread;
@@ -2213,6 +2226,7 @@ bool LLAppViewer::initThreads()
     static const bool enable_threads = true;
 
     LLImage::initClass(gSavedSettings.getBOOL("TextureNewByteRange"),gSavedSettings.getS32("TextureReverseByteRange"));
+    LLImageBufferPool::setMaxBytes((S64)gSavedSettings.getU32("ImageBufferPoolMaxMB") * 1024 * 1024);
 
     LLLFSThread::initClass(enable_threads && true); // TODO: fix crashes associated with this shutdo
 
@@ -2242,6 +2256,8 @@ bool LLAppViewer::initThreads()
 
     // Image decoding
     LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+    // Local image files for uploads
+    LLAppViewer::sImageIngestThread = new LLImageIngestThread();
     LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
     LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
                                                     enable_threads && true,
@@ -2249,6 +2265,10 @@ bool LLAppViewer::initThreads()
 
     // general task background thread (LLPerfStats, etc)
     LLAppViewer::instance()->initGeneralThread();
+    if (gSavedSettings.getBOOL("Jpeg2000ParallelEncode"))
+    {
+        LLImageJ2C::setDefaultEncodeQueue(LL::WorkQueue::getInstance("General"));
+    }
 
     LLAppViewer::sPurgeDiskCacheThread = new LLPurgeDiskCacheThread();
 
@@ -4450,7 +4470,7 @@ bool LLAppViewer::initCache()
     }
 
     const std::string cache_dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, cache_dir_name);
-    LLDiskCache::initParamSingleton(cache_dir, disk_cache_size, enable_cache_debug_info);
+    LLDiskCache::initParamSingleton(cache_dir, disk_cache_size, enable_cache_debug_info, read_only);
 
     if (!read_only)
     {
@@ -4490,6 +4510,19 @@ bool LLAppViewer::initCache()
 
     LLAppViewer::getTextureCache()->initCache(LL_PATH_CACHE, texture_cache_size, texture_cache_mismatch);
 
+    // The decoded texture cache has its own budget on top of 'CacheSize':
+    // decoded mips are several times the size of their J2C data.
+    if (gSavedSettings.getBOOL("TextureDecodedCache"))
+    {
+        const uintmax_t decoded_cache_size = uintmax_t(gSavedSettings.getU32("TextureDecodedCacheSize")) * MB;
+        LLDecodedImageCache::initParamSingleton(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "decodedtextures"),
+                                                decoded_cache_size, read_only);
+        if (texture_cache_mismatch)
+        {
+            LLDecodedImageCache::getInstance()->clearCache();
+        }
+    }
+
     const U32 CACHE_NUMBER_OF_REGIONS_FOR_OBJECTS = 128;
     LLVOCache::getInstance()->initCache(LL_PATH_CACHE, CACHE_NUMBER_OF_REGIONS_FOR_OBJECTS, getObjectCacheVersion());
 
@@ -4550,6 +4583,10 @@ void LLAppViewer::purgeCacheImmediate()
     LL_INFOS("AppCache") << "Purging Object Cache and Texture Cache immediately..." << LL_ENDL;
     LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE, false);
     LLVOCache::getInstance()->removeCache(LL_PATH_CACHE, true);
+    if (LLDecodedImageCache::instanceExists())
+    {
+        LLDecodedImageCache::getInstance()->clearCache();
+    }
 }
 
 std::string LLAppViewer::getSecondLifeTitle() const
@@ -58,6 +58,7 @@ class LLFrameTimer;
 class LLPumpIO;
 class LLTextureCache;
 class LLImageDecodeThread;
+class LLImageIngestThread;
 class LLTextureFetch;
 class LLWatchdogTimeout;
 class LLViewerJoystick;
@@ -134,6 +135,7 @@ public:
     // Thread accessors
     static LLTextureCache* getTextureCache() { return sTextureCache; }
     static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
+    static LLImageIngestThread* getImageIngestThread() { return sImageIngestThread; }
     static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
     static LLPurgeDiskCacheThread* getPurgeDiskCacheThread() { return sPurgeDiskCacheThread; }
 
@@ -335,6 +337,7 @@ private:
     // Thread objects.
     static LLTextureCache* sTextureCache;
     static LLImageDecodeThread* sImageDecodeThread;
+    static LLImageIngestThread* sImageIngestThread;
     static LLTextureFetch* sTextureFetch;
     static LLPurgeDiskCacheThread* sPurgeDiskCacheThread;
     LL::ThreadPool* mGeneralThreadPool;
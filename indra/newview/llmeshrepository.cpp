@@ -80,8 +80,6 @@
 #include "llvoavatarself.h"
 #include "llskinningutil.h"
 
-#include "boost/iostreams/device/array.hpp"
-#include "boost/iostreams/stream.hpp"
 #include "boost/lexical_cast.hpp"
 
 #ifndef LL_WINDOWS
@@ -347,6 +345,11 @@ constexpr U32 CACHE_PREAMBLE_VERSION = 1;
 constexpr S32 CACHE_PREAMBLE_SIZE = sizeof(U32) * 3; //version, header_size, flags
 constexpr S32 MESH_HEADER_SIZE = 4096;                      // Important:  assumption is that headers fit in this space
 
+// Decoded LODs live in the regular disk cache under an id derived from the
+// mesh id, the LOD and the mirror/invert flags, so they are evicted like any
+// other cache entry. Bump the salt whenever the decoded format changes.
+const LLUUID DECODED_LOD_CACHE_SALT("c2b0f9a8-5d7e-4c43-9a61-3e8f1f6d2b57");
+
 
 constexpr S32 REQUEST2_HIGH_WATER_MIN = 32;                 // Limits for GetMesh2 regions
 constexpr S32 REQUEST2_HIGH_WATER_MAX = 100;
@@ -908,6 +911,20 @@ void log_upload_error(
     gMeshRepo.uploadError(args);
 }
 
+static LLUUID decoded_lod_cache_id(const LLVolumeParams& mesh_params, S32 lod)
+{
+    LLUUID salt(DECODED_LOD_CACHE_SALT);
+    salt.mData[0] ^= (U8)lod;
+    salt.mData[1] ^= (U8)(mesh_params.getSculptType() & LL_SCULPT_FLAG_MASK);
+    return mesh_params.getSculptID().combine(salt);
+}
+
+static bool use_decoded_lod_cache()
+{
+    static LLCachedControl<bool> use_decoded_cache(gSavedSettings, "MeshUseDecodedCache", true);
+    return use_decoded_cache;
+}
+
 void write_preamble(LLFileSystem &file, S32 header_bytes, S32 flags)
 {
     LLMeshRepository::sCacheBytesWritten += CACHE_PREAMBLE_SIZE;
@@ -950,6 +967,9 @@ LLMeshRepoThread::LLMeshRepoThread()
     // and a need to do expensive cacheOptimize().
     mMeshThreadPool.reset(new LL::ThreadPool("MeshLodProcessing", 2));
     mMeshThreadPool->start();
+
+    // Bind the cached control here, pool threads only read it
+    use_decoded_lod_cache();
 }
 
 
@@ -2027,6 +2047,11 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 
         if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
         {
+            if (loadDecodedLOD(mesh_params, lod))
+            {
+                return true;
+            }
+
             S32 disk_ofset = offset + CACHE_PREAMBLE_SIZE;
             //check cache for mesh asset
             LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
@@ -2207,9 +2232,8 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
 
         data_size = (S32)dsize;
 
-        boost::iostreams::stream<boost::iostreams::array_source> stream(result_ptr, data_size);
-
-        if (!LLSDSerialize::fromBinary(header_data, stream, data_size))
+        size_t header_bytes = 0;
+        if (LLSDSerialize::fromBinary(header_data, (const U8*)result_ptr, data_size, -1, &header_bytes) <= 0)
         {
             LL_WARNS(LOG_MESH) << "Mesh header parse error.  Not a valid mesh asset!  ID:  " << mesh_id
                                << LL_ENDL;
@@ -2232,7 +2256,7 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
         // make sure there is at least one lod, function returns -1 and marks as 404 otherwise
         else if (LLMeshRepository::getActualMeshLOD(header, 0) >= 0)
         {
-            header.mHeaderSize = (S32)stream.tellg();
+            header.mHeaderSize = (S32)header_bytes;
             header_size += header.mHeaderSize;
             skin_offset = header.mSkinOffset;
             skin_size = header.mSkinSize;
@@ -2372,59 +2396,151 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
     }
 
     LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
-    if (volume->unpackVolumeFaces(data, data_size))
-    {
-        // Use LLVolume::getNumVolumeFaces() here and not LLVolume::getNumFaces(),
-        // because setMeshAssetLoaded() has not yet been called for this volume
-        // (it is set later in LLMeshRepository::notifyMeshLoaded()), and
-        // getNumFaces() would return the number of faces in the LLProfile
-        // instead. HB
-        S32 num_faces = volume->getNumVolumeFaces();
-        if (num_faces > 0)
-        {
-            // if we have a valid SkinInfo, cache per-joint bounding boxes for this LOD
-            LLPointer<LLMeshSkinInfo> skin_info = nullptr;
-            {
-                LLMutexLock lock(mSkinMapMutex);
-                skin_map::iterator iter = mSkinMap.find(mesh_params.getSculptID());
-                if (iter != mSkinMap.end())
-                {
-                    skin_info = iter->second;
-                }
-            }
-            if (skin_info.notNull() && isAgentAvatarValid())
-            {
-                for (S32 i = 0; i < num_faces; ++i)
-                {
-                    // NOTE: no need to lock gAgentAvatarp as the state being checked is not changed after initialization
-                    LLVolumeFace& face = volume->getVolumeFace(i);
-                    LLSkinningUtil::updateRiggingInfo(skin_info, gAgentAvatarp, face);
-                }
-            }
+    // large LODs borrow idle mesh processing workers to unpack their faces
+    if (volume->unpackVolumeFaces(data, data_size, &mMeshThreadPool->getQueue()))
+    {
+        cacheDecodedLOD(mesh_params, lod, volume);
+        return lodUnpacked(volume, mesh_params, lod);
+    }
+
+    return MESH_UNKNOWN;
+}
 
-            LoadedMesh mesh(volume, mesh_params, lod);
+EMeshProcessingResult LLMeshRepoThread::lodUnpacked(LLPointer<LLVolume>& volume, const LLVolumeParams& mesh_params, S32 lod)
+{
+    // Use LLVolume::getNumVolumeFaces() here and not LLVolume::getNumFaces(),
+    // because setMeshAssetLoaded() has not yet been called for this volume
+    // (it is set later in LLMeshRepository::notifyMeshLoaded()), and
+    // getNumFaces() would return the number of faces in the LLProfile
+    // instead. HB
+    S32 num_faces = volume->getNumVolumeFaces();
+    if (num_faces > 0)
+    {
+        // if we have a valid SkinInfo, cache per-joint bounding boxes for this LOD
+        LLPointer<LLMeshSkinInfo> skin_info = nullptr;
+        {
+            LLMutexLock lock(mSkinMapMutex);
+            skin_map::iterator iter = mSkinMap.find(mesh_params.getSculptID());
+            if (iter != mSkinMap.end())
             {
-                LLMutexLock lock(mLoadedMutex);
-                mLoadedQ.push_back(mesh);
-                // LLPointer is not thread safe, since we added this pointer into
-                // threaded list, make sure counter gets decreased inside mutex lock
-                // and won't affect mLoadedQ processing
-                volume = NULL;
-                // might be good idea to turn mesh into pointer to avoid making a copy
-                mesh.mVolume = NULL;
+                skin_info = iter->second;
             }
+        }
+        if (skin_info.notNull() && isAgentAvatarValid())
+        {
+            for (S32 i = 0; i < num_faces; ++i)
             {
-                // make sure skin info is not removed from list while we are decreasing reference count
-                LLMutexLock lock(mSkinMapMutex);
-                skin_info = nullptr;
+                // NOTE: no need to lock gAgentAvatarp as the state being checked is not changed after initialization
+                LLVolumeFace& face = volume->getVolumeFace(i);
+                LLSkinningUtil::updateRiggingInfo(skin_info, gAgentAvatarp, face);
             }
-            return MESH_OK;
         }
+
+        LoadedMesh mesh(volume, mesh_params, lod);
+        {
+            LLMutexLock lock(mLoadedMutex);
+            mLoadedQ.push_back(mesh);
+            // LLPointer is not thread safe, since we added this pointer into
+            // threaded list, make sure counter gets decreased inside mutex lock
+            // and won't affect mLoadedQ processing
+            volume = NULL;
+            // might be good idea to turn mesh into pointer to avoid making a copy
+            mesh.mVolume = NULL;
+        }
+        {
+            // make sure skin info is not removed from list while we are decreasing reference count
+            LLMutexLock lock(mSkinMapMutex);
+            skin_info = nullptr;
+        }
+        return MESH_OK;
     }
 
     return MESH_UNKNOWN;
 }
 
+void LLMeshRepoThread::cacheDecodedLOD(const LLVolumeParams& mesh_params, S32 lod, const LLVolume* volume)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    if (!use_decoded_lod_cache())
+    {
+        return;
+    }
+
+    std::vector<U8> decoded;
+    if (!volume->packDecodedFaces(decoded) || decoded.size() > (size_t)S32_MAX)
+    {
+        return;
+    }
+
+    LLFileSystem file(decoded_lod_cache_id(mesh_params, lod), LLAssetType::AT_MESH, LLFileSystem::WRITE);
+    if (file.write(decoded.data(), (S32)decoded.size()))
+    {
+        LLMeshRepository::sCacheBytesWritten += (U32)decoded.size();
+        ++LLMeshRepository::sCacheWrites;
+    }
+}
+
+bool LLMeshRepoThread::loadDecodedLOD(const LLVolumeParams& mesh_params, S32 lod)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    if (!use_decoded_lod_cache())
+    {
+        return false;
+    }
+
+    const LLUUID cache_id = decoded_lod_cache_id(mesh_params, lod);
+    S32 cached_size = LLFileSystem::getFileSize(cache_id, LLAssetType::AT_MESH);
+    if (cached_size <= 0)
+    {
+        return false;
+    }
+
+    // Reading and copying the arrays back is cheap next to unpacking, but
+    // keep it off the repo thread all the same.
+    const LLVolumeParams params(mesh_params);
+    bool posted = mMeshThreadPool->getQueue().post(
+        [params, lod, cache_id]()
+    {
+        if (gMeshRepo.mThread->isShuttingDown())
+        {
+            return;
+        }
+
+        LLFileSystem file(cache_id, LLAssetType::AT_MESH);
+        S32 size = file.getSize();
+        std::unique_ptr<U8[]> buffer(size > 0 ? new(std::nothrow) U8[size] : nullptr);
+        bool loaded = false;
+        if (buffer && file.read(buffer.get(), size) && file.getLastBytesRead() == size)
+        {
+            LLPointer<LLVolume> volume = new LLVolume(params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+            loaded = volume->unpackDecodedFaces(buffer.get(), size)
+                && gMeshRepo.mThread->lodUnpacked(volume, params, lod) == MESH_OK;
+        }
+
+        if (loaded)
+        {
+            LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh body for ID " << params.getSculptID() << " - was retrieved from the decoded cache." << LL_ENDL;
+        }
+        else
+        {
+            // stale or damaged entry, drop it and go through the regular path
+            LL_DEBUGS(LOG_MESH) << "Decoded cache entry for mesh " << params.getSculptID() << " LOD " << lod << " rejected." << LL_ENDL;
+            LLFileSystem::removeFile(cache_id, LLAssetType::AT_MESH);
+
+            LLMutexLock lock(gMeshRepo.mThread->mMutex);
+            gMeshRepo.mThread->mLODReqQ.push(LODRequest(params, lod));
+            LLMeshRepository::sLODProcessing++;
+        }
+    });
+
+    if (posted)
+    {
+        LLMeshRepository::sCacheBytesRead += cached_size;
+        ++LLMeshRepository::sCacheReads;
+    }
+    return posted;
+}
+
 bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
 {
     LL_PROFILE_ZONE_SCOPED;
@@ -3645,15 +3761,25 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
                 goto common_exit;
             }
 
-            // *TODO: Try to get rid of data copying and add interfaces
-            // that support BufferArray directly.  Introduce a two-phase
-            // handler, optional first that takes a body, fallback second
-            // that requires a temporary allocation and data copy.
+            // Take the body memory over when the response starts
+            // where we asked, otherwise copy the useful part.  Either
+            // way data comes from ll_aligned_malloc_16().
             body_offset = mOffset - offset;
-            data = new(std::nothrow) U8[data_size - body_offset];
+            if (! body_offset)
+            {
+                size_t body_size(0);
+                data = (U8 *) body->detachContiguous(&body_size);
+            }
+            if (! data)
+            {
+                data = (U8 *) ll_aligned_malloc_16(data_size - body_offset);
+                if (data)
+                {
+                    body->read(body_offset, (char *) data, data_size - body_offset);
+                }
+            }
             if (data)
             {
-                body->read(body_offset, (char *) data, data_size - body_offset);
                 LLMeshRepository::sBytesReceived += static_cast<U32>(data_size);
             }
             else
@@ -3667,7 +3793,7 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
 
         if (mHasDataOwnership)
         {
-            delete [] data;
+            ll_aligned_free_16(data);
         }
     }
 
@@ -3915,12 +4041,12 @@ void LLMeshLODHandler::processData(LLCore::BufferArray * /* body */, S32 /* body
         {
             if (gMeshRepo.mThread->isShuttingDown())
             {
-                delete[] data;
+                ll_aligned_free_16(data);
                 return;
             }
             LLMeshLODHandler* handler = (LLMeshLODHandler * )shrd_handler.get();
             handler->processLod(data, data_size);
-            delete[] data;
+            ll_aligned_free_16(data);
         });
 
         if (posted)
@@ -4033,12 +4159,12 @@ void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * /* body */, S32 /*
         {
             if (gMeshRepo.mThread->isShuttingDown())
             {
-                delete[] data;
+                ll_aligned_free_16(data);
                 return;
             }
             LLMeshSkinInfoHandler* handler = (LLMeshSkinInfoHandler*)shrd_handler.get();
             handler->processSkin(data, data_size);
-            delete[] data;
+            ll_aligned_free_16(data);
         });
 
         if (posted)
@@ -575,6 +575,8 @@ public:
     bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
     EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size, U32 flags = 0);
     EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
+    // Load a LOD from the decoded mesh cache, skipping unpackVolumeFaces()
+    bool loadDecodedLOD(const LLVolumeParams& mesh_params, S32 lod);
     bool skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
     bool decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
     EMeshProcessingResult physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
@@ -631,6 +633,16 @@ private:
     // Mutex: acquires mPendingMutex, mMutex and mHeaderMutex as needed
     void loadMeshLOD(const LLUUID &mesh_id, const LLVolumeParams& mesh_params, S32 lod);
 
+    // Queues an unpacked LOD for the main thread.
+    //
+    // Threads:  Repo thread or mesh processing pool
+    EMeshProcessingResult lodUnpacked(LLPointer<LLVolume>& volume, const LLVolumeParams& mesh_params, S32 lod);
+
+    // Writes an unpacked LOD to the decoded mesh cache if enabled.
+    //
+    // Threads:  Repo thread or mesh processing pool
+    void cacheDecodedLOD(const LLVolumeParams& mesh_params, S32 lod, const LLVolume* volume);
+
     // Threads:  Repo thread only
     U8* getDiskCacheBuffer(S32 size);
     S32 mDiskCacheBufferSize = 0;
@@ -54,6 +54,7 @@
 #include "llviewertexturelist.h"
 #include "llwindow.h"
 #include "llworld.h"
+#include "workqueue.h"
 #include <boost/filesystem.hpp>
 
 constexpr F32 AUTO_SNAPSHOT_TIME_DELAY = 1.f;
@@ -599,7 +600,7 @@ void LLSnapshotLivePreview::generateThumbnailImage(bool force_update)
             if (filter_path != "")
             {
                 LLImageFilter filter(filter_path);
-                filter.executeFilter(raw);
+                filter.executeFilter(raw, LL::WorkQueue::getInstance("General").get());
             }
             else
             {
@@ -647,7 +648,7 @@ LLViewerTexture* LLSnapshotLivePreview::getBigThumbnailImage()
             if (filter_path != "")
             {
                 LLImageFilter filter(filter_path);
-                filter.executeFilter(raw);
+                filter.executeFilter(raw, LL::WorkQueue::getInstance("General").get());
             }
             else
             {
@@ -961,7 +962,7 @@ LLPointer<LLImageFormatted> LLSnapshotLivePreview::getFormattedImage()
             if (filter_path != "")
             {
                 LLImageFilter filter(filter_path);
-                filter.executeFilter(mPreviewImage);
+                filter.executeFilter(mPreviewImage, LL::WorkQueue::getInstance("General").get());
             }
             else
             {
@@ -1039,7 +1040,7 @@ void LLSnapshotLivePreview::saveTexture(bool outfit_snapshot, std::string name)
         if (filter_path != "")
         {
             LLImageFilter filter(filter_path);
-            filter.executeFilter(scaled);
+            filter.executeFilter(scaled, LL::WorkQueue::getInstance("General").get());
         }
         else
         {
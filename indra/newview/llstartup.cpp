@@ -675,6 +675,11 @@ bool idle_startup()
 
             F32 dropPercent = gSavedSettings.getF32("PacketDropPercentage");
             msg->mPacketRing.setDropPercentage(dropPercent);
+            msg->mPacketRing.setBatchMode(gSavedSettings.getBOOL("PacketBatchedIO"));
+            if (gSavedSettings.getBOOL("MessageNetworkThread"))
+            {
+                msg->startNetworkThread();
+            }
         }
 
         LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
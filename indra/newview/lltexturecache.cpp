@@ -795,7 +795,6 @@ LLTextureCache::LLTextureCache(bool threaded)
       mHeaderMutex(),
       mListMutex(),
       mFastCacheMutex(),
-      mHeaderAPRFile(NULL),
       mReadOnly(true), //do not allow to change the texture cache until setReadOnly() is called.
       mTexturesSizeTotal(0),
       mDoPurge(false),
@@ -809,7 +808,14 @@ LLTextureCache::LLTextureCache(bool threaded)
 LLTextureCache::~LLTextureCache()
 {
     clearDeleteList() ;
-    writeUpdatedEntries() ;
+    if (!mReadOnly)
+    {
+        mHeaderEntriesFile.flush(false);
+    }
+    {
+        LLExclusiveMutexLock lock(&mMappingMutex);
+        mHeaderEntriesFile.unmap();
+    }
     delete mFastCachep;
     delete mFastCachePoolp;
     delete mHeaderAPRFilePoolp;
@@ -956,7 +962,6 @@ void LLTextureCache::purgeCache(ELLPath location, bool remove_dir)
     if (!mReadOnly)
     {
         setDirNames(location);
-        llassert_always(mHeaderAPRFile == NULL);
 
         //remove the legacy cache if exists
         std::string texture_dir = mTexturesDirName ;
@@ -1042,33 +1047,45 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, bool texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+bool LLTextureCache::mapHeaderEntriesFile()
 {
-    llassert_always(mHeaderAPRFile == NULL);
-    apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-    mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, mHeaderAPRFilePoolp);
-    if(offset > 0)
-    {
-        mHeaderAPRFile->seek(APR_SET, offset);
+    // Map room for the maximum number of entries up front so that the
+    // mapping never has to grow. LLMappedFile grows the file sparse where
+    // the file system allows it.
+    size_t capacity = llmax(sCacheMaxEntries, mHeaderEntriesInfo.mEntries);
+    size_t size = sizeof(EntriesInfo) + capacity * sizeof(Entry);
+    LLExclusiveMutexLock lock(&mMappingMutex);
+    if (!mHeaderEntriesFile.map(mHeaderEntriesFileName, size, mReadOnly))
+    {
+        LL_WARNS("TextureCache") << "Unable to map texture cache entries " << mHeaderEntriesFileName << LL_ENDL;
+        return false;
     }
-    return mHeaderAPRFile;
+    return true;
 }
 
-void LLTextureCache::closeHeaderEntriesFile()
+LLTextureCache::Entry* LLTextureCache::getMappedEntry(S32 idx)
 {
-    if(!mHeaderAPRFile)
+    if (idx < 0 || !mHeaderEntriesFile.isMapped())
     {
-        return ;
+        return NULL;
     }
-
-    delete mHeaderAPRFile;
-    mHeaderAPRFile = NULL;
+    size_t offset = sizeof(EntriesInfo) + (size_t)idx * sizeof(Entry);
+    if (offset + sizeof(Entry) > mHeaderEntriesFile.getSize())
+    {
+        return NULL;
+    }
+    return (Entry*)(mHeaderEntriesFile.getData() + offset);
 }
 
 void LLTextureCache::readEntriesHeader()
 {
+    if (mHeaderEntriesFile.isMapped())
+    {
+        // mHeaderEntriesInfo is kept in sync with the mapped copy
+        return;
+    }
+
     // mHeaderEntriesInfo initializes to default values so safe not to read it
-    llassert_always(mHeaderAPRFile == NULL);
     if (LLAPRFile::isExist(mHeaderEntriesFileName, mHeaderAPRFilePoolp))
     {
         LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
@@ -1079,6 +1096,8 @@ void LLTextureCache::readEntriesHeader()
         setEntriesHeader();
         writeEntriesHeader() ;
     }
+
+    mapHeaderEntriesFile();
 }
 
 void LLTextureCache::setEntriesHeader()
@@ -1100,11 +1119,17 @@ void LLTextureCache::setEntriesHeader()
 
 void LLTextureCache::writeEntriesHeader()
 {
-    llassert_always(mHeaderAPRFile == NULL);
     if (!mReadOnly)
     {
-        LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-                           mHeaderAPRFilePoolp);
+        if (mHeaderEntriesFile.isMapped())
+        {
+            memcpy(mHeaderEntriesFile.getData(), &mHeaderEntriesInfo, sizeof(EntriesInfo));
+        }
+        else
+        {
+            LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
+                               mHeaderAPRFilePoolp);
+        }
     }
 }
 
@@ -1169,23 +1194,15 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
         // Remove this entry from the LRU if it exists
         mLRU.erase(id);
         // Read the entry
-        idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-        if(iter != mUpdatedEntryMap.end())
-        {
-            entry = iter->second ;
-        }
-        else
-        {
-            readEntryFromHeaderImmediately(idx, entry) ;
-        }
-        if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
+        readEntryFromHeaderImmediately(idx, entry) ;
+        if(idx >= 0 && entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
         {
             LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL ;
 
             //erase this entry and the cached texture from the cache.
             std::string tex_filename = getTextureFileName(id);
             removeEntry(idx, entry, tex_filename) ;
-            mUpdatedEntryMap.erase(idx) ;
+            writeEntryToHeaderImmediately(idx, entry) ;
             idx = -1 ;
         }
     }
@@ -1195,56 +1212,46 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
 {
-    LLAPRFile* aprfile ;
-    S32 bytes_written ;
-    S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-    if(write_header)
+    if (mReadOnly)
     {
-        aprfile = openHeaderEntriesFile(false, 0);
-        bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-        if(bytes_written != sizeof(EntriesInfo))
-        {
-            clearCorruptedCache() ; //clear the cache.
-            idx = -1 ;//mark the idx invalid.
-            return ;
-        }
-
-        mHeaderAPRFile->seek(APR_SET, offset);
+        return;
     }
-    else
+
+    if(write_header)
     {
-        aprfile = openHeaderEntriesFile(false, offset);
+        writeEntriesHeader();
     }
-    bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-    if(bytes_written != sizeof(Entry))
+
+    Entry* mapped_entry = getMappedEntry(idx);
+    if (!mapped_entry)
     {
         clearCorruptedCache() ; //clear the cache.
         idx = -1 ;//mark the idx invalid.
-
         return ;
     }
 
-    closeHeaderEntriesFile();
-    mUpdatedEntryMap.erase(idx) ;
+    LLMutexLock lock(&getEntryMutex(idx));
+    *mapped_entry = entry;
 }
 
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
 {
-    S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-    LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-    S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-    closeHeaderEntriesFile();
-
-    if(bytes_read != sizeof(Entry))
+    Entry* mapped_entry = getMappedEntry(idx);
+    if (!mapped_entry)
     {
         clearCorruptedCache() ; //clear the cache.
         idx = -1 ;//mark the idx invalid.
+        return ;
     }
+
+    LLMutexLock lock(&getEntryMutex(idx));
+    entry = *mapped_entry;
 }
 
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
+//update an existing entry time stamp in place.
+//Does not need mHeaderMutex: if the entry was reused for another texture
+//since it was read, it is left alone.
 void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 {
     static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
@@ -1259,7 +1266,17 @@ void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
         if (!mReadOnly)
         {
             entry.mTime = (U32)time(NULL);
-            mUpdatedEntryMap[idx] = entry ;
+
+            LLSharedMutexLock mapping_lock(&mMappingMutex);
+            Entry* mapped_entry = getMappedEntry(idx);
+            if (mapped_entry)
+            {
+                LLMutexLock lock(&getEntryMutex(idx));
+                if (mapped_entry->mID == entry.mID)
+                {
+                    mapped_entry->mTime = entry.mTime;
+                }
+            }
         }
     }
 }
@@ -1328,33 +1345,29 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
     mFreeList.clear();
     mTexturesSizeTotal = 0;
 
-    LLAPRFile* aprfile = NULL;
-    if(mUpdatedEntryMap.empty())
-    {
-        aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
-    }
-    else //update the header file first.
+    if (num_entries && !getMappedEntry(num_entries - 1))
     {
-        aprfile = openHeaderEntriesFile(false, 0);
-        updatedHeaderEntriesFile() ;
-        if(!aprfile)
-        {
-            return 0;
-        }
-        aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
+        LL_WARNS() << "Corrupted header entries, expected " << num_entries << " entries but got "
+                   << (mHeaderEntriesFile.getSize() > sizeof(EntriesInfo) ? (mHeaderEntriesFile.getSize() - sizeof(EntriesInfo)) / sizeof(Entry) : 0)
+                   << LL_ENDL;
+        purgeAllTextures(false);
+        return 0;
     }
 
     try
     {
         entries.resize(num_entries);
-        S32 total_entries_size = sizeof(Entry) * num_entries;
-        S32 bytes_read = aprfile->read((void*)entries.data(), total_entries_size);
-        if (bytes_read != total_entries_size)
+        if (num_entries)
         {
-            LL_WARNS() << "Corrupted header entries, expected " << total_entries_size << " bytes but got " << bytes_read << " bytes" << LL_ENDL;
-            closeHeaderEntriesFile();
-            purgeAllTextures(false);
-            return 0;
+            for (LLMutex& mutex : mEntryMutexes)
+            {
+                mutex.lock();
+            }
+            memcpy((void*)entries.data(), getMappedEntry(0), sizeof(Entry) * num_entries);
+            for (LLMutex& mutex : mEntryMutexes)
+            {
+                mutex.unlock();
+            }
         }
 
         for (U32 idx = 0; idx < num_entries; idx++)
@@ -1380,84 +1393,22 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
         entries.clear();
         LL_WARNS() << "Bad alloc trying to read texture entries from cache, mFreeList: " << (S32)mFreeList.size()
             << ", total entries: " << num_entries << LL_ENDL;
-        closeHeaderEntriesFile();
         purgeAllTextures(false);
         return 0;
     }
-    closeHeaderEntriesFile();
     return num_entries;
 }
 
-void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
-{
-    auto num_entries = entries.size();
-    llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
-
-    if (!mReadOnly)
-    {
-        LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-        for (size_t idx=0; idx<num_entries; idx++)
-        {
-            S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-            if(bytes_written != sizeof(Entry))
-            {
-                clearCorruptedCache() ; //clear the cache.
-                return ;
-            }
-        }
-        closeHeaderEntriesFile();
-    }
-}
-
+// Entries are written in place, just ask the OS to write the dirty pages
 void LLTextureCache::writeUpdatedEntries()
 {
     lockHeaders() ;
-    if (!mReadOnly && !mUpdatedEntryMap.empty())
+    if (!mReadOnly)
     {
-        openHeaderEntriesFile(false, 0);
-        updatedHeaderEntriesFile() ;
-        closeHeaderEntriesFile();
+        mHeaderEntriesFile.flush();
     }
     unlockHeaders() ;
 }
-
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
-{
-    if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
-    {
-        //entriesInfo
-        mHeaderAPRFile->seek(APR_SET, 0);
-        S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-        if(bytes_written != sizeof(EntriesInfo))
-        {
-            clearCorruptedCache() ; //clear the cache.
-            return ;
-        }
-
-        //write each updated entry
-        S32 entry_size = (S32)sizeof(Entry) ;
-        S32 prev_idx = -1 ;
-        S32 delta_idx ;
-        for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-        {
-            delta_idx = iter->first - prev_idx - 1;
-            prev_idx = iter->first ;
-            if(delta_idx)
-            {
-                mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-            }
-
-            bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-            if(bytes_written != entry_size)
-            {
-                clearCorruptedCache() ; //clear the cache.
-                return ;
-            }
-        }
-        mUpdatedEntryMap.clear() ;
-    }
-}
 //----------------------------------------------------------------------------
 
 // Called from either the main thread or the worker thread
@@ -1543,8 +1494,14 @@ void LLTextureCache::readHeaderCache()
                 LLTimer timer;
                 for (std::set<U32>::iterator iter = purge_list.begin(); iter != purge_list.end(); ++iter)
                 {
-                    std::string tex_filename = getTextureFileName(entries[*iter].mID);
-                    removeEntry((S32)*iter, entries[*iter], tex_filename);
+                    S32 idx = (S32)*iter;
+                    std::string tex_filename = getTextureFileName(entries[idx].mID);
+                    removeEntry(idx, entries[idx], tex_filename);
+                    writeEntryToHeaderImmediately(idx, entries[*iter]);
+                    if (idx < 0)
+                    {
+                        break; // the cache was cleared
+                    }
 
                     //make sure that pruning entries doesn't take too much time
                     if (timer.getElapsedTimeF32() > TEXTURE_PRUNING_MAX_TIME)
@@ -1552,7 +1509,6 @@ void LLTextureCache::readHeaderCache()
                         break;
                     }
                 }
-                writeEntriesAndClose(entries);
             }
             else
             {
@@ -1570,7 +1526,6 @@ void LLTextureCache::clearCorruptedCache()
 {
     LL_WARNS() << "the texture cache is corrupted, need to be cleared." << LL_ENDL ;
 
-    closeHeaderEntriesFile();//close possible file handler
     purgeAllTextures(false) ; //clear the cache.
 
     if (!mReadOnly) //regenerate the directory tree if not exists.
@@ -1590,6 +1545,12 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+    // the entries file is about to be deleted or reset
+    {
+        LLExclusiveMutexLock lock(&mMappingMutex);
+        mHeaderEntriesFile.unmap();
+    }
+
     if (!mReadOnly)
     {
         const char* subdirs = "0123456789abcdef";
@@ -1625,11 +1586,14 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
     mTexturesSizeTotal = 0;
     mFreeList.clear();
     mTexturesSizeTotal = 0;
-    mUpdatedEntryMap.clear();
 
     // Info with 0 entries
     setEntriesHeader();
     writeEntriesHeader();
+    if (!purge_directories && !mReadOnly)
+    {
+        mapHeaderEntriesFile();
+    }
 
     LL_INFOS() << "The entire texture cache is cleared." << LL_ENDL ;
 }
@@ -1818,13 +1782,14 @@ void LLTextureCache::purgeTextures(bool validate)
             LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
             cache_size -= entries[idx].mBodySize;
             removeEntry(idx, entries[idx], filename) ;
+            writeEntryToHeaderImmediately(idx, entries[iter->second]);
+            if (idx < 0)
+            {
+                break; // the cache was cleared
+            }
         }
     }
 
-    LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
-
-    writeEntriesAndClose(entries);
-
     // *FIX:Mani - watchdog back on.
     LLAppViewer::instance()->resumeMainloopTimeout();
 
@@ -1869,11 +1834,14 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
-    LLMutexLock lock(&mHeaderMutex);
-    S32 idx = openAndReadEntry(id, entry, false);
+    S32 idx;
+    {
+        LLMutexLock lock(&mHeaderMutex);
+        idx = openAndReadEntry(id, entry, false);
+    }
     if (idx >= 0)
     {
-        updateEntryTimeStamp(idx, entry); // updates time
+        updateEntryTimeStamp(idx, entry); // updates time, only locks the entry
     }
     return idx;
 }
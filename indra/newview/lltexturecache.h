@@ -28,6 +28,7 @@
 #define LL_LLTEXTURECACHE_H
 
 #include "lldir.h"
+#include "llmappedfile.h"
 #include "llstl.h"
 #include "llstring.h"
 #include "lluuid.h"
@@ -164,8 +165,9 @@ private:
     void purgeAllTextures(bool purge_directories);
     void purgeTexturesLazy(F32 time_limit_sec);
     void purgeTextures(bool validate);
-    LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
-    void closeHeaderEntriesFile();
+    bool mapHeaderEntriesFile();
+    Entry* getMappedEntry(S32 idx);
+    LLMutex& getEntryMutex(S32 idx) { return mEntryMutexes[idx % ENTRY_MUTEX_STRIPES]; }
     void readEntriesHeader();
     void setEntriesHeader();
     void writeEntriesHeader();
@@ -173,7 +175,6 @@ private:
     bool updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_body_size);
     void updateEntryTimeStamp(S32 idx, Entry& entry) ;
     U32 openAndReadEntries(std::vector<Entry>& entries);
-    void writeEntriesAndClose(const std::vector<Entry>& entries);
     void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
     void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
     void removeEntry(S32 idx, Entry& entry, std::string& filename);
@@ -181,7 +182,6 @@ private:
     S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
     S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
     void writeUpdatedEntries() ;
-    void updatedHeaderEntriesFile() ;
     void lockHeaders() { mHeaderMutex.lock(); }
     void unlockHeaders() { mHeaderMutex.unlock(); }
 
@@ -195,7 +195,17 @@ private:
     LLMutex mHeaderMutex;
     LLMutex mListMutex;
     LLMutex mFastCacheMutex;
-    LLAPRFile* mHeaderAPRFile;
+
+    // The entries file is mapped in memory, entries are read and updated in
+    // place. It is only mapped and unmapped with both mHeaderMutex and
+    // mMappingMutex held exclusively, so either one keeps the mapping alive.
+    // Each entry slot is guarded by one of the striped mutexes, which lets
+    // time stamp updates run under a shared mMappingMutex lock rather than
+    // mHeaderMutex.
+    static const S32 ENTRY_MUTEX_STRIPES = 16;
+    LLMutex mEntryMutexes[ENTRY_MUTEX_STRIPES];
+    LLSharedMutex mMappingMutex;
+    LLMappedFile mHeaderEntriesFile;
     LLVolatileAPRPool* mFastCachePoolp;
 
     // mLocalAPRFilePoolp is not thread safe and is meant only for workers
@@ -222,7 +232,7 @@ private:
     EntriesInfo mHeaderEntriesInfo;
     std::set<S32> mFreeList; // deleted entries
     std::set<LLUUID> mLRU;
-    typedef std::map<LLUUID, S32> id_map_t;
+    typedef std::unordered_map<LLUUID, S32> id_map_t;
     id_map_t mHeaderIDMap;
 
     LLAPRFile*   mFastCachep;
@@ -236,8 +246,6 @@ private:
     S64 mTexturesSizeTotal;
     LLAtomicBool mDoPurge;
 
-    typedef std::map<S32, Entry> idx_entry_map_t;
-    idx_entry_map_t mUpdatedEntryMap;
     typedef std::vector<std::pair<S32, Entry> > idx_entry_vector_t;
     idx_entry_vector_t mPurgeEntryList;
 
@@ -53,6 +53,7 @@
 #include "llviewerassetstats.h"
 #include "llworld.h"
 #include "llsdparam.h"
+#include "llsdserialize.h"
 #include "llsdutil.h"
 #include "llstartup.h"
 
@@ -350,13 +351,14 @@ private:
         }
 
         // Threads:  Tid
-        virtual void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux, U32 request_id)
+        virtual void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux,
+                               LLImageBCMips* compressed, U32 request_id)
         {
             LL_PROFILE_ZONE_SCOPED;
             LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
             if (worker)
             {
-                worker->callbackDecoded(success, error_message, raw, aux, request_id);
+                worker->callbackDecoded(success, error_message, raw, aux, compressed, request_id);
             }
         }
     private:
@@ -400,7 +402,8 @@ public:
     void callbackCacheWrite(bool success);
 
     // Threads:  Tid
-    void callbackDecoded(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux, S32 decode_id);
+    void callbackDecoded(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux,
+                         LLImageBCMips* compressed, S32 decode_id);
 
     // Threads:  T*
     void setGetStatus(LLCore::HttpStatus status, const std::string& reason)
@@ -531,6 +534,7 @@ private:
     LLPointer<LLImageFormatted> mFormattedImage;
     LLPointer<LLImageRaw>       mRawImage,
                                 mAuxImage;
+    LLPointer<LLImageBCMips>    mCompressedImage;
     FTType mFTType;
     LLUUID mID;
     LLHost mHost;
@@ -1000,6 +1004,11 @@ void LLTextureFetchWorker::setDesiredDiscard(S32 discard, S32 size)
 // Locks:  Mw
 void LLTextureFetchWorker::setImagePriority(F32 priority)
 {
+    if (mDecodeHandle != 0 && priority != mImagePriority && LLAppViewer::getImageDecodeThread())
+    {
+        // reorder our decode if it's still waiting for a worker
+        LLAppViewer::getImageDecodeThread()->setPriority(mDecodeHandle, priority);
+    }
     mImagePriority = priority; //should map to max virtual size, abort if zero
 }
 
@@ -1645,7 +1654,21 @@ bool LLTextureFetchWorker::doWork(S32 param)
                 mRequestedOffset += src_offset;
             }
 
-            U8 * buffer = (U8 *)ll_aligned_malloc_16(total_size);
+            U8 * buffer = NULL;
+            bool copy_body = true;
+            if (cur_size == 0)
+            {
+                // Nothing loaded yet, take over the response body
+                // memory rather than copying it.
+                size_t body_size = 0;
+                buffer = (U8 *)mHttpBufferArray->detachContiguous(&body_size);
+                llassert_always(!buffer || body_size == (size_t)total_size);
+                copy_body = (buffer == NULL);
+            }
+            if (!buffer)
+            {
+                buffer = (U8 *)ll_aligned_malloc_16(total_size);
+            }
             if (!buffer)
             {
                 // abort. If we have no space for packet, we have not enough space to decode image
@@ -1677,12 +1700,15 @@ bool LLTextureFetchWorker::doWork(S32 param)
                 mFileSize = total_size + 1 ; //flag the file is not fully loaded.
             }
 
-            if (cur_size > 0)
+            if (copy_body)
             {
-                // Copy previously collected data into buffer
-                memcpy(buffer, mFormattedImage->getData(), cur_size);
+                if (cur_size > 0)
+                {
+                    // Copy previously collected data into buffer
+                    memcpy(buffer, mFormattedImage->getData(), cur_size);
+                }
+                mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
             }
-            mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
 
             // NOTE: setData releases current data and owns new data (buffer)
             mFormattedImage->setData(buffer, total_size);
@@ -1762,6 +1788,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
         mDecodeTimer.reset();
         mRawImage = NULL;
         mAuxImage = NULL;
+        mCompressedImage = NULL;
         llassert_always(mFormattedImage.notNull());
 
         // if we have the entire image data (and the image is not J2C), decode the full res image
@@ -1772,13 +1799,29 @@ bool LLTextureFetchWorker::doWork(S32 param)
         LL_DEBUGS(LOG_TXT) << mID << ": Decoding. Bytes: " << mFormattedImage->getDataSize() << " Discard: " << discard
                            << " All Data: " << mHaveAllData << LL_ENDL;
 
+        // Only regular assets are immutable for a given id: bakes and map
+        // tiles change under the same id and local files are cheap to decode
+        // again, so keep them out of the decoded texture cache.
+        const bool use_decoded_cache = mFTType == FTT_DEFAULT
+                                       && mUrl.compare(0, 7, "file://") != 0
+                                       && mFetcher->canLoadFromCache();
+        // Block compress on the decode thread rather than in the driver.
+        // LLImageGL still uploads the raw image for textures that must not
+        // be compressed, such as UI images.
+        const LLImageBC::EFormat compress_format = mFTType == FTT_DEFAULT || mFTType == FTT_SERVER_BAKE
+                                                   ? LLImageGL::getBlockCompressionFormat()
+                                                   : LLImageBC::FORMAT_NONE;
+
         // In case worked manages to request decode, be shut down,
         // then init and request decode again with first decode
         // still in progress, assign a sufficiently unique id
         mDecodeHandle = LLAppViewer::getImageDecodeThread()->decodeImage(mFormattedImage,
                                                                        discard,
                                                                        mNeedsAux,
-                                                                       new DecodeResponder(mFetcher, mID, this));
+                                                                       new DecodeResponder(mFetcher, mID, this),
+                                                                       mImagePriority,
+                                                                       use_decoded_cache ? mID : LLUUID::null,
+                                                                       compress_format);
         if (mDecodeHandle == 0)
         {
             // Abort, failed to put into queue.
@@ -2036,7 +2079,11 @@ void LLTextureFetchWorker::endWork(S32 param, bool aborted)
     LL_PROFILE_ZONE_SCOPED;
     if (mDecodeHandle != 0)
     {
-        // LL::ThreadPool has no operation to cancel a particular work item
+        // drop the decode if no worker has started it yet
+        if (LLAppViewer::getImageDecodeThread())
+        {
+            LLAppViewer::getImageDecodeThread()->cancel(mDecodeHandle);
+        }
         mDecodeHandle = 0;
     }
     mFormattedImage = NULL;
@@ -2293,7 +2340,8 @@ void LLTextureFetchWorker::callbackCacheWrite(bool success)
 //////////////////////////////////////////////////////////////////////////////
 
 // Threads:  Tid
-void LLTextureFetchWorker::callbackDecoded(bool success, const std::string &error_message, LLImageRaw* raw, LLImageRaw* aux, S32 decode_id)
+void LLTextureFetchWorker::callbackDecoded(bool success, const std::string &error_message, LLImageRaw* raw, LLImageRaw* aux,
+                                           LLImageBCMips* compressed, S32 decode_id)
 {
     LLMutexLock lock(&mWorkMutex);                                      // +Mw
     if (mDecodeHandle == 0)
@@ -2322,6 +2370,7 @@ void LLTextureFetchWorker::callbackDecoded(bool success, const std::string &erro
         llassert_always(raw);
         mRawImage = raw;
         mAuxImage = aux;
+        mCompressedImage = compressed;
         mDecodedDiscard = mFormattedImage->getDiscardLevel();
         if (mDecodedDiscard < mDesiredDiscard)
         {
@@ -2463,6 +2512,16 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, bool threaded, bool qa_mod
             sTesterp = NULL;
         }
     }
+
+    std::string replay_log = gSavedSettings.getString("TextureFetchReplayLog");
+    if (!replay_log.empty())
+    {
+        mReplayLog.open(replay_log.c_str(), std::ios::out | std::ios::app);
+        if (!mReplayLog.is_open())
+        {
+            LL_WARNS(LOG_TXT) << "Unable to open texture replay log " << replay_log << LL_ENDL;
+        }
+    }
 }
 
 LLTextureFetch::~LLTextureFetch()
@@ -2603,6 +2662,19 @@ S32 LLTextureFetch::createRequest(FTType f_type, const std::string& url, const L
 
     LL_DEBUGS(LOG_TXT) << "REQUESTED: " << id << " f_type " << fttype_to_string(f_type)
         << " Discard: " << desired_discard << " size " << desired_size << LL_ENDL;
+
+    if (mReplayLog.is_open())
+    {
+        LLSD entry;
+        entry["t"] = mReplayLogTimer.getElapsedTimeF64();
+        entry["id"] = id;
+        entry["discard"] = desired_discard;
+        entry["size"] = desired_size;
+        entry["priority"] = priority;
+
+        LLMutexLock lock(&mReplayLogMutex);                             // +Mfrl
+        mReplayLog << LLSDNotationStreamer(entry) << "\n";
+    }                                                                   // -Mfrl
     return desired_discard;
 }
 
@@ -2750,6 +2822,7 @@ LLTextureFetchWorker* LLTextureFetch::getWorker(const LLUUID& id)
 // Threads:  T*
 bool LLTextureFetch::getRequestFinished(const LLUUID& id, S32& discard_level, S32& worker_state,
                                         LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux,
+                                        LLPointer<LLImageBCMips>& compressed,
                                         LLCore::HttpStatus& last_http_get_status)
 {
     LL_PROFILE_ZONE_SCOPED;
@@ -2785,6 +2858,7 @@ bool LLTextureFetch::getRequestFinished(const LLUUID& id, S32& discard_level, S3
             discard_level = worker->mDecodedDiscard;
             raw = worker->mRawImage;
             aux = worker->mAuxImage;
+            compressed = worker->mCompressedImage;
 
             decode_time = worker->mDecodeTime;
             fetch_time = worker->mFetchTime;
@@ -2830,6 +2904,7 @@ bool LLTextureFetch::getRequestFinished(const LLUUID& id, S32& discard_level, S3
                 discard_level = worker->mDecodedDiscard;
                 raw = worker->mRawImage;
                 aux = worker->mAuxImage;
+                compressed = worker->mCompressedImage;
             }
             worker->unlockWorkMutex();                                  // -Mw
         }
@@ -31,6 +31,7 @@
 #include <map>
 
 #include "lldir.h"
+#include "llfile.h"
 #include "llimage.h"
 #include "lluuid.h"
 #include "llworkerthread.h"
@@ -40,6 +41,7 @@
 #include "httpoptions.h"
 #include "httpheaders.h"
 #include "httphandler.h"
+#include "lltimer.h"
 #include "lltrace.h"
 #include "llviewertexture.h"
 
@@ -106,6 +108,7 @@ public:
     // keep in mind that if fetcher isn't done, it still might need original raw image
     bool getRequestFinished(const LLUUID& id, S32& discard_level, S32& worker_state,
                             LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux,
+                            LLPointer<LLImageBCMips>& compressed,
                             LLCore::HttpStatus& last_http_get_status);
 
     // Threads:  T*
@@ -338,6 +341,11 @@ private:
     LLTextureInfo mTextureInfo;
     LLTextureInfo mTextureInfoMainThread;
 
+    // Request log for the llimagereplay benchmark, see TextureFetchReplayLog
+    LLMutex mReplayLogMutex;
+    llofstream mReplayLog;                                              // Mfrl
+    LLTimer mReplayLogTimer;
+
     // XXX possible delete
     U32Bits mHTTPTextureBits;                                               // Mfnq
 
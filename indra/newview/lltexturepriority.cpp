@@ -0,0 +1,231 @@
+/**
+ * @file lltexturepriority.cpp
+ * @brief Struct of arrays table of texture update priorities.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturepriority.h"
+
+#include "llgltexture.h"
+#include "llvector4a.h"
+
+#include <algorithm>
+
+namespace
+{
+    U32 padded_size(U32 rows)
+    {
+        return (rows + 3) & ~3u;
+    }
+}
+
+LLTexturePriorityTable::LLTexturePriorityTable()
+{
+}
+
+S32 LLTexturePriorityTable::add(LLViewerFetchedTexture* texture)
+{
+    const S32 row = (S32)mTextures.size();
+    mTextures.push_back(texture);
+    mUpdateFrame.push_back(0);
+
+    const U32 old_size = mVirtualSize.size();
+    const U32 new_size = padded_size(row + 1);
+    if (new_size > old_size)
+    {
+        LLAlignedArray<F32, 64>* columns[] = { &mVirtualSize, &mResidentArea, &mFullArea, &mLastBindTime,
+                                               &mBoostLevel, &mFetchScore, &mDiscardScore };
+        for (LLAlignedArray<F32, 64>* column : columns)
+        {
+            column->resize(new_size);
+            std::fill(column->mArray + old_size, column->mArray + new_size, 0.f);
+        }
+    }
+    return row;
+}
+
+LLViewerFetchedTexture* LLTexturePriorityTable::remove(S32 row)
+{
+    llassert(row >= 0 && row < size());
+
+    const S32 last = size() - 1;
+    LLAlignedArray<F32, 64>* columns[] = { &mVirtualSize, &mResidentArea, &mFullArea, &mLastBindTime,
+                                           &mBoostLevel, &mFetchScore, &mDiscardScore };
+    for (LLAlignedArray<F32, 64>* column : columns)
+    {
+        column->mArray[row] = column->mArray[last];
+        column->mArray[last] = 0.f;
+    }
+    mTextures[row] = mTextures[last];
+    mUpdateFrame[row] = mUpdateFrame[last];
+    mTextures.pop_back();
+    mUpdateFrame.pop_back();
+
+    return row < last ? mTextures[row] : nullptr;
+}
+
+void LLTexturePriorityTable::clear()
+{
+    mTextures.clear();
+    mUpdateFrame.clear();
+    LLAlignedArray<F32, 64>* columns[] = { &mVirtualSize, &mResidentArea, &mFullArea, &mLastBindTime,
+                                           &mBoostLevel, &mFetchScore, &mDiscardScore };
+    for (LLAlignedArray<F32, 64>* column : columns)
+    {
+        column->resize(0);
+    }
+}
+
+void LLTexturePriorityTable::update(S32 row, F32 virtual_size, F32 resident_area, F32 full_area,
+                                    F32 last_bind_time, S32 boost_level, U32 frame)
+{
+    updateState(row, resident_area, full_area, last_bind_time, boost_level);
+    mVirtualSize.mArray[row] = virtual_size;
+    mUpdateFrame[row] = frame;
+}
+
+void LLTexturePriorityTable::updateState(S32 row, F32 resident_area, F32 full_area,
+                                         F32 last_bind_time, S32 boost_level)
+{
+    llassert(row >= 0 && row < size());
+
+    mResidentArea.mArray[row] = resident_area;
+    mFullArea.mArray[row] = full_area;
+    mLastBindTime.mArray[row] = last_bind_time;
+    mBoostLevel.mArray[row] = (F32)boost_level;
+}
+
+//static
+void LLTexturePriorityTable::scoreRow(F32 virtual_size, F32 resident_area, F32 full_area,
+                                      F32 last_bind_time, F32 boost_level, F32 now,
+                                      F32& fetch_score, F32& discard_score)
+{
+    // how many times more texels the texture could use
+    const F32 need = virtual_size / llmax(resident_area, 1.f);
+    const F32 weight = boost_level >= (F32)LLGLTexture::BOOST_HIGH ? BOOSTED_WEIGHT : 1.f;
+    fetch_score = resident_area < full_area && need >= MIN_AREA_RATIO ? need * weight : 0.f;
+
+    // how many times more texels the texture holds than it uses, the longer
+    // it has not been drawn the better. Baked and boosted textures are never
+    // scaled down.
+    const F32 excess = resident_area / llmax(virtual_size, 1.f);
+    const F32 idle = now - last_bind_time;
+    discard_score = boost_level < (F32)LLGLTexture::BOOST_AVATAR_BAKED && excess >= MIN_AREA_RATIO && idle >= MIN_IDLE_TIME
+                    ? excess * idle : 0.f;
+}
+
+void LLTexturePriorityTable::score(F32 now)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+    LLVector4a zero, one, min_ratio, min_idle, boosted_weight, boost_high, boost_baked, now4;
+    zero.clear();
+    one.splat(1.f);
+    min_ratio.splat(MIN_AREA_RATIO);
+    min_idle.splat(MIN_IDLE_TIME);
+    boosted_weight.splat(BOOSTED_WEIGHT);
+    boost_high.splat((F32)LLGLTexture::BOOST_HIGH);
+    boost_baked.splat((F32)LLGLTexture::BOOST_AVATAR_BAKED);
+    now4.splat(now);
+
+    // same operations in the same order as scoreRow(), so the results match
+    const S32 padded = (S32)mVirtualSize.size();
+    for (S32 i = 0; i < padded; i += 4)
+    {
+        LLVector4a virtual_size, resident_area, full_area, last_bind_time, boost_level;
+        virtual_size.load4a(mVirtualSize.mArray + i);
+        resident_area.load4a(mResidentArea.mArray + i);
+        full_area.load4a(mFullArea.mArray + i);
+        last_bind_time.load4a(mLastBindTime.mArray + i);
+        boost_level.load4a(mBoostLevel.mArray + i);
+
+        LLVector4a divisor, need, weight, fetch_score;
+        divisor.setMax(resident_area, one);
+        need.setDiv(virtual_size, divisor);
+        weight.setSelectWithMask(boost_level.greaterEqual(boost_high), boosted_weight, one);
+        fetch_score.setMul(need, weight);
+        LLVector4Logical fetch_mask = _mm_and_ps(resident_area.lessThan(full_area), need.greaterEqual(min_ratio));
+        fetch_score.setSelectWithMask(fetch_mask, fetch_score, zero);
+
+        LLVector4a excess, idle, discard_score;
+        divisor.setMax(virtual_size, one);
+        excess.setDiv(resident_area, divisor);
+        idle.setSub(now4, last_bind_time);
+        discard_score.setMul(excess, idle);
+        LLVector4Logical discard_mask = _mm_and_ps(_mm_and_ps(boost_level.lessThan(boost_baked), excess.greaterEqual(min_ratio)),
+                                                   idle.greaterEqual(min_idle));
+        discard_score.setSelectWithMask(discard_mask, discard_score, zero);
+
+        fetch_score.store4a(mFetchScore.mArray + i);
+        discard_score.store4a(mDiscardScore.mArray + i);
+    }
+}
+
+void LLTexturePriorityTable::selectTop(const LLAlignedArray<F32, 64>& scores, S32 count, U32 frame,
+                                       std::vector<LLViewerFetchedTexture*>& out) const
+{
+    out.clear();
+    if (count <= 0)
+    {
+        return;
+    }
+
+    std::vector<S32> rows;
+    for (S32 row = 0; row < size(); ++row)
+    {
+        if (scores.mArray[row] > 0.f && mUpdateFrame[row] != frame)
+        {
+            rows.push_back(row);
+        }
+    }
+
+    // best first, ties in row order so the choice does not depend on the
+    // partial sort
+    auto better = [&scores](S32 a, S32 b)
+    {
+        return scores.mArray[a] != scores.mArray[b] ? scores.mArray[a] > scores.mArray[b] : a < b;
+    };
+    if ((S32)rows.size() > count)
+    {
+        std::nth_element(rows.begin(), rows.begin() + count, rows.end(), better);
+        rows.resize(count);
+    }
+    std::sort(rows.begin(), rows.end(), better);
+
+    out.reserve(rows.size());
+    for (S32 row : rows)
+    {
+        out.push_back(mTextures[row]);
+    }
+}
+
+void LLTexturePriorityTable::selectCandidates(S32 count, U32 frame,
+                                              std::vector<LLViewerFetchedTexture*>& fetch,
+                                              std::vector<LLViewerFetchedTexture*>& discard) const
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    selectTop(mFetchScore, count, frame, fetch);
+    selectTop(mDiscardScore, count, frame, discard);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file lltexturepriority.h
+ * @brief Struct of arrays table of texture update priorities.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREPRIORITY_H
+#define LL_LLTEXTUREPRIORITY_H
+
+#include "llalignedarray.h"
+
+#include <vector>
+
+class LLViewerFetchedTexture;
+
+// LLViewerTextureList only gets through a few percent of its textures each
+// frame, in round robin order, because finding a texture's virtual size
+// means walking all of its faces. This table keeps what that walk found for
+// every texture, one array per field, so the whole list can be scored with
+// SIMD every frame and the textures that most need more resolution, or
+// hold the most resolution they no longer need, can take part of the
+// round robin's updates. The fields that don't need the face walk are
+// refreshed in batches in between.
+//
+// The table never dereferences the texture pointers it holds.
+class LLTexturePriorityTable
+{
+public:
+    static const S32 INVALID_ROW = -1;
+
+    // A texture must want at least a discard level more (or less) texels
+    // than it has to be a candidate
+    static constexpr F32 MIN_AREA_RATIO = 4.f;
+    // Seconds unbound before a texture is a discard candidate
+    static constexpr F32 MIN_IDLE_TIME = 10.f;
+    // Fetch score multiplier of textures boosted to BOOST_HIGH and above
+    static constexpr F32 BOOSTED_WEIGHT = 4.f;
+
+    LLTexturePriorityTable();
+
+    // Returns the texture's row
+    S32 add(LLViewerFetchedTexture* texture);
+    // The last row moves into the removed one: returns the texture now in
+    // row, null if row was the last one
+    LLViewerFetchedTexture* remove(S32 row);
+    void clear();
+    S32 size() const { return (S32)mTextures.size(); }
+    LLViewerFetchedTexture* getTexture(S32 row) const { return mTextures[row]; }
+
+    // Record the state of a texture after its priority was updated.
+    // resident_area is the texel count of its GL image, full_area the texel
+    // count it could have, last_bind_time is in LLImageGL::sLastFrameTime
+    // seconds.
+    void update(S32 row, F32 virtual_size, F32 resident_area, F32 full_area,
+                F32 last_bind_time, S32 boost_level, U32 frame);
+    // Same without the virtual size, which keeps what the last update()
+    // found
+    void updateState(S32 row, F32 resident_area, F32 full_area,
+                     F32 last_bind_time, S32 boost_level);
+    // The frame of the last update()
+    U32 getUpdateFrame(S32 row) const { return mUpdateFrame[row]; }
+
+    // Score every row as of now
+    void score(F32 now);
+
+    // The count rows with the highest fetch and discard scores, best first,
+    // skipping rows with no score and rows updated during frame
+    void selectCandidates(S32 count, U32 frame,
+                          std::vector<LLViewerFetchedTexture*>& fetch,
+                          std::vector<LLViewerFetchedTexture*>& discard) const;
+
+    F32 getFetchScore(S32 row) const { return mFetchScore[row]; }
+    F32 getDiscardScore(S32 row) const { return mDiscardScore[row]; }
+
+    // The scores of one row, the reference for the SIMD loop in score()
+    static void scoreRow(F32 virtual_size, F32 resident_area, F32 full_area,
+                         F32 last_bind_time, F32 boost_level, F32 now,
+                         F32& fetch_score, F32& discard_score);
+
+private:
+    void selectTop(const LLAlignedArray<F32, 64>& scores, S32 count, U32 frame,
+                   std::vector<LLViewerFetchedTexture*>& out) const;
+
+    std::vector<LLViewerFetchedTexture*> mTextures;
+    std::vector<U32> mUpdateFrame;
+
+    // Padded to a multiple of 4 rows, the padding is zero and scores zero
+    LLAlignedArray<F32, 64> mVirtualSize;
+    LLAlignedArray<F32, 64> mResidentArea;
+    LLAlignedArray<F32, 64> mFullArea;
+    LLAlignedArray<F32, 64> mLastBindTime;
+    LLAlignedArray<F32, 64> mBoostLevel;
+
+    LLAlignedArray<F32, 64> mFetchScore;
+    LLAlignedArray<F32, 64> mDiscardScore;
+};
+
+#endif // LL_LLTEXTUREPRIORITY_H
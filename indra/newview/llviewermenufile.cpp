@@ -44,6 +44,7 @@
 #include "llimage.h"
 #include "llimagebmp.h"
 #include "llimagepng.h"
+#include "llimageingest.h"
 #include "llimagej2c.h"
 #include "llimagejpeg.h"
 #include "llimagetga.h"
@@ -542,6 +543,67 @@ void upload_single_file(
     return;
 }
 
+// Uploads a texture of a bulk upload once the image ingest thread has
+// loaded, scaled and encoded its file
+class LLBulkTextureUploadResponder : public LLImageIngestThread::Responder
+{
+public:
+    LLBulkTextureUploadResponder(const std::string& asset_name, S32 max_width, S32 max_height)
+        : mAssetName(asset_name),
+          mMaxWidth(max_width),
+          mMaxHeight(max_height)
+    {
+    }
+
+    void completed(LLImageIngestThread::handle_t handle, const LLImageIngestThread::Result& result) override
+    {
+        if (!result.mSuccess)
+        {
+            LL_WARNS() << "Failed to prepare image " << mAssetName << " for upload: " << result.mError << LL_ENDL;
+            return;
+        }
+
+        LLPointer<LLImageRaw> raw_image = result.mRawImage;
+        if (result.mFitted)
+        {
+            // Inform the resident about the resized image
+            LLSD subs;
+            subs["[ORIGINAL_WIDTH]"]  = result.mOriginalWidth;
+            subs["[ORIGINAL_HEIGHT]"] = result.mOriginalHeight;
+            subs["[NEW_WIDTH]"]       = raw_image->getWidth();
+            subs["[NEW_HEIGHT]"]      = raw_image->getHeight();
+            subs["[MAX_WIDTH]"]       = mMaxWidth;
+            subs["[MAX_HEIGHT]"]      = mMaxHeight;
+            LLNotificationsUtil::add("ImageUploadResized", subs);
+        }
+
+        LLTransactionID tid;
+        tid.generate();
+        LLAssetID new_asset_id = tid.makeAssetID(gAgent.getSecureSessionID());
+
+        LLFileSystem fmt_file(new_asset_id, LLAssetType::AT_TEXTURE, LLFileSystem::WRITE);
+        fmt_file.write(result.mEncodedImage->getData(), result.mEncodedImage->getDataSize());
+
+        LLResourceUploadInfo::ptr_t assetUploadInfo(new LLResourceUploadInfo(
+            tid, LLAssetType::AT_TEXTURE,
+            mAssetName,
+            mAssetName, 0,
+            LLFolderType::FT_NONE, LLInventoryType::IT_NONE,
+            LLFloaterPerms::getNextOwnerPerms("Uploads"),
+            LLFloaterPerms::getGroupPerms("Uploads"),
+            LLFloaterPerms::getEveryonePerms("Uploads"),
+            LLAgentBenefitsMgr::current().getTextureUploadCost(raw_image->getWidth(), raw_image->getHeight())
+        ));
+
+        upload_new_resource(assetUploadInfo);
+    }
+
+private:
+    std::string mAssetName;
+    S32 mMaxWidth;
+    S32 mMaxHeight;
+};
+
 void do_bulk_upload(std::vector<std::string> filenames, bool allow_2k)
 {
     for (std::vector<std::string>::const_iterator in_iter = filenames.begin(); in_iter != filenames.end(); ++in_iter)
@@ -576,97 +638,17 @@ void do_bulk_upload(std::vector<std::string> filenames, bool allow_2k)
             {
                 if (asset_type == LLAssetType::AT_TEXTURE)
                 {
-                    std::string exten = gDirUtilp->getExtension(filename);
-                    U32         codec = LLImageBase::getCodecFromExtension(exten);
-
-                    // Load the image
-                    LLPointer<LLImageFormatted> image = LLImageFormatted::createFromType(codec);
-                    if (image.isNull())
-                    {
-                        LL_WARNS() << "Failed to create image container for " << filename << LL_ENDL;
-                        continue;
-                    }
-                    if (!image->load(filename))
-                    {
-                        LL_WARNS() << "Failed to load image: " << filename << LL_ENDL;
-                        continue;
-                    }
-                    // Decompress or expand it in a raw image structure
-                    LLPointer<LLImageRaw> raw_image = new LLImageRaw;
-                    if (!image->decode(raw_image, 0.0f))
-                    {
-                        LL_WARNS() << "Failed to decode image: " << filename << LL_ENDL;
-                        continue;
-                    }
-                    // Check the image constraints
-                    if ((image->getComponents() != 3) && (image->getComponents() != 4))
-                    {
-                        LL_WARNS() << "Attempted to upload a texture that has " << image->getComponents()
-                                   << " components, but only 3 (RGB) or 4 (RGBA) are allowed." << LL_ENDL;
-                        continue;
-                    }
                     // Downscale images to fit the max_texture_dimensions_*, or 1024 if allow_2k is false
-                    S32 max_width  = allow_2k ? gSavedSettings.getS32("max_texture_dimension_X") : 1024;
-                    S32 max_height = allow_2k ? gSavedSettings.getS32("max_texture_dimension_Y") : 1024;
-
-                    S32 orig_width  = raw_image->getWidth();
-                    S32 orig_height = raw_image->getHeight();
-
-                    if (orig_width > max_width || orig_height > max_height)
-                    {
-                        // Calculate scale factors
-                        F32 width_scale  = (F32)max_width / (F32)orig_width;
-                        F32 height_scale = (F32)max_height / (F32)orig_height;
-                        F32 scale        = llmin(width_scale, height_scale);
-
-                        // Calculate new dimensions, preserving aspect ratio
-                        S32 new_width  = LLImageRaw::contractDimToPowerOfTwo(llclamp((S32)llroundf(orig_width * scale), 4, max_width));
-                        S32 new_height = LLImageRaw::contractDimToPowerOfTwo(llclamp((S32)llroundf(orig_height * scale), 4, max_height));
-
-                        if (!raw_image->scale(new_width, new_height))
-                        {
-                            LL_WARNS() << "Failed to scale image from " << orig_width << "x" << orig_height << " to " << new_width << "x"
-                                       << new_height << LL_ENDL;
-                            continue;
-                        }
-
-                        // Inform the resident about the resized image
-                        LLSD subs;
-                        subs["[ORIGINAL_WIDTH]"]  = orig_width;
-                        subs["[ORIGINAL_HEIGHT]"] = orig_height;
-                        subs["[NEW_WIDTH]"]       = new_width;
-                        subs["[NEW_HEIGHT]"]      = new_height;
-                        subs["[MAX_WIDTH]"]       = max_width;
-                        subs["[MAX_HEIGHT]"]      = max_height;
-                        LLNotificationsUtil::add("ImageUploadResized", subs);
-                    }
-
-                    raw_image->biasedScaleToPowerOfTwo(LLViewerFetchedTexture::MAX_IMAGE_SIZE_DEFAULT);
-
-                    LLTransactionID tid;
-                    tid.generate();
-                    LLAssetID new_asset_id = tid.makeAssetID(gAgent.getSecureSessionID());
-
-                    LLPointer<LLImageJ2C> formatted = new LLImageJ2C;
-
-                    if (formatted->encode(raw_image, 0.0f))
-                    {
-                        LLFileSystem fmt_file(new_asset_id, LLAssetType::AT_TEXTURE, LLFileSystem::WRITE);
-                        fmt_file.write(formatted->getData(), formatted->getDataSize());
-
-                        LLResourceUploadInfo::ptr_t assetUploadInfo(new LLResourceUploadInfo(
-                            tid, LLAssetType::AT_TEXTURE,
-                            asset_name,
-                            asset_name, 0,
-                            LLFolderType::FT_NONE, LLInventoryType::IT_NONE,
-                            LLFloaterPerms::getNextOwnerPerms("Uploads"),
-                            LLFloaterPerms::getGroupPerms("Uploads"),
-                            LLFloaterPerms::getEveryonePerms("Uploads"),
-                            LLAgentBenefitsMgr::current().getTextureUploadCost(raw_image->getWidth(), raw_image->getHeight())
-                        ));
-
-                        upload_new_resource(assetUploadInfo);
-                    }
+                    LLImageIngestThread::Request request;
+                    request.mFilename = filename;
+                    request.mMaxWidth = allow_2k ? gSavedSettings.getS32("max_texture_dimension_X") : 1024;
+                    request.mMaxHeight = allow_2k ? gSavedSettings.getS32("max_texture_dimension_Y") : 1024;
+                    request.mMaxDimension = LLViewerFetchedTexture::MAX_IMAGE_SIZE_DEFAULT;
+
+                    // Decoding and encoding hundreds of files would freeze
+                    // the viewer, the upload starts when they are done
+                    LLAppViewer::getImageIngestThread()->ingest(request,
+                        new LLBulkTextureUploadResponder(asset_name, request.mMaxWidth, request.mMaxHeight));
                 }
                 else
                 {
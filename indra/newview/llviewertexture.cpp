@@ -1253,6 +1253,7 @@ void LLViewerFetchedTexture::loadFromFastCache()
 
     LLTimer fastCacheTimer;
     mRawImage = LLAppViewer::getTextureCache()->readFromFastCache(getID(), mRawDiscardLevel);
+    mCompressedImage = nullptr;
     if(mRawImage.notNull())
     {
         F32 cachReadTime = fastCacheTimer.getElapsedTimeF32();
@@ -1590,7 +1591,8 @@ bool LLViewerFetchedTexture::createTexture(S32 usename/*= 0*/)
         return false;
     }
 
-    bool res = mGLTexturep->createGLTexture(mRawDiscardLevel, mRawImage, usename, true, mBoostLevel);
+    bool res = mGLTexturep->createGLTexture(mRawDiscardLevel, mRawImage, usename, true, mBoostLevel,
+                                            false, nullptr, mCompressedImage);
 
     return res;
 }
@@ -2082,7 +2084,7 @@ bool LLViewerFetchedTexture::updateFetch()
         if (mAuxRawImage.notNull()) sAuxCount--;
         // keep in mind that fetcher still might need raw image, don't modify original
         bool finished = LLAppViewer::getTextureFetch()->getRequestFinished(getID(), fetch_discard, mFetchState, mRawImage, mAuxRawImage,
-            mLastHttpGetStatus);
+            mCompressedImage, mLastHttpGetStatus);
         if (mRawImage.notNull()) sRawCount++;
         if (mAuxRawImage.notNull())
         {
@@ -2216,6 +2218,7 @@ bool LLViewerFetchedTexture::updateFetch()
                 if (mRawImage.notNull()) sRawCount--;
                 if (mAuxRawImage.notNull()) sAuxCount--;
                 decoded_discard = LLAppViewer::getTextureFetch()->getLastRawImage(getID(), mRawImage, mAuxRawImage);
+                mCompressedImage = nullptr;
                 if (mRawImage.notNull()) sRawCount++;
                 if (mAuxRawImage.notNull())
                 {
@@ -2801,6 +2804,7 @@ void LLViewerFetchedTexture::destroyRawImage()
         }
 
         mRawImage = nullptr;
+        mCompressedImage = nullptr;
 
         mIsRawImageValid = false;
         mRawDiscardLevel = INVALID_DISCARD_LEVEL;
@@ -38,6 +38,7 @@
 #include "httpcommon.h"
 #include "workqueue.h"
 #include "gltf/common.h"
+#include "lltexturepriority.h"
 
 #include <map>
 #include <list>
@@ -417,6 +418,7 @@ public:
 
     bool mCreatePending = false;    // if true, this is in gTextureList.mCreateTextureList
     mutable bool mDownScalePending = false; // if true, this is in gTextureList.mDownScaleQueue
+    S32 mPriorityRow = LLTexturePriorityTable::INVALID_ROW; // row in gTextureList.mPriorityTable while in the image list
 
     LLUUID      getUploader();
     LLDate      getUploadTime();
@@ -483,6 +485,8 @@ protected:
 
     LLPointer<LLImageRaw> mRawImage;
     S32 mRawDiscardLevel = -1;
+    // Block compressed copy of mRawImage made by the decode thread, if any
+    LLPointer<LLImageBCMips> mCompressedImage;
 
     // Used ONLY for cloth meshes right now.  Make SURE you know what you're
     // doing if you use it for anything else! - djs
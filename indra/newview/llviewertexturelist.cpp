@@ -366,6 +366,11 @@ void LLViewerTextureList::shutdown()
 
     mUUIDMap.clear();
 
+    for (LLViewerFetchedTexture* imagep : mImageList)
+    {
+        imagep->mPriorityRow = LLTexturePriorityTable::INVALID_ROW;
+    }
+    mPriorityTable.clear();
     mImageList.clear();
 
     mInitialized = false ; //prevent loading textures again.
@@ -715,6 +720,10 @@ void LLViewerTextureList::addImageToList(LLViewerFetchedTexture *image)
         {
             LL_WARNS() << "Error happens when insert image " << image->getID()  << " into mImageList!" << LL_ENDL ;
         }
+        else
+        {
+            image->mPriorityRow = mPriorityTable.add(image);
+        }
         image->setInImageList(true);
     }
 }
@@ -726,6 +735,16 @@ void LLViewerTextureList::removeImageFromList(LLViewerFetchedTexture *image)
     llassert_always(mInitialized) ;
     llassert(image);
 
+    if (image->mPriorityRow != LLTexturePriorityTable::INVALID_ROW)
+    {
+        LLViewerFetchedTexture* moved = mPriorityTable.remove(image->mPriorityRow);
+        if (moved)
+        {
+            moved->mPriorityRow = image->mPriorityRow;
+        }
+        image->mPriorityRow = LLTexturePriorityTable::INVALID_ROW;
+    }
+
     size_t count = 0;
     if (image->isInImageList())
     {
@@ -1086,6 +1105,48 @@ void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imag
     }
 
     imagep->processTextureStats();
+
+    updatePriorityRow(imagep, true);
+}
+
+void LLViewerTextureList::updatePriorityRow(LLViewerFetchedTexture* imagep, bool with_virtual_size)
+{
+    if (imagep->mPriorityRow == LLTexturePriorityTable::INVALID_ROW)
+    {
+        return;
+    }
+
+    bool has_gl_texture = imagep->hasGLTexture();
+    F32 resident_area = has_gl_texture ? (F32)imagep->getWidth() * (F32)imagep->getHeight() : 0.f;
+    F32 full_area = (F32)imagep->getFullWidth() * (F32)imagep->getFullHeight();
+    F32 last_bind_time = has_gl_texture ? LLImageGL::sLastFrameTime - imagep->getTimePassedSinceLastBound() : 0.f;
+    if (with_virtual_size)
+    {
+        mPriorityTable.update(imagep->mPriorityRow, imagep->mMaxVirtualSize, resident_area, full_area,
+                              last_bind_time, imagep->getBoostLevel(), gFrameCount);
+    }
+    else
+    {
+        mPriorityTable.updateState(imagep->mPriorityRow, resident_area, full_area,
+                                   last_bind_time, imagep->getBoostLevel());
+    }
+}
+
+void LLViewerTextureList::refreshPriorityTable(S32 count)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    // no face walk, only what the texture itself knows, so that idle times
+    // and resident sizes are current when the table is scored
+    const S32 rows = mPriorityTable.size();
+    count = llmin(count, rows);
+    for (S32 i = 0; i < count; ++i)
+    {
+        if (mPriorityRefreshRow >= rows)
+        {
+            mPriorityRefreshRow = 0;
+        }
+        updatePriorityRow(mPriorityTable.getTexture(mPriorityRefreshRow++), false);
+    }
 }
 
 F32 LLViewerTextureList::updateImagesCreateTextures(F32 max_time)
@@ -1253,11 +1314,29 @@ F32 LLViewerTextureList::updateImagesFetchTextures(F32 max_time)
     }
     update_count = llmin(update_count, (U32) mUUIDMap.size());
 
+    // The textures that most need more or less resolution, going by what
+    // the table last found, take up to half of the updates ahead of their
+    // turn in the round robin, which gets the rest.
+    std::vector<LLViewerFetchedTexture*> fetch_candidates;
+    std::vector<LLViewerFetchedTexture*> discard_candidates;
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_TEXTURE("vtluift - priority");
+        static LLCachedControl<S32> candidate_count(gSavedSettings, "TextureFetchPriorityCandidates", 32);
+        static LLCachedControl<S32> refresh_count(gSavedSettings, "TextureFetchPriorityRefreshCount", 512);
+
+        refreshPriorityTable(refresh_count);
+        mPriorityTable.score(LLImageGL::sLastFrameTime);
+        mPriorityTable.selectCandidates(llmin((S32)candidate_count, (S32)update_count / 4), gFrameCount,
+                                        fetch_candidates, discard_candidates);
+        update_count -= (U32)(fetch_candidates.size() + discard_candidates.size());
+    }
+
+    size_t round_robin_count = 0;
     { // copy entries out of UUID map to avoid iterator invalidation from deletion inside updateImageDecodeProiroty or updateFetch below
         LL_PROFILE_ZONE_NAMED_CATEGORY_TEXTURE("vtluift - copy");
 
         // copy entries out of UUID map for updating
-        entries.reserve(update_count);
+        entries.reserve(update_count + fetch_candidates.size() + discard_candidates.size());
         uuid_map_t::iterator iter = mUUIDMap.upper_bound(mLastUpdateKey);
         while (update_count-- > 0)
         {
@@ -1272,13 +1351,27 @@ F32 LLViewerTextureList::updateImagesFetchTextures(F32 max_time)
             }
             ++iter;
         }
+        round_robin_count = entries.size();
+
+        entries.insert(entries.end(), fetch_candidates.begin(), fetch_candidates.end());
+        entries.insert(entries.end(), discard_candidates.begin(), discard_candidates.end());
     }
 
     LLTimer timer;
 
-    for (auto& imagep : entries)
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        mLastUpdateKey = LLTextureKey(imagep->getID(), (ETexListType)imagep->getTextureListType());
+        LLViewerFetchedTexture* imagep = entries[i];
+        if (i < round_robin_count)
+        {
+            mLastUpdateKey = LLTextureKey(imagep->getID(), (ETexListType)imagep->getTextureListType());
+        }
+        else if (imagep->mPriorityRow != LLTexturePriorityTable::INVALID_ROW
+                 && mPriorityTable.getUpdateFrame(imagep->mPriorityRow) == gFrameCount)
+        {
+            // already updated by the round robin
+            continue;
+        }
 
         if (imagep->getNumRefs() > 1) // make sure this image hasn't been deleted before attempting to update (may happen as a side effect of some other image updating)
         {
@@ -1326,10 +1419,12 @@ void LLViewerTextureList::decodeAllImages(F32 max_time)
         LLViewerFetchedTexture* imagep = *iter++;
         image_list.push_back(imagep);
         imagep->setInImageList(false) ;
+        imagep->mPriorityRow = LLTexturePriorityTable::INVALID_ROW;
     }
 
     llassert_always(image_list.size() == mImageList.size()) ;
     mImageList.clear();
+    mPriorityTable.clear();
     for (std::vector<LLPointer<LLViewerFetchedTexture> >::iterator iter = image_list.begin();
          iter != image_list.end(); ++iter)
     {
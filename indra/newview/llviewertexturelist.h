@@ -150,6 +150,11 @@ public:
 private:
     F32  updateImagesCreateTextures(F32 max_time);
     F32  updateImagesFetchTextures(F32 max_time);
+    // Record the state of a texture in mPriorityTable, its virtual size
+    // only when it was just computed
+    void updatePriorityRow(LLViewerFetchedTexture* imagep, bool with_virtual_size);
+    // Record the state of the next count rows of mPriorityTable
+    void refreshPriorityTable(S32 count);
     void updateImagesUpdateStats();
     F32  updateImagesLoadingFastCache(F32 max_time);
 
@@ -233,6 +238,12 @@ private:
 
     image_list_t mImageList;
 
+    // what updateImageDecodePriority() last found for every texture in
+    // mImageList, to pick textures to update ahead of the round robin
+    LLTexturePriorityTable mPriorityTable;
+    // next row refreshPriorityTable() visits
+    S32 mPriorityRefreshRow = 0;
+
     // simply holds on to LLViewerFetchedTexture references to stop them from being purged too soon
     boost::unordered_set<LLPointer<LLViewerFetchedTexture> > mImagePreloads;
 
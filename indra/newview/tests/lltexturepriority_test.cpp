@@ -0,0 +1,204 @@
+/**
+ * @file lltexturepriority_test.cpp
+ * @brief Test for the struct of arrays texture priority table.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header: almost always required for newview cpp files
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../lltexturepriority.h"
+// Dependencies
+#include "llgltexture.h"
+
+// Tut header
+#include "../test/lltut.h"
+
+// -------------------------------------------------------------------------------------------
+// Stubbing: Declarations required to link and run the class being tested
+// Notes:
+// * The table never dereferences its texture pointers, so tests use made up ones
+
+namespace
+{
+    LLViewerFetchedTexture* fake_texture(S32 i)
+    {
+        return reinterpret_cast<LLViewerFetchedTexture*>((uintptr_t)(i + 1) * 16);
+    }
+}
+
+// End Stubbing
+// -------------------------------------------------------------------------------------------
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+    struct texturepriority_test
+    {
+        LLTexturePriorityTable mTable;
+    };
+
+    typedef test_group<texturepriority_test> texturepriority_t;
+    typedef texturepriority_t::object texturepriority_object_t;
+    tut::texturepriority_t tut_texturepriority("LLTexturePriorityTable");
+
+    // add and remove
+    template<> template<>
+    void texturepriority_object_t::test<1>()
+    {
+        for (S32 i = 0; i < 5; ++i)
+        {
+            ensure_equals("row", mTable.add(fake_texture(i)), i);
+        }
+
+        // the last row moves into the removed one
+        ensure("moved", mTable.remove(1) == fake_texture(4));
+        ensure_equals("size", mTable.size(), 4);
+        ensure("row 1", mTable.getTexture(1) == fake_texture(4));
+
+        // nothing moves when removing the last row
+        ensure("last", mTable.remove(3) == nullptr);
+        ensure_equals("size after last", mTable.size(), 3);
+
+        mTable.clear();
+        ensure_equals("cleared", mTable.size(), 0);
+        ensure_equals("row after clear", mTable.add(fake_texture(0)), 0);
+    }
+
+    // the SIMD loop scores like the scalar reference
+    template<> template<>
+    void texturepriority_object_t::test<2>()
+    {
+        const F32 now = 1000.f;
+        const S32 rows = 103;   // not a multiple of 4
+        U32 state = 1;
+        auto next = [&state](U32 range)
+        {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) % range;
+        };
+
+        std::vector<F32> vsize(rows), resident(rows), full(rows), bind(rows), boost(rows);
+        for (S32 i = 0; i < rows; ++i)
+        {
+            mTable.add(fake_texture(i));
+            vsize[i] = (F32)(next(4) == 0 ? 0 : 1u << next(22));
+            resident[i] = next(5) == 0 ? 0.f : (F32)(1u << (2 * next(11)));
+            full[i] = llmax(resident[i], (F32)(1u << (2 * next(11))));
+            bind[i] = now - (F32)next(40);
+            boost[i] = (F32)next(LLGLTexture::BOOST_MAX_LEVEL);
+            mTable.update(i, vsize[i], resident[i], full[i], bind[i], (S32)boost[i], 1);
+        }
+
+        mTable.score(now);
+
+        S32 fetch_rows = 0;
+        S32 discard_rows = 0;
+        for (S32 i = 0; i < rows; ++i)
+        {
+            F32 fetch, discard;
+            LLTexturePriorityTable::scoreRow(vsize[i], resident[i], full[i], bind[i], boost[i], now, fetch, discard);
+            ensure_equals(llformat("fetch score %d", i), mTable.getFetchScore(i), fetch);
+            ensure_equals(llformat("discard score %d", i), mTable.getDiscardScore(i), discard);
+            fetch_rows += fetch > 0.f;
+            discard_rows += discard > 0.f;
+        }
+        // the random rows cover both kinds of candidate
+        ensure("fetch rows", fetch_rows > 0);
+        ensure("discard rows", discard_rows > 0);
+    }
+
+    // candidate selection
+    template<> template<>
+    void texturepriority_object_t::test<3>()
+    {
+        const F32 now = 100.f;
+        const S32 low = LLGLTexture::BOOST_NONE;
+
+        // 0: 16 times the texels of its 64x64, but already full size
+        mTable.add(fake_texture(0));
+        mTable.update(0, 65536.f, 4096.f, 4096.f, now, low, 1);
+        // 1: wants 8 times more
+        mTable.add(fake_texture(1));
+        mTable.update(1, 32768.f, 4096.f, 65536.f, now, low, 1);
+        // 2: wants 16 times more
+        mTable.add(fake_texture(2));
+        mTable.update(2, 65536.f, 4096.f, 65536.f, now, low, 1);
+        // 3: wants 8 times more and is boosted
+        mTable.add(fake_texture(3));
+        mTable.update(3, 32768.f, 4096.f, 65536.f, now, LLGLTexture::BOOST_HIGH, 1);
+        // 4: 16 times more texels than drawn, unbound for 20 seconds
+        mTable.add(fake_texture(4));
+        mTable.update(4, 256.f, 4096.f, 4096.f, now - 20.f, low, 1);
+        // 5: same but bound recently
+        mTable.add(fake_texture(5));
+        mTable.update(5, 256.f, 4096.f, 4096.f, now - 1.f, low, 1);
+        // 6: same but a baked texture
+        mTable.add(fake_texture(6));
+        mTable.update(6, 256.f, 4096.f, 4096.f, now - 20.f, LLGLTexture::BOOST_AVATAR_BAKED, 1);
+        // 7: wants 4 times more but was updated this frame
+        mTable.add(fake_texture(7));
+        mTable.update(7, 16384.f, 4096.f, 65536.f, now, low, 2);
+
+        mTable.score(now);
+
+        std::vector<LLViewerFetchedTexture*> fetch, discard;
+        mTable.selectCandidates(8, 2, fetch, discard);
+        ensure_equals("fetch count", fetch.size(), (size_t)3);
+        ensure("boosted first", fetch[0] == fake_texture(3));
+        ensure("then most needed", fetch[1] == fake_texture(2));
+        ensure("then least needed", fetch[2] == fake_texture(1));
+        ensure_equals("discard count", discard.size(), (size_t)1);
+        ensure("idle texture", discard[0] == fake_texture(4));
+
+        mTable.selectCandidates(2, 3, fetch, discard);
+        ensure_equals("limited fetch count", fetch.size(), (size_t)2);
+        ensure("top of the limited", fetch[0] == fake_texture(3) && fetch[1] == fake_texture(2));
+    }
+
+    // refreshing without the virtual size
+    template<> template<>
+    void texturepriority_object_t::test<4>()
+    {
+        const F32 now = 100.f;
+        const S32 low = LLGLTexture::BOOST_NONE;
+
+        // 16 times more texels than drawn, but bound recently
+        mTable.add(fake_texture(0));
+        mTable.update(0, 256.f, 4096.f, 4096.f, now - 1.f, low, 1);
+        mTable.score(now);
+        ensure_equals("recently bound", mTable.getDiscardScore(0), 0.f);
+
+        // unbound since, the virtual size and update frame are kept
+        mTable.updateState(0, 4096.f, 4096.f, now - 20.f, low);
+        ensure_equals("update frame kept", mTable.getUpdateFrame(0), (U32)1);
+        mTable.score(now);
+        F32 fetch, discard;
+        LLTexturePriorityTable::scoreRow(256.f, 4096.f, 4096.f, now - 20.f, (F32)low, now, fetch, discard);
+        ensure("now idle", discard > 0.f);
+        ensure_equals("discard score", mTable.getDiscardScore(0), discard);
+    }
+}
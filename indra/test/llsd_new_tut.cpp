@@ -30,8 +30,13 @@
 #include "linden_common.h"
 #include "lltut.h"
 
+#include "llsdflatmap.h"
 #include "llsdtraits.h"
 #include "llstring.h"
+#include "lltimer.h"
+#include "tests/wrapllerrs.h"
+
+#include <map>
 
 using std::fpclassify;
 
@@ -811,6 +816,276 @@ namespace tut
         ensure("type is a string", v.isString());
     }
 
+    template<> template<>
+    void SDTestObject::test<15>()
+        // map operations: ordering, lookup, erase and reference stability
+    {
+        LLSD m = LLSD::emptyMap();
+        m["delta"] = 4;
+        m["alpha"] = 1;
+        m["charlie"] = 3;
+
+        LLSD& alpha = m["alpha"];
+        for (S32 i = 0; i < 100; ++i)
+        {
+            m[llformat("key%03d", i)] = i;
+        }
+        ensure_equals("reference survives inserts", alpha.asInteger(), 1);
+        alpha = 11;
+        ensure_equals("reference still aliases entry", m["alpha"].asInteger(), 11);
+
+        m.erase("charlie");
+        m.erase("missing");
+        ensure("erased key gone", !m.has("charlie"));
+        ensure_equals("size after erase", m.size(), size_t(102));
+        m["bravo"] = 2;
+        ensure_equals("reused slot", m["bravo"].asInteger(), 2);
+        ensure_equals("lookup after reuse", m["delta"].asInteger(), 4);
+
+        std::string prev;
+        size_t count = 0;
+        for (LLSD::map_const_iterator it = m.beginMap(); it != m.endMap(); ++it, ++count)
+        {
+            ensure("keys in order", count == 0 || prev < it->first);
+            prev = it->first;
+        }
+        ensure_equals("iterated every entry", count, m.size());
+
+        LLSD::map_iterator last = m.endMap();
+        --last;
+        ensure_equals("last key", last->first, "key099");
+        ensure_equals("first key", m.beginMap()->first, "alpha");
+
+        // copy-on-write must leave the original untouched
+        LLSD copy = m;
+        copy["zulu"] = 26;
+        copy.erase("alpha");
+        ensure("original keeps alpha", m.has("alpha"));
+        ensure("original lacks zulu", !m.has("zulu"));
+        ensure_equals("copy size", copy.size(), m.size());
+
+        const LLSD& cm = m;
+        ensure("const lookup of missing key is undefined", cm["nope"].isUndefined());
+        ensure("const lookup did not insert", !m.has("nope"));
+    }
+
+    template<> template<>
+    void SDTestObject::test<16>()
+        // memory and lookup comparison against std::map; timings are
+        // logged for reference and never asserted
+    {
+        const S32 MAPS = 2000;
+        const S32 KEYS = 24;
+        std::vector<std::string> keys;
+        for (S32 i = 0; i < KEYS; ++i)
+        {
+            keys.push_back(llformat("attribute_%d", (i * 7919) % 1000));
+        }
+
+        typedef std::map<std::string, LLSD, std::less<>> tree_map_t;
+        std::vector<tree_map_t> trees(MAPS);
+        std::vector<LLSDFlatMap<LLSD>> flats(MAPS);
+
+        LLTimer timer;
+        for (tree_map_t& tree : trees)
+        {
+            for (S32 i = 0; i < KEYS; ++i)
+            {
+                tree.emplace(keys[i], LLSD(i));
+            }
+        }
+        F32 tree_build = timer.getElapsedTimeAndResetF32();
+        for (LLSDFlatMap<LLSD>& flat : flats)
+        {
+            for (S32 i = 0; i < KEYS; ++i)
+            {
+                flat.emplace(keys[i], LLSD(i));
+            }
+        }
+        F32 flat_build = timer.getElapsedTimeAndResetF32();
+
+        S64 tree_sum = 0;
+        for (const tree_map_t& tree : trees)
+        {
+            for (const std::string& key : keys)
+            {
+                tree_sum += tree.find(key)->second.asInteger();
+            }
+        }
+        F32 tree_lookup = timer.getElapsedTimeAndResetF32();
+        S64 flat_sum = 0;
+        size_t flat_bytes = 0;
+        for (const LLSDFlatMap<LLSD>& flat : flats)
+        {
+            for (const std::string& key : keys)
+            {
+                flat_sum += flat.find(key)->second.asInteger();
+            }
+            flat_bytes += flat.memoryUsage();
+        }
+        F32 flat_lookup = timer.getElapsedTimeAndResetF32();
+
+        ensure_equals("same lookup results", flat_sum, tree_sum);
+        for (S32 i = 0; i < MAPS; ++i)
+        {
+            ensure("same iteration order",
+                   std::equal(trees[i].begin(), trees[i].end(), flats[i].begin(), flats[i].end(),
+                              [](const auto& a, const auto& b) { return a.first == b.first; }));
+        }
+
+        // libstdc++ and MSVC red-black tree nodes carry three links and a color
+        size_t tree_bytes = size_t(MAPS) * KEYS * (sizeof(tree_map_t::value_type) + 4 * sizeof(void*));
+        LL_INFOS() << "LLSD map, " << MAPS << " maps x " << KEYS << " keys: "
+                   << "std::map ~" << tree_bytes << " bytes, build " << tree_build << "s, lookup " << tree_lookup << "s; "
+                   << "LLSDFlatMap " << flat_bytes << " bytes, build " << flat_build << "s, lookup " << flat_lookup << "s"
+                   << LL_ENDL;
+    }
+
+    template<> template<>
+    void SDTestObject::test<17>()
+        // bulk building through append() and sortAppended()
+    {
+        const S32 KEYS = 5000;
+        LLSDFlatMap<LLSD> flat;
+        flat.emplace("key00100", LLSD("emplaced"));
+
+        std::vector<LLSD*> values;
+        for (S32 i = KEYS - 1; i >= 0; --i)
+        {
+            // every key of the form key*7 comes twice
+            const std::string key = llformat("key%05d", (i * 7919) % KEYS);
+            values.push_back(&flat.append(key, LLSD(i)).second);
+            if (i % 7 == 0)
+            {
+                flat.append(key, LLSD("duplicate"));
+            }
+        }
+        ensure_equals("appended entries are not visible", flat.size(), (size_t)1);
+        ensure("appended entry not found", flat.find("key00001") == flat.end());
+
+        LLSDFlatMap<LLSD> copy(flat);
+        flat.sortAppended();
+        copy.sortAppended();
+
+        ensure_equals("size", flat.size(), (size_t)KEYS);
+        ensure_equals("copy size", copy.size(), (size_t)KEYS);
+        ensure_equals("existing entry wins", flat.find("key00100")->second.asString(), std::string("emplaced"));
+        std::string prev;
+        for (const auto& entry : flat)
+        {
+            ensure("keys in order", prev.empty() || prev < entry.first);
+            ensure("first appended entry wins", entry.second.asString() != "duplicate");
+            prev = entry.first;
+        }
+        ensure("same content as the copy",
+               std::equal(flat.begin(), flat.end(), copy.begin(), copy.end(),
+                          [](const auto& a, const auto& b)
+                          { return a.first == b.first && a.second.asString() == b.second.asString(); }));
+
+        // references to kept entries stay valid
+        const std::string key = llformat("key%05d", ((KEYS - 1) * 7919) % KEYS);
+        ensure("reference", &flat.find(key)->second == values.front());
+
+        // an LLSD map built out of order matches one built in order
+        LLSD built;
+        for (S32 i = 0; i < 100; ++i)
+        {
+            built.appendToMap(llformat("k%d", 99 - i), i);
+        }
+        built.sortMap();
+        LLSD expected;
+        for (S32 i = 0; i < 100; ++i)
+        {
+            expected[llformat("k%d", 99 - i)] = i;
+        }
+        ensure_equals("built map", built, expected);
+    }
+
+    template<> template<>
+    void SDTestObject::test<18>()
+        // incremental inserts into a large map against std::map; unlike the
+        // parsers' bulk path, each insert shifts the index, so this is the
+        // flat map's worst case. Timings are logged and never asserted.
+    {
+        const S32 KEYS = 20000;
+        std::vector<std::string> keys;
+        for (S32 i = 0; i < KEYS; ++i)
+        {
+            keys.push_back(llformat("key%06d", (S32)(((U64)i * 7919) % KEYS)));
+        }
+
+        LLTimer timer;
+        std::map<std::string, LLSD, std::less<>> tree;
+        for (S32 i = 0; i < KEYS; ++i)
+        {
+            tree.emplace(keys[i], LLSD(i));
+        }
+        F32 tree_random = timer.getElapsedTimeAndResetF32();
+
+        LLSD random;
+        for (S32 i = 0; i < KEYS; ++i)
+        {
+            random[keys[i]] = i;
+        }
+        F32 flat_random = timer.getElapsedTimeAndResetF32();
+
+        // every key sorts first: each insert shifts the whole index
+        LLSD reverse;
+        for (S32 i = KEYS - 1; i >= 0; --i)
+        {
+            reverse[llformat("key%06d", i)] = i;
+        }
+        F32 flat_reverse = timer.getElapsedTimeAndResetF32();
+
+        LLSD bulk;
+        for (S32 i = 0; i < KEYS; ++i)
+        {
+            bulk.appendToMap(keys[i], i);
+        }
+        bulk.sortMap();
+        F32 flat_bulk = timer.getElapsedTimeAndResetF32();
+
+        ensure_equals("random size", random.size(), KEYS);
+        ensure_equals("reverse size", reverse.size(), KEYS);
+        ensure_equals("same as bulk", random, bulk);
+        ensure("same order as std::map",
+               std::equal(tree.begin(), tree.end(), random.beginMap(), random.endMap(),
+                          [](const auto& a, const auto& b) { return a.first == b.first; }));
+
+        LL_INFOS() << "LLSD map, " << KEYS << " incremental inserts: "
+                   << "std::map " << tree_random << "s; LLSD random order " << flat_random
+                   << "s, reverse order " << flat_reverse << "s, bulk " << flat_bulk << "s"
+                   << LL_ENDL;
+    }
+
+    template<> template<>
+    void SDTestObject::test<19>()
+        // debug builds catch iterators used after their map changed
+    {
+#if LL_SDFLATMAP_CHECK_ITERATORS
+        LLSDFlatMap<LLSD> flat;
+        flat.emplace("b", LLSD(2));
+        LLSDFlatMap<LLSD>::iterator it = flat.find("b");
+        ensure_equals("found", it->second.asInteger(), 2);
+
+        // looking up an existing key changes nothing
+        flat.emplace("b", LLSD(3));
+        ensure_equals("still valid", it->second.asInteger(), 2);
+
+        flat.emplace("a", LLSD(1));
+        WrapLLErrs capture;
+        std::string threw = capture.catch_llerrs([&it]() { return it->second.asInteger(); });
+        ensure_contains("stale after insert", threw, "iterator used after its map was modified");
+
+        it = flat.find("a");
+        flat.erase("b");
+        threw = capture.catch_llerrs([&it, &flat]() { return it == flat.end(); });
+        ensure_contains("stale after erase", threw, "iterator used after its map was modified");
+#else
+        skip("iterator checks need SHOW_ASSERT");
+#endif
+    }
+
     /* TO DO:
         conversion of undefined to UUID, Date, URI and Binary
         conversion of undefined to map and array